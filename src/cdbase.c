@@ -51,6 +51,13 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include <assert.h>
 #include <ctype.h>
 #include <wchar.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
 #include "cdbase.h"
 #include "error.h"
 #include "debug.h"
@@ -101,6 +108,11 @@ static s32 ISOCDReadTOC(u32 *);
 static int ISOCDReadSectorFAD(u32, void *);
 static void ISOCDReadAheadFAD(u32);
 static void ISOCDSetStatus(int status);
+static int ISOCDReadSectorFADDirect(u32 FAD, void *buffer);
+static void ISOCDPrefetchStart(void);
+static void ISOCDPrefetchStop(void);
+static void ISOCDMapTracks(void);
+static void ISOCDUnmapTracks(void);
 
 CDInterface ISOCD = {
 CDCORE_ISO,
@@ -267,6 +279,8 @@ typedef struct
    u32 physframeofs;
    u32 chdframeofs;
    u32 logframeofs;
+   const u8 *map;       // Whole image file when mapped, shared by its tracks
+   size_t map_size;
 } track_info_struct;
 
 typedef struct
@@ -957,6 +971,8 @@ static int ISOCDInit(const char * iso) {
    }
 
    BuildTOC();
+   ISOCDMapTracks();
+   ISOCDPrefetchStart();
    return 0;
 }
 
@@ -964,6 +980,8 @@ static int ISOCDInit(const char * iso) {
 
 static void ISOCDDeInit(void) {
    int i, j, k;
+   ISOCDPrefetchStop();
+   ISOCDUnmapTracks();
    if (disc.session)
    {
       for (i = 0; i < disc.session_num; i++)
@@ -1022,7 +1040,160 @@ static s32 ISOCDReadTOC(u32 * TOC) {
 
 track_info_struct *currentTrack = NULL;
 
-static int ISOCDReadSectorFAD(u32 FAD, void *buffer) {
+static const u16 deint_offsets[] = {
+   0, 66, 125, 191, 100, 50, 150, 175, 8, 33, 58, 83,
+   108, 133, 158, 183, 16, 41, 25, 91, 116, 141, 166, 75,
+   24, 90, 149, 215, 124, 74, 174, 199, 32, 57, 82, 107,
+   132, 157, 182, 207, 40, 65, 49, 115, 140, 165, 190, 99,
+   48, 114, 173, 239, 148, 98, 198, 223, 56, 81, 106, 131,
+   156, 181, 206, 231, 64, 89, 73, 139, 164, 189, 214, 123,
+   72, 138, 197, 263, 172, 122, 222, 247, 80, 105, 130, 155,
+   180, 205, 230, 255, 88, 113, 97, 163, 188, 213, 238, 147
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_MMAP
+// Image files are mapped whole, a sector is then one memcpy out of the page
+// cache instead of an fseek and up to five freads.
+static void ISOCDMapTracks(void)
+{
+   int i, j, k, l;
+
+   for (i = 0; i < disc.session_num; i++)
+   {
+      for (j = 0; j < disc.session[i].track_num; j++)
+      {
+         track_info_struct *track = &disc.session[i].track[j];
+         struct stat st;
+         void *map;
+
+         if (track->fp == NULL || track->map != NULL)
+            continue;
+         if (fstat(fileno(track->fp), &st) != 0 || st.st_size == 0)
+            continue;
+         map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(track->fp), 0);
+         if (map == MAP_FAILED)
+         {
+            CDLOG("Warning: could not map track %d, using stdio\n", j + 1);
+            continue;
+         }
+         madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+         // Tracks of a single BIN share the mapping
+         for (k = i; k < disc.session_num; k++)
+         {
+            for (l = (k == i) ? j : 0; l < disc.session[k].track_num; l++)
+            {
+               if (disc.session[k].track[l].fp == track->fp)
+               {
+                  disc.session[k].track[l].map = map;
+                  disc.session[k].track[l].map_size = st.st_size;
+               }
+            }
+         }
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void ISOCDUnmapTracks(void)
+{
+   int i, j, k, l;
+
+   for (i = 0; i < disc.session_num; i++)
+   {
+      for (j = 0; j < disc.session[i].track_num; j++)
+      {
+         const u8 *map = disc.session[i].track[j].map;
+
+         if (map == NULL)
+            continue;
+         munmap((void *)map, disc.session[i].track[j].map_size);
+         for (k = i; k < disc.session_num; k++)
+         {
+            for (l = (k == i) ? j : 0; l < disc.session[k].track_num; l++)
+            {
+               if (disc.session[k].track[l].map == map)
+                  disc.session[k].track[l].map = NULL;
+            }
+         }
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int ISOCDReadSectorMapped(track_info_struct *track, u32 offset, u8 *buffer)
+{
+   const u8 *src = track->map + offset;
+   int i;
+
+   // Every byte of the buffer is written: what is past the end of the file
+   // reads as zeroes, like the fread path leaves it
+   switch (track->sector_size)
+   {
+      case 2448:
+         if (!track->interleaved_sub)
+         {
+            if (offset + 2448 <= track->map_size)
+               memcpy(buffer, src, 2448);
+            else
+               memset(buffer, 0, 2448);
+         }
+         else
+         {
+            // Data, then the three subcode packs spread over this sector and
+            // the next two
+            if (offset + 2352 <= track->map_size)
+               memcpy(buffer, src, 2352);
+            else
+               memset(buffer, 0, 2352);
+            for (i = 0; i < 96; i++)
+            {
+               u32 sub = deint_offsets[i];
+               u32 pos = offset + 2352 + (sub / 96) * 2448 + (sub % 96);
+               buffer[2352 + i] = (pos < track->map_size) ? track->map[pos] : 0;
+            }
+         }
+         break;
+      case 2352:
+         if (offset + 2352 <= track->map_size)
+            memcpy(buffer, src, 2352);
+         else
+            memset(buffer, 0, 2352);
+         memset(buffer + 2352, 0, 2448 - 2352);
+         break;
+      case 2048:
+         memcpy(buffer, syncHdr, 12);
+         memset(buffer + 12, 0, 4);
+         if (offset + 2048 <= track->map_size)
+            memcpy(buffer + 0x10, src, 2048);
+         else
+            memset(buffer + 0x10, 0, 2048);
+         memset(buffer + 0x810, 0, 2448 - 0x810);
+         break;
+      default:
+         memset(buffer, 0, 2448);
+         break;
+   }
+
+   return 1;
+}
+#else
+static void ISOCDMapTracks(void)
+{
+}
+
+static void ISOCDUnmapTracks(void)
+{
+}
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int ISOCDReadSectorFADDirect(u32 FAD, void *buffer) {
    int i,j;
    //size_t num_read = 0;
    int found = 0;
@@ -1034,8 +1205,6 @@ static int ISOCDReadSectorFAD(u32 FAD, void *buffer) {
      return ISOCDReadSectorFADFromCHD(FAD,buffer);
    }
 
-   memset(buffer, 0, 2448);
-
    for (i = 0; i < disc.session_num; i++)
    {
       for (j = 0; j < disc.session[i].track_num; j++)
@@ -1061,6 +1230,12 @@ static int ISOCDReadSectorFAD(u32 FAD, void *buffer) {
    }
    offset = currentTrack->file_offset + (FAD-currentTrack->fad_start) * currentTrack->sector_size;
 
+#ifdef HAVE_MMAP
+   if (currentTrack->map != NULL)
+      return ISOCDReadSectorMapped(currentTrack, offset, buffer);
+#endif
+
+   memset(buffer, 0, 2448);
    fseek(currentTrack->fp, offset, SEEK_SET);
 
    if (currentTrack->sector_size == 2448)
@@ -1071,16 +1246,6 @@ static int ISOCDReadSectorFAD(u32 FAD, void *buffer) {
       }
       else
       {
-         const u16 deint_offsets[] = {
-            0, 66, 125, 191, 100, 50, 150, 175, 8, 33, 58, 83,
-            108, 133, 158, 183, 16, 41, 25, 91, 116, 141, 166, 75,
-            24, 90, 149, 215, 124, 74, 174, 199, 32, 57, 82, 107,
-            132, 157, 182, 207, 40, 65, 49, 115, 140, 165, 190, 99,
-            48, 114, 173, 239, 148, 98, 198, 223, 56, 81, 106, 131,
-            156, 181, 206, 231, 64, 89, 73, 139, 164, 189, 214, 123,
-            72, 138, 197, 263, 172, 122, 222, 247, 80, 105, 130, 155,
-            180, 205, 230, 255, 88, 113, 97, 163, 188, 213, 238, 147
-         };
          u8 subcode_buffer[96 * 3];
 
          fread(buffer, 2352, 1, currentTrack->fp);
@@ -1109,13 +1274,215 @@ static int ISOCDReadSectorFAD(u32 FAD, void *buffer) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-static void ISOCDReadAheadFAD(UNUSED u32 FAD)
+// Read-ahead
+//
+// A worker thread keeps the sectors that follow the last FAD passed to
+// ReadAheadFAD decoded in a ring, so the sectors Cs2Exec reads while playing
+// are a copy instead of a wait on the SD/USB device. Only the worker writes
+// the ring and FADs ra_base to ra_fill - 1 are ready. Moving the window
+// anywhere but forward bumps ra_gen, which drops the sector being read.
+
+#define ISOCD_SECTOR_SIZE        2448
+#define ISOCD_PREFETCH_STACK     (32 * 1024)
+#define ISOCD_PREFETCH_PRIO      70
+
+static u32 ra_size = ISOCD_PREFETCH_DEFAULT;
+static u8 *ra_ring = NULL;
+static u32 ra_base;
+static u32 ra_fill;
+static u32 ra_end;
+static u32 ra_gen;
+static u32 ra_stall;
+static int ra_quit;
+static cd_prefetch_stats ra_stats;
+static lwp_t ra_thread = LWP_THREAD_NULL;
+static mutex_t ra_lock;      // Ring state and stats
+static mutex_t ra_io_lock;   // Image files, currentTrack and the CHD hunk
+static cond_t ra_cond;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void *ISOCDPrefetchThread(UNUSED void *arg)
+{
+   LWP_MutexLock(ra_lock);
+   while (!ra_quit)
+   {
+      u32 fad, gen;
+      u8 *slot;
+      int ret;
+
+      if (ra_fill > ra_end || ra_fill - ra_base >= ra_size || ra_stall == ra_gen)
+      {
+         LWP_CondWait(ra_cond, ra_lock);
+         continue;
+      }
+
+      fad = ra_fill;
+      gen = ra_gen;
+      slot = ra_ring + (fad % ra_size) * ISOCD_SECTOR_SIZE;
+      LWP_MutexUnlock(ra_lock);
+
+      LWP_MutexLock(ra_io_lock);
+      ret = ISOCDReadSectorFADDirect(fad, slot);
+      LWP_MutexUnlock(ra_io_lock);
+
+      LWP_MutexLock(ra_lock);
+      if (gen == ra_gen && fad == ra_fill)
+      {
+         if (ret)
+         {
+            ra_fill++;
+            ra_stats.prefetched++;
+         }
+         else
+            ra_stall = gen;
+      }
+   }
+   LWP_MutexUnlock(ra_lock);
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void ISOCDPrefetchStart(void)
+{
+   int i;
+
+   memset(&ra_stats, 0, sizeof(ra_stats));
+   if (ra_size == 0)
+      return;
+
+   ra_ring = malloc(ra_size * ISOCD_SECTOR_SIZE);
+   if (ra_ring == NULL)
+      return;
+
+   ra_end = 0;
+   for (i = 0; i < disc.session_num; i++)
+   {
+      if (disc.session[i].fad_end > ra_end)
+         ra_end = disc.session[i].fad_end;
+   }
+
+   // The first thing read is the IP, so start at the beginning of the disc
+   ra_base = ra_fill = 150;
+   ra_gen = 0;
+   ra_stall = 0xFFFFFFFF;
+   ra_quit = 0;
+
+   LWP_MutexInit(&ra_lock, false);
+   LWP_MutexInit(&ra_io_lock, false);
+   LWP_CondInit(&ra_cond);
+   if (LWP_CreateThread(&ra_thread, ISOCDPrefetchThread, NULL, NULL,
+                        ISOCD_PREFETCH_STACK, ISOCD_PREFETCH_PRIO) < 0)
+   {
+      CDLOG("Failed to start CD read-ahead thread\n");
+      ra_thread = LWP_THREAD_NULL;
+      LWP_CondDestroy(ra_cond);
+      LWP_MutexDestroy(ra_io_lock);
+      LWP_MutexDestroy(ra_lock);
+      free(ra_ring);
+      ra_ring = NULL;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void ISOCDPrefetchStop(void)
+{
+   if (ra_thread == LWP_THREAD_NULL)
+      return;
+
+   LWP_MutexLock(ra_lock);
+   ra_quit = 1;
+   LWP_CondSignal(ra_cond);
+   LWP_MutexUnlock(ra_lock);
+   LWP_JoinThread(ra_thread, NULL);
+   ra_thread = LWP_THREAD_NULL;
+
+   LWP_CondDestroy(ra_cond);
+   LWP_MutexDestroy(ra_io_lock);
+   LWP_MutexDestroy(ra_lock);
+   free(ra_ring);
+   ra_ring = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ISOCDSetPrefetch(u32 sectors)
+{
+   ra_size = sectors;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ISOCDGetPrefetchStats(cd_prefetch_stats *stats)
 {
-	// No-op
+   if (ra_thread != LWP_THREAD_NULL)
+      LWP_MutexLock(ra_lock);
+   *stats = ra_stats;
+   if (ra_thread != LWP_THREAD_NULL)
+      LWP_MutexUnlock(ra_lock);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
+static int ISOCDReadSectorFAD(u32 FAD, void *buffer) {
+   int ret;
+
+   if (ra_thread == LWP_THREAD_NULL)
+      return ISOCDReadSectorFADDirect(FAD, buffer);
+
+   LWP_MutexLock(ra_lock);
+   if (FAD >= ra_base && FAD < ra_fill)
+   {
+      memcpy(buffer, ra_ring + (FAD % ra_size) * ISOCD_SECTOR_SIZE, ISOCD_SECTOR_SIZE);
+      ra_stats.hits++;
+      LWP_MutexUnlock(ra_lock);
+      return 1;
+   }
+   ra_stats.misses++;
+   LWP_MutexUnlock(ra_lock);
+
+   LWP_MutexLock(ra_io_lock);
+   ret = ISOCDReadSectorFADDirect(FAD, buffer);
+   LWP_MutexUnlock(ra_io_lock);
+
+   return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void ISOCDReadAheadFAD(u32 FAD)
+{
+   if (ra_thread == LWP_THREAD_NULL)
+      return;
+
+   LWP_MutexLock(ra_lock);
+   if (FAD >= ra_base && FAD <= ra_fill)
+   {
+      // Playing on, the sectors before FAD are done with
+      if (FAD == ra_base)
+      {
+         LWP_MutexUnlock(ra_lock);
+         return;
+      }
+      ra_base = FAD;
+   }
+   else
+   {
+      // Seeked away, whatever was read ahead is lost
+      ra_stats.discarded += ra_fill - ra_base;
+      ra_base = ra_fill = FAD;
+      ra_gen++;
+   }
+   LWP_CondSignal(ra_cond);
+   LWP_MutexUnlock(ra_lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+#ifdef HAVE_LIBCHDR
 #include <libchdr/chd.h>
 
 #define CD_MAX_SECTOR_DATA      (2352)
@@ -1124,15 +1491,118 @@ static void ISOCDReadAheadFAD(UNUSED u32 FAD)
 #define CD_MAX_TRACKS           (99)    /* AFAIK the theoretical limit */
 #define CD_TRACK_PADDING 4
 
+// Decompressed hunks are kept in a small LRU cache, so reads that alternate
+// between two areas of the disc (streamed audio and file system lookups, say)
+// don't decode the same LZMA/zlib hunk again and again.
+typedef struct ChdHunk_ {
+  char * data;
+  int hunk_id;
+  u32 last_use;
+} ChdHunk;
+
 typedef struct ChdInfo_ {
   chd_file *chd;
   core_file * image_file;
   const chd_header * header;
-  char * hunk_buffer;
-  int current_hunk_id;
+  ChdHunk * hunks;
+  u32 hunk_num;
+  u32 hunk_clock;
 } ChdInfo;
 
 ChdInfo * pChdInfo = NULL;
+static u32 chd_cache_size = ISOCD_CHD_HUNKS_DEFAULT;
+static cd_hunk_stats chd_stats;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FreeCHD(void)
+{
+  u32 i;
+
+  if (pChdInfo == NULL)
+    return;
+
+  if (pChdInfo->hunks != NULL) {
+    for (i = 0; i < pChdInfo->hunk_num; i++)
+      free(pChdInfo->hunks[i].data);
+    free(pChdInfo->hunks);
+  }
+  chd_close(pChdInfo->chd);
+  free(pChdInfo);
+  pChdInfo = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int AllocCHDCache(void)
+{
+  u32 i;
+
+  memset(&chd_stats, 0, sizeof(chd_stats));
+  pChdInfo->hunk_num = chd_cache_size ? chd_cache_size : 1;
+  pChdInfo->hunk_clock = 0;
+  pChdInfo->hunks = calloc(pChdInfo->hunk_num, sizeof(ChdHunk));
+  if (pChdInfo->hunks == NULL)
+    return -1;
+
+  for (i = 0; i < pChdInfo->hunk_num; i++) {
+    pChdInfo->hunks[i].hunk_id = -1;
+    pChdInfo->hunks[i].data = malloc(pChdInfo->header->hunkbytes);
+    if (pChdInfo->hunks[i].data == NULL)
+      return -1;
+  }
+
+  return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static const char *GetCHDHunk(int hunkid)
+{
+  ChdHunk *hunk = &pChdInfo->hunks[0];
+  u32 i;
+
+  pChdInfo->hunk_clock++;
+  for (i = 0; i < pChdInfo->hunk_num; i++) {
+    if (pChdInfo->hunks[i].hunk_id == hunkid) {
+      pChdInfo->hunks[i].last_use = pChdInfo->hunk_clock;
+      chd_stats.hits++;
+      return pChdInfo->hunks[i].data;
+    }
+    if (pChdInfo->hunks[i].last_use < hunk->last_use)
+      hunk = &pChdInfo->hunks[i];
+  }
+
+  // Empty entries have never been used, so they go first
+  chd_stats.misses++;
+  if (chd_read(pChdInfo->chd, hunkid, hunk->data) != CHDERR_NONE) {
+    hunk->hunk_id = -1;
+    hunk->last_use = 0;
+    return NULL;
+  }
+  hunk->hunk_id = hunkid;
+  hunk->last_use = pChdInfo->hunk_clock;
+
+  return hunk->data;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ISOCDSetCHDCache(u32 hunks)
+{
+  chd_cache_size = hunks;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void ISOCDGetCHDCacheStats(cd_hunk_stats *stats)
+{
+  if (ra_thread != LWP_THREAD_NULL)
+    LWP_MutexLock(ra_io_lock);
+  *stats = chd_stats;
+  if (ra_thread != LWP_THREAD_NULL)
+    LWP_MutexUnlock(ra_io_lock);
+}
 
 int checkCHD(const char *filename ) {
 
@@ -1163,10 +1633,7 @@ static int LoadCHD(const char *chd_filename, FILE *iso_file)
   u32 resulttag;
   u8 resultflags;
 
-  if (pChdInfo != NULL) {
-	  chd_close(pChdInfo->chd);
-    free(pChdInfo);
-  }
+  FreeCHD();
 
   pChdInfo = malloc(sizeof(ChdInfo));
   memset(pChdInfo, 0, sizeof(ChdInfo));
@@ -1347,9 +1814,12 @@ static int LoadCHD(const char *chd_filename, FILE *iso_file)
 
   memcpy(disc.session[0].track, trk, num_tracks * sizeof(track_info_struct));
 
-  pChdInfo->hunk_buffer = malloc(pChdInfo->header->hunkbytes);
-  chd_read(pChdInfo->chd, 0, pChdInfo->hunk_buffer);
-  pChdInfo->current_hunk_id = 0;
+  if (AllocCHDCache() != 0)
+  {
+    YabSetError(YAB_ERR_MEMORYALLOC, NULL);
+    FreeCHD();
+    return -1;
+  }
 
   return 0;
 }
@@ -1395,15 +1865,17 @@ static int ISOCDReadSectorFADFromCHD(u32 FAD, void *buffer) {
   int hunkid = (chdlba*CD_FRAME_SIZE) / pChdInfo->header->hunkbytes ;
   int hunk_offset =  (chdlba*CD_FRAME_SIZE) % pChdInfo->header->hunkbytes;
 
-  if (pChdInfo->current_hunk_id != hunkid) {
-    chd_read(pChdInfo->chd, hunkid, pChdInfo->hunk_buffer);
-    pChdInfo->current_hunk_id = hunkid;
+  const char *hunk = GetCHDHunk(hunkid);
+  if (hunk == NULL)
+  {
+    CDLOG("Warning: failed to decompress hunk %d", hunkid);
+    return 0;
   }
 
   if (track->ctl_addr == 0x01) {
     for (int i = 0; i < track->sector_size; i += 2) {
-      ((char*)buffer)[i] = pChdInfo->hunk_buffer[hunk_offset + i + 1];
-      ((char*)buffer)[i+1] = pChdInfo->hunk_buffer[hunk_offset + i];
+      ((char*)buffer)[i] = hunk[hunk_offset + i + 1];
+      ((char*)buffer)[i+1] = hunk[hunk_offset + i];
     }
   }
   else {
@@ -1411,13 +1883,45 @@ static int ISOCDReadSectorFADFromCHD(u32 FAD, void *buffer) {
     if (track->sector_size == 2048)
     {
       memcpy(buffer, syncHdr, 12);
-      memcpy((char *)buffer + 0x10, pChdInfo->hunk_buffer + hunk_offset, track->sector_size);
+      memcpy((char *)buffer + 0x10, hunk + hunk_offset, track->sector_size);
     }
     else {
-      memcpy(buffer, pChdInfo->hunk_buffer + hunk_offset, track->sector_size);
+      memcpy(buffer, hunk + hunk_offset, track->sector_size);
     }
   }
 
   return 1;
 }
 
+#else
+
+//////////////////////////////////////////////////////////////////////////////
+
+// Built without libchdr (e.g. the host build), CHD images are refused
+
+int checkCHD(UNUSED const char *filename)
+{
+  return -1;
+}
+
+static int LoadCHD(UNUSED const char *chd_filename, UNUSED FILE *iso_file)
+{
+  YabSetError(YAB_ERR_OTHER, "CHD support not compiled in");
+  return -1;
+}
+
+static int ISOCDReadSectorFADFromCHD(UNUSED u32 FAD, UNUSED void *buffer)
+{
+  return 0;
+}
+
+void ISOCDSetCHDCache(UNUSED u32 hunks)
+{
+}
+
+void ISOCDGetCHDCacheStats(cd_hunk_stats *stats)
+{
+  memset(stats, 0, sizeof(cd_hunk_stats));
+}
+
+#endif
@@ -78,6 +78,34 @@ typedef struct
 
 extern CDInterface DummyCD;
 
+#define ISOCD_PREFETCH_DEFAULT 32
+
+typedef struct
+{
+        u32 hits;         // Sectors copied from the read-ahead ring
+        u32 misses;       // Sectors read from the image on the emulation thread
+        u32 prefetched;   // Sectors read by the read-ahead thread
+        u32 discarded;    // Prefetched sectors dropped by a seek
+} cd_prefetch_stats;
+
+// Number of sectors the ISO interface reads ahead of the drive, 0 turns the
+// read-ahead thread off. Takes effect on the next Init.
+void ISOCDSetPrefetch(u32 sectors);
+void ISOCDGetPrefetchStats(cd_prefetch_stats *stats);
+
+#define ISOCD_CHD_HUNKS_DEFAULT 8
+
+typedef struct
+{
+        u32 hits;         // Sectors found in an already decompressed hunk
+        u32 misses;       // Hunks decompressed
+} cd_hunk_stats;
+
+// Number of decompressed hunks kept for CHD images (at least 1). Takes
+// effect on the next Init.
+void ISOCDSetCHDCache(u32 hunks);
+void ISOCDGetCHDCacheStats(cd_hunk_stats *stats);
+
 extern CDInterface ISOCD;
 
 extern CDInterface ArchCD;
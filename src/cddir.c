@@ -0,0 +1,251 @@
+/*
+ * cddir.c
+ *--------------------
+ * ISO9660 directory cache. When a disc is mounted the tree is walked from the
+ * root in the primary volume descriptor and the records of every directory
+ * are copied as they are on the disc into one pool, so the CD block parses
+ * them exactly like sectors it read. Directories are found by the LBA of
+ * their first sector through a small hash, which is how the file system
+ * commands refer to them. A directory that can't be read is left out and
+ * the CD block falls back to reading it from the disc.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "cddir.h"
+
+#define CDDIR_HASH_SIZE		1024
+#define CDDIR_NONE			0xFFFFFFFF
+#define CDDIR_SLACK			256		//Bytes a bad name length can read past a record
+
+static cddir_dir *cddir_dirs = NULL;
+static u32 cddir_num_dirs = 0;
+static u32 *cddir_recs = NULL;		//Offset of every record in the pool
+static u32 cddir_num_recs = 0;
+static u32 cddir_max_recs = 0;
+static u8 *cddir_pool = NULL;
+static u32 cddir_pool_used = 0;
+static u32 cddir_pool_size = 0;
+static u32 cddir_hash[CDDIR_HASH_SIZE];
+static u8 cddir_sector[2448];
+static u8 cddir_empty[64];
+static cddir_stats cddir_st;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 cddir_Hash(u32 lba)
+{
+	return (lba * 2654435761u) >> 22;
+}
+
+static u32 cddir_ReadLE32(const u8 *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32) p[3] << 24);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void cddir_Clear(void)
+{
+	free(cddir_dirs);
+	free(cddir_recs);
+	free(cddir_pool);
+	cddir_dirs = NULL;
+	cddir_recs = NULL;
+	cddir_pool = NULL;
+	cddir_num_dirs = cddir_num_recs = cddir_max_recs = 0;
+	cddir_pool_used = cddir_pool_size = 0;
+	memset(cddir_hash, 0xFF, sizeof(cddir_hash));
+	memset(&cddir_st, 0, sizeof(cddir_st));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Queues a directory to be read unless it already is, the tree can loop
+static void cddir_AddDir(u32 lba, u32 size)
+{
+	u32 *link = &cddir_hash[cddir_Hash(lba)];
+
+	while (*link != CDDIR_NONE) {
+		if (cddir_dirs[*link].lba == lba) {
+			return;
+		}
+		link = &cddir_dirs[*link].next;
+	}
+	if (cddir_num_dirs >= CDDIR_MAX_DIRS) {
+		return;
+	}
+	cddir_dir *dir = &cddir_dirs[cddir_num_dirs];
+	dir->lba = lba;
+	dir->size = size;
+	dir->first = 0;
+	dir->count = 0;
+	dir->next = CDDIR_NONE;
+	*link = cddir_num_dirs++;
+}
+
+static u32 cddir_AddRecord(const u8 *rec, u32 len)
+{
+	if (cddir_num_recs >= cddir_max_recs) {
+		u32 max = cddir_max_recs ? cddir_max_recs << 1 : 1024;
+		u32 *recs = (u32 *) realloc(cddir_recs, max * sizeof(u32));
+		if (!recs) {
+			return 0;
+		}
+		cddir_recs = recs;
+		cddir_max_recs = max;
+	}
+	if (cddir_pool_used + len + CDDIR_SLACK > cddir_pool_size) {
+		u32 size = cddir_pool_size ? cddir_pool_size << 1 : 0x10000;
+		u8 *pool = (u8 *) realloc(cddir_pool, size);
+		if (!pool) {
+			return 0;
+		}
+		memset(pool + cddir_pool_size, 0, size - cddir_pool_size);
+		cddir_pool = pool;
+		cddir_pool_size = size;
+	}
+	memcpy(cddir_pool + cddir_pool_used, rec, len);
+	cddir_recs[cddir_num_recs++] = cddir_pool_used;
+	cddir_pool_used += len;
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 cddir_ReadDir(CDInterface *cdi, u32 indx)
+{
+	u32 lba = cddir_dirs[indx].lba;
+	u32 sectors = (cddir_dirs[indx].size + 2047) >> 11;
+	u32 first = cddir_num_recs;
+	u32 pool_used = cddir_pool_used;
+
+	if (sectors > CDDIR_MAX_SECTORS) {
+		sectors = CDDIR_MAX_SECTORS;
+	}
+	for (u32 s = 0; s < sectors; ++s) {
+		if (!cdi->ReadSectorFAD(lba + s + 150, cddir_sector)) {
+			goto fail;
+		}
+		cddir_st.sectors++;
+		//Mode 2 form 1 has the subheader before the user data
+		const u8 *data = cddir_sector + (cddir_sector[0xF] == 0x02 ? 24 : 16);
+		//Records never cross a sector, zeros pad the rest of it
+		for (u32 ofs = 0; ofs < 2048 && data[ofs] != 0; ofs += data[ofs]) {
+			const u8 *rec = data + ofs;
+			u32 len = rec[0];
+			if (len < 34 || ofs + len > 2048) {
+				break;
+			}
+			if (!cddir_AddRecord(rec, len)) {
+				goto fail;
+			}
+			//Subdirectories, but not . and ..
+			if ((rec[25] & 0x02) && !(rec[32] == 1 && rec[33] <= 1)) {
+				cddir_AddDir(cddir_ReadLE32(rec + 2), cddir_ReadLE32(rec + 10));
+			}
+		}
+	}
+	cddir_dirs[indx].first = first;
+	cddir_dirs[indx].count = cddir_num_recs - first;
+	return 1;
+
+fail:
+	cddir_num_recs = first;
+	cddir_pool_used = pool_used;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 cddir_Build(CDInterface *cdi)
+{
+	u64 start = gettime();
+
+	cddir_Clear();
+	//Primary volume descriptor
+	if (!cdi->ReadSectorFAD(166, cddir_sector)) {
+		return 0;
+	}
+	const u8 *pvd = cddir_sector + (cddir_sector[0xF] == 0x02 ? 24 : 16);
+	if (pvd[0] != 1 || memcmp(pvd + 1, "CD001", 5) != 0) {
+		return 0;
+	}
+	//Allocated whole so the list never moves while a directory is read
+	if ((cddir_dirs = (cddir_dir *) malloc(CDDIR_MAX_DIRS * sizeof(cddir_dir))) == NULL) {
+		return 0;
+	}
+	cddir_AddDir(cddir_ReadLE32(pvd + 0x9C + 2), cddir_ReadLE32(pvd + 0x9C + 10));
+
+	//The directory list is also the queue of directories left to read
+	u32 dirs = 0;
+	for (u32 i = 0; i < cddir_num_dirs; ++i) {
+		dirs += cddir_ReadDir(cdi, i);
+	}
+
+	//Give back what wasn't used
+	cddir_dir *dirs_fit = (cddir_dir *) realloc(cddir_dirs, cddir_num_dirs * sizeof(cddir_dir));
+	if (dirs_fit) {
+		cddir_dirs = dirs_fit;
+	}
+	if (cddir_num_recs) {
+		u32 *recs_fit = (u32 *) realloc(cddir_recs, cddir_num_recs * sizeof(u32));
+		if (recs_fit) {
+			cddir_recs = recs_fit;
+			cddir_max_recs = cddir_num_recs;
+		}
+		u8 *pool_fit = (u8 *) realloc(cddir_pool, cddir_pool_used + CDDIR_SLACK);
+		if (pool_fit) {
+			cddir_pool = pool_fit;
+			cddir_pool_size = cddir_pool_used + CDDIR_SLACK;
+		}
+	}
+
+	cddir_st.dirs = dirs;
+	cddir_st.records = cddir_num_recs;
+	cddir_st.bytes = cddir_num_dirs * sizeof(cddir_dir) + cddir_max_recs * sizeof(u32) +
+		cddir_pool_size;
+	cddir_st.build_ticks = gettime() - start;
+	return dirs;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const cddir_dir *cddir_Root(void)
+{
+	return (cddir_num_dirs && cddir_dirs[0].count) ? &cddir_dirs[0] : NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const cddir_dir *cddir_Find(u32 lba)
+{
+	if (!cddir_dirs) {
+		return NULL;
+	}
+	for (u32 i = cddir_hash[cddir_Hash(lba)]; i != CDDIR_NONE; i = cddir_dirs[i].next) {
+		if (cddir_dirs[i].lba == lba) {
+			return cddir_dirs[i].count ? &cddir_dirs[i] : NULL;
+		}
+	}
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u8 *cddir_Record(const cddir_dir *dir, u32 i)
+{
+	if (i >= dir->count) {
+		return cddir_empty;
+	}
+	return cddir_pool + cddir_recs[dir->first + i];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void cddir_GetStats(cddir_stats *stats)
+{
+	*stats = cddir_st;
+}
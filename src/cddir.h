@@ -0,0 +1,49 @@
+#ifndef __CDDIR_H__
+#define __CDDIR_H__
+
+/*
+ * cddir.h
+ *--------------------
+ * ISO9660 directory cache: the directory tree of the disc, read once when it
+ * is mounted so the CD block file system commands don't go to the disc
+ */
+
+#include "core.h"
+#include "cdbase.h"
+
+#define CDDIR_MAX_DIRS		4096	//Directories cached at most
+#define CDDIR_MAX_SECTORS	256		//Sectors read of a directory at most
+
+//A directory of the disc, its records are kept in disc order
+typedef struct {
+	u32 lba;				//First sector of the directory
+	u32 size;				//Bytes in the directory
+	u32 first;				//Index of its first record, . is always first
+	u32 count;				//Records, 0 until the directory is read
+	u32 next;				//Next directory in the same hash bucket
+} cddir_dir;
+
+typedef struct {
+	u32 dirs;
+	u32 records;
+	u32 bytes;				//Memory the cache takes
+	u32 sectors;			//Sectors read to build it
+	u64 build_ticks;
+} cddir_stats;
+
+//Reads the directory tree of the disc in cdi, replacing the cached one.
+//Returns the number of directories cached, 0 when the disc isn't ISO9660
+u32 cddir_Build(CDInterface *cdi);
+void cddir_Clear(void);
+//Root directory, NULL when nothing is cached
+const cddir_dir *cddir_Root(void);
+//Directory starting at lba, NULL when it isn't cached
+const cddir_dir *cddir_Find(u32 lba);
+//Raw ISO9660 record i of dir. Past the last one it returns an empty record,
+//like the zeros that pad a directory sector
+u8 *cddir_Record(const cddir_dir *dir, u32 i);
+
+void cddir_GetStats(cddir_stats *stats);
+
+
+#endif /*__CDDIR_H__*/
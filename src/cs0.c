@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include "cs0.h"
 #include "error.h"
+#include "state.h"
 #ifdef GEKKO
 #include "cs2.h"
 static char rom16mname[512];
@@ -1120,3 +1121,27 @@ void CartDeInit(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
+void CartAddState(void)
+{
+	if (CartridgeArea == NULL)
+		return;
+
+	if (CartridgeArea->bupram)
+		state_AddRegion("Cart-BUP", CartridgeArea->bupram, 0x40000 << CartridgeArea->carttype);
+
+	if (CartridgeArea->dram)
+		state_AddRegion("Cart-DRAM", CartridgeArea->dram,
+			CartridgeArea->carttype == CART_DRAM8MBIT ? 0x100000 : 0x400000);
+
+	if (CartridgeArea->carttype == CART_PAR) {
+		state_AddRegion("Cart-Flash0", flbuf0, sizeof(flbuf0));
+		state_AddRegion("Cart-Flash1", flbuf1, sizeof(flbuf1));
+		state_AddRegion("Cart-FlState0", &flstate0, sizeof(flstate0));
+		state_AddRegion("Cart-FlState1", &flstate1, sizeof(flstate1));
+		state_AddRegion("Cart-FlReg0", &flreg0, sizeof(flreg0));
+		state_AddRegion("Cart-FlReg1", &flreg1, sizeof(flreg1));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
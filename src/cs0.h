@@ -73,5 +73,6 @@ extern cartridge_struct *CartridgeArea;
 int CartInit(const char *filename, int);
 void CartFlush(void);
 void CartDeInit(void);
+void CartAddState(void);
 
 #endif
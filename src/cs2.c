@@ -44,6 +44,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
 #include <stdlib.h>
 #include <ctype.h>
 #include "cs2.h"
+#include "cddir.h"
 #include "debug.h"
 #include "error.h"
 #include "scsp.h"
@@ -100,6 +101,9 @@ enum CDB_DATATRANSTYPE
 Cs2 * Cs2Area = NULL;
 ip_struct *cdip = NULL;
 
+static u32 cs2_speed = CS2_SPEED_REAL;
+static cs2_read_stats cs2_stats;
+
 extern CDInterface *CDCoreList[];
 
 //////////////////////////////////////////////////////////////////////////////
@@ -336,7 +340,6 @@ void FASTCALL Cs2WriteWord(u32 addr, u16 val) {
 //////////////////////////////////////////////////////////////////////////////
 
 u32 FASTCALL Cs2ReadLong(u32 addr) {
-  s32 i;
   u32 val = 0;
   addr &= 0xFFFFF; // fix me(I should really have proper mapping)
 
@@ -379,13 +382,14 @@ u32 FASTCALL Cs2ReadLong(u32 addr) {
                      // Make sure we still have sectors to transfer
                      if (Cs2Area->datanumsecttrans < Cs2Area->datasectstotrans)
                      {
-                        const u8 *ptr = &Cs2Area->datatranspartition->block[Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans]->data[Cs2Area->datatransoffset];
-                        if (Cs2Area->datatranspartition->block[Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans] == NULL)
+                        const u8 *ptr = &Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans)->data[Cs2Area->datatransoffset];
+                        if (Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans) == NULL)
                         {
                            CDLOG("cs2\t: datatranspartition->block[Cs2Area->datanumsecttrans] was NULL");
                            return 0;
                         }
-                        val = *((const u32 *) ptr);
+                        val = T1ReadLong((u8 *) ptr, 0);
+                        cs2_stats.port_bytes += 4;
 
                         //LOG("[CS2] get addr = %d,val = %08X", Cs2Area->datatransoffset, val);
 
@@ -394,7 +398,7 @@ u32 FASTCALL Cs2ReadLong(u32 addr) {
                         Cs2Area->datatransoffset += 4;
 
                         // Make sure we're not beyond the sector size boundary
-						if (Cs2Area->datatransoffset >= Cs2Area->datatranspartition->block[Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans]->size)
+						if (Cs2Area->datatransoffset >= Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans)->size)
                         {
                            Cs2Area->datatransoffset = 0;
                            Cs2Area->datanumsecttrans++;
@@ -409,19 +413,8 @@ u32 FASTCALL Cs2ReadLong(u32 addr) {
 
                            Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
-                           // free blocks
-                           for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
-                           {
-                              Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-                              Cs2Area->datatranspartition->block[i] = NULL;
-                              Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-                           }
-
-                           // sort remaining blocks
-                           Cs2SortBlocks(Cs2Area->datatranspartition);
-
+                           Cs2PartitionDelete(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
                            Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-                           Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
                            CDLOG("cs2\t: datatranspartition->size = %x\n", Cs2Area->datatranspartition->size);
                         }
@@ -460,14 +453,14 @@ void FASTCALL Cs2WriteLong(UNUSED u32 addr, UNUSED u32 val) {
 
               if (offset >= 0) {
                 // Transfer Data
-                const u8 *ptr = &Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->data[offset];
+                const u8 *ptr = &Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans)->data[offset];
 
-                if (Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans] == NULL)
+                if (Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans) == NULL)
                 {
                   CDLOG("cs2\t: datatranspartition->block[Cs2Area->datanumsecttrans] was NULL");
                   return;
                 }
-                *((u32 *)ptr) = val;
+                T1WriteLong((u8 *) ptr, 0, val);
               }
 
                // increment datatransoffset/cdwnum
@@ -475,7 +468,7 @@ void FASTCALL Cs2WriteLong(UNUSED u32 addr, UNUSED u32 val) {
                Cs2Area->datatransoffset += 4;
 
                // Make sure we're not beyond the sector size boundary
-               if (Cs2Area->datatransoffset >= Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->size)
+               if (Cs2Area->datatransoffset >= Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans)->size)
                {
                   Cs2Area->datatransoffset = 0;
                   Cs2Area->datanumsecttrans++;
@@ -507,8 +500,8 @@ void FASTCALL Cs2RapidCopyT1(void *dest, u32 count)
 
       while (count > 0 && Cs2Area->datanumsecttrans < Cs2Area->datasectstotrans)
       {
-         const u8 *src = &Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->data[Cs2Area->datatransoffset];
-         const u32 size = Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->size;
+         const u8 *src = &Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans)->data[Cs2Area->datatransoffset];
+         const u32 size = Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans)->size;
          const u32 max = size - Cs2Area->datatransoffset;
          const u32 copy = (max < count*4) ? max : count*4;
          memcpy(dest8, src, copy);
@@ -530,21 +523,10 @@ void FASTCALL Cs2RapidCopyT1(void *dest, u32 count)
       if (Cs2Area->datatranstype == CDB_DATATRANSTYPE_GETDELSECTOR
        && Cs2Area->datanumsecttrans >= Cs2Area->datasectstotrans)
       {
-         u32 i;
-
          Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
-         for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
-         {
-            Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-            Cs2Area->datatranspartition->block[i] = NULL;
-            Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-         }
-
-         Cs2SortBlocks(Cs2Area->datatranspartition);
-
+         Cs2PartitionDelete(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
          Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-         Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
          CDLOG("cs2\t: datatranspartition->size = %x\n", Cs2Area->datatranspartition->size);
       }
@@ -574,8 +556,8 @@ void FASTCALL Cs2RapidCopyT2(void *dest, u32 count)
 
       while (count > 0 && Cs2Area->datanumsecttrans < Cs2Area->datasectstotrans)
       {
-         const u8 *src = &Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->data[Cs2Area->datatransoffset];
-         const u32 size = Cs2Area->datatranspartition->block[Cs2Area->datanumsecttrans]->size;
+         const u8 *src = &Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans)->data[Cs2Area->datatransoffset];
+         const u32 size = Cs2PartitionBlock(Cs2Area->datatranspartition, Cs2Area->datanumsecttrans)->size;
          const u32 max = size - Cs2Area->datatransoffset;
          const u32 copy = (max < count*4) ? max : count*4;
          u32 i = 0;
@@ -613,21 +595,10 @@ void FASTCALL Cs2RapidCopyT2(void *dest, u32 count)
       if (Cs2Area->datatranstype == CDB_DATATRANSTYPE_GETDELSECTOR
        && Cs2Area->datanumsecttrans >= Cs2Area->datasectstotrans)
       {
-         u32 i;
-
          Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
-         for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos+Cs2Area->datasectstotrans); i++)
-         {
-            Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-            Cs2Area->datatranspartition->block[i] = NULL;
-            Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-         }
-
-         Cs2SortBlocks(Cs2Area->datatranspartition);
-
+         Cs2PartitionDelete(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
          Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-         Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
          CDLOG("cs2\t: datatranspartition->size = %x\n", Cs2Area->datatranspartition->size);
       }
@@ -641,6 +612,62 @@ void FASTCALL Cs2RapidCopyT2(void *dest, u32 count)
 
 //////////////////////////////////////////////////////////////////////////////
 
+/* Bulk path for the DMA engines: when "src" is the data port and "dst" is a
+ * direct mapped page, copies up to "count" 32-bit words of sector data there
+ * as though 0x25818000 had been read that many times. Stops at the end of the
+ * sector data and at the end of the page. Returns the number of words copied,
+ * 0 when the words have to go through Cs2ReadLong. Code marks are left to
+ * the caller, like the DMA loops do for every other write. */
+
+u32 Cs2DataPortDma(u32 src, u32 dst, u32 count)
+{
+   const mem_page *page = &mem_write_page[MEM_GET_FUNC_ADDR(dst)];
+   u32 func = MEM_GET_FUNC_ADDR(src);
+   u32 ofs, room, words = 0;
+
+   if ((func != 0xB0 && func != 0xB1) || (src & 0xFFFFF) != 0x18000)
+      return 0;
+   if ((dst >> 29) > 1 || (dst & 3) || page->base == NULL)
+      return 0;
+   if (Cs2Area->datatranstype != CDB_DATATRANSTYPE_GETSECTOR &&
+       Cs2Area->datatranstype != CDB_DATATRANSTYPE_GETDELSECTOR)
+      return 0;
+
+   ofs = dst & page->mask;
+   room = mem_PageRoom(dst, page->mask) >> 2;
+   if (count > room)
+      count = room;
+
+   while (words < count && Cs2Area->datanumsecttrans < Cs2Area->datasectstotrans)
+   {
+      const block_struct *blk = Cs2PartitionBlock(Cs2Area->datatranspartition,
+                                  Cs2Area->datatranssectpos + Cs2Area->datanumsecttrans);
+      u32 left, copy;
+
+      if (blk == NULL)
+         break;
+      left = (blk->size - Cs2Area->datatransoffset + 3) >> 2;
+      copy = (left < count - words) ? left : count - words;
+      memcpy(page->base + ofs + (words << 2), &blk->data[Cs2Area->datatransoffset], copy << 2);
+      words += copy;
+
+      Cs2Area->cdwnum += copy << 2;
+      Cs2Area->datatransoffset += copy << 2;
+      if (Cs2Area->datatransoffset >= blk->size)
+      {
+         Cs2Area->datatransoffset = 0;
+         Cs2Area->datanumsecttrans++;
+      }
+   }
+
+   if (words && page->dirty)
+      mem_DirtyRange(page->dirty, ofs, words << 2);
+   cs2_stats.dma_bytes += words << 2;
+   return words;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int Cs2Init(int carttype, int coreid, const char *cdpath, const char *mpegpath, const char *modemip, const char *modemport) {
    int ret;
 
@@ -663,6 +690,8 @@ int Cs2Init(int carttype, int coreid, const char *cdpath, const char *mpegpath,
    if ((cdip = (ip_struct *) calloc(sizeof(ip_struct), 1)) == NULL)
       return -1;
 
+   memset(&cs2_stats, 0, sizeof(cs2_stats));
+
    return 0;
 }
 
@@ -707,6 +736,9 @@ int Cs2ChangeCDCore(int coreid, const char *cdpath)
       Cs2Area->cdi = &DummyCD;
    }
 
+   // Index the file system of the new disc
+   cddir_Build(Cs2Area->cdi);
+
    Cs2Area->isdiskchanged = 1;
    Cs2Area->status = CDB_STAT_PAUSE;
    SmpcRecheckRegion();
@@ -725,6 +757,7 @@ void Cs2DeInit(void) {
       free(Cs2Area);
    }
    Cs2Area = NULL;
+   cddir_Clear();
 
    if (cdip)
       free(cdip);
@@ -818,6 +851,7 @@ void Cs2Reset(void) {
   {
      Cs2Area->partition[i].size = -1;
      Cs2Area->partition[i].numblocks = 0;
+     Cs2Area->partition[i].head = 0;
 
      for (i2 = 0; i2 < MAX_BLOCKS; i2++)
      {
@@ -831,6 +865,7 @@ void Cs2Reset(void) {
   {
      Cs2Area->block[i].size = -1;
      memset(Cs2Area->block[i].data, 0, 2352);
+     Cs2Area->freeblock[i] = MAX_BLOCKS - 1 - i;
   }
 
   Cs2Area->blockfreespace = MAX_BLOCKS;
@@ -904,77 +939,9 @@ int Cs2ForceCloseTray( int coreid, const char * cdpath ){
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Cs2Exec(u32 timing) {
-   Cs2Area->_statuscycles += timing * 3;
-   Cs2Area->_periodiccycles += timing * 3;
-
-   // Command is not acceptable while other command is executing
-   if( Cs2Area->_command_execlock > 0  ){
-      Cs2Area->_command_execlock -= timing;
-      if (Cs2Area->_command_execlock <= 0) {
-        Cs2SetIRQ(Cs2Area->_delay_irq);
-      }
-   }
-   else {
-     if (Cs2Area->_commandtiming > 0)
-     {
-       if (Cs2Area->_commandtiming <= timing)
-       {
-         Cs2Execute();
-         Cs2Area->_commandtiming = 0;
-       }
-       else {
-         //printf("delay timing %d\n",Cs2Area->_commandtiming);
-         Cs2Area->_commandtiming -= timing;
-       }
-     }
-   }
-
-
-   if (Cs2Area->_statuscycles >= Cs2Area->_statustiming)
-   {
-
-      Cs2Area->_statuscycles -= Cs2Area->_statustiming;
-      switch(Cs2Area->cdi->GetStatus())
-      {
-         case 0:
-         case 1:
-            if ((Cs2Area->status & 0xF) == CDB_STAT_NODISC ||
-                (Cs2Area->status & 0xF) == CDB_STAT_OPEN)
-            {
-               Cs2Area->status = CDB_STAT_PAUSE;
-               Cs2Area->isdiskchanged = 1;
-            }
-            break;
-         case 2:
-            // may need to change this
-            if ((Cs2Area->status & 0xF) != CDB_STAT_NODISC)
-               Cs2Area->status = CDB_STAT_NODISC;
-            break;
-         case 3:
-            // may need to change this
-            if ((Cs2Area->status & 0xF) != CDB_STAT_OPEN)
-               Cs2Area->status = CDB_STAT_OPEN;
-            break;
-         default: break;
-      }
-   }
-
-   if (Cs2Area->_periodiccycles >= Cs2Area->_periodictiming)
-   {
-      Cs2Area->_periodiccycles -= Cs2Area->_periodictiming;
-	  if (Cs2Area->_periodictiming == SEEK_TIME){
-		  Cs2SetTiming(1);
-	  }
-
-      // Get Drive's current status and compare with old status
-      switch (Cs2Area->status & 0xF) {
-         case CDB_STAT_PAUSE:
-         {
-             break;
-         }
-         case CDB_STAT_PLAY:
-         {
+// Reads the sector at the play position into its partition and moves the
+// play position on, returns what Cs2ReadFilteredSector did
+static int Cs2PlaySector(void) {
             partition_struct * playpartition;
             int ret = Cs2ReadFilteredSector(Cs2Area->FAD, &playpartition);
 
@@ -996,6 +963,7 @@ void Cs2Exec(u32 timing) {
 
                      Cs2SetIRQ(CDB_HIRQ_CSCT);
                      Cs2Area->isonesectorstored = 1;
+                     cs2_stats.sectors++;
 
 					           if (Cs2Area->isbufferfull) {
 						           CDLOG("BUFFER IS FULL\n");
@@ -1068,6 +1036,93 @@ void Cs2Exec(u32 timing) {
                   break;
             }
 
+            return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Cs2Exec(u32 timing) {
+   Cs2Area->_statuscycles += timing * 3;
+   Cs2Area->_periodiccycles += timing * 3;
+
+   // Command is not acceptable while other command is executing
+   if( Cs2Area->_command_execlock > 0  ){
+      Cs2Area->_command_execlock -= timing;
+      if (Cs2Area->_command_execlock <= 0) {
+        Cs2SetIRQ(Cs2Area->_delay_irq);
+      }
+   }
+   else {
+     if (Cs2Area->_commandtiming > 0)
+     {
+       if (Cs2Area->_commandtiming <= timing)
+       {
+         Cs2Execute();
+         Cs2Area->_commandtiming = 0;
+       }
+       else {
+         //printf("delay timing %d\n",Cs2Area->_commandtiming);
+         Cs2Area->_commandtiming -= timing;
+       }
+     }
+   }
+
+
+   if (Cs2Area->_statuscycles >= Cs2Area->_statustiming)
+   {
+
+      Cs2Area->_statuscycles -= Cs2Area->_statustiming;
+      switch(Cs2Area->cdi->GetStatus())
+      {
+         case 0:
+         case 1:
+            if ((Cs2Area->status & 0xF) == CDB_STAT_NODISC ||
+                (Cs2Area->status & 0xF) == CDB_STAT_OPEN)
+            {
+               Cs2Area->status = CDB_STAT_PAUSE;
+               Cs2Area->isdiskchanged = 1;
+            }
+            break;
+         case 2:
+            // may need to change this
+            if ((Cs2Area->status & 0xF) != CDB_STAT_NODISC)
+               Cs2Area->status = CDB_STAT_NODISC;
+            break;
+         case 3:
+            // may need to change this
+            if ((Cs2Area->status & 0xF) != CDB_STAT_OPEN)
+               Cs2Area->status = CDB_STAT_OPEN;
+            break;
+         default: break;
+      }
+   }
+
+   if (Cs2Area->_periodiccycles >= Cs2Area->_periodictiming)
+   {
+      Cs2Area->_periodiccycles -= Cs2Area->_periodictiming;
+	  if (Cs2Area->_periodictiming == SEEK_TIME){
+		  Cs2SetTiming(1);
+	  }
+
+      // Get Drive's current status and compare with old status
+      switch (Cs2Area->status & 0xF) {
+         case CDB_STAT_PAUSE:
+         {
+             break;
+         }
+         case CDB_STAT_PLAY:
+         {
+            // Drain mode reads data until the buffer fills, one sector per
+            // period otherwise
+            u32 burst = (cs2_speed == CS2_SPEED_DRAIN) ? MAX_BLOCKS : 1;
+            u32 stored = cs2_stats.sectors;
+
+            while (Cs2PlaySector() == 0 && --burst && (Cs2Area->status & 0xF) == CDB_STAT_PLAY &&
+                   !Cs2Area->isaudio && !Cs2Area->speed1x)
+               ;
+            if (cs2_stats.sectors != stored)
+               cs2_stats.periods++;
+
             break;
          }
          case CDB_STAT_SEEK:
@@ -1141,6 +1196,8 @@ void Cs2SetTiming(int mode) {
   if (mode == 1) {
      if (Cs2Area->isaudio || Cs2Area->speed1x == 1)
         Cs2Area->_periodictiming = 40000;  // 13333.333... * 3
+     else if (cs2_speed > CS2_SPEED_REAL)
+        Cs2Area->_periodictiming = 20000 / cs2_speed;
      else
         Cs2Area->_periodictiming = 20000;  // 6666.666... * 3
   }
@@ -1155,6 +1212,26 @@ void Cs2SetTiming(int mode) {
 
 //////////////////////////////////////////////////////////////////////////////
 
+void Cs2SetFastLoad(u32 speed) {
+  if (speed > CS2_SPEED_MAX)
+     speed = CS2_SPEED_MAX;
+  cs2_speed = speed;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 Cs2GetFastLoad(void) {
+  return cs2_speed;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Cs2GetReadStats(cs2_read_stats *stats) {
+  *stats = cs2_stats;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void Cs2SetCommandTiming(u8 cmd) {
   switch(cmd) {
     case 0x02: // Cs2GetToc
@@ -1590,6 +1667,7 @@ void Cs2InitializeCDSystem(void) {
     {
       Cs2Area->partition[i].size = -1;
       Cs2Area->partition[i].numblocks = 0;
+      Cs2Area->partition[i].head = 0;
 
       for (i2 = 0; i2 < MAX_BLOCKS; i2++)
       {
@@ -1603,6 +1681,7 @@ void Cs2InitializeCDSystem(void) {
     {
       Cs2Area->block[i].size = -1;
       memset(Cs2Area->block[i].data, 0, 2352);
+      Cs2Area->freeblock[i] = MAX_BLOCKS - 1 - i;
     }
 
     Cs2Area->blockfreespace = MAX_BLOCKS;
@@ -1667,7 +1746,6 @@ void Cs2OpenTray(void)
 //////////////////////////////////////////////////////////////////////////////
 
 void Cs2EndDataTransfer(void) {
-  s32 i;
   if (Cs2Area->cdwnum)
   {
      Cs2Area->reg.CR1 = (u16)((Cs2Area->status << 8) | ((Cs2Area->cdwnum >> 17) & 0xFF));
@@ -1701,19 +1779,8 @@ void Cs2EndDataTransfer(void) {
 
         Cs2Area->datatranstype = CDB_DATATRANSTYPE_INVALID;
 
-        // free blocks
-        for (i = Cs2Area->datatranssectpos; i < (Cs2Area->datatranssectpos + Cs2Area->datasectstotrans); i++)
-        {
-           Cs2FreeBlock(Cs2Area->datatranspartition->block[i]);
-           Cs2Area->datatranspartition->block[i] = NULL;
-           Cs2Area->datatranspartition->blocknum[i] = 0xFF;
-        }
-
-        // sort remaining blocks
-        Cs2SortBlocks(Cs2Area->datatranspartition);
-
+        Cs2PartitionDelete(Cs2Area->datatranspartition, Cs2Area->datatranssectpos, Cs2Area->datasectstotrans);
         Cs2Area->datatranspartition->size -= Cs2Area->cdwnum;
-        Cs2Area->datatranspartition->numblocks -= Cs2Area->datasectstotrans;
 
         if (Cs2Area->blockfreespace == MAX_BLOCKS) Cs2Area->isonesectorstored = 0;
 
@@ -1837,6 +1904,8 @@ void Cs2PlayDisc(void) {
   if (Cs2Area->_periodictiming > (u32)SEEK_TIME) {
      Cs2Area->_periodictiming = (u32)SEEK_TIME;
   }
+  if (cs2_speed != CS2_SPEED_REAL)
+     Cs2Area->_periodictiming /= (cs2_speed == CS2_SPEED_DRAIN) ? CS2_SPEED_MAX : cs2_speed;
   CDLOG("cs2\t:Seek length = %0d - %d = %d/%d %d\n", (int)current_fad, (int)Cs2Area->FAD, length, SEEK_TIME, Cs2Area->_periodictiming );
 
   //Cs2Area->_periodictiming = SEEK_TIME;
@@ -2216,15 +2285,9 @@ void Cs2ResetSelector(void) {
      if (rsbufno < MAX_SELECTORS)
      {
         // clear partition
-        for (i = 0; i < Cs2Area->partition[rsbufno].numblocks; i++)
-        {
-           Cs2FreeBlock(Cs2Area->partition[rsbufno].block[i]);
-           Cs2Area->partition[rsbufno].block[i] = NULL;
-           Cs2Area->partition[rsbufno].blocknum[i] = 0xFF;
-        }
-
+        Cs2PartitionDelete(&Cs2Area->partition[rsbufno], 0, Cs2Area->partition[rsbufno].numblocks);
         Cs2Area->partition[rsbufno].size = -1;
-        Cs2Area->partition[rsbufno].numblocks = 0;
+        Cs2Area->partition[rsbufno].head = 0;
      }
 
      if (Cs2Area->blockfreespace > 0) Cs2Area->isbufferfull = 0;
@@ -2288,6 +2351,7 @@ void Cs2ResetSelector(void) {
      {
         Cs2Area->partition[i].size = -1;
         Cs2Area->partition[i].numblocks = 0;
+        Cs2Area->partition[i].head = 0;
 
         for (i2 = 0; i2 < MAX_BLOCKS; i2++)
         {
@@ -2301,6 +2365,7 @@ void Cs2ResetSelector(void) {
      {
         Cs2Area->block[i].size = -1;
         memset(Cs2Area->block[i].data, 0, 2352);
+        Cs2Area->freeblock[i] = MAX_BLOCKS - 1 - i;
      }
 
      Cs2Area->blockfreespace = 200;
@@ -2374,8 +2439,8 @@ void Cs2CalculateActualSize(void) {
 
      for (i = 0; i < casnumsect; i++)
      {
-        if (Cs2Area->partition[casbufno].block[cassectoffset])
-           Cs2Area->calcsize += (Cs2Area->partition[casbufno].block[cassectoffset]->size / 2);
+        if (Cs2PartitionBlock(&Cs2Area->partition[casbufno], cassectoffset))
+           Cs2Area->calcsize += (Cs2PartitionBlock(&Cs2Area->partition[casbufno], cassectoffset)->size / 2);
      }
   }
   else
@@ -2411,10 +2476,10 @@ void Cs2GetSectorInfo(void) {
   gsibufno = Cs2Area->reg.CR3 >> 8;
   if (gsibufno < MAX_SELECTORS) {
      if (gsisctnum < Cs2Area->partition[gsibufno].numblocks) {
-        Cs2Area->reg.CR1 = (u16)((Cs2Area->status << 8) | ((Cs2Area->partition[gsibufno].block[gsisctnum]->FAD >> 16) & 0xFF));
-        Cs2Area->reg.CR2 = (u16)Cs2Area->partition[gsibufno].block[gsisctnum]->FAD;
-        Cs2Area->reg.CR3 = (Cs2Area->partition[gsibufno].block[gsisctnum]->fn << 8) | Cs2Area->partition[gsibufno].block[gsisctnum]->cn;
-        Cs2Area->reg.CR4 = (Cs2Area->partition[gsibufno].block[gsisctnum]->sm << 8) | Cs2Area->partition[gsibufno].block[gsisctnum]->ci;
+        Cs2Area->reg.CR1 = (u16)((Cs2Area->status << 8) | ((Cs2PartitionBlock(&Cs2Area->partition[gsibufno], gsisctnum)->FAD >> 16) & 0xFF));
+        Cs2Area->reg.CR2 = (u16)Cs2PartitionBlock(&Cs2Area->partition[gsibufno], gsisctnum)->FAD;
+        Cs2Area->reg.CR3 = (Cs2PartitionBlock(&Cs2Area->partition[gsibufno], gsisctnum)->fn << 8) | Cs2PartitionBlock(&Cs2Area->partition[gsibufno], gsisctnum)->cn;
+        Cs2Area->reg.CR4 = (Cs2PartitionBlock(&Cs2Area->partition[gsibufno], gsisctnum)->sm << 8) | Cs2PartitionBlock(&Cs2Area->partition[gsibufno], gsisctnum)->ci;
         Cs2SetIRQ(CDB_HIRQ_CMOK | CDB_HIRQ_ESEL);
         return;
      }
@@ -2576,17 +2641,9 @@ void Cs2DeleteSectorData(void)
    CalcSectorOffsetNumber(dsdbufno, &dsdsectoffset, &dsdsectnum);
 
    for (i = dsdsectoffset; i < (dsdsectoffset+dsdsectnum); i++)
-   {
-      Cs2Area->partition[dsdbufno].size -= Cs2Area->partition[dsdbufno].block[i]->size;
-      Cs2FreeBlock(Cs2Area->partition[dsdbufno].block[i]);
-      Cs2Area->partition[dsdbufno].block[i] = NULL;
-      Cs2Area->partition[dsdbufno].blocknum[i] = 0xFF;
-   }
-
-   // sort remaining blocks
-   Cs2SortBlocks(&Cs2Area->partition[dsdbufno]);
+      Cs2Area->partition[dsdbufno].size -= Cs2PartitionBlock(&Cs2Area->partition[dsdbufno], i)->size;
 
-   Cs2Area->partition[dsdbufno].numblocks -= (u8)dsdsectnum;
+   Cs2PartitionDelete(&Cs2Area->partition[dsdbufno], dsdsectoffset, dsdsectnum);
 
    if (Cs2Area->blockfreespace == MAX_BLOCKS)
       Cs2Area->isonesectorstored = 0;
@@ -2668,8 +2725,8 @@ void Cs2PutSectorData(void) {
          int startpos = putpartition->numblocks;
          for (i = 0; i < psdsectnum; i++)
          {
-            putpartition->block[putpartition->numblocks] = Cs2AllocateBlock(&putpartition->blocknum[putpartition->numblocks], Cs2Area->putsectsize);
-            putpartition->block[putpartition->numblocks]->FAD = i;
+            Cs2PartitionBlock(putpartition, putpartition->numblocks) = Cs2AllocateBlock(&putpartition->blocknum[Cs2PartitionSlot(putpartition, putpartition->numblocks)], Cs2Area->putsectsize);
+            Cs2PartitionBlock(putpartition, putpartition->numblocks)->FAD = i;
             putpartition->numblocks++;
             putpartition->size += Cs2Area->putsectsize;
          }
@@ -2719,9 +2776,9 @@ void Cs2CopySectorData(void) {
   }
 
   for (int i = 0; i < count; i++) {
-    putpartition->block[putpartition->numblocks] = Cs2AllocateBlock(&putpartition->blocknum[putpartition->numblocks],2352);
-    u8 *dest_ptr =  putpartition->block[putpartition->numblocks]->data;
-    u8 *src_ptr = srcpartition->block[offset+i]->data;
+    Cs2PartitionBlock(putpartition, putpartition->numblocks) = Cs2AllocateBlock(&putpartition->blocknum[Cs2PartitionSlot(putpartition, putpartition->numblocks)],2352);
+    u8 *dest_ptr =  Cs2PartitionBlock(putpartition, putpartition->numblocks)->data;
+    u8 *src_ptr = Cs2PartitionBlock(srcpartition, offset+i)->data;
     memcpy(dest_ptr, src_ptr, sizeof(u8) * 2352);
     putpartition->numblocks++;
     putpartition->size += 2352;
@@ -2760,15 +2817,15 @@ void Cs2MoveSectorData(void) {
   }
 
   for (int i = 0; i < count; i++) {
-    putpartition->block[putpartition->numblocks] = srcpartition->block[offset + i];
-    srcpartition->numblocks--;
+    u32 slot = Cs2PartitionSlot(putpartition, putpartition->numblocks);
+    putpartition->block[slot] = Cs2PartitionBlock(srcpartition, offset + i);
+    putpartition->blocknum[slot] = srcpartition->blocknum[Cs2PartitionSlot(srcpartition, offset + i)];
     srcpartition->size -= 2352;
-    srcpartition->block[offset + i] = NULL;
     putpartition->numblocks++;
     putpartition->size += 2352;
   }
 
-  Cs2SortBlocks(&Cs2Area->partition[source]);
+  Cs2PartitionRemove(srcpartition, offset, count);
   doCDReport(Cs2Area->status);
   Cs2SetIRQ(CDB_HIRQ_CMOK | CDB_HIRQ_ECPY);
 }
@@ -3288,11 +3345,11 @@ void Cs2GetMPEGRom(void) {
 
         for (i = 0; i < readsize; i++)
         {
-           mpgpartition->block[mpgpartition->numblocks] = Cs2AllocateBlock(&mpgpartition->blocknum[mpgpartition->numblocks], Cs2Area->getsectsize);
+           Cs2PartitionBlock(mpgpartition, mpgpartition->numblocks) = Cs2AllocateBlock(&mpgpartition->blocknum[Cs2PartitionSlot(mpgpartition, mpgpartition->numblocks)], Cs2Area->getsectsize);
 
-           if (mpgpartition->block[mpgpartition->numblocks] != NULL) {
+           if (Cs2PartitionBlock(mpgpartition, mpgpartition->numblocks) != NULL) {
               // read data
-              yread(&check, (void *)mpgpartition->block[mpgpartition->numblocks]->data, 1, Cs2Area->getsectsize, mpgfp);
+              yread(&check, (void *)Cs2PartitionBlock(mpgpartition, mpgpartition->numblocks)->data, 1, Cs2Area->getsectsize, mpgfp);
 
               mpgpartition->numblocks++;
               mpgpartition->size += Cs2Area->getsectsize;
@@ -3377,23 +3434,21 @@ void Cs2SetupDefaultPlayStats(u8 track_number, int writeFAD) {
 
 block_struct * Cs2AllocateBlock(u8 * blocknum, s32 sectsize) {
   u32 i;
-  // find a free block
-  for(i = 0; i < MAX_BLOCKS; i++)
+
+  // take a free block off the stack
+  if (Cs2Area->blockfreespace > 0)
   {
-     if (Cs2Area->block[i].size == -1)
-     {
-        Cs2Area->blockfreespace--;
+     i = Cs2Area->freeblock[--Cs2Area->blockfreespace];
 
-		if (Cs2Area->blockfreespace <= 0) {
-			Cs2Area->isbufferfull = 1;
-      Cs2SetIRQ(CDB_HIRQ_BFUL);
-		}
+     if (Cs2Area->blockfreespace <= 0) {
+        Cs2Area->isbufferfull = 1;
+        Cs2SetIRQ(CDB_HIRQ_BFUL);
+     }
 
-        Cs2Area->block[i].size = sectsize;
+     Cs2Area->block[i].size = sectsize;
 
-        *blocknum = (u8)i;
-        return (Cs2Area->block + i);
-     }
+     *blocknum = (u8)i;
+     return (Cs2Area->block + i);
   }
 
   Cs2Area->isbufferfull = 1;
@@ -3404,32 +3459,60 @@ block_struct * Cs2AllocateBlock(u8 * blocknum, s32 sectsize) {
 //////////////////////////////////////////////////////////////////////////////
 
 void Cs2FreeBlock(block_struct * blk) {
-  if (blk == NULL) return;
+  if (blk == NULL || blk->size == -1) return;
   blk->size = -1;
-  Cs2Area->blockfreespace++;
+  Cs2Area->freeblock[Cs2Area->blockfreespace++] = (u8)(blk - Cs2Area->block);
   Cs2Area->isbufferfull = 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Cs2SortBlocks(partition_struct * part) {
-  unsigned int from, to;
+// Takes sectors out of a partition without freeing them. Sectors are almost
+// always taken from the front, which only moves the head; from anywhere else
+// the sectors after them are moved down.
+void Cs2PartitionRemove(partition_struct * part, u32 offset, u32 count) {
+  u32 i;
+
+  if (offset >= part->numblocks)
+     return;
+  if (count > part->numblocks - offset)
+     count = part->numblocks - offset;
 
-  for (from = to = 0; from < MAX_BLOCKS; from++)
+  if (offset == 0)
   {
-     if (part->block[from] != NULL)
+     for (i = 0; i < count; i++)
      {
-        if (to != from)
-        {
-           part->block[to] = part->block[from];
-        }
-        to++;
+        Cs2PartitionBlock(part, i) = NULL;
+        part->blocknum[Cs2PartitionSlot(part, i)] = 0xFF;
      }
+     part->head = (u8)Cs2PartitionSlot(part, count);
   }
-
-  for (; to < MAX_BLOCKS; to++) {
-      part->block[to] = NULL;
+  else
+  {
+     for (i = offset; i + count < part->numblocks; i++)
+     {
+        Cs2PartitionBlock(part, i) = Cs2PartitionBlock(part, i + count);
+        part->blocknum[Cs2PartitionSlot(part, i)] = part->blocknum[Cs2PartitionSlot(part, i + count)];
+     }
+     for (; i < part->numblocks; i++)
+     {
+        Cs2PartitionBlock(part, i) = NULL;
+        part->blocknum[Cs2PartitionSlot(part, i)] = 0xFF;
+     }
   }
+
+  part->numblocks -= (u8)count;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Cs2PartitionDelete(partition_struct * part, u32 offset, u32 count) {
+  u32 i;
+
+  for (i = offset; i < offset + count && i < part->numblocks; i++)
+     Cs2FreeBlock(Cs2PartitionBlock(part, i));
+
+  Cs2PartitionRemove(part, offset, count);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -3522,18 +3605,18 @@ partition_struct * Cs2FilterData(filter_struct * curfilter, int isaudio)
   }
 
   // Allocate block
-  fltpartition->block[fltpartition->numblocks] = Cs2AllocateBlock(&fltpartition->blocknum[fltpartition->numblocks], Cs2Area->getsectsize);
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks) = Cs2AllocateBlock(&fltpartition->blocknum[Cs2PartitionSlot(fltpartition, fltpartition->numblocks)], Cs2Area->getsectsize);
 
-  if (fltpartition->block[fltpartition->numblocks] == NULL)
+  if (Cs2PartitionBlock(fltpartition, fltpartition->numblocks) == NULL)
     return NULL;
 
   // Copy workblock settings to allocated block
-  fltpartition->block[fltpartition->numblocks]->size = Cs2Area->workblock.size;
-  fltpartition->block[fltpartition->numblocks]->FAD = Cs2Area->workblock.FAD;
-  fltpartition->block[fltpartition->numblocks]->cn = Cs2Area->workblock.cn;
-  fltpartition->block[fltpartition->numblocks]->fn = Cs2Area->workblock.fn;
-  fltpartition->block[fltpartition->numblocks]->sm = Cs2Area->workblock.sm;
-  fltpartition->block[fltpartition->numblocks]->ci = Cs2Area->workblock.ci;
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->size = Cs2Area->workblock.size;
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->FAD = Cs2Area->workblock.FAD;
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->cn = Cs2Area->workblock.cn;
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->fn = Cs2Area->workblock.fn;
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->sm = Cs2Area->workblock.sm;
+  Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->ci = Cs2Area->workblock.ci;
 
   // convert raw sector to type specified in getsectsize
   switch(Cs2Area->workblock.size)
@@ -3541,27 +3624,27 @@ partition_struct * Cs2FilterData(filter_struct * curfilter, int isaudio)
      case 2048: // user data only
                 if (Cs2Area->workblock.data[0xF] == 0x02)
                    // m2f1
-                   memcpy(fltpartition->block[fltpartition->numblocks]->data,
+                   memcpy(Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->data,
                           Cs2Area->workblock.data + 24, Cs2Area->workblock.size);
                 else
                    // m1
-                   memcpy(fltpartition->block[fltpartition->numblocks]->data,
+                   memcpy(Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->data,
                              Cs2Area->workblock.data + 16, Cs2Area->workblock.size);
                 break;
      case 2324: // m2f2 user data only
-                memcpy(fltpartition->block[fltpartition->numblocks]->data,
+                memcpy(Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->data,
                        Cs2Area->workblock.data + 24, Cs2Area->workblock.size);
                 break;
      case 2336: // m2f2 skip sync+header data
-                memcpy(fltpartition->block[fltpartition->numblocks]->data,
+                memcpy(Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->data,
                 Cs2Area->workblock.data + 16, Cs2Area->workblock.size);
                 break;
      case 2340: // m2f2 skip sync data
-                memcpy(fltpartition->block[fltpartition->numblocks]->data,
+                memcpy(Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->data,
                 Cs2Area->workblock.data + 12, Cs2Area->workblock.size);
                 break;
      case 2352: // Copy data as is
-                memcpy(fltpartition->block[fltpartition->numblocks]->data,
+                memcpy(Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->data,
                        Cs2Area->workblock.data, Cs2Area->workblock.size);
                 break;
      default: break;
@@ -3569,7 +3652,7 @@ partition_struct * Cs2FilterData(filter_struct * curfilter, int isaudio)
 
   // Modify Partition values
   if (fltpartition->size == -1) fltpartition->size = 0;
-  fltpartition->size += fltpartition->block[fltpartition->numblocks]->size;
+  fltpartition->size += Cs2PartitionBlock(fltpartition, fltpartition->numblocks)->size;
   fltpartition->numblocks++;
 
   return fltpartition;
@@ -3589,6 +3672,8 @@ int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec)
   memcpy(&dirrec->xarecordsize, buffer, sizeof(dirrec->xarecordsize));
   buffer += sizeof(dirrec->xarecordsize);
 
+  // Both byte orders are stored, little endian first
+#ifdef WORDS_BIGENDIAN
   buffer += sizeof(dirrec->lba);
   memcpy(&dirrec->lba, buffer, sizeof(dirrec->lba));
   buffer += sizeof(dirrec->lba);
@@ -3596,6 +3681,13 @@ int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec)
   buffer += sizeof(dirrec->size);
   memcpy(&dirrec->size, buffer, sizeof(dirrec->size));
   buffer += sizeof(dirrec->size);
+#else
+  memcpy(&dirrec->lba, buffer, sizeof(dirrec->lba));
+  buffer += sizeof(dirrec->lba) << 1;
+
+  memcpy(&dirrec->size, buffer, sizeof(dirrec->size));
+  buffer += sizeof(dirrec->size) << 1;
+#endif
 
   dirrec->dateyear = buffer[0];
   dirrec->datemonth = buffer[1];
@@ -3615,9 +3707,14 @@ int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec)
   dirrec->interleavegapsize = buffer[0];
   buffer += sizeof(dirrec->interleavegapsize);
 
+#ifdef WORDS_BIGENDIAN
   buffer += sizeof(dirrec->volumesequencenumber);
   memcpy(&dirrec->volumesequencenumber, buffer, sizeof(dirrec->volumesequencenumber));
   buffer += sizeof(dirrec->volumesequencenumber);
+#else
+  memcpy(&dirrec->volumesequencenumber, buffer, sizeof(dirrec->volumesequencenumber));
+  buffer += sizeof(dirrec->volumesequencenumber) << 1;
+#endif
 
   dirrec->namelength = buffer[0];
   buffer += sizeof(dirrec->namelength);
@@ -3635,13 +3732,13 @@ int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec)
 
   if ((dirrec->recordsize - (buffer - temp_pointer)) == 14)
   {
-     memcpy(&dirrec->xarecord.groupid, buffer, sizeof(dirrec->xarecord.groupid));
+     dirrec->xarecord.groupid = T1ReadWord(buffer, 0);
      buffer += sizeof(dirrec->xarecord.groupid);
 
-     memcpy(&dirrec->xarecord.userid, buffer, sizeof(dirrec->xarecord.userid));
+     dirrec->xarecord.userid = T1ReadWord(buffer, 0);
      buffer += sizeof(dirrec->xarecord.userid);
 
-     memcpy(&dirrec->xarecord.attributes, buffer, sizeof(dirrec->xarecord.attributes));
+     dirrec->xarecord.attributes = T1ReadWord(buffer, 0);
      buffer += sizeof(dirrec->xarecord.attributes);
 
      memcpy(&dirrec->xarecord.signature, buffer, sizeof(dirrec->xarecord.signature));
@@ -3659,11 +3756,59 @@ int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec)
 
 //////////////////////////////////////////////////////////////////////////////
 
+// Does what the sector walk in Cs2ReadFileSystem does, with the records of
+// the directory cache. The end of the directory reads as an empty record.
+static void Cs2ReadCachedDirectory(const cddir_dir *dir, u32 fid, int isoffset)
+{
+   u32 i;
+   u32 rec = 0;
+
+   memset(Cs2Area->fileinfo, 0, sizeof(dirrec_struct) * MAX_FILES);
+
+   // Fill in first two entries of fileinfo
+   for (i = 0; i < 2; i++)
+   {
+      Cs2CopyDirRecord(cddir_Record(dir, rec), Cs2Area->fileinfo + i);
+      Cs2Area->fileinfo[i].lba += 150;
+
+      if (++rec >= dir->count)
+      {
+         Cs2Area->numfiles = i;
+         break;
+      }
+   }
+
+   // Skip to the entry that matches fid
+   if (isoffset && fid > 2)
+   {
+      rec += fid - 2;
+      if (rec > dir->count)
+         rec = dir->count;
+   }
+
+   for (i = 2; i < MAX_FILES; i++)
+   {
+      Cs2CopyDirRecord(cddir_Record(dir, rec), Cs2Area->fileinfo + i);
+      Cs2Area->fileinfo[i].lba += 150;
+
+      if (rec < dir->count)
+         rec++;
+      if (rec >= dir->count)
+      {
+         Cs2Area->numfiles = i;
+         break;
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
 {
    u8 * workbuffer;
    u32 i;
    dirrec_struct dirrec;
+   const cddir_dir * cached;
    u8 numsectorsleft = 0;
    u32 curdirlba = 0;
    partition_struct * rfspartition;
@@ -3690,25 +3835,28 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
       if (fid == 0xFFFFFF)
       {
          // Figure out root directory's location
+         if ((cached = cddir_Root()) != NULL)
+         {
+            // Size Cs2ReadUnFilteredSector would give the sector 16 block
+            blocksectsize = Cs2Area->getsectsize;
+            dirrec.lba = cached->lba;
+            dirrec.size = cached->size;
+         }
+         else
+         {
+            // Read sector 16
+            if ((rfspartition = Cs2ReadUnFilteredSector(166)) == NULL)
+               return -2;
 
-         // Read sector 16
-         if ((rfspartition = Cs2ReadUnFilteredSector(166)) == NULL)
-            return -2;
-
-         blocksectsize = rfspartition->block[rfspartition->numblocks - 1]->size;
-
-         // Retrieve directory record's lba
-         Cs2CopyDirRecord(rfspartition->block[rfspartition->numblocks - 1]->data + 0x9C, &dirrec);
+            blocksectsize = Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->size;
 
-         // Free Block
-         rfspartition->size -= rfspartition->block[rfspartition->numblocks - 1]->size;
-         Cs2FreeBlock(rfspartition->block[rfspartition->numblocks - 1]);
-         rfspartition->block[rfspartition->numblocks - 1] = NULL;
-         rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
+            // Retrieve directory record's lba
+            Cs2CopyDirRecord(Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->data + 0x9C, &dirrec);
 
-         // Sort remaining blocks
-         Cs2SortBlocks(rfspartition);
-         rfspartition->numblocks -= 1;
+            // Free Block
+            rfspartition->size -= Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->size;
+            Cs2PartitionDelete(rfspartition, rfspartition->numblocks - 1, 1);
+         }
 
          curdirlba = Cs2Area->curdirsect = dirrec.lba;
          Cs2Area->curdirsize = (dirrec.size / blocksectsize) - 1;
@@ -3730,6 +3878,15 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
       }
    }
 
+   // Directories indexed when the disc was mounted don't touch the buffer
+   if ((cached = cddir_Find(curdirlba)) != NULL)
+   {
+      Cs2ReadCachedDirectory(cached, fid, isoffset);
+      cs2_stats.dir_cached++;
+      return 0;
+   }
+   cs2_stats.dir_read++;
+
    // Make sure any old records are cleared
    memset(Cs2Area->fileinfo, 0, sizeof(dirrec_struct) * MAX_FILES);
 
@@ -3738,7 +3895,7 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
       return -2;
 
    curdirlba++;
-   workbuffer = rfspartition->block[rfspartition->numblocks - 1]->data;
+   workbuffer = Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->data;
 
    // Fill in first two entries of fileinfo
    for (i = 0; i < 2; i++)
@@ -3768,14 +3925,8 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
             if (numsectorsleft > 0)
             {
                // Free previous read sector
-               rfspartition->size -= rfspartition->block[rfspartition->numblocks - 1]->size;
-               Cs2FreeBlock(rfspartition->block[rfspartition->numblocks - 1]);
-               rfspartition->block[rfspartition->numblocks - 1] = NULL;
-               rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
-
-               // Sort remaining blocks
-               Cs2SortBlocks(rfspartition);
-               rfspartition->numblocks -= 1;
+               rfspartition->size -= Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->size;
+               Cs2PartitionDelete(rfspartition, rfspartition->numblocks - 1, 1);
 
                // Read in next sector of directory record
                if ((rfspartition = Cs2ReadUnFilteredSector(curdirlba+150)) == NULL)
@@ -3784,7 +3935,7 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
                curdirlba++;
 
                numsectorsleft--;
-               workbuffer = rfspartition->block[rfspartition->numblocks - 1]->data;
+               workbuffer = Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->data;
             }
             else
             {
@@ -3807,14 +3958,8 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
          if (numsectorsleft > 0)
          {
             // Free previous read sector
-            rfspartition->size -= rfspartition->block[rfspartition->numblocks - 1]->size;
-            Cs2FreeBlock(rfspartition->block[rfspartition->numblocks - 1]);
-            rfspartition->block[rfspartition->numblocks - 1] = NULL;
-            rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
-
-            // Sort remaining blocks
-            Cs2SortBlocks(rfspartition);
-            rfspartition->numblocks -= 1;
+            rfspartition->size -= Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->size;
+            Cs2PartitionDelete(rfspartition, rfspartition->numblocks - 1, 1);
 
             // Read in next sector of directory record
             if ((rfspartition = Cs2ReadUnFilteredSector(curdirlba+150)) == NULL)
@@ -3822,7 +3967,7 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
 
             curdirlba++;
             numsectorsleft--;
-            workbuffer = rfspartition->block[rfspartition->numblocks - 1]->data;
+            workbuffer = Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->data;
          }
          else
          {
@@ -3833,14 +3978,8 @@ int Cs2ReadFileSystem(filter_struct * curfilter, u32 fid, int isoffset)
    }
 
    // Free the remaining sector
-   rfspartition->size -= rfspartition->block[rfspartition->numblocks - 1]->size;
-   Cs2FreeBlock(rfspartition->block[rfspartition->numblocks - 1]);
-   rfspartition->block[rfspartition->numblocks - 1] = NULL;
-   rfspartition->blocknum[rfspartition->numblocks - 1] = 0xFF;
-
-   // Sort remaining blocks
-   Cs2SortBlocks(rfspartition);
-   rfspartition->numblocks -= 1;
+   rfspartition->size -= Cs2PartitionBlock(rfspartition, rfspartition->numblocks - 1)->size;
+   Cs2PartitionDelete(rfspartition, rfspartition->numblocks - 1, 1);
 
 //#if CDDEBUG
 //  for (i = 0; i < MAX_FILES; i++)
@@ -3881,9 +4020,9 @@ partition_struct * Cs2ReadUnFilteredSector(u32 rufsFAD) {
   if ((rufspartition = Cs2GetPartition(Cs2Area->outconcddev)) != NULL && !Cs2Area->isbufferfull)
   {
      // Allocate Block
-     rufspartition->block[rufspartition->numblocks] = Cs2AllocateBlock(&rufspartition->blocknum[rufspartition->numblocks], Cs2Area->getsectsize);
+     Cs2PartitionBlock(rufspartition, rufspartition->numblocks) = Cs2AllocateBlock(&rufspartition->blocknum[Cs2PartitionSlot(rufspartition, rufspartition->numblocks)], Cs2Area->getsectsize);
 
-     if (rufspartition->block[rufspartition->numblocks] == NULL)
+     if (Cs2PartitionBlock(rufspartition, rufspartition->numblocks) == NULL)
         return NULL;
 
      // read a sector using cd interface function
@@ -3900,32 +4039,32 @@ partition_struct * Cs2ReadUnFilteredSector(u32 rufsFAD) {
                       if (!(Cs2Area->workblock.data[0x12] & 0x20))
                       {
                          // form 1
-                         memcpy(rufspartition->block[rufspartition->numblocks]->data,
+                         memcpy(Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->data,
                                 Cs2Area->workblock.data + 24, 2048);
                          Cs2Area->workblock.size = Cs2Area->getsectsize;
                       }
                       else
                       {
                          // form 2
-                         memcpy(rufspartition->block[rufspartition->numblocks]->data,
+                         memcpy(Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->data,
                                 Cs2Area->workblock.data + 24, 2324);
                          Cs2Area->workblock.size = 2324;
                       }
                    }
                    else
                    {
-                      memcpy(rufspartition->block[rufspartition->numblocks]->data,
+                      memcpy(Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->data,
                              Cs2Area->workblock.data + 16, 2048);
                       Cs2Area->workblock.size = Cs2Area->getsectsize;
                    }
                    break;
         case 2336: // skip sync+header data
-                   memcpy(rufspartition->block[rufspartition->numblocks]->data,
+                   memcpy(Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->data,
                    Cs2Area->workblock.data + 16, 2336);
                    Cs2Area->workblock.size = Cs2Area->getsectsize;
                    break;
         case 2340: // skip sync data
-                   memcpy(rufspartition->block[rufspartition->numblocks]->data,
+                   memcpy(Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->data,
                    Cs2Area->workblock.data + 12, 2340);
                    Cs2Area->workblock.size = Cs2Area->getsectsize;
                    break;
@@ -3939,17 +4078,17 @@ partition_struct * Cs2ReadUnFilteredSector(u32 rufsFAD) {
      if (memcmp(syncheader, Cs2Area->workblock.data, 12) == 0 &&
          Cs2Area->workblock.data[0xF] == 0x02)
      {
-        rufspartition->block[rufspartition->numblocks]->fn = Cs2Area->workblock.data[0x10];
-        rufspartition->block[rufspartition->numblocks]->cn = Cs2Area->workblock.data[0x11];
-        rufspartition->block[rufspartition->numblocks]->sm = Cs2Area->workblock.data[0x12];
-        rufspartition->block[rufspartition->numblocks]->ci = Cs2Area->workblock.data[0x13];
+        Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->fn = Cs2Area->workblock.data[0x10];
+        Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->cn = Cs2Area->workblock.data[0x11];
+        Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->sm = Cs2Area->workblock.data[0x12];
+        Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->ci = Cs2Area->workblock.data[0x13];
      }
 
      Cs2Area->workblock.FAD = rufsFAD;
 
      // Modify Partition values
      if (rufspartition->size == -1) rufspartition->size = 0;
-     rufspartition->size += rufspartition->block[rufspartition->numblocks]->size;
+     rufspartition->size += Cs2PartitionBlock(rufspartition, rufspartition->numblocks)->size;
      rufspartition->numblocks++;
 
      return rufspartition;
@@ -4055,7 +4194,7 @@ u8 Cs2GetIP(int autoregion) {
    if ((gripartition = Cs2ReadUnFilteredSector(150)) != NULL)
    {
 	   int i;
-      unsigned char *buf=(unsigned char*)gripartition->block[gripartition->numblocks - 1]->data;
+      unsigned char *buf=(unsigned char*)Cs2PartitionBlock(gripartition, gripartition->numblocks - 1)->data;
 
       // Make sure we're dealing with a saturn game
       if (memcmp(buf, "SEGA SEGASATURN", 15) == 0)
@@ -4083,11 +4222,11 @@ u8 Cs2GetIP(int autoregion) {
          sscanf((const char*) buf + 0x50, "%s", cdip->peripheral);
          memcpy(cdip->gamename, buf+0x60, 112);
          cdip->gamename[112]='\0';
-         memcpy(&cdip->ipsize, buf+0xE0, sizeof(u32));
-         memcpy(&cdip->msh2stack, buf+0xE8, sizeof(u32));
-         memcpy(&cdip->ssh2stack, buf+0xEC, sizeof(u32));
-         memcpy(&cdip->firstprogaddr, buf+0xF0, sizeof(u32));
-         memcpy(&cdip->firstprogsize, buf+0xF4, sizeof(u32));
+         cdip->ipsize = T1ReadLong(buf, 0xE0);
+         cdip->msh2stack = T1ReadLong(buf, 0xE8);
+         cdip->ssh2stack = T1ReadLong(buf, 0xEC);
+         cdip->firstprogaddr = T1ReadLong(buf, 0xF0);
+         cdip->firstprogsize = T1ReadLong(buf, 0xF4);
 
          if (autoregion)
          {
@@ -4124,14 +4263,8 @@ u8 Cs2GetIP(int autoregion) {
       }
 
       // Free Block
-      gripartition->size -= gripartition->block[gripartition->numblocks - 1]->size;
-      Cs2FreeBlock(gripartition->block[gripartition->numblocks - 1]);
-      gripartition->block[gripartition->numblocks - 1] = NULL;
-      gripartition->blocknum[gripartition->numblocks - 1] = 0xFF;
-
-      // Sort remaining blocks
-      Cs2SortBlocks(gripartition);
-      gripartition->numblocks -= 1;
+      gripartition->size -= Cs2PartitionBlock(gripartition, gripartition->numblocks - 1)->size;
+      Cs2PartitionDelete(gripartition, gripartition->numblocks - 1, 1);
    }
 
    return ret;
@@ -4215,20 +4348,27 @@ int Cs2SaveState(FILE * fp) {
    // Write CD buffer
    ywrite(&check, (void *)Cs2Area->block, sizeof(block_struct), MAX_BLOCKS, fp);
 
-   // Write partition data
+   // Write partition data, the rings are written from their head so the
+   // format stays the same
    for (i = 0; i < MAX_SELECTORS; i++)
    {
-      ywrite(&check, (void *)&Cs2Area->partition[i].size, 4, 1, fp);
-      ywrite(&check, (void *)Cs2Area->partition[i].blocknum, 1, MAX_BLOCKS, fp);
-      ywrite(&check, (void *)&Cs2Area->partition[i].numblocks, 1, 1, fp);
+      partition_struct *part = &Cs2Area->partition[i];
+      u8 blocknum[MAX_BLOCKS];
+
+      for (i2 = 0; i2 < MAX_BLOCKS; i2++)
+        blocknum[i2] = part->blocknum[Cs2PartitionSlot(part, i2)];
+
+      ywrite(&check, (void *)&part->size, 4, 1, fp);
+      ywrite(&check, (void *)blocknum, 1, MAX_BLOCKS, fp);
+      ywrite(&check, (void *)&part->numblocks, 1, 1, fp);
 
       u32 index = 0;
       for (i2 = 0; i2 < MAX_BLOCKS; i2++)
       {
-        if (Cs2Area->partition[i].block[i2] == NULL)
+        if (Cs2PartitionBlock(part, i2) == NULL)
           index = 0xFFFFFFFF;
         else
-          index = Cs2Area->partition[i].block[i2] - Cs2Area->block;
+          index = Cs2PartitionBlock(part, i2) - Cs2Area->block;
         ywrite(&check, &index, 4, 1, fp);
       }
    }
@@ -4378,6 +4518,15 @@ int Cs2LoadState(FILE * fp, int version, int size) {
           Cs2Area->partition[i].block[i2] = Cs2Area->block + index;
         }
       }
+      Cs2Area->partition[i].head = 0;
+   }
+
+   // Rebuild the free block stack
+   Cs2Area->blockfreespace = 0;
+   for (i = MAX_BLOCKS - 1; i >= 0; i--)
+   {
+      if (Cs2Area->block[i].size == -1)
+         Cs2Area->freeblock[Cs2Area->blockfreespace++] = (u8)i;
    }
 
    // Read filter data
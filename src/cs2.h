@@ -52,6 +52,10 @@ extern "C" {
 #define MAX_SELECTORS   24
 #define MAX_FILES       256
 
+#define CS2_SPEED_DRAIN 0   // Data sectors as fast as the buffer drains
+#define CS2_SPEED_REAL  1   // Drive timing of the real hardware
+#define CS2_SPEED_MAX   16
+
   typedef struct
   {
     s32 size;
@@ -81,9 +85,10 @@ extern "C" {
   typedef struct
   {
     s32 size;
-    block_struct *block[MAX_BLOCKS];
+    block_struct *block[MAX_BLOCKS];   // Ring of sectors, the oldest at head
     u8 blocknum[MAX_BLOCKS];
     u8 numblocks;
+    u8 head;
   } partition_struct;
 
   typedef struct
@@ -219,6 +224,7 @@ extern "C" {
     u16 datasectstotrans;
 
     u32 blockfreespace;
+    u8 freeblock[MAX_BLOCKS];   // Stack of free blocks, blockfreespace deep
     block_struct block[MAX_BLOCKS];
     struct
     {
@@ -288,6 +294,23 @@ extern "C" {
     u64 gameid;
   } ip_struct;
 
+  typedef struct {
+    u32 sectors;    // Sectors stored in the buffer by the drive
+    u32 periods;    // Drive periods that stored at least one
+    u32 port_bytes; // Sector data read from the data port a long at a time
+    u32 dma_bytes;  // Sector data copied in bulk by Cs2DataPortDma
+    u32 dir_cached; // Directories the file system commands took from cddir
+    u32 dir_read;   // Directories they had to read from the disc
+  } cs2_read_stats;
+
+  // Slot in the ring of a partition's sector i, counting from the oldest
+  static INLINE u32 Cs2PartitionSlot(const partition_struct * part, u32 i) {
+    i += part->head;
+    return (i >= MAX_BLOCKS) ? i - MAX_BLOCKS : i;
+  }
+
+#define Cs2PartitionBlock(part, i)  ((part)->block[Cs2PartitionSlot((part), (i))])
+
   extern Cs2 * Cs2Area;
   extern ip_struct * cdip;
 
@@ -304,6 +327,7 @@ extern "C" {
 
   void FASTCALL   Cs2RapidCopyT1(void *dest, u32 count);
   void FASTCALL   Cs2RapidCopyT2(void *dest, u32 count);
+  u32 Cs2DataPortDma(u32 src, u32 dst, u32 count);
 
   void Cs2Exec(u32);
   int Cs2GetTimeToNextSector(void);
@@ -312,6 +336,13 @@ extern "C" {
   void Cs2SetTiming(int);
   void Cs2Command(void);
   void Cs2SetCommandTiming(u8 cmd);
+  // Speed of data reads and seeks: CS2_SPEED_REAL, an N times multiplier up
+  // to CS2_SPEED_MAX, or CS2_SPEED_DRAIN to read until the buffer is full on
+  // every drive period. Audio tracks and reads the game asked to run at 1x
+  // keep the drive timing.
+  void Cs2SetFastLoad(u32 speed);
+  u32 Cs2GetFastLoad(void);
+  void Cs2GetReadStats(cs2_read_stats *stats);
 
   //   command name                             command code
   void Cs2GetStatus(void);                   // 0x00
@@ -397,7 +428,8 @@ extern "C" {
   void Cs2SetupDefaultPlayStats(u8 track_number, int writeFAD);
   block_struct * Cs2AllocateBlock(u8 * blocknum, s32 sectsize);
   void Cs2FreeBlock(block_struct * blk);
-  void Cs2SortBlocks(partition_struct * part);
+  void Cs2PartitionRemove(partition_struct * part, u32 offset, u32 count);
+  void Cs2PartitionDelete(partition_struct * part, u32 offset, u32 count);
   partition_struct * Cs2GetPartition(filter_struct * curfilter);
   partition_struct * Cs2FilterData(filter_struct * curfilter, int isaudio);
   int Cs2CopyDirRecord(u8 * buffer, dirrec_struct * dirrec);
@@ -0,0 +1,528 @@
+/*
+ * bench.c
+ *--------------------
+ * setagx-bench: headless runner for the host build. Boots a BIOS and a disc
+ * image, runs a fixed number of frames through YabauseEmulate and reports the
+ * achieved frame rate and the time spent in each subsystem (the same split the
+ * OSD cycle bars show on the Wii).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "host.h"
+#include "lockstep.h"
+#include "swizzle_bench.h"
+#include "tlut_bench.h"
+#include "cdbuf_bench.h"
+#include "../yabause.h"
+#include "../yui.h"
+#include "../cs2.h"
+#include "../cdbase.h"
+#include "../cddir.h"
+#include "../scsp.h"
+#include "../m68kcore.h"
+#include "../memory.h"
+#include "../state.h"
+#include "../vidsoft.h"
+#include "../vdp1soft.h"
+#include "../vdp2soft.h"
+#include "../vdp2list.h"
+#include "../vdp1batch.h"
+#include "../pace.h"
+#include "../osd/osd.h"
+
+extern int declinenum;
+
+static const char *cycle_names[OSD_CYCLES_NUM] = {
+	"MSH2", "SSH2", "SCU", "SMPC", "CDB", "VDP1/VDP2", "SCSP"
+};
+
+static const char *layer_names[VDP2SOFT_LAYER_NUM] = {
+	"NBG0", "NBG1", "NBG2", "NBG3", "RBG0", "compose"
+};
+
+
+static void bench_Usage(const char *prog)
+{
+	printf("usage: %s -b BIOS -i IMAGE [options]\n"
+		"  -b FILE    BIOS image (omit to use the emulated BIOS)\n"
+		"  -i FILE    disc image (ISO, CUE or CHD)\n"
+		"  -n N       frames to time (default 600)\n"
+		"  -w N       warm-up frames run before timing (default 0)\n"
+		"  -s N       SH2 core id (0 interpreter, 2 block interpreter, 3 dynarec)\n"
+		"  -l N       run SH2 core N in lockstep with the interpreter once the\n"
+		"             warm-up frames are done, stop on the first divergence\n"
+		"  -g N       lockstep granularity in cycles (0 whole SH2Exec slices,\n"
+		"             1 every instruction, default 0)\n"
+		"  -r N       CD read-ahead in sectors (0 off, default %d)\n"
+		"  -c N       decompressed CHD hunks kept (default %d)\n"
+		"  -k N       save a snapshot every N frames, then restore the last one\n"
+		"             and check that replaying reaches the same state\n"
+		"  -z N       check the texture swizzlers and time N rounds of each,\n"
+		"             no image needed\n"
+		"  -u         check that the CRAM palette block uploads land where a\n"
+		"             full upload puts them, no image needed\n"
+		"  -v N       render VDP2 in software on N scanline bands and report\n"
+		"             frame hashes and per-layer throughput\n"
+		"  -o FILE    write the last software VDP2 frame as PPM (implies -v 1)\n"
+		"  -d N       rasterise VDP1 in software on N scanline bands and report\n"
+		"             framebuffer hashes and throughput\n"
+		"  -x N       walk the NBG scroll screens into the GX stub, 0 immediately,\n"
+		"             1 through the VDP2 display lists, and report the stream\n"
+		"  -p N       frame pacing, 0 real time, 1 on the audio queue, 2 as fast\n"
+		"             as possible (default)\n"
+		"  -f         skip drawing frames that run late (needs -p 0 or 1)\n"
+		"  -q N       stream N sectors through the CD block buffer and time\n"
+		"             the bookkeeping\n"
+		"  -cd N      CD drive speed, 1 real (default), N times or 0 as fast\n"
+		"             as the buffer drains\n"
+		"  -t         run the SCSP and the 68K on their own thread\n"
+		"  -pal       run as a PAL machine\n"
+		"  -h         this help\n", prog, ISOCD_PREFETCH_DEFAULT,
+		ISOCD_CHD_HUNKS_DEFAULT);
+}
+
+
+static int bench_SavePPM(const char *path)
+{
+	u32 w, h;
+	const u32 *frame = vdp2soft_GetFrame(&w, &h);
+	FILE *fp = fopen(path, "wb");
+
+	if (fp == NULL) {
+		return -1;
+	}
+	fprintf(fp, "P6\n%u %u\n255\n", w, h);
+	for (u32 y = 0; y < h; ++y) {
+		for (u32 x = 0; x < w; ++x) {
+			u32 c = frame[y * VDP2SOFT_MAX_W + x];
+			u8 rgb[3] = {c >> 16, c >> 8, c};
+			fwrite(rgb, 1, 3, fp);
+		}
+	}
+	fclose(fp);
+	return 0;
+}
+
+
+//Smallest bin holding at least pct percent of the frames counted in hist
+static u32 bench_HistPercentile(const u32 *hist, u32 total, u32 pct)
+{
+	u64 need = ((u64) total * pct + 99) / 100;
+	u64 sum = 0;
+	for (u32 b = 0; b < PACE_HIST_BINS; ++b) {
+		sum += hist[b];
+		if (sum >= need && sum) {
+			return b;
+		}
+	}
+	return PACE_HIST_BINS - 1;
+}
+
+
+//FNV-1a of a memory area, to compare what two builds left in RAM
+static u32 bench_Hash(const u8 *mem, u32 size)
+{
+	u32 hash = 2166136261u;
+	for (u32 i = 0; i < size; ++i) {
+		hash = (hash ^ mem[i]) * 16777619u;
+	}
+	return hash;
+}
+
+
+static int bench_Arg(int argc, char **argv, int *i)
+{
+	if (*i + 1 >= argc) {
+		fprintf(stderr, "missing value for %s\n", argv[*i]);
+		exit(1);
+	}
+	return atoi(argv[++(*i)]);
+}
+
+
+int main(int argc, char **argv)
+{
+	yabauseinit_struct yinit;
+	const char *biospath = NULL;
+	const char *isopath = NULL;
+	u32 frames = 600;
+	u32 warmup = 0;
+	int sh2core = SH2CORE_INTERPRETER;
+	int pal = 0;
+	int lockstep = -1;
+	u32 granularity = 0;
+	u32 snapevery = 0;
+	u32 bands = 0;
+	u32 vdp1bands = 0;
+	int gxlists = -1;
+	u32 pacemode = PACE_UNCAPPED;
+	u32 frameskip = 0;
+	int cdspeed = -1;
+	u32 cdbuf = 0;
+	int threads = 0;
+	const char *ppmpath = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+			biospath = argv[++i];
+		} else if (!strcmp(argv[i], "-i") && i + 1 < argc) {
+			isopath = argv[++i];
+		} else if (!strcmp(argv[i], "-n")) {
+			frames = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-w")) {
+			warmup = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-s")) {
+			sh2core = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-l")) {
+			lockstep = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-g")) {
+			granularity = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-r")) {
+			ISOCDSetPrefetch(bench_Arg(argc, argv, &i));
+		} else if (!strcmp(argv[i], "-c")) {
+			ISOCDSetCHDCache(bench_Arg(argc, argv, &i));
+		} else if (!strcmp(argv[i], "-k")) {
+			snapevery = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-z")) {
+			return swizzle_Bench(bench_Arg(argc, argv, &i)) ? 2 : 0;
+		} else if (!strcmp(argv[i], "-u")) {
+			return tlut_Bench() ? 2 : 0;
+		} else if (!strcmp(argv[i], "-v")) {
+			bands = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-d")) {
+			vdp1bands = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-x")) {
+			gxlists = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+			ppmpath = argv[++i];
+		} else if (!strcmp(argv[i], "-p")) {
+			pacemode = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-q")) {
+			cdbuf = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-cd")) {
+			cdspeed = bench_Arg(argc, argv, &i);
+		} else if (!strcmp(argv[i], "-f")) {
+			frameskip = 1;
+		} else if (!strcmp(argv[i], "-t")) {
+			threads = 1;
+		} else if (!strcmp(argv[i], "-pal")) {
+			pal = 1;
+		} else {
+			bench_Usage(argv[0]);
+			return strcmp(argv[i], "-h") ? 1 : 0;
+		}
+	}
+
+	if (!isopath) {
+		bench_Usage(argv[0]);
+		return 1;
+	}
+
+	//The boot up to the end of the warm-up is replayed on the interpreter alone,
+	//so a divergence is reproduced by running again with the same -w
+	if (lockstep >= 0) {
+		if (lockstep_Setup(lockstep, granularity) != 0) {
+			fprintf(stderr, "unknown SH2 core %d\n", lockstep);
+			return 1;
+		}
+		sh2core = SH2CORE_LOCKSTEP;
+	}
+
+	//Same timing settings the Wii frontend starts with
+	declinenum = 10;
+
+	if (ppmpath && !bands) {
+		bands = 1;
+	}
+	if (bands && vdp2soft_Init(bands) != 0) {
+		fprintf(stderr, "can't allocate the software VDP2 frame\n");
+		return 1;
+	}
+	if (vdp1bands && vdp1soft_Init(vdp1bands) != 0) {
+		fprintf(stderr, "can't allocate the software VDP1 draw list\n");
+		return 1;
+	}
+	if (gxlists >= 0) {
+		host_gx_mode = HOST_GX_IMMEDIATE;
+		if (gxlists) {
+			if (vdp2list_Init() != 0) {
+				fprintf(stderr, "can't allocate the VDP2 display lists\n");
+				return 1;
+			}
+			host_gx_mode = HOST_GX_LISTS;
+		}
+	}
+
+	mem_allocate();
+	mem_Init();
+
+	memset(&yinit, 0, sizeof(yabauseinit_struct));
+	yinit.sh2coretype = sh2core;
+	yinit.vidcoretype = VIDCORE_SOFT;
+	yinit.scspcoretype = SCSCORE_SCSP2;
+	yinit.sndcoretype = 0;
+	yinit.cdcoretype = CDCORE_ISO;
+	yinit.m68kcoretype = M68KCORE_C68K;
+	yinit.carttype = 0;
+	yinit.regionid = REGION_AUTODETECT;
+	yinit.biospath = biospath;
+	yinit.cdpath = isopath;
+	yinit.buppath = NULL;
+	yinit.videoformattype = pal;
+	yinit.usethreads = threads;
+
+	if (cdspeed >= 0) {
+		Cs2SetFastLoad(cdspeed);
+	}
+	if (YabauseInit(&yinit) != 0) {
+		fprintf(stderr, "YabauseInit failed\n");
+		return 1;
+	}
+	if (cdbuf) {
+		int ret = cdbuf_Bench(cdbuf);
+		YabauseDeInit();
+		return ret ? 2 : 0;
+	}
+	ScspSetFrameAccurate(1);
+	YabauseSetDecilineMode(1);
+	pace_SetMode(pacemode);
+	pace_SetFrameskip(frameskip);
+
+	for (u32 i = 0; i < warmup; ++i) {
+		YabauseEmulate();
+	}
+
+	lockstep_Enable(lockstep >= 0);
+
+	state_snapshot *snap = NULL;
+	state_stats snapstats;
+	u32 snapframe = 0;
+	u64 snapticks = 0;
+	u64 snapcopied = 0;
+	if (snapevery) {
+		snap = state_Create();
+		if (snap == NULL) {
+			fprintf(stderr, "snapshots are not supported with this setup\n");
+			return 1;
+		}
+		state_Save(snap);
+	}
+
+	vram_dirty_stats vram0 = vram_stats;
+	u64 totals[OSD_CYCLES_NUM] = {0};
+	vdp2soft_stats soft0;
+	vdp2soft_GetStats(&soft0);
+	vdp1soft_stats vdp1soft0;
+	vdp1soft_GetStats(&vdp1soft0);
+	host_gx_stats gx0 = host_gx;
+	vdp2list_stats lists0;
+	vdp2list_GetStats(&lists0);
+	vdp1batch_stats batch0;
+	vdp1batch_GetStats(&batch0);
+	pace_stats pace0;
+	pace_GetStats(&pace0);
+	cs2_read_stats cd0, cd;
+	Cs2GetReadStats(&cd0);
+	u32 cdsectors = cd0.sectors;
+	u32 cdlast = 0;
+	u32 runhash = 2166136261u;
+	u32 vdp1hash = 2166136261u;
+	u64 start = gettime();
+	for (u32 i = 0; i < frames; ++i) {
+		host_CyclesReset();
+		YabauseEmulate();
+		for (u32 j = 0; j < OSD_CYCLES_NUM; ++j) {
+			totals[j] += host_cycles[j];
+		}
+		Cs2GetReadStats(&cd);
+		if (cd.sectors != cdsectors) {
+			cdsectors = cd.sectors;
+			cdlast = i + 1;
+		}
+		if (bands) {
+			runhash = (runhash ^ vdp2soft_Hash()) * 16777619u;
+		}
+		if (vdp1bands) {
+			vdp1hash = (vdp1hash ^ vdp1soft_Hash()) * 16777619u;
+		}
+		if (snap && (i + 1) % snapevery == 0) {
+			u64 t = gettime();
+			state_Save(snap);
+			snapticks += gettime() - t;
+			state_GetStats(snap, &snapstats);
+			snapcopied += snapstats.copied;
+			snapframe = i + 1;
+		}
+		if (lockstep_Diverged()) {
+			printf("lockstep: stopped in frame %u\n", warmup + i);
+			state_Free(snap);
+			YabauseDeInit();
+			return 2;
+		}
+	}
+	u64 elapsed = gettime() - start;
+
+	f64 secs = (f64) elapsed / (f64) secs_to_ticks(1);
+	f64 fps = secs > 0.0 ? frames / secs : 0.0;
+	f64 target = yabsys.IsPal ? 50.0 : (60.0 / 1.001);
+
+	printf("image:    %s\n", isopath);
+	printf("bios:     %s\n", biospath ? biospath : "(emulated)");
+	printf("frames:   %u (+%u warm-up)\n", frames, warmup);
+	printf("time:     %.3f s\n", secs);
+	printf("fps:      %.2f (%.1f%% of %.2f)\n", fps, fps * 100.0 / target, target);
+	pace_stats pace;
+	pace_GetStats(&pace);
+	u32 hist[PACE_HIST_BINS];
+	u32 shown = 0;
+	for (u32 b = 0; b < PACE_HIST_BINS; ++b) {
+		hist[b] = pace.hist[b] - pace0.hist[b];
+		shown += hist[b];
+	}
+	printf("pacing:   %s, %u skipped, waited %u times for %.1f ms, frame time p50 %u ms, p99 %u ms\n",
+		pace_GetMode() == PACE_UNCAPPED ? "uncapped" :
+		pace_GetMode() == PACE_AUDIO ? "audio queue" : "real time", pace.skipped - pace0.skipped,
+		pace.waited - pace0.waited,
+		(f64) (pace.wait_ticks - pace0.wait_ticks) / (f64) millisecs_to_ticks(1),
+		bench_HistPercentile(hist, shown, 50), bench_HistPercentile(hist, shown, 99));
+	printf("\n%-10s %12s %12s %7s\n", "subsystem", "total ms", "ms/frame", "share");
+	for (u32 j = 0; j < OSD_CYCLES_NUM; ++j) {
+		f64 ms = (f64) totals[j] / (f64) millisecs_to_ticks(1);
+		printf("%-10s %12.2f %12.4f %6.1f%%\n", cycle_names[j], ms,
+			frames ? ms / frames : 0.0, elapsed ? (totals[j] * 100.0) / elapsed : 0.0);
+	}
+	f64 nframes = frames ? (f64) frames : 1.0;
+	printf("\nvram pages:    %.1f VDP1 and %.1f VDP2 flushed per frame, textures kept %u of %u frames\n",
+		(vram_stats.vdp1_flushed - vram0.vdp1_flushed) / nframes,
+		(vram_stats.vdp2_flushed - vram0.vdp2_flushed) / nframes,
+		vram_stats.tex_kept - vram0.tex_kept, frames);
+	printf("vdp1 cmdlist:  decoded %u times in %u frames\n",
+		vram_stats.cmd_built - vram0.cmd_built, frames);
+	cd_prefetch_stats cdra;
+	ISOCDGetPrefetchStats(&cdra);
+	printf("cd read-ahead: %u hits, %u misses, %u prefetched, %u discarded\n",
+		cdra.hits, cdra.misses, cdra.prefetched, cdra.discarded);
+	printf("cd drive:      %u sectors stored in %u periods, the last in frame %u\n",
+		cd.sectors - cd0.sectors, cd.periods - cd0.periods, cdlast);
+	printf("cd transfer:   %.1f KB read from the data port, %.1f KB copied by DMA\n",
+		(cd.port_bytes - cd0.port_bytes) / 1024.0, (cd.dma_bytes - cd0.dma_bytes) / 1024.0);
+	cddir_stats dirs;
+	cddir_GetStats(&dirs);
+	printf("cd directory:  %u directories, %u records cached in %u KB, built in %llu us\n",
+		dirs.dirs, dirs.records, dirs.bytes >> 10, (unsigned long long) ticks_to_microsecs(dirs.build_ticks));
+	printf("cd file cmds:  %u directories from the cache, %u read from the disc\n",
+		cd.dir_cached - cd0.dir_cached, cd.dir_read - cd0.dir_read);
+	printf("memory:        work RAM %08x, VDP1 RAM %08x, VDP2 RAM %08x\n",
+		bench_Hash(wram, WRAM_SIZE), bench_Hash(Vdp1Ram, 0x80000), bench_Hash(Vdp2Ram, 0x80000));
+	if (SCSCore->Sync) {
+		SCSCore->Sync();
+	}
+	printf("scsp:          %s, sound RAM %08x\n", yabsys.UseThreads ? "threaded" : "inline",
+		bench_Hash(SoundRam, 0x80000));
+	cd_hunk_stats chd;
+	ISOCDGetCHDCacheStats(&chd);
+	if (chd.hits || chd.misses) {
+		printf("chd hunks:     %u hits, %u decompressed\n", chd.hits, chd.misses);
+	}
+	if (bands) {
+		vdp2soft_stats soft;
+		u32 w, h;
+		vdp2soft_GetStats(&soft);
+		vdp2soft_GetFrame(&w, &h);
+		u32 softframes = soft.frames - soft0.frames;
+		printf("\nvdp2 soft:     %u bands, %u frames drawn, last %ux%u hash %08x, run hash %08x\n",
+			bands, softframes, w, h, vdp2soft_Hash(), runhash);
+		printf("%-10s %12s %12s\n", "layer", "Mpixels/s", "ms/frame");
+		for (u32 j = 0; j < VDP2SOFT_LAYER_NUM; ++j) {
+			u64 pixels = soft.pixels[j] - soft0.pixels[j];
+			f64 lsecs = (f64) (soft.ticks[j] - soft0.ticks[j]) / (f64) secs_to_ticks(1);
+			if (!pixels) {
+				continue;
+			}
+			printf("%-10s %12.1f %12.4f\n", layer_names[j], lsecs > 0.0 ? pixels / (lsecs * 1000000.0) : 0.0,
+				softframes ? lsecs * 1000.0 / softframes : 0.0);
+		}
+		if (ppmpath && bench_SavePPM(ppmpath) != 0) {
+			fprintf(stderr, "can't write %s\n", ppmpath);
+		}
+	}
+	if (vdp1bands) {
+		vdp1soft_stats soft;
+		vdp1soft_GetStats(&soft);
+		u32 softframes = soft.frames - vdp1soft0.frames;
+		f64 fdiv = softframes ? (f64) softframes : 1.0;
+		f64 rsecs = (f64) (soft.raster_ticks - vdp1soft0.raster_ticks) / (f64) secs_to_ticks(1);
+		u64 pixels = soft.pixels - vdp1soft0.pixels;
+		printf("\nvdp1 soft:     %u bands, %u lists drawn, last hash %08x, run hash %08x\n",
+			vdp1bands, softframes, vdp1soft_Hash(), vdp1hash);
+		printf("vdp1 soft:     %.1f ops and %.0f pixels per list, %.1f%% of band passes culled\n",
+			(soft.ops - vdp1soft0.ops) / fdiv, pixels / fdiv,
+			soft.ops > vdp1soft0.ops ? (soft.culled - vdp1soft0.culled) * 100.0 /
+				((f64) (soft.ops - vdp1soft0.ops) * vdp1bands) : 0.0);
+		printf("vdp1 soft:     parse %.4f ms, rasterise %.4f ms per list, %.1f Mpixels/s\n",
+			(soft.parse_ticks - vdp1soft0.parse_ticks) / fdiv / (f64) millisecs_to_ticks(1),
+			rsecs * 1000.0 / fdiv, rsecs > 0.0 ? pixels / (rsecs * 1000000.0) : 0.0);
+	}
+	if (gxlists >= 0) {
+		vdp2list_stats lists;
+		vdp2list_GetStats(&lists);
+		printf("\ngx stream:     hash %08x, %.0f quads written and %.1f KB sent per frame\n",
+			host_gx.hash, (host_gx.quads - gx0.quads) / nframes,
+			(host_gx.bytes - gx0.bytes) / nframes / 1024.0);
+		vdp1batch_stats batch;
+		vdp1batch_GetStats(&batch);
+		f64 lists_drawn = batch.frames > batch0.frames ? (f64) (batch.frames - batch0.frames) : 1.0;
+		printf("vdp1 batches:  %.1f per list for %.1f primitives, %.1f state changes\n",
+			(batch.batches - batch0.batches) / lists_drawn, (batch.prims - batch0.prims) / lists_drawn,
+			(batch.states - batch0.states) / lists_drawn);
+		if (gxlists) {
+			printf("vdp2 lists:    %u called, %u recorded, %u overflowed, dropped %u on settings and %u on VRAM\n",
+				lists.called - lists0.called, lists.recorded - lists0.recorded,
+				lists.overflows - lists0.overflows, lists.stale_key - lists0.stale_key,
+				lists.stale_vram - lists0.stale_vram);
+		}
+	}
+	if (snap) {
+		//Replaying from the last snapshot must land on the state just reached
+		state_snapshot *end = state_Create();
+		if (end == NULL) {
+			fprintf(stderr, "can't allocate the end snapshot\n");
+			state_Free(snap);
+			YabauseDeInit();
+			return 1;
+		}
+		state_Save(end);
+		state_Load(snap);
+		for (u32 i = snapframe; i < frames; ++i) {
+			YabauseEmulate();
+		}
+		state_Save(snap);
+		const char *diff = state_Compare(snap, end);
+		state_Free(end);
+
+		state_GetStats(snap, &snapstats);
+		u64 saves = snapstats.saves - 2;
+		printf("\nsnapshots:     %llu saves, %.1f of %u pages and %.3f ms each\n",
+			(unsigned long long) saves, saves ? (f64) snapcopied / saves : 0.0, snapstats.pages,
+			saves ? (f64) snapticks / saves / (f64) millisecs_to_ticks(1) : 0.0);
+		state_Free(snap);
+		if (diff) {
+			printf("snapshots:     replay of %u frames differs in %s\n", frames - snapframe, diff);
+			YabauseDeInit();
+			return 2;
+		}
+		printf("snapshots:     replay of %u frames matched\n", frames - snapframe);
+	}
+	if (lockstep >= 0) {
+		printf("\nlockstep: %llu steps matched\n", (unsigned long long) lockstep_Steps());
+	}
+
+	YabauseDeInit();
+	vdp2soft_DeInit();
+	vdp1soft_DeInit();
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * cdbuf_bench.c
+ *--------------------
+ * setagx-bench -q: streams sectors through a CD block partition the way a
+ * game reading with Get Then Delete Sector Data does. The partition is kept
+ * nearly full, where finding a free block and dropping the oldest sector cost
+ * the most, and every sector taken off the front is checked to be the oldest.
+ */
+
+#include <stdio.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "cdbuf_bench.h"
+#include "../cs2.h"
+
+#define BENCH_DEPTH		(MAX_BLOCKS - 8)	//Sectors kept in the partition
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int cdbuf_Store(partition_struct *part, u32 fad)
+{
+	u32 slot = Cs2PartitionSlot(part, part->numblocks);
+	block_struct *blk = Cs2AllocateBlock(&part->blocknum[slot], 2048);
+
+	if (blk == NULL) {
+		return -1;
+	}
+	blk->FAD = fad;
+	part->block[slot] = blk;
+	part->numblocks++;
+	part->size += 2048;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int cdbuf_Bench(u32 sectors)
+{
+	partition_struct *part = &Cs2Area->partition[0];
+	u32 next = 0;
+
+	Cs2Reset();
+	part->size = 0;
+	for (u32 i = 0; i < BENCH_DEPTH; ++i) {
+		cdbuf_Store(part, i);
+	}
+
+	u64 start = gettime();
+	for (u32 i = 0; i < sectors; ++i) {
+		if (cdbuf_Store(part, BENCH_DEPTH + i) != 0) {
+			printf("cd buffer: ran out of blocks after %u sectors\n", i);
+			return 1;
+		}
+		if (Cs2PartitionBlock(part, 0)->FAD != next) {
+			printf("cd buffer: sector %u came out as %u\n", next, Cs2PartitionBlock(part, 0)->FAD);
+			return 1;
+		}
+		part->size -= Cs2PartitionBlock(part, 0)->size;
+		Cs2PartitionDelete(part, 0, 1);
+		next++;
+	}
+	u64 elapsed = gettime() - start;
+
+	if (part->numblocks + Cs2Area->blockfreespace != MAX_BLOCKS) {
+		printf("cd buffer: %u sectors stored and %u blocks free\n",
+			part->numblocks, Cs2Area->blockfreespace);
+		return 1;
+	}
+	printf("cd buffer: %u sectors streamed %u deep, %.1f ns each\n", sectors, BENCH_DEPTH,
+		sectors ? (f64) elapsed * 1000.0 / (f64) microsecs_to_ticks(1) / sectors : 0.0);
+	return 0;
+}
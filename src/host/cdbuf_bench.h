@@ -0,0 +1,16 @@
+#ifndef __CDBUF_BENCH_H__
+#define __CDBUF_BENCH_H__
+
+/*
+ * cdbuf_bench.h
+ *--------------------
+ * Times the CD block buffer bookkeeping for setagx-bench
+ */
+
+#include "../core.h"
+
+//Returns 0 when the sectors came out in the order they were stored
+int cdbuf_Bench(u32 sectors);
+
+
+#endif /*__CDBUF_BENCH_H__*/
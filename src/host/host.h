@@ -0,0 +1,35 @@
+#ifndef __HOST_H__
+#define __HOST_H__
+
+/*
+ * host.h
+ *--------------------
+ * Shared state between the headless host backends and setagx-bench
+ */
+
+#include <gccore.h>
+#include "../osd/osd.h"
+
+//Per-frame subsystem time in gettime() ticks, filled through osd_CyclesSet
+extern u64 host_cycles[OSD_CYCLES_NUM];
+
+void host_CyclesReset(void);
+
+//How host_video.c walks the NBG scroll screens into the GX stubs
+#define HOST_GX_OFF			0
+#define HOST_GX_IMMEDIATE	1
+#define HOST_GX_LISTS		2	//Through vdp2list, needs vdp2list_Init
+
+//Command stream that reached the stub FIFO, display lists expanded
+typedef struct {
+	u32 hash;			//FNV-1a of the bytes, the same whether lists were used or not
+	u64 bytes;
+	u32 quads;			//Quads the CPU wrote, to a list or to the FIFO
+	u32 lists_called;
+} host_gx_stats;
+
+extern u32 host_gx_mode;
+extern host_gx_stats host_gx;
+
+
+#endif /*__HOST_H__*/
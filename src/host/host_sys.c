@@ -0,0 +1,178 @@
+/*
+ * host_sys.c
+ *--------------------
+ * Frontend glue for the host build: core lists, silent audio, an idle pad
+ * and an OSD that only records the per subsystem timings for setagx-bench.
+ * The audio goes nowhere, but the queue the Wii voice would hold is modelled
+ * from the samples written and the time gone by, so PACE_AUDIO can run here.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "host.h"
+#include "lockstep.h"
+#include "../yui.h"
+#include "../sh2core.h"
+#include "../sh2int.h"
+#include "../cdbase.h"
+#include "../scsp.h"
+#include "../peripheral.h"
+#include "../snd.h"
+#include "../yabause.h"
+
+#define HOST_AUDIO_RATE		(44100 * 4)	//Bytes of 16 bit stereo per second
+
+SH2Interface_struct *SH2CoreList[] = {
+&SH2Interpreter,
+&SH2DebugInterpreter,
+&SH2BlockInterpreter,
+#ifdef SH2_DYNAREC
+&SH2Dynarec,
+#endif
+&SH2Lockstep,
+NULL
+};
+
+CDInterface *CDCoreList[] = {
+&DummyCD,
+&ISOCD,
+NULL
+};
+
+SCSPInterface_struct *SCSCoreList[] = {
+&SCSDummy,
+&SCSScsp2,
+&SCSScsp2,
+NULL
+};
+
+char saves_dir[64];
+char prev_itemnum[512];
+int eachbackupramon = 0;
+u32 *display_fb;
+
+PerData per_data;
+
+u64 host_cycles[OSD_CYCLES_NUM];
+
+
+void host_CyclesReset(void)
+{
+	memset(host_cycles, 0, sizeof(host_cycles));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void osd_MsgAdd(u32 x, u32 y, u32 color, char *str)
+{
+}
+
+void osd_MsgShow(void)
+{
+}
+
+void osd_CyclesSet(u32 indx, u64 cycles)
+{
+	if (indx < OSD_CYCLES_NUM) {
+		host_cycles[indx] = cycles;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void per_initPads(void)
+{
+	per_data.ids[0] = PER_ID_DIGITAL;
+}
+
+u32 per_updatePads(void)
+{
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void VIDEO_WaitVSync(void)
+{
+	const u64 field = secs_to_ticks(1001) / 60000;
+	u64 wait = field - gettime() % field;
+	struct timespec ts = {(time_t) (wait / secs_to_ticks(1)), (long) (wait % secs_to_ticks(1))};
+	nanosleep(&ts, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void snd_Init(void)
+{
+}
+
+void snd_SetVolume(int volume)
+{
+}
+
+void snd_DeInit(void)
+{
+}
+
+int snd_Reset(void)
+{
+	return 0;
+}
+
+int snd_ChangeVideoFormat(int vertfreq)
+{
+	return 0;
+}
+
+static u64 host_audio_written = 0;	//Bytes the SCSP handed over, from its thread too
+static u64 host_audio_played = 0;	//Bytes the voice would have played by now
+static u64 host_audio_ticks = 0;	//When host_audio_played was brought up to date
+
+void snd_UpdateAudio(u32 *leftchanbuffer, u32 *rightchanbuffer, u32 num_samples)
+{
+	__atomic_fetch_add(&host_audio_written, (u64) num_samples * 4, __ATOMIC_RELEASE);
+}
+
+//Report an always empty buffer so the SCSP never throttles emulation
+u32 snd_GetAudioSpace(void)
+{
+	return 0x4000;
+}
+
+u32 snd_GetAudioQueued(void)
+{
+	u64 written = __atomic_load_n(&host_audio_written, __ATOMIC_ACQUIRE);
+	u64 now = YabauseGetTicks();
+
+	if (host_audio_ticks == 0) {
+		host_audio_ticks = now;
+	}
+	//Plays at the output rate while there is something queued, time is
+	//only taken by whole bytes so the rest counts towards the next call
+	u64 played = (now - host_audio_ticks) * HOST_AUDIO_RATE / yabsys.tickfreq;
+	host_audio_ticks += played * yabsys.tickfreq / HOST_AUDIO_RATE;
+	host_audio_played = MIN(host_audio_played + played, written);
+	return (u32) (written - host_audio_played);
+}
+
+void snd_MuteAudio()
+{
+}
+
+void snd_UnMuteAudio()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YuiErrorMsg(const char *string)
+{
+	fprintf(stderr, "%s\n", string);
+}
+
+void YuiSwapBuffers(void)
+{
+}
@@ -0,0 +1,462 @@
+/*
+ * host_video.c
+ *--------------------
+ * Video backend for the host build. There is no GX to draw with, so the
+ * VDP1/VDP2 entry points keep the register side effects the core relies on
+ * (clipping, resolution) and hand the frame to the software renderers, which
+ * do nothing unless setagx-bench started them.
+ *
+ * The GX vertex and display list calls write their bytes to a stub FIFO that
+ * is hashed. With host_gx_mode set the NBG scroll screens are walked into it
+ * cell by cell the way vidsoft.c does, the pattern name standing in for the
+ * texture and palette registers, so the display lists of vdp2list.c can be
+ * checked against drawing immediately. The VDP1 primitives go through
+ * vdp1batch.c keyed by the command words the GX state of vidsoft.c is built
+ * from, which is enough to count the batches a frame needs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "host.h"
+#include "../vidsoft.h"
+#include "../vdp1.h"
+#include "../vdp2.h"
+#include "../vdp1soft.h"
+#include "../vdp2soft.h"
+#include "../vdp2list.h"
+#include "../vdp1batch.h"
+#include "../vidshared.h"
+
+u8 *wii_vram;
+u32 host_gx_mode = HOST_GX_OFF;
+host_gx_stats host_gx = {2166136261u, 0, 0, 0};
+
+static u8 *gx_list = NULL;			//Display list being recorded
+static u32 gx_list_size;
+static u32 gx_list_pos;
+
+
+static void host_GXWrite(const u8 *data, u32 n)
+{
+	if (gx_list) {
+		if (gx_list_pos + n <= gx_list_size) {
+			memcpy(gx_list + gx_list_pos, data, n);
+		}
+		gx_list_pos += n;
+		return;
+	}
+	for (u32 i = 0; i < n; ++i) {
+		host_gx.hash = (host_gx.hash ^ data[i]) * 16777619u;
+	}
+	host_gx.bytes += n;
+}
+
+static void host_GXWrite16(u16 v)
+{
+	u8 b[2] = {v >> 8, v};
+	host_GXWrite(b, 2);
+}
+
+static void host_GXWrite32(u32 v)
+{
+	u8 b[4] = {v >> 24, v >> 16, v >> 8, v};
+	host_GXWrite(b, 4);
+}
+
+void GX_Begin(u8 primitve, u8 vtxfmt, u16 vtxcnt)
+{
+	u8 cmd = primitve | (vtxfmt & 0x7);
+	host_GXWrite(&cmd, 1);
+	host_GXWrite16(vtxcnt);
+	host_gx.quads++;
+}
+
+void GX_Position2s16(s16 x, s16 y)
+{
+	host_GXWrite16(x);
+	host_GXWrite16(y);
+}
+
+void GX_Color1u32(u32 clr)
+{
+	host_GXWrite32(clr);
+}
+
+void GX_TexCoord1u16(u16 s)
+{
+	host_GXWrite16(s);
+}
+
+void GX_BeginDisplayList(void *list, u32 size)
+{
+	gx_list = (u8 *) list;
+	gx_list_size = size;
+	gx_list_pos = 0;
+}
+
+u32 GX_EndDisplayList(void)
+{
+	u32 size = gx_list_pos;
+	u32 fits = (gx_list_pos <= gx_list_size);
+	gx_list = NULL;
+	return fits ? size : 0;
+}
+
+void GX_CallDisplayList(const void *list, u32 nbytes)
+{
+	host_GXWrite((const u8 *) list, nbytes);
+	host_gx.lists_called++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Settings of NBG n the way Vdp2DrawNBG0-3 read them, returns 0 for bitmap
+//screens. A zoom of 0 is taken as 1.
+static u32 host_ScrollSetup(u32 n, vdp2draw_struct *info, u32 *planetbl)
+{
+	static void FASTCALL (* const plane_addr[4])(vdp2draw_struct *, int) = {
+		Vdp2NBG0PlaneAddr, Vdp2NBG1PlaneAddr, Vdp2NBG2PlaneAddr, Vdp2NBG3PlaneAddr
+	};
+	u32 hi = (n & 1) << 3;
+	u32 chctl, zx = 0, zy = 0;
+
+	memset(info, 0, sizeof(vdp2draw_struct));
+	if (n < 2) {
+		chctl = Vdp2Regs->CHCTLA >> hi;
+		info->colornumber = (chctl >> 4) & (n ? 0x3 : 0x7);
+		if (chctl & 0x2) {
+			return 0;
+		}
+	} else {
+		chctl = Vdp2Regs->CHCTLB >> ((n & 1) << 2);
+		info->colornumber = (chctl >> 1) & 0x1;
+	}
+	info->mapwh = 2;
+	ReadPlaneSize(info, Vdp2Regs->PLSZ >> (n << 1));
+	ReadPatternData(info, (&Vdp2Regs->PNCN0)[n], chctl & 0x1);
+
+	switch (n) {
+		case 0:
+			info->x = Vdp2Regs->SCXIN0 & 0x7FF;
+			info->y = Vdp2Regs->SCYIN0 & 0x7FF;
+			zx = Vdp2Regs->ZMXN0.all & 0x7FF00;
+			zy = Vdp2Regs->ZMYN0.all & 0x7FF00;
+			break;
+		case 1:
+			info->x = Vdp2Regs->SCXIN1 & 0x7FF;
+			info->y = Vdp2Regs->SCYIN1 & 0x7FF;
+			zx = Vdp2Regs->ZMXN1.all & 0x7FF00;
+			zy = Vdp2Regs->ZMYN1.all & 0x7FF00;
+			break;
+		case 2:
+			info->x = Vdp2Regs->SCXN2 & 0x7FF;
+			info->y = Vdp2Regs->SCYN2 & 0x7FF;
+			break;
+		default:
+			info->x = Vdp2Regs->SCXN3 & 0x7FF;
+			info->y = Vdp2Regs->SCYN3 & 0x7FF;
+			break;
+	}
+	info->coordincx = (zx ? zx : 0x10000) / (float) 65536;
+	info->coordincy = (zy ? zy : 0x10000) / (float) 65536;
+	info->transparencyenable = !(Vdp2Regs->BGON & (0x100 << n));
+	info->priority = ((&Vdp2Regs->PRINA)[n >> 1] >> hi) & 0x7;
+
+	info->PlaneAddr = (void FASTCALL (*)(void *, int)) plane_addr[n];
+	for (int i = 0; i < info->mapwh * info->mapwh; ++i) {
+		info->PlaneAddr(info, i);
+		planetbl[i] = info->addr;
+	}
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Cell walk of gfx_EmitScroll
+static void host_EmitScroll(vdp2draw_struct *info, const u32 *planetbl, u32 w, u32 h)
+{
+	const u32 pagesize_bits = info->pagewh_bits << 1;
+	const u32 cellwh = 3 + info->patternwh_bits;
+	const u32 inc_xy = 8 << info->patternwh_bits;
+	const u32 mask_xy = inc_xy - 1;
+	const u32 pix_h = (h + inc_xy) * info->coordincy;
+	const u32 pix_w = (w + inc_xy) * info->coordincx;
+	const u32 planew_bits = info->planew + 8;
+	const u32 planeh_bits = info->planeh + 8;
+	const u32 xmask = (info->mapwh << planew_bits) - 1;
+	const u32 ymask = (info->mapwh << planeh_bits) - 1;
+	u32 y = info->y & ~mask_xy;
+
+	for (u32 j = 0; j < pix_h; j += inc_xy, y += inc_xy) {
+		u32 x = info->x & ~mask_xy;
+		y &= ymask;
+		for (u32 i = 0; i < pix_w; i += inc_xy, x += inc_xy) {
+			x &= xmask;
+			u32 planenum = ((y >> planeh_bits) * info->mapwh) + (x >> planew_bits);
+			u32 x0 = x & ((1 << planew_bits) - 1);
+			u32 y0 = y & ((1 << planeh_bits) - 1);
+			u32 addr = planetbl[planenum] + (((((y0 >> 9) << pagesize_bits) << info->planew_bits) +
+							((x0 >> 9) << pagesize_bits) +
+							(((y0 & 511) >> cellwh) << info->pagewh_bits) +
+							((x0 & 511) >> cellwh)) << (info->patterndatasize_bits + 1));
+			addr &= 0x7FFFF;
+			vdp2list_Page(addr, 2 << info->patterndatasize_bits);
+			u32 pattern = T1ReadWord(Vdp2Ram, addr);
+			if (info->patterndatasize == 2) {
+				pattern = (pattern << 16) | T1ReadWord(Vdp2Ram, (addr + 2) & 0x7FFFF);
+			}
+
+			GX_Begin(GX_QUADS, GX_VTXFMT2, 4);
+				GX_Position2s16(i, j);
+				GX_Color1u32(pattern);
+				GX_TexCoord1u16(0x0000);
+				GX_Position2s16(i + inc_xy, j);
+				GX_Color1u32(pattern);
+				GX_TexCoord1u16(0x0100);
+				GX_Position2s16(i + inc_xy, j + inc_xy);
+				GX_Color1u32(pattern);
+				GX_TexCoord1u16(0x0101);
+				GX_Position2s16(i, j + inc_xy);
+				GX_Color1u32(pattern);
+				GX_TexCoord1u16(0x0001);
+			GX_End();
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void host_DrawScrollScreens(void)
+{
+	static const u16 heights[4] = {224, 240, 256, 256};
+	vdp2draw_struct info;
+	u32 planetbl[16];
+	u32 w = 320 + ((Vdp2Regs->TVMD & 1) << 5);
+	u32 h = heights[(Vdp2Regs->TVMD >> 4) & 0x3];
+
+	vdp2list_BeginFrame();
+	for (u32 n = 0; n < 4; ++n) {
+		if (!(Vdp2Regs->BGON & (1 << n)) || !host_ScrollSetup(n, &info, planetbl)) {
+			continue;
+		}
+		if (host_gx_mode == HOST_GX_LISTS) {
+			u32 key = vdp2list_Key(&info, planetbl, w, h);
+			if (vdp2list_Call(n, key)) {
+				continue;
+			}
+			u32 rec = vdp2list_Record(n, key);
+			host_EmitScroll(&info, planetbl, w, h);
+			if (rec && !vdp2list_End()) {
+				host_EmitScroll(&info, planetbl, w, h);
+			}
+		} else {
+			host_EmitScroll(&info, planetbl, w, h);
+		}
+	}
+}
+
+
+int VIDSoftInit(void)
+{
+	return 0;
+}
+
+void VIDSoftDeInit(void)
+{
+}
+
+int VIDSoftVdp1Reset(void)
+{
+	Vdp1Regs->userclipX1 = Vdp1Regs->systemclipX1 = 0;
+	Vdp1Regs->userclipY1 = Vdp1Regs->systemclipY1 = 0;
+	Vdp1Regs->userclipX2 = Vdp1Regs->systemclipX2 = 512;
+	Vdp1Regs->userclipY2 = Vdp1Regs->systemclipY2 = 256;
+	return 0;
+}
+
+void VIDSoftVdp1DrawStart(void)
+{
+	VIDSoftVdp1EraseFrameBuffer();
+	vdp1soft_Draw();
+	if (host_gx_mode != HOST_GX_OFF) {
+		vdp1batch_Begin();
+	}
+}
+
+void VIDSoftVdp1DrawEnd(void)
+{
+	vdp1batch_Flush();
+}
+
+//Queues the current command as n vertices of prim. Textured commands are
+//keyed by their colour mode, texture and colour word, untextured ones by
+//their RGB colour; positions are the command vertices as read.
+static void host_Vdp1Prim(u32 prim, u32 textured, u32 n)
+{
+	const vdp1cmd_struct *c = vdp1_curcmd;
+	const s16 xy[8] = {c->CMDXA, c->CMDYA, c->CMDXB, c->CMDYB, c->CMDXC, c->CMDYC, c->CMDXD, c->CMDYD};
+	static const u8 corner[8] = {0, 1, 1, 2, 2, 3, 3, 0};
+	static const u16 tex_corner[4] = {0x0000, 0x3F00, 0x3FFF, 0x00FF};
+	u32 mode = (c->CMDPMOD >> 3) & 0x7;
+	u32 st[4] = {c->CMDPMOD & 0x1F8, 0, 0, 0};
+	u32 col[4] = {0};
+	vdp1batch_vtx v[8];
+
+	if (host_gx_mode == HOST_GX_OFF) {
+		return;
+	}
+	if (textured) {
+		st[1] = (mode == 5) ? 0 : c->CMDCOLR;
+		st[2] = c->CMDSRCA;
+		st[3] = c->CMDSIZE & 0x3FFF;
+		col[0] = col[1] = col[2] = col[3] = 0x7f7f7f00;
+	} else {
+		st[1] = c->CMDCOLR & 0x7FFF;
+	}
+	if (prim == GX_QUADS && (c->CMDPMOD & 0x4)) {
+		for (u32 i = 0; i < 4; ++i) {
+			col[i] = T1ReadWord(Vdp1Ram, (((u32) c->CMDGRDA) << 3) + (i << 1));
+		}
+	}
+
+	u32 tex_flip = ((c->CMDCTRL & 0x10) ? 0x3F00 : 0) | ((c->CMDCTRL & 0x20) ? 0x00FF : 0);
+	for (u32 i = 0; i < n; ++i) {
+		u32 k = (n == 8) ? corner[i] : i;
+		v[i].x = xy[k << 1];
+		v[i].y = xy[(k << 1) + 1];
+		v[i].color = col[k];
+		v[i].tex = (c->CMDSIZE & 0x3FFF) & (tex_corner[k] ^ tex_flip);
+	}
+	vdp1batch_SetState(prim, textured, st, sizeof(st));
+	vdp1batch_Add(v, n);
+}
+
+void VIDSoftVdp1NormalSpriteDraw(void)
+{
+	host_Vdp1Prim(GX_QUADS, 1, 4);
+}
+
+void VIDSoftVdp1ScaledSpriteDraw(void)
+{
+	host_Vdp1Prim(GX_QUADS, 1, 4);
+}
+
+void VIDSoftVdp1DistortedSpriteDraw(void)
+{
+	host_Vdp1Prim(GX_QUADS, !(vdp1_curcmd->CMDCTRL & 0x4), 4);
+}
+
+void VIDSoftVdp1PolylineDraw(void)
+{
+	host_Vdp1Prim(GX_LINES, 0, 8);
+}
+
+void VIDSoftVdp1LineDraw(void)
+{
+	host_Vdp1Prim(GX_LINES, 0, 2);
+}
+
+void vid_Vdp1PolygonDraw(void)
+{
+	host_Vdp1Prim(GX_QUADS, 0, 4);
+}
+
+void VIDSoftVdp1UserClipping(void)
+{
+	Vdp1Regs->userclipX1 = vdp1_curcmd->CMDXA;
+	Vdp1Regs->userclipY1 = vdp1_curcmd->CMDYA;
+	Vdp1Regs->userclipX2 = vdp1_curcmd->CMDXC;
+	Vdp1Regs->userclipY2 = vdp1_curcmd->CMDYC;
+}
+
+void VIDSoftVdp1SystemClipping(void)
+{
+	vdp1batch_Flush();
+	Vdp1Regs->systemclipX2 = vdp1_curcmd->CMDXC;
+	Vdp1Regs->systemclipY2 = vdp1_curcmd->CMDYC;
+}
+
+void VIDSoftVdp1LocalCoordinate(void)
+{
+	vdp1batch_Flush();
+	Vdp1Regs->localX = vdp1_curcmd->CMDXA;
+	Vdp1Regs->localY = vdp1_curcmd->CMDYA;
+}
+
+void VIDSoftVdp1SwapFrameBuffer(void)
+{
+	if ((~Vdp1Regs->FBCR & 2) | Vdp1External.manualchange) {
+		Vdp1External.manualchange = 0;
+	}
+}
+
+void VIDSoftVdp1EraseFrameBuffer(void)
+{
+	if (!(Vdp1Regs->FBCR & 2) || Vdp1External.manualerase) {
+		vdp1soft_Erase();
+		Vdp1External.manualerase = 0;
+	}
+}
+
+int VIDSoftVdp2Reset(void)
+{
+	vdp2list_Invalidate();
+	return 0;
+}
+
+void VIDSoftVdp2DrawStart(void)
+{
+}
+
+void VIDSoftVdp2DrawEnd(void)
+{
+}
+
+void VIDSoftVdp2DrawScreens(void)
+{
+	vdp2soft_Render();
+	if (host_gx_mode != HOST_GX_OFF) {
+		host_DrawScrollScreens();
+	}
+}
+
+void VIDSoftVdp2DrawScreen(int screen)
+{
+}
+
+void VIDSoftVdp2SetResolution(u16 TVMD)
+{
+}
+
+void VIDSoftOnScreenDebugMessage(char *string, ...)
+{
+}
+
+void VidSoftTexConvert(u32 ram_addr)
+{
+}
+
+void gfx_WindowTextureGen(void)
+{
+}
+
+void SGX_ColorRamDirty(u32 pos)
+{
+}
+
+void SGX_ColorRamDirtyAll(void)
+{
+}
+
+void SGX_InvalidateVRAM(void)
+{
+}
+
+void SGX_InvalidateCopies(void)
+{
+}
+
+void SGX_TlutCRAMUpdate(void)
+{
+}
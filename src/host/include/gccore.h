@@ -0,0 +1,98 @@
+/*
+ * gccore.h (host)
+ *--------------------
+ * Minimal stand-in for the libogc headers used by the emulation core, so the
+ * core can be built for a headless Linux host (see Makefile.host). Only the
+ * types and calls reached from the core files are provided; GX state calls
+ * are no-ops and cache maintenance does nothing. Vertex and display list
+ * calls write a byte stream that host_video.c hashes.
+ */
+
+#ifndef __HOST_GCCORE_H__
+#define __HOST_GCCORE_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <malloc.h>
+
+typedef uint8_t		u8;
+typedef uint16_t	u16;
+typedef uint32_t	u32;
+typedef uint64_t	u64;
+typedef int8_t		s8;
+typedef int16_t		s16;
+typedef int32_t		s32;
+typedef int64_t		s64;
+typedef float		f32;
+typedef double		f64;
+typedef int			BOOL;
+
+#ifndef TRUE
+#define TRUE	1
+#define FALSE	0
+#endif
+
+#define ATTRIBUTE_ALIGN(v)		__attribute__((aligned(v)))
+#define MEM_K0_TO_K1(x)			((void *)(x))
+
+//Cache maintenance: the host has coherent memory
+static inline void DCFlushRange(void *addr, u32 len) { (void) addr; (void) len; }
+static inline void DCStoreRange(void *addr, u32 len) { (void) addr; (void) len; }
+static inline void DCInvalidateRange(void *addr, u32 len) { (void) addr; (void) len; }
+
+//Sleeps to the next 59.94 Hz retrace of a free running clock
+void VIDEO_WaitVSync(void);
+
+//GX state used by the VDP code
+typedef struct _gxcolors10 {
+	s16 r, g, b, a;
+} GXColorS10;
+
+#define GX_FALSE				0
+#define GX_TRUE					1
+#define GX_DISABLE				0
+#define GX_ENABLE				1
+
+#define GX_NEVER				0
+#define GX_LESS					1
+#define GX_EQUAL				2
+#define GX_LEQUAL				3
+#define GX_GREATER				4
+#define GX_NEQUAL				5
+#define GX_GEQUAL				6
+#define GX_ALWAYS				7
+
+#define GX_TEVPREV				0
+#define GX_TEVREG0				1
+#define GX_TEVREG1				2
+#define GX_TEVREG2				3
+
+#define GX_TEXCOORD0			0
+
+//TLUT sizes in 16 entry units
+#define GX_TLUT_16				1
+#define GX_TLUT_256				16
+#define GX_TLUT_2K				128
+
+static inline void GX_SetTevColorS10(u8 tevregid, GXColorS10 color) { (void) tevregid; (void) color; }
+static inline void GX_SetZMode(u8 enable, u8 func, u8 update_enable) { (void) enable; (void) func; (void) update_enable; }
+static inline void GX_SetTexCoordScaleManually(u32 texcoord, u8 enable, u16 ss, u16 ts) { (void) texcoord; (void) enable; (void) ss; (void) ts; }
+static inline void GX_InvalidateTexAll(void) { }
+
+//Command stream, written in FIFO order either to the display list being
+//recorded or to the running hash in host_video.c. Display list sizes aren't
+//padded to 32 bytes.
+#define GX_QUADS				0x80
+#define GX_LINES				0xA8
+#define GX_VTXFMT2				2
+
+void GX_Begin(u8 primitve, u8 vtxfmt, u16 vtxcnt);
+static inline void GX_End(void) { }
+void GX_Position2s16(s16 x, s16 y);
+void GX_Color1u32(u32 clr);
+void GX_TexCoord1u16(u16 s);
+void GX_BeginDisplayList(void *list, u32 size);
+u32 GX_EndDisplayList(void);
+void GX_CallDisplayList(const void *list, u32 nbytes);
+
+#endif /*__HOST_GCCORE_H__*/
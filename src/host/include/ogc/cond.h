@@ -0,0 +1,38 @@
+/*
+ * cond.h (host)
+ *--------------------
+ * libogc condition variables on top of pthreads.
+ */
+
+#ifndef __HOST_COND_H__
+#define __HOST_COND_H__
+
+#include <ogc/mutex.h>
+
+typedef pthread_cond_t *cond_t;
+
+#define LWP_COND_NULL			((cond_t) NULL)
+
+static inline s32 LWP_CondInit(cond_t *cond)
+{
+	pthread_cond_t *c = malloc(sizeof(pthread_cond_t));
+	if (!c) {
+		return -1;
+	}
+	pthread_cond_init(c, NULL);
+	*cond = c;
+	return 0;
+}
+
+static inline s32 LWP_CondDestroy(cond_t cond)
+{
+	pthread_cond_destroy(cond);
+	free(cond);
+	return 0;
+}
+
+static inline s32 LWP_CondWait(cond_t cond, mutex_t mutex) { return pthread_cond_wait(cond, mutex); }
+static inline s32 LWP_CondSignal(cond_t cond) { return pthread_cond_signal(cond); }
+static inline s32 LWP_CondBroadcast(cond_t cond) { return pthread_cond_broadcast(cond); }
+
+#endif /*__HOST_COND_H__*/
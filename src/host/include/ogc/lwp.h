@@ -0,0 +1,44 @@
+/*
+ * lwp.h (host)
+ *--------------------
+ * libogc threads on top of pthreads. Handles are heap allocated pthread_t,
+ * priorities and caller supplied stacks are ignored.
+ */
+
+#ifndef __HOST_LWP_H__
+#define __HOST_LWP_H__
+
+#include <pthread.h>
+#include <sched.h>
+#include <gccore.h>
+
+typedef pthread_t *lwp_t;
+
+#define LWP_THREAD_NULL			((lwp_t) NULL)
+#define LWP_PRIO_IDLE			0
+#define LWP_PRIO_HIGHEST		127
+
+static inline s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg,
+									void *stackbase, u32 stack_size, u8 prio)
+{
+	(void) stackbase; (void) stack_size; (void) prio;
+	pthread_t *t = malloc(sizeof(pthread_t));
+	if (!t || pthread_create(t, NULL, entry, arg) != 0) {
+		free(t);
+		*thethread = LWP_THREAD_NULL;
+		return -1;
+	}
+	*thethread = t;
+	return 0;
+}
+
+static inline s32 LWP_JoinThread(lwp_t thethread, void **value_ptr)
+{
+	s32 ret = pthread_join(*thethread, value_ptr);
+	free(thethread);
+	return ret;
+}
+
+static inline void LWP_YieldThread(void) { sched_yield(); }
+
+#endif /*__HOST_LWP_H__*/
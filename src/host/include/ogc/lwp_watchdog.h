@@ -0,0 +1,30 @@
+/*
+ * lwp_watchdog.h (host)
+ *--------------------
+ * Time base for the host build. Ticks are nanoseconds from CLOCK_MONOTONIC.
+ */
+
+#ifndef __HOST_LWP_WATCHDOG_H__
+#define __HOST_LWP_WATCHDOG_H__
+
+#include <time.h>
+#include <gccore.h>
+
+#define TB_TIMER_CLOCK			1000000u
+
+static inline u64 gettime(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((u64) ts.tv_sec * 1000000000ull) + (u64) ts.tv_nsec;
+}
+
+#define secs_to_ticks(sec)		((u64)(sec) * 1000000000ull)
+#define millisecs_to_ticks(ms)	((u64)(ms) * 1000000ull)
+#define microsecs_to_ticks(us)	((u64)(us) * 1000ull)
+#define ticks_to_secs(ticks)	((u64)(ticks) / 1000000000ull)
+#define ticks_to_millisecs(ticks)	((u64)(ticks) / 1000000ull)
+#define ticks_to_microsecs(ticks)	((u64)(ticks) / 1000ull)
+#define diff_ticks(tick0, tick1)	((u64)(tick1) - (u64)(tick0))
+
+#endif /*__HOST_LWP_WATCHDOG_H__*/
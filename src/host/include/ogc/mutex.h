@@ -0,0 +1,46 @@
+/*
+ * mutex.h (host)
+ *--------------------
+ * libogc mutexes on top of pthreads.
+ */
+
+#ifndef __HOST_MUTEX_H__
+#define __HOST_MUTEX_H__
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <gccore.h>
+
+typedef pthread_mutex_t *mutex_t;
+
+#define LWP_MUTEX_NULL			((mutex_t) NULL)
+
+static inline s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive)
+{
+	pthread_mutexattr_t attr;
+	pthread_mutex_t *m = malloc(sizeof(pthread_mutex_t));
+	if (!m) {
+		return -1;
+	}
+	pthread_mutexattr_init(&attr);
+	if (use_recursive) {
+		pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	}
+	pthread_mutex_init(m, &attr);
+	pthread_mutexattr_destroy(&attr);
+	*mutex = m;
+	return 0;
+}
+
+static inline s32 LWP_MutexDestroy(mutex_t mutex)
+{
+	pthread_mutex_destroy(mutex);
+	free(mutex);
+	return 0;
+}
+
+static inline s32 LWP_MutexLock(mutex_t mutex) { return pthread_mutex_lock(mutex); }
+static inline s32 LWP_MutexTryLock(mutex_t mutex) { return pthread_mutex_trylock(mutex); }
+static inline s32 LWP_MutexUnlock(mutex_t mutex) { return pthread_mutex_unlock(mutex); }
+
+#endif /*__HOST_MUTEX_H__*/
@@ -0,0 +1,710 @@
+/*
+ * lockstep.c
+ *--------------------
+ * SH2 core that runs the interpreter and a candidate core over the same state
+ * and compares them after every step. The interpreter goes first against the
+ * real memory map while every access is logged, then its work RAM writes are
+ * rolled back, the context is restored and the candidate runs. Device reads of
+ * the candidate are served from the interpreter's log and its device writes
+ * are dropped, so hardware side effects only happen once. Registers, cycles
+ * and both write logs must match or the step is reported as a divergence.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lockstep.h"
+#include "../sh2int.h"
+#include "../memory.h"
+
+#define LS_REF			0
+#define LS_CAND			1
+
+//Pages where accesses have no side effects
+#define LS_PLAIN_READ	0x1
+#define LS_PLAIN_WRITE	0x2
+
+#define LS_LOG_MIN		256
+
+typedef struct {
+	u32 addr;
+	u32 val;
+	u32 old;
+	u32 size;
+} ls_access;
+
+typedef struct {
+	ls_access *data;
+	u32 num;
+	u32 max;
+} ls_log;
+
+typedef struct {
+	u16 mask;
+	u16 match;
+	const char *fmt;
+} ls_opcode;
+
+extern SH2Interface_struct *SH2CoreList[];
+
+static SH2Interface_struct *ls_cand = NULL;
+static u32 ls_step = 0;
+static int ls_enabled = 0;
+static int ls_diverged = 0;
+static u64 ls_steps = 0;
+
+static u32 ls_pass;
+static u32 ls_busy;
+static ls_log ls_writes[2];
+static ls_log ls_reads;
+static u32 ls_read_pos;
+static ls_access ls_bad_read;
+static int ls_read_bad;
+
+static SH2_struct ls_start;
+static SH2_struct ls_ref;
+
+static u8 ls_plain[0x100];
+static ReadFunc8 ls_read8[0x100];
+static ReadFunc16 ls_read16[0x100];
+static ReadFunc32 ls_read32[0x100];
+static WriteFunc8 ls_write8[0x100];
+static WriteFunc16 ls_write16[0x100];
+static WriteFunc32 ls_write32[0x100];
+static mem_page ls_read_page[0x100];
+static mem_page ls_write_page[0x100];
+
+static int lockstep_Init(void);
+static void lockstep_DeInit(void);
+static void lockstep_Reset(SH2_struct *context);
+static void FASTCALL lockstep_Exec(SH2_struct *context, u32 cycles);
+static void lockstep_WriteNotify(u32 start, u32 length);
+
+SH2Interface_struct SH2Lockstep = {
+	SH2CORE_LOCKSTEP,
+	"SH2 Lockstep",
+
+	lockstep_Init,
+	lockstep_DeInit,
+	lockstep_Reset,
+	lockstep_Exec,
+
+	SH2InterpreterGetRegisters,
+	SH2InterpreterGetGPR,
+	SH2InterpreterGetSR,
+	SH2InterpreterGetGBR,
+	SH2InterpreterGetVBR,
+	SH2InterpreterGetMACH,
+	SH2InterpreterGetMACL,
+	SH2InterpreterGetPR,
+	SH2InterpreterGetPC,
+
+	SH2InterpreterSetRegisters,
+	SH2InterpreterSetGPR,
+	SH2InterpreterSetSR,
+	SH2InterpreterSetGBR,
+	SH2InterpreterSetVBR,
+	SH2InterpreterSetMACH,
+	SH2InterpreterSetMACL,
+	SH2InterpreterSetPR,
+	SH2InterpreterSetPC,
+
+	SH2InterpreterSendInterrupt,
+	SH2InterpreterGetInterrupts,
+	SH2InterpreterSetInterrupts,
+
+	lockstep_WriteNotify
+};
+
+/*
+ * Disassembler for the divergence report. Operand codes:
+ * %n Rn, %m Rm, %i signed imm8, %u unsigned imm8,
+ * %b %w %l disp4 scaled by 1/2/4, %B %W %L disp8 scaled by 1/2/4,
+ * %p %q PC relative word/long address, %j disp8 branch, %J disp12 branch
+ */
+static const ls_opcode ls_opcodes[] = {
+	{0xFFFF, 0x0008, "clrt"},
+	{0xFFFF, 0x0009, "nop"},
+	{0xFFFF, 0x000B, "rts"},
+	{0xFFFF, 0x0018, "sett"},
+	{0xFFFF, 0x0019, "div0u"},
+	{0xFFFF, 0x001B, "sleep"},
+	{0xFFFF, 0x0028, "clrmac"},
+	{0xFFFF, 0x002B, "rte"},
+	{0xF0FF, 0x0002, "stc sr,%n"},
+	{0xF0FF, 0x0003, "bsrf %n"},
+	{0xF0FF, 0x000A, "sts mach,%n"},
+	{0xF0FF, 0x0012, "stc gbr,%n"},
+	{0xF0FF, 0x001A, "sts macl,%n"},
+	{0xF0FF, 0x0022, "stc vbr,%n"},
+	{0xF0FF, 0x0023, "braf %n"},
+	{0xF0FF, 0x0029, "movt %n"},
+	{0xF0FF, 0x002A, "sts pr,%n"},
+	{0xF00F, 0x0004, "mov.b %m,@(r0,%n)"},
+	{0xF00F, 0x0005, "mov.w %m,@(r0,%n)"},
+	{0xF00F, 0x0006, "mov.l %m,@(r0,%n)"},
+	{0xF00F, 0x0007, "mul.l %m,%n"},
+	{0xF00F, 0x000C, "mov.b @(r0,%m),%n"},
+	{0xF00F, 0x000D, "mov.w @(r0,%m),%n"},
+	{0xF00F, 0x000E, "mov.l @(r0,%m),%n"},
+	{0xF00F, 0x000F, "mac.l @%m+,@%n+"},
+	{0xF000, 0x1000, "mov.l %m,@(%l,%n)"},
+	{0xF00F, 0x2000, "mov.b %m,@%n"},
+	{0xF00F, 0x2001, "mov.w %m,@%n"},
+	{0xF00F, 0x2002, "mov.l %m,@%n"},
+	{0xF00F, 0x2004, "mov.b %m,@-%n"},
+	{0xF00F, 0x2005, "mov.w %m,@-%n"},
+	{0xF00F, 0x2006, "mov.l %m,@-%n"},
+	{0xF00F, 0x2007, "div0s %m,%n"},
+	{0xF00F, 0x2008, "tst %m,%n"},
+	{0xF00F, 0x2009, "and %m,%n"},
+	{0xF00F, 0x200A, "xor %m,%n"},
+	{0xF00F, 0x200B, "or %m,%n"},
+	{0xF00F, 0x200C, "cmp/str %m,%n"},
+	{0xF00F, 0x200D, "xtrct %m,%n"},
+	{0xF00F, 0x200E, "mulu.w %m,%n"},
+	{0xF00F, 0x200F, "muls.w %m,%n"},
+	{0xF00F, 0x3000, "cmp/eq %m,%n"},
+	{0xF00F, 0x3002, "cmp/hs %m,%n"},
+	{0xF00F, 0x3003, "cmp/ge %m,%n"},
+	{0xF00F, 0x3004, "div1 %m,%n"},
+	{0xF00F, 0x3005, "dmulu.l %m,%n"},
+	{0xF00F, 0x3006, "cmp/hi %m,%n"},
+	{0xF00F, 0x3007, "cmp/gt %m,%n"},
+	{0xF00F, 0x3008, "sub %m,%n"},
+	{0xF00F, 0x300A, "subc %m,%n"},
+	{0xF00F, 0x300B, "subv %m,%n"},
+	{0xF00F, 0x300C, "add %m,%n"},
+	{0xF00F, 0x300D, "dmuls.l %m,%n"},
+	{0xF00F, 0x300E, "addc %m,%n"},
+	{0xF00F, 0x300F, "addv %m,%n"},
+	{0xF0FF, 0x4000, "shll %n"},
+	{0xF0FF, 0x4001, "shlr %n"},
+	{0xF0FF, 0x4002, "sts.l mach,@-%n"},
+	{0xF0FF, 0x4003, "stc.l sr,@-%n"},
+	{0xF0FF, 0x4004, "rotl %n"},
+	{0xF0FF, 0x4005, "rotr %n"},
+	{0xF0FF, 0x4006, "lds.l @%n+,mach"},
+	{0xF0FF, 0x4007, "ldc.l @%n+,sr"},
+	{0xF0FF, 0x4008, "shll2 %n"},
+	{0xF0FF, 0x4009, "shlr2 %n"},
+	{0xF0FF, 0x400A, "lds %n,mach"},
+	{0xF0FF, 0x400B, "jsr @%n"},
+	{0xF0FF, 0x400E, "ldc %n,sr"},
+	{0xF0FF, 0x4010, "dt %n"},
+	{0xF0FF, 0x4011, "cmp/pz %n"},
+	{0xF0FF, 0x4012, "sts.l macl,@-%n"},
+	{0xF0FF, 0x4013, "stc.l gbr,@-%n"},
+	{0xF0FF, 0x4015, "cmp/pl %n"},
+	{0xF0FF, 0x4016, "lds.l @%n+,macl"},
+	{0xF0FF, 0x4017, "ldc.l @%n+,gbr"},
+	{0xF0FF, 0x4018, "shll8 %n"},
+	{0xF0FF, 0x4019, "shlr8 %n"},
+	{0xF0FF, 0x401A, "lds %n,macl"},
+	{0xF0FF, 0x401B, "tas.b @%n"},
+	{0xF0FF, 0x401E, "ldc %n,gbr"},
+	{0xF0FF, 0x4020, "shal %n"},
+	{0xF0FF, 0x4021, "shar %n"},
+	{0xF0FF, 0x4022, "sts.l pr,@-%n"},
+	{0xF0FF, 0x4023, "stc.l vbr,@-%n"},
+	{0xF0FF, 0x4024, "rotcl %n"},
+	{0xF0FF, 0x4025, "rotcr %n"},
+	{0xF0FF, 0x4026, "lds.l @%n+,pr"},
+	{0xF0FF, 0x4027, "ldc.l @%n+,vbr"},
+	{0xF0FF, 0x4028, "shll16 %n"},
+	{0xF0FF, 0x4029, "shlr16 %n"},
+	{0xF0FF, 0x402A, "lds %n,pr"},
+	{0xF0FF, 0x402B, "jmp @%n"},
+	{0xF0FF, 0x402E, "ldc %n,vbr"},
+	{0xF00F, 0x400F, "mac.w @%m+,@%n+"},
+	{0xF000, 0x5000, "mov.l @(%l,%m),%n"},
+	{0xF00F, 0x6000, "mov.b @%m,%n"},
+	{0xF00F, 0x6001, "mov.w @%m,%n"},
+	{0xF00F, 0x6002, "mov.l @%m,%n"},
+	{0xF00F, 0x6003, "mov %m,%n"},
+	{0xF00F, 0x6004, "mov.b @%m+,%n"},
+	{0xF00F, 0x6005, "mov.w @%m+,%n"},
+	{0xF00F, 0x6006, "mov.l @%m+,%n"},
+	{0xF00F, 0x6007, "not %m,%n"},
+	{0xF00F, 0x6008, "swap.b %m,%n"},
+	{0xF00F, 0x6009, "swap.w %m,%n"},
+	{0xF00F, 0x600A, "negc %m,%n"},
+	{0xF00F, 0x600B, "neg %m,%n"},
+	{0xF00F, 0x600C, "extu.b %m,%n"},
+	{0xF00F, 0x600D, "extu.w %m,%n"},
+	{0xF00F, 0x600E, "exts.b %m,%n"},
+	{0xF00F, 0x600F, "exts.w %m,%n"},
+	{0xF000, 0x7000, "add %i,%n"},
+	{0xFF00, 0x8000, "mov.b r0,@(%b,%m)"},
+	{0xFF00, 0x8100, "mov.w r0,@(%w,%m)"},
+	{0xFF00, 0x8400, "mov.b @(%b,%m),r0"},
+	{0xFF00, 0x8500, "mov.w @(%w,%m),r0"},
+	{0xFF00, 0x8800, "cmp/eq %i,r0"},
+	{0xFF00, 0x8900, "bt %j"},
+	{0xFF00, 0x8B00, "bf %j"},
+	{0xFF00, 0x8D00, "bt/s %j"},
+	{0xFF00, 0x8F00, "bf/s %j"},
+	{0xF000, 0x9000, "mov.w %p,%n"},
+	{0xF000, 0xA000, "bra %J"},
+	{0xF000, 0xB000, "bsr %J"},
+	{0xFF00, 0xC000, "mov.b r0,@(%B,gbr)"},
+	{0xFF00, 0xC100, "mov.w r0,@(%W,gbr)"},
+	{0xFF00, 0xC200, "mov.l r0,@(%L,gbr)"},
+	{0xFF00, 0xC300, "trapa %u"},
+	{0xFF00, 0xC400, "mov.b @(%B,gbr),r0"},
+	{0xFF00, 0xC500, "mov.w @(%W,gbr),r0"},
+	{0xFF00, 0xC600, "mov.l @(%L,gbr),r0"},
+	{0xFF00, 0xC700, "mova %q,r0"},
+	{0xFF00, 0xC800, "tst %u,r0"},
+	{0xFF00, 0xC900, "and %u,r0"},
+	{0xFF00, 0xCA00, "xor %u,r0"},
+	{0xFF00, 0xCB00, "or %u,r0"},
+	{0xFF00, 0xCC00, "tst.b %u,@(r0,gbr)"},
+	{0xFF00, 0xCD00, "and.b %u,@(r0,gbr)"},
+	{0xFF00, 0xCE00, "xor.b %u,@(r0,gbr)"},
+	{0xFF00, 0xCF00, "or.b %u,@(r0,gbr)"},
+	{0xF000, 0xD000, "mov.l %q,%n"},
+	{0xF000, 0xE000, "mov %i,%n"},
+	{0x0000, 0x0000, ".word %X"}
+};
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Disasm(u32 pc, u16 op, char *out)
+{
+	const ls_opcode *o = ls_opcodes;
+	while ((op & o->mask) != o->match) {
+		o++;
+	}
+
+	for (const char *f = o->fmt; *f; ++f) {
+		if (*f != '%') {
+			*out++ = *f;
+			continue;
+		}
+		switch (*++f) {
+			case 'n': out += sprintf(out, "r%u", (op >> 8) & 0xF); break;
+			case 'm': out += sprintf(out, "r%u", (op >> 4) & 0xF); break;
+			case 'i': out += sprintf(out, "#%d", (s8) op); break;
+			case 'u': out += sprintf(out, "#0x%02X", op & 0xFF); break;
+			case 'b': out += sprintf(out, "0x%X", op & 0xF); break;
+			case 'w': out += sprintf(out, "0x%X", (op & 0xF) << 1); break;
+			case 'l': out += sprintf(out, "0x%X", (op & 0xF) << 2); break;
+			case 'B': out += sprintf(out, "0x%X", op & 0xFF); break;
+			case 'W': out += sprintf(out, "0x%X", (op & 0xFF) << 1); break;
+			case 'L': out += sprintf(out, "0x%X", (op & 0xFF) << 2); break;
+			case 'p': out += sprintf(out, "@(0x%08X)", pc + 4 + ((op & 0xFF) << 1)); break;
+			case 'q': out += sprintf(out, "@(0x%08X)", ((pc + 4) & ~3) + ((op & 0xFF) << 2)); break;
+			case 'j': out += sprintf(out, "0x%08X", pc + 4 + ((s32) (s8) op << 1)); break;
+			case 'J': out += sprintf(out, "0x%08X", pc + 4 + (((s32) (op << 20) >> 20) << 1)); break;
+			case 'X': out += sprintf(out, "0x%X", op); break;
+		}
+	}
+	*out = '\0';
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Window(SH2_struct *context, u32 center, u32 before, u32 after)
+{
+	char str[64];
+	u32 start = center - (before << 1);
+	u32 end = center + (after << 1);
+
+	for (u32 pc = start; pc != end + 2; pc += 2) {
+		u16 op = fetchlist[(pc >> 20) & 0x0FF](pc);
+		lockstep_Disasm(pc, op, str);
+		printf("  %c%c%c %08X  %04X  %s\n",
+			pc == ls_start.regs.PC ? '>' : ' ',
+			pc == ls_ref.regs.PC ? 'I' : ' ',
+			pc == context->regs.PC ? 'C' : ' ',
+			pc, op, str);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static ls_access *lockstep_Push(ls_log *log)
+{
+	if (log->num == log->max) {
+		log->max = log->max ? log->max * 2 : LS_LOG_MIN;
+		log->data = (ls_access *) realloc(log->data, log->max * sizeof(ls_access));
+	}
+	return &log->data[log->num++];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 lockstep_OrigRead(u32 addr, u32 size)
+{
+	u32 page = MEM_GET_FUNC_ADDR(addr);
+	switch (size) {
+		case 1:		return ls_read8[page](addr);
+		case 2:		return ls_read16[page](addr);
+		default:	return ls_read32[page](addr);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_OrigWrite(u32 addr, u32 size, u32 val)
+{
+	u32 page = MEM_GET_FUNC_ADDR(addr);
+	switch (size) {
+		case 1:		ls_write8[page](addr, val); break;
+		case 2:		ls_write16[page](addr, val); break;
+		default:	ls_write32[page](addr, val); break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 lockstep_Read(u32 addr, u32 size)
+{
+	//Accesses made by the hardware itself (SCU DMA started by a register
+	//write) are not part of the SH2 stream
+	if (ls_busy || (ls_plain[MEM_GET_FUNC_ADDR(addr)] & LS_PLAIN_READ)) {
+		return lockstep_OrigRead(addr, size);
+	}
+
+	if (ls_pass == LS_REF) {
+		ls_busy = 1;
+		u32 val = lockstep_OrigRead(addr, size);
+		ls_busy = 0;
+		ls_access *a = lockstep_Push(&ls_reads);
+		a->addr = addr;
+		a->size = size;
+		a->val = val;
+		a->old = 0;
+		return val;
+	}
+
+	if (ls_read_pos < ls_reads.num) {
+		ls_access *a = &ls_reads.data[ls_read_pos++];
+		if (a->addr == addr && a->size == size) {
+			return a->val;
+		}
+	}
+	if (!ls_read_bad) {
+		ls_read_bad = 1;
+		ls_bad_read.addr = addr;
+		ls_bad_read.size = size;
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Write(u32 addr, u32 size, u32 val)
+{
+	if (ls_busy) {
+		lockstep_OrigWrite(addr, size, val);
+		return;
+	}
+
+	ls_access *a = lockstep_Push(&ls_writes[ls_pass]);
+	a->addr = addr;
+	a->size = size;
+	a->val = val;
+	a->old = 0;
+	if (ls_plain[MEM_GET_FUNC_ADDR(addr)] & LS_PLAIN_WRITE) {
+		a->old = lockstep_OrigRead(addr, size);
+		lockstep_OrigWrite(addr, size, val);
+	} else if (ls_pass == LS_REF) {
+		ls_busy = 1;
+		lockstep_OrigWrite(addr, size, val);
+		ls_busy = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u8 FASTCALL lockstep_Read8(u32 addr)		{ return lockstep_Read(addr, 1); }
+static u16 FASTCALL lockstep_Read16(u32 addr)	{ return lockstep_Read(addr, 2); }
+static u32 FASTCALL lockstep_Read32(u32 addr)	{ return lockstep_Read(addr, 4); }
+static void FASTCALL lockstep_Write8(u32 addr, u8 val)		{ lockstep_Write(addr, 1, val); }
+static void FASTCALL lockstep_Write16(u32 addr, u16 val)	{ lockstep_Write(addr, 2, val); }
+static void FASTCALL lockstep_Write32(u32 addr, u32 val)	{ lockstep_Write(addr, 4, val); }
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Hook(void)
+{
+	memcpy(ls_read8, mem_read8_arr, sizeof(ls_read8));
+	memcpy(ls_read16, mem_read16_arr, sizeof(ls_read16));
+	memcpy(ls_read32, mem_read32_arr, sizeof(ls_read32));
+	memcpy(ls_write8, mem_write8_arr, sizeof(ls_write8));
+	memcpy(ls_write16, mem_write16_arr, sizeof(ls_write16));
+	memcpy(ls_write32, mem_write32_arr, sizeof(ls_write32));
+	memcpy(ls_read_page, mem_read_page, sizeof(ls_read_page));
+	memcpy(ls_write_page, mem_write_page, sizeof(ls_write_page));
+
+	//Direct pages would bypass the logging handlers
+	memset(mem_read_page, 0, sizeof(mem_read_page));
+	memset(mem_write_page, 0, sizeof(mem_write_page));
+
+	for (u32 i = 0; i < 0x100; ++i) {
+		ls_plain[i] = 0;
+		if (ls_read32[i] == wram_Read32 || ls_read32[i] == bios_Read32) {
+			ls_plain[i] |= LS_PLAIN_READ;
+		}
+		if (ls_write32[i] == wram_Write32) {
+			ls_plain[i] |= LS_PLAIN_WRITE;
+		}
+		mem_read8_arr[i] = lockstep_Read8;
+		mem_read16_arr[i] = lockstep_Read16;
+		mem_read32_arr[i] = lockstep_Read32;
+		mem_write8_arr[i] = lockstep_Write8;
+		mem_write16_arr[i] = lockstep_Write16;
+		mem_write32_arr[i] = lockstep_Write32;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Unhook(void)
+{
+	memcpy(mem_read8_arr, ls_read8, sizeof(ls_read8));
+	memcpy(mem_read16_arr, ls_read16, sizeof(ls_read16));
+	memcpy(mem_read32_arr, ls_read32, sizeof(ls_read32));
+	memcpy(mem_write8_arr, ls_write8, sizeof(ls_write8));
+	memcpy(mem_write16_arr, ls_write16, sizeof(ls_write16));
+	memcpy(mem_write32_arr, ls_write32, sizeof(ls_write32));
+	memcpy(mem_read_page, ls_read_page, sizeof(ls_read_page));
+	memcpy(mem_write_page, ls_write_page, sizeof(ls_write_page));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int lockstep_WritesDiffer(u32 *first)
+{
+	ls_log *ref = &ls_writes[LS_REF];
+	ls_log *cand = &ls_writes[LS_CAND];
+	u32 num = ref->num < cand->num ? ref->num : cand->num;
+
+	for (u32 i = 0; i < num; ++i) {
+		ls_access *r = &ref->data[i];
+		ls_access *c = &cand->data[i];
+		if (r->addr != c->addr || r->size != c->size || r->val != c->val) {
+			*first = i;
+			return 1;
+		}
+	}
+	*first = num;
+	return ref->num != cand->num;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_PrintWrite(const char *who, ls_log *log, u32 i)
+{
+	static const char size_ch[5] = {'?', 'b', 'w', '?', 'l'};
+
+	if (i < log->num) {
+		ls_access *a = &log->data[i];
+		printf("  %-12s write #%u [%08X].%c = %08X\n", who, i, a->addr, size_ch[a->size], a->val);
+	} else {
+		printf("  %-12s write #%u (none)\n", who, i);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Report(SH2_struct *context)
+{
+	static const char *names[23] = {
+		"R0", "R1", "R2", "R3", "R4", "R5", "R6", "R7",
+		"R8", "R9", "R10", "R11", "R12", "R13", "R14", "R15",
+		"SR", "GBR", "VBR", "MACH", "MACL", "PR", "PC"
+	};
+	const u32 *r = (const u32 *) &ls_ref.regs;
+	const u32 *c = (const u32 *) &context->regs;
+	u32 first;
+
+	printf("lockstep: %s diverged from the interpreter on step %llu\n",
+		context == MSH2 ? "MSH2" : "SSH2", (unsigned long long) ls_steps);
+	printf("  started at PC %08X, cycles %u, %u reads and %u writes logged\n",
+		ls_start.regs.PC, ls_start.cycles, ls_reads.num, ls_writes[LS_REF].num);
+	printf("\n  %-6s %-12s %-12s\n", "", "interpreter", ls_cand->Name);
+	for (u32 i = 0; i < 23; ++i) {
+		if (r[i] != c[i]) {
+			printf("  %-6s %08X     %08X\n", names[i], r[i], c[i]);
+		}
+	}
+	if (ls_ref.cycles != context->cycles) {
+		printf("  %-6s %-12u %-12u\n", "cycles", ls_ref.cycles, context->cycles);
+	}
+
+	if (lockstep_WritesDiffer(&first)) {
+		printf("\n");
+		lockstep_PrintWrite("interpreter", &ls_writes[LS_REF], first);
+		lockstep_PrintWrite(ls_cand->Name, &ls_writes[LS_CAND], first);
+	}
+	if (ls_read_bad) {
+		printf("\n  device read [%08X]/%u does not follow the interpreter's reads\n",
+			ls_bad_read.addr, ls_bad_read.size);
+	} else if (ls_read_pos != ls_reads.num) {
+		printf("\n  candidate made %u of the interpreter's %u device reads\n",
+			ls_read_pos, ls_reads.num);
+	}
+
+	//> step start, I interpreter stop, C candidate stop
+	printf("\n");
+	lockstep_Window(context, ls_start.regs.PC, 8, 16);
+	if (ls_ref.regs.PC - ls_start.regs.PC + 16 > 48) {
+		printf("  ...\n");
+		lockstep_Window(context, ls_ref.regs.PC, 4, 4);
+	}
+	if (context->regs.PC - ls_start.regs.PC + 16 > 48 && context->regs.PC != ls_ref.regs.PC) {
+		printf("  ...\n");
+		lockstep_Window(context, context->regs.PC, 4, 4);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Step(SH2_struct *context, u32 cycles)
+{
+	memcpy(&ls_start, context, sizeof(SH2_struct));
+	ls_writes[LS_REF].num = 0;
+	ls_writes[LS_CAND].num = 0;
+	ls_reads.num = 0;
+	ls_read_pos = 0;
+	ls_read_bad = 0;
+
+	ls_pass = LS_REF;
+	SH2InterpreterExec(context, cycles);
+	memcpy(&ls_ref, context, sizeof(SH2_struct));
+
+	//Undo the work RAM writes, the candidate's copies go through the
+	//real handlers again so code invalidation sees both
+	for (u32 i = ls_writes[LS_REF].num; i-- > 0;) {
+		ls_access *a = &ls_writes[LS_REF].data[i];
+		if (ls_plain[MEM_GET_FUNC_ADDR(a->addr)] & LS_PLAIN_WRITE) {
+			lockstep_OrigWrite(a->addr, a->size, a->old);
+		}
+	}
+	memcpy(context, &ls_start, sizeof(SH2_struct));
+
+	ls_pass = LS_CAND;
+	ls_cand->Exec(context, cycles);
+
+	//Interrupts raised by device writes only reached the interpreter's copy
+	context->NumberOfInterrupts = ls_ref.NumberOfInterrupts;
+	memcpy(context->interrupts, ls_ref.interrupts, sizeof(context->interrupts));
+
+	ls_steps++;
+	u32 first;
+	if (memcmp(&ls_ref.regs, &context->regs, sizeof(sh2regs_struct)) ||
+		ls_ref.cycles != context->cycles || ls_read_bad ||
+		ls_read_pos != ls_reads.num || lockstep_WritesDiffer(&first)) {
+		lockstep_Report(context);
+		ls_diverged = 1;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void FASTCALL lockstep_Exec(SH2_struct *context, u32 cycles)
+{
+	if (!ls_enabled || ls_diverged) {
+		SH2InterpreterExec(context, cycles);
+		return;
+	}
+
+	//Like the other cores at least one instruction runs even when the
+	//context is already past the budget
+	lockstep_Hook();
+	do {
+		u32 target = cycles;
+		if (ls_step && context->cycles + ls_step < cycles) {
+			target = context->cycles + ls_step;
+		}
+		lockstep_Step(context, target);
+	} while (context->cycles < cycles && !ls_diverged);
+	lockstep_Unhook();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int lockstep_Init(void)
+{
+	if (ls_cand == NULL) {
+		return -1;
+	}
+	if (SH2InterpreterInit() != 0) {
+		return -1;
+	}
+	return ls_cand->Init();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_DeInit(void)
+{
+	if (ls_cand) {
+		ls_cand->DeInit();
+	}
+	for (u32 i = 0; i < 2; ++i) {
+		free(ls_writes[i].data);
+		memset(&ls_writes[i], 0, sizeof(ls_log));
+	}
+	free(ls_reads.data);
+	memset(&ls_reads, 0, sizeof(ls_log));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_Reset(SH2_struct *context)
+{
+	SH2InterpreterReset(context);
+	ls_cand->Reset(context);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void lockstep_WriteNotify(u32 start, u32 length)
+{
+	if (ls_cand->WriteNotify) {
+		ls_cand->WriteNotify(start, length);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int lockstep_Setup(int coreid, u32 step)
+{
+	ls_cand = NULL;
+	for (u32 i = 0; SH2CoreList[i] != NULL; ++i) {
+		if (SH2CoreList[i]->id == coreid && coreid != SH2CORE_LOCKSTEP) {
+			ls_cand = SH2CoreList[i];
+		}
+	}
+	ls_step = step;
+	ls_enabled = 0;
+	ls_diverged = 0;
+	ls_steps = 0;
+	return ls_cand ? 0 : -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void lockstep_Enable(int enable)
+{
+	ls_enabled = enable;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int lockstep_Diverged(void)
+{
+	return ls_diverged;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u64 lockstep_Steps(void)
+{
+	return ls_steps;
+}
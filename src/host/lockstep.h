@@ -0,0 +1,23 @@
+#ifndef __LOCKSTEP_H__
+#define __LOCKSTEP_H__
+
+/*
+ * lockstep.h
+ *--------------------
+ * Differential SH2 core tester for setagx-bench
+ */
+
+#include "../sh2core.h"
+
+#define SH2CORE_LOCKSTEP	4
+
+extern SH2Interface_struct SH2Lockstep;
+
+//Must be called before YabauseInit, step is in cycles (0 whole Exec slices)
+int lockstep_Setup(int coreid, u32 step);
+void lockstep_Enable(int enable);
+int lockstep_Diverged(void);
+u64 lockstep_Steps(void);
+
+
+#endif /*__LOCKSTEP_H__*/
@@ -0,0 +1,134 @@
+/*
+ * swizzle_bench.c
+ *--------------------
+ * setagx-bench -z: runs every swizzle implementation the CPU has over random
+ * textures, compares the output against a texel by texel reference of the GX
+ * tile layout and reports the throughput of each.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "swizzle_bench.h"
+#include "../swizzle.h"
+
+//Sizes covering single tiles, the SIMD tails and the biggest VDP1 sprite
+static const u32 bench_sizes[][2] = {
+	{8, 8}, {16, 8}, {24, 16}, {40, 24}, {72, 8}, {256, 256}, {504, 256}
+};
+
+#define BENCH_SIZES		(sizeof(bench_sizes) / sizeof(bench_sizes[0]))
+#define BENCH_MAX_BYTES	(512 * 256 * 2)
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Source offset of the byte that lands at dst offset ofs. Texels smaller than
+//a byte travel in pairs so bytes are enough.
+static u32 swizzle_RefSource(u32 fmt, u32 cells, u32 w, u32 ofs)
+{
+	u32 th = swizzle_TileHeight(fmt);
+	u32 tw = 32 / th;						//Tile row in bytes
+	u32 pitch = (w << fmt) >> 1;
+	u32 tile = ofs >> 5;
+	u32 in = ofs & 31;
+	u32 tiles_x = pitch / tw;
+	u32 y = (tile / tiles_x) * th + in / tw;
+	u32 xb = (tile % tiles_x) * tw + in % tw;	//Byte in the row
+
+	if (!cells) {
+		return y * pitch + xb;
+	}
+	u32 cell_pitch = 4 << fmt;
+	u32 cell = (y >> 3) * (w >> 3) + xb / cell_pitch;
+	return (cell << (5 + fmt)) + (y & 7) * cell_pitch + xb % cell_pitch;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static int swizzle_Check(const swizzle_impl *impl, const u8 *src, u8 *dst)
+{
+	for (u32 cells = 0; cells < 2; ++cells) {
+		for (u32 fmt = 0; fmt < SWIZZLE_FMT_NUM; ++fmt) {
+			for (u32 i = 0; i < BENCH_SIZES; ++i) {
+				u32 w = bench_sizes[i][0];
+				u32 h = bench_sizes[i][1];
+				u32 size = ((w * h) << fmt) >> 1;
+				memset(dst, 0xCD, size + 64);
+				if (cells) {
+					impl->cells[fmt](dst, src, w, h);
+				} else {
+					impl->linear[fmt](dst, src, w, h);
+				}
+				for (u32 ofs = 0; ofs < size; ++ofs) {
+					if (dst[ofs] != src[swizzle_RefSource(fmt, cells, w, ofs)]) {
+						printf("swizzle: %s %s %ubpp %ux%u differs at byte %u\n", impl->name,
+							cells ? "cells" : "linear", 4 << fmt, w, h, ofs);
+						return -1;
+					}
+				}
+				for (u32 ofs = size; ofs < size + 64; ++ofs) {
+					if (dst[ofs] != 0xCD) {
+						printf("swizzle: %s %s %ubpp %ux%u writes past the end\n", impl->name,
+							cells ? "cells" : "linear", 4 << fmt, w, h);
+						return -1;
+					}
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int swizzle_Bench(u32 rounds)
+{
+	static const char *fmt_names[SWIZZLE_FMT_NUM] = {"4bpp", "8bpp", "16bpp"};
+	u8 *src = (u8*) memalign(32, BENCH_MAX_BYTES);
+	u8 *dst = (u8*) memalign(32, BENCH_MAX_BYTES + 64);
+	int ret = 0;
+
+	srand(1);
+	for (u32 i = 0; i < BENCH_MAX_BYTES; ++i) {
+		src[i] = rand();
+	}
+
+	printf("%-8s %-8s %12s %12s\n", "impl", "format", "linear MB/s", "cells MB/s");
+	for (u32 id = 0; id < SWIZZLE_IMPL_NUM; ++id) {
+		const swizzle_impl *impl = swizzle_GetImpl(id);
+		if (impl == NULL) {
+			continue;
+		}
+		if (swizzle_Check(impl, src, dst)) {
+			ret = -1;
+			continue;
+		}
+		//Timed on the biggest VDP1 sprite
+		for (u32 fmt = 0; fmt < SWIZZLE_FMT_NUM; ++fmt) {
+			u32 size = ((504 * 256) << fmt) >> 1;
+			f64 mbs[2];
+			for (u32 cells = 0; cells < 2; ++cells) {
+				u64 start = gettime();
+				for (u32 r = 0; r < rounds; ++r) {
+					if (cells) {
+						impl->cells[fmt](dst, src, 504, 256);
+					} else {
+						impl->linear[fmt](dst, src, 504, 256);
+					}
+				}
+				f64 secs = (f64) (gettime() - start) / (f64) secs_to_ticks(1);
+				mbs[cells] = secs > 0.0 ? ((f64) size * rounds) / (secs * 1000000.0) : 0.0;
+			}
+			printf("%-8s %-8s %12.1f %12.1f\n", impl->name, fmt_names[fmt], mbs[0], mbs[1]);
+		}
+	}
+	printf("swizzle: %s\n", ret ? "MISMATCH" : "all implementations match the reference");
+
+	free(src);
+	free(dst);
+	return ret;
+}
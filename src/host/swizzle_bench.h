@@ -0,0 +1,16 @@
+#ifndef __SWIZZLE_BENCH_H__
+#define __SWIZZLE_BENCH_H__
+
+/*
+ * swizzle_bench.h
+ *--------------------
+ * Checks and times the texture swizzlers for setagx-bench
+ */
+
+#include "../core.h"
+
+//Returns 0 when every implementation matches the reference layout
+int swizzle_Bench(u32 rounds);
+
+
+#endif /*__SWIZZLE_BENCH_H__*/
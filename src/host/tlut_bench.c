@@ -0,0 +1,95 @@
+/*
+ * tlut_bench.c
+ *--------------------
+ * setagx-bench -u: SGX_TlutCRAMUpdate loads only the 256 entry blocks of the
+ * three color RAM tables that changed. For every set of dirty blocks this
+ * replays the loads it makes against a model of TLUT memory, decoding the
+ * TMEM offset and size from the tlut names as GX_LoadTlut does, and checks
+ * that the dirty blocks hold what a full upload of each table puts there and
+ * that nothing else was written.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tlut_bench.h"
+#include "../sgx/sgx.h"
+
+#define TLUT_TMEM_ENTRIES	(0x400 * 16)	//Entries the 10 bit offset can reach
+#define TLUT_CRAM_ENTRIES	2048
+#define TLUT_UNTOUCHED		0xFFFF
+
+static u16 tlut_tmem[TLUT_TMEM_ENTRIES];
+static u16 tlut_full[TLUT_TMEM_ENTRIES];
+static u16 tlut_table[TLUT_CRAM_ENTRIES];
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Loads count entries of src at the tlut name, -1 when the size in the name
+//isn't count
+static int tlut_Load(u16 *tmem, const u16 *src, u32 count, u32 name)
+{
+	u32 ofs = (name & 0x3FF) << 4;
+	u32 size = (name >> 10) << 4;
+
+	if (size != count || ofs + count > TLUT_TMEM_ENTRIES) {
+		return -1;
+	}
+	memcpy(tmem + ofs, src, count * sizeof(u16));
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int tlut_Bench(void)
+{
+	static const u32 types[3] = {TLUT_TYPE_FULL, TLUT_TYPE_8BPP, TLUT_TYPE_4BPP};
+	u32 loads = 0;
+
+	//Each table tags its entries so a block in the wrong place shows
+	memset(tlut_full, 0xFF, sizeof(tlut_full));
+	for (u32 t = 0; t < 3; ++t) {
+		for (u32 i = 0; i < TLUT_CRAM_ENTRIES; ++i) {
+			tlut_table[i] = (t << 12) | i;
+		}
+		if (tlut_Load(tlut_full, tlut_table, TLUT_CRAM_ENTRIES, TLUT_INDX(types[t], 0))) {
+			printf("tlut: full upload of table %u doesn't decode\n", t);
+			return -1;
+		}
+	}
+
+	for (u32 mask = 1; mask < 0x100; ++mask) {
+		u8 blk_dirty[8];
+		for (u32 b = 0; b < 8; ++b) {
+			blk_dirty[b] = (mask >> b) & 1;
+		}
+		memset(tlut_tmem, 0xFF, sizeof(tlut_tmem));
+		for (u32 t = 0; t < 3; ++t) {
+			for (u32 i = 0; i < TLUT_CRAM_ENTRIES; ++i) {
+				tlut_table[i] = (t << 12) | i;
+			}
+			u32 n;
+			for (u32 b = 0; (n = SGX_TlutBlockRun(blk_dirty, &b)) != 0; b += n) {
+				if (tlut_Load(tlut_tmem, tlut_table + (b << 8), n << 8, TLUT_INDX_BLK(types[t], b, n))) {
+					printf("tlut: blocks %u-%u of table %u don't decode\n", b, b + n - 1, t);
+					return -1;
+				}
+				loads++;
+			}
+		}
+		for (u32 i = 0; i < TLUT_TMEM_ENTRIES; ++i) {
+			u16 want = tlut_full[i];
+			//Full upload entries are tagged with the block they came from
+			if (want != TLUT_UNTOUCHED && !blk_dirty[(want & 0x7FF) >> 8]) {
+				want = TLUT_UNTOUCHED;
+			}
+			if (tlut_tmem[i] != want) {
+				printf("tlut: dirty blocks %02x, TMEM entry %04x holds %04x instead of %04x\n",
+					mask, i, tlut_tmem[i], want);
+				return -1;
+			}
+		}
+	}
+	printf("tlut: %u block loads over 255 dirty sets match the full upload\n", loads);
+	return 0;
+}
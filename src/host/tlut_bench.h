@@ -0,0 +1,16 @@
+#ifndef __TLUT_BENCH_H__
+#define __TLUT_BENCH_H__
+
+/*
+ * tlut_bench.h
+ *--------------------
+ * Checks the color RAM palette block uploads for setagx-bench
+ */
+
+#include "../core.h"
+
+//Returns 0 when every set of dirty blocks lands where a full upload puts it
+int tlut_Bench(void);
+
+
+#endif /*__TLUT_BENCH_H__*/
@@ -21,6 +21,7 @@
 #include "memory.h"
 #include "musashi/m68k.h"
 #include "musashi/m68kcpu.h"
+#include "state.h"
 
 extern u8 * SoundRam;
 
@@ -157,6 +158,12 @@ void musashi_SetWriteW(M68K_WRITE *func)
 	mus_write16 = func;
 }
 
+//Same copy m68k_get_context makes
+void musashi_AddState(void)
+{
+	state_AddRegion("68K", &m68ki_cpu, sizeof(m68ki_cpu));
+}
+
 //Implementation for musashi read/write functions
 u32 m68k_read_memory_8(u32 address)
 {
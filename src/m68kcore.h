@@ -54,6 +54,7 @@ void musashi_SetReadB(M68K_READ *func);
 void musashi_SetReadW(M68K_READ *func);
 void musashi_SetWriteB(M68K_WRITE *func);
 void musashi_SetWriteW(M68K_WRITE *func);
+void musashi_AddState(void);
 //Implementation for musashi read/write functions
 u32 m68k_read_memory_8(u32 address);
 u32 m68k_read_memory_16(u32 address);
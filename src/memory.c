@@ -56,6 +56,9 @@ ReadFunc8 mem_read8_arr[0x100];
 ReadFunc16 mem_read16_arr[0x100];
 ReadFunc32 mem_read32_arr[0x100];
 
+mem_page mem_read_page[0x100];
+mem_page mem_write_page[0x100];
+
 
 //Mask for repeating memorymap sections
 u32 read_mask[0x800];
@@ -72,6 +75,13 @@ u32 write32_mask[0x800];
 #endif
 
 u8 *wram;
+//Marks the work RAM granules an SH2 core keeps decoded code for, CPU writes
+//to a marked granule are passed on to SH2WriteNotify
+u8 wram_code[WRAM_SIZE >> WRAM_CODE_SHIFT];
+u8 wram_dirty[WRAM_SIZE >> VRAM_DIRTY_SHIFT];
+u8 vdp1_ram_dirty[VRAM_DIRTY_PAGES];
+u8 vdp2_ram_dirty[VRAM_DIRTY_PAGES];
+vram_dirty_stats vram_stats;
 u8 *bios_rom;
 u8 *bup_ram;
 
@@ -211,13 +221,13 @@ u8  FASTCALL bios_Read8(u32 addr)
 
 u16 FASTCALL bios_Read16(u32 addr)
 {
-	return *((u16*) (bios_rom + (addr & (BIOS_SIZE - 1))));
+	return T2ReadWord(bios_rom, addr & (BIOS_SIZE - 1));
 }
 
 
 u32 FASTCALL bios_Read32(u32 addr)
 {
-	return *((u32*) (bios_rom + (addr & (BIOS_SIZE - 1))));
+	return T2ReadLong(bios_rom, addr & (BIOS_SIZE - 1));
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -244,31 +254,40 @@ u8 FASTCALL wram_Read8(u32 addr)
 u16 FASTCALL wram_Read16(u32 addr)
 {
 	addr = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
-	return *((u16*) (wram + addr));
+	return T2ReadWord(wram, addr);
 }
 
 u32 FASTCALL wram_Read32(u32 addr)
 {
 	addr = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
-	return *((u32*) (wram + addr));
+	return T2ReadLong(wram, addr);
 }
 
 void FASTCALL wram_Write8(u32 addr, u8 val)
 {
-	addr = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
-	wram[addr] = val;
+	u32 ofs = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
+	if (wram_code[ofs >> WRAM_CODE_SHIFT])
+		SH2WriteNotify(addr, 1);
+	wram_dirty[ofs >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
+	wram[ofs] = val;
 }
 
 void FASTCALL wram_Write16(u32 addr, u16 val)
 {
-	addr = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
-	*((u16*) (wram + addr)) = val;
+	u32 ofs = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
+	if (wram_code[ofs >> WRAM_CODE_SHIFT])
+		SH2WriteNotify(addr, 2);
+	wram_dirty[ofs >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
+	T2WriteWord(wram, ofs, val);
 }
 
 void FASTCALL wram_Write32(u32 addr, u32 val)
 {
-	addr = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
-	*((u32*) (wram + addr)) = val;
+	u32 ofs = (addr | ((addr >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1);
+	if (wram_code[ofs >> WRAM_CODE_SHIFT])
+		SH2WriteNotify(addr, 4);
+	wram_dirty[ofs >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
+	T2WriteLong(wram, ofs, val);
 }
 
 
@@ -416,6 +435,10 @@ void mem_allocate(void)
 void mem_Init(void)
 {
 	memset(wram, 0x0, WRAM_SIZE);
+	memset(wram_code, 0x0, sizeof(wram_code));
+	memset(wram_dirty, VRAM_DIRTY_ALL, sizeof(wram_dirty));
+	memset(vdp1_ram_dirty, VRAM_DIRTY_ALL, sizeof(vdp1_ram_dirty));
+	memset(vdp2_ram_dirty, VRAM_DIRTY_ALL, sizeof(vdp2_ram_dirty));
 	memset(bios_rom, 0x0, BIOS_SIZE);
 	memset(bup_ram, 0x0, BACKUP_RAM_SIZE);
 }
@@ -615,6 +638,88 @@ void MappedMemoryInit()
                                 &wram_Write8,
                                 &wram_Write16,
                                 &wram_Write32);
+
+	mem_PageInit();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void mem_PageFill(u32 start, u32 end, u8 *base, u32 mask, u32 r, u32 w)
+{
+	for (u32 i = start; i < end; ++i) {
+		if (r) {
+			mem_read_page[i].base = base;
+			mem_read_page[i].mask = mask;
+		}
+		if (w) {
+			mem_write_page[i].base = base;
+			mem_write_page[i].mask = mask;
+		}
+	}
+}
+
+//Must mirror the handlers set in MappedMemoryInit. Run again once the video
+//cores have allocated their RAM, pages with no memory yet stay on handlers.
+void mem_PageInit(void)
+{
+	memset(mem_read_page, 0, sizeof(mem_read_page));
+	memset(mem_write_page, 0, sizeof(mem_write_page));
+
+	mem_PageFill(0x00, 0x02, bios_rom, BIOS_SIZE - 1, 1, 0);
+	mem_PageFill(0x04, 0x06, wram, LOW_WRAM_SIZE - 1, 1, 1);
+	mem_PageFill(0xB8, 0xB9, Vdp1Ram, 0x7FFFF, 1, 1);
+	mem_PageFill(0xB9, 0xBA, Vdp1FrameBuffer, 0x3FFFF, 1, 1);
+	mem_PageFill(0xBC, 0xBE, Vdp2Ram, 0x7FFFF, 1, 1);
+	mem_PageFill(0xC0, 0xFF, wram + LOW_WRAM_SIZE, HIGH_WRAM_SIZE - 1, 1, 1);
+
+	for (u32 i = 0x04; i < 0x06; ++i) {
+		mem_write_page[i].code = wram_code;
+		mem_write_page[i].dirty = wram_dirty;
+	}
+	for (u32 i = 0xC0; i < 0xFF; ++i) {
+		mem_write_page[i].code = wram_code + (LOW_WRAM_SIZE >> WRAM_CODE_SHIFT);
+		mem_write_page[i].dirty = wram_dirty + (LOW_WRAM_SIZE >> VRAM_DIRTY_SHIFT);
+	}
+	mem_write_page[0xB8].dirty = vdp1_ram_dirty;
+	for (u32 i = 0xBC; i < 0xBE; ++i) {
+		mem_write_page[i].dirty = vdp2_ram_dirty;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Flushes the VDP RAM pages written since the last flush out of the data
+//cache, neighbouring pages in one call. Returns the number of pages flushed.
+u32 mem_DirtyFlush(u8 *ram, u8 *dirty)
+{
+	u32 pages = 0;
+	for (u32 i = 0; i < VRAM_DIRTY_PAGES; ++i) {
+		if (!(dirty[i] & VRAM_DIRTY_FLUSH)) {
+			continue;
+		}
+		u32 n = 0;
+		while (i + n < VRAM_DIRTY_PAGES && (dirty[i + n] & VRAM_DIRTY_FLUSH)) {
+			dirty[i + n] &= ~VRAM_DIRTY_FLUSH;
+			n++;
+		}
+		DCFlushRange(ram + (i << VRAM_DIRTY_SHIFT), n << VRAM_DIRTY_SHIFT);
+		pages += n;
+		i += n - 1;
+	}
+	return pages;
+}
+
+//Clears bit on every page and returns how many pages had it set
+u32 mem_DirtyTake(u8 *dirty, u32 bit)
+{
+	u32 pages = 0;
+	for (u32 i = 0; i < VRAM_DIRTY_PAGES; ++i) {
+		if (dirty[i] & bit) {
+			dirty[i] &= ~bit;
+			pages++;
+		}
+	}
+	return pages;
 }
 
 
@@ -631,7 +736,7 @@ u8 FASTCALL mem_Read8(u32 addr)
 		case 0x1:	//Cache-through area
 		case 0x5:	//dunno
 			addr &= 0x0FFFFFFF;
-			return mem_read8_arr[(addr >> 19) & 0xFF](addr);
+			return mem_PageRead8(addr);
 		case 0x3:	//Adress Array, read/write space
 			return 0;
 		case 0x2:	//Associative purge space
@@ -653,7 +758,7 @@ u16 FASTCALL mem_Read16(u32 addr)
 		case 0x1:	//Cache-through area
 		case 0x5:	//dunno
 			addr &= 0x0FFFFFFF;
-			return mem_read16_arr[(addr >> 19) & 0xFF](addr);
+			return mem_PageRead16(addr);
 		case 0x3:	//Adress Array, read/write space
 			return 0;
 		case 0x2:	//Associative purge space
@@ -675,7 +780,7 @@ u32 FASTCALL mem_Read32(u32 addr)
 		case 0x1:	//Cache-through area
 		case 0x5:	//dunno
 			addr &= 0x0FFFFFFF;
-			return mem_read32_arr[(addr >> 19) & 0xFF](addr);
+			return mem_PageRead32(addr);
 		case 0x3:	//Adress Array, read/write space
 			return AddressArrayReadLong(addr);
 		case 0x2:	//Associative purge space
@@ -697,7 +802,7 @@ void FASTCALL mem_Write8(u32 addr, u8 val)
 		case 0x1:	//Cache-through area
 		case 0x5:	//dunno
 			addr &= 0x0FFFFFFF;
-			mem_write8_arr[(addr >> 19) & 0xFF](addr, val); return;
+			mem_PageWrite8(addr, val); return;
 		case 0x3:	//Adress Array, read/write space
 			break;
 		case 0x2:	//Associative purge space
@@ -720,7 +825,7 @@ void FASTCALL mem_Write16(u32 addr, u16 val)
 		case 0x1:	//Cache-through area
 		case 0x5:	//dunno
 			addr &= 0x0FFFFFFF;
-			mem_write16_arr[(addr >> 19) & 0xFF](addr, val); return;
+			mem_PageWrite16(addr, val); return;
 		case 0x3:	//Adress Array, read/write space
 			break;
 		case 0x2:	//Associative purge space
@@ -743,7 +848,7 @@ void FASTCALL mem_Write32(u32 addr, u32 val)
 		case 0x1:	//Cache-through area
 		case 0x5:	//Dunno
 			addr &= 0x0FFFFFFF;
-			mem_write32_arr[(addr >> 19) & 0xFF](addr, val); return;
+			mem_PageWrite32(addr, val); return;
 		case 0x3:	//Adress Array, read/write space
 			AddressArrayWriteLong(addr, val); return;
 		case 0x2:	//Associative purge space
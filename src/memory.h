@@ -25,6 +25,9 @@
 #include "core.h"
 //#include "sh2core.h"
 
+/* All emulated memory is kept in Saturn (big endian) byte order, so on a
+   little endian host the word and long accessors swap on the way through */
+
 /* Type 1 Memory, faster for byte (8 bits) accesses */
 
 u8 * T1MemoryInit(u32);
@@ -37,12 +40,20 @@ static INLINE u8 T1ReadByte(u8 * mem, u32 addr)
 
 static INLINE u16 T1ReadWord(u8 * mem, u32 addr)
 {
+#ifdef WORDS_BIGENDIAN
    return *((u16 *) (mem + addr));
+#else
+   return BSWAP16(*((u16 *) (mem + addr)));
+#endif
 }
 
 static INLINE u32 T1ReadLong(u8 * mem, u32 addr)
 {
+#ifdef WORDS_BIGENDIAN
    return *((u32 *) (mem + addr));
+#else
+   return BSWAP32(*((u32 *) (mem + addr)));
+#endif
 }
 
 static INLINE void T1WriteByte(u8 * mem, u32 addr, u8 val)
@@ -52,12 +63,20 @@ static INLINE void T1WriteByte(u8 * mem, u32 addr, u8 val)
 
 static INLINE void T1WriteWord(u8 * mem, u32 addr, u16 val)
 {
+#ifdef WORDS_BIGENDIAN
    *((u16 *) (mem + addr)) = val;
+#else
+   *((u16 *) (mem + addr)) = BSWAP16(val);
+#endif
 }
 
 static INLINE void T1WriteLong(u8 * mem, u32 addr, u32 val)
 {
+#ifdef WORDS_BIGENDIAN
    *((u32 *) (mem + addr)) = val;
+#else
+   *((u32 *) (mem + addr)) = BSWAP32(val);
+#endif
 }
 
 /* Type 2 Memory, faster for word (16 bits) accesses */
@@ -72,12 +91,20 @@ static INLINE u8 T2ReadByte(u8 * mem, u32 addr)
 
 static INLINE u16 T2ReadWord(u8 * mem, u32 addr)
 {
+#ifdef WORDS_BIGENDIAN
    return *((u16 *) (mem + addr));
+#else
+   return BSWAP16(*((u16 *) (mem + addr)));
+#endif
 }
 
 static INLINE u32 T2ReadLong(u8 * mem, u32 addr)
 {
+#ifdef WORDS_BIGENDIAN
    return *((u32 *) (mem + addr));
+#else
+   return BSWAP32(*((u32 *) (mem + addr)));
+#endif
 }
 
 static INLINE void T2WriteByte(u8 * mem, u32 addr, u8 val)
@@ -87,12 +114,20 @@ static INLINE void T2WriteByte(u8 * mem, u32 addr, u8 val)
 
 static INLINE void T2WriteWord(u8 * mem, u32 addr, u16 val)
 {
+#ifdef WORDS_BIGENDIAN
    *((u16 *) (mem + addr)) = val;
+#else
+   *((u16 *) (mem + addr)) = BSWAP16(val);
+#endif
 }
 
 static INLINE void T2WriteLong(u8 * mem, u32 addr, u32 val)
 {
+#ifdef WORDS_BIGENDIAN
    *((u32 *) (mem + addr)) = val;
+#else
+   *((u32 *) (mem + addr)) = BSWAP32(val);
+#endif
 }
 
 /* Type 3 Memory, faster for long (32 bits) accesses */
@@ -113,12 +148,20 @@ static INLINE u8 T3ReadByte(T3Memory * mem, u32 addr)
 
 static INLINE u16 T3ReadWord(T3Memory * mem, u32 addr)
 {
+#ifdef WORDS_BIGENDIAN
 	return *((u16 *) (mem->mem + addr));
+#else
+	return BSWAP16(*((u16 *) (mem->mem + addr)));
+#endif
 }
 
 static INLINE u32 T3ReadLong(T3Memory * mem, u32 addr)
 {
+#ifdef WORDS_BIGENDIAN
 	return *((u32 *) (mem->mem + addr));
+#else
+	return BSWAP32(*((u32 *) (mem->mem + addr)));
+#endif
 }
 
 static INLINE void T3WriteByte(T3Memory * mem, u32 addr, u8 val)
@@ -128,12 +171,20 @@ static INLINE void T3WriteByte(T3Memory * mem, u32 addr, u8 val)
 
 static INLINE void T3WriteWord(T3Memory * mem, u32 addr, u16 val)
 {
+#ifdef WORDS_BIGENDIAN
 	*((u16 *) (mem->mem + addr)) = val;
+#else
+	*((u16 *) (mem->mem + addr)) = BSWAP16(val);
+#endif
 }
 
 static INLINE void T3WriteLong(T3Memory * mem, u32 addr, u32 val)
 {
+#ifdef WORDS_BIGENDIAN
 	*((u32 *) (mem->mem + addr)) = val;
+#else
+	*((u32 *) (mem->mem + addr)) = BSWAP32(val);
+#endif
 }
 
 static INLINE int T123Load(void * mem, u32 size, int type, const char *filename)
@@ -285,14 +336,46 @@ void FASTCALL mem_WriteNoCache8(u32 addr, u8 val);
 void FASTCALL mem_WriteNoCache16(u32 addr, u16 val);
 void FASTCALL mem_WriteNoCache32(u32 addr, u32 val);
 
+u8 FASTCALL bios_Read8(u32 addr);
+u32 FASTCALL bios_Read32(u32 addr);
+u8 FASTCALL wram_Read8(u32 addr);
+u16 FASTCALL wram_Read16(u32 addr);
+u32 FASTCALL wram_Read32(u32 addr);
+void FASTCALL wram_Write8(u32 addr, u8 val);
+void FASTCALL wram_Write16(u32 addr, u16 val);
+void FASTCALL wram_Write32(u32 addr, u32 val);
+
 #define HIGH_WRAM_SIZE		0x100000
 #define LOW_WRAM_SIZE		0x100000
 #define WRAM_SIZE			0x200000
 #define BIOS_SIZE			0x80000
 #define BACKUP_RAM_SIZE		0x10000
 #define PAGE_SIZE			4096
+#define WRAM_CODE_SHIFT		7
 extern u8 bup_ram_written;
 
+//VDP1 and VDP2 RAM pages written since each consumer last looked, one byte
+//per 4KB page with a bit per consumer. Writes set every bit. Work RAM has a
+//map of its own that only the state snapshots read.
+#define VRAM_DIRTY_SHIFT	12
+#define VRAM_DIRTY_PAGES	(0x80000 >> VRAM_DIRTY_SHIFT)
+#define VRAM_DIRTY_FLUSH	0x01	//Still has to be flushed from the data cache
+#define VRAM_DIRTY_TEX		0x02	//GX texture cache may hold stale texels
+#define VRAM_DIRTY_TEXC		0x04	//Converted VDP1 sprites need a new generation
+#define VRAM_DIRTY_CMD		0x08	//Decoded VDP1 command list may be stale
+#define VRAM_DIRTY_LIST		0x10	//VDP2 display lists that read the page may be stale
+#define VRAM_DIRTY_STATE	0x20	//Not copied into the state snapshots yet
+#define VRAM_DIRTY_ALL		0xFF
+
+//Running totals, the frame rate tells how many pages each frame costs
+typedef struct {
+	u32 vdp1_flushed;	//VDP1 RAM pages flushed from the data cache
+	u32 vdp2_flushed;	//VDP2 RAM pages flushed from the data cache
+	u32 tex_pages;		//Pages that made the VRAM textures be invalidated
+	u32 tex_kept;		//Frames that kept the VRAM textures cached
+	u32 cmd_built;		//Times the VDP1 command list was decoded
+} vram_dirty_stats;
+
 typedef void (FASTCALL *WriteFunc8)(u32, u8);
 typedef void (FASTCALL *WriteFunc16)(u32, u16);
 typedef void (FASTCALL *WriteFunc32)(u32, u32);
@@ -337,6 +420,11 @@ void mem_allocate(void);
 void mem_Deinit(void);
 
 extern u8 *wram;
+extern u8 wram_code[WRAM_SIZE >> WRAM_CODE_SHIFT];
+extern u8 wram_dirty[WRAM_SIZE >> VRAM_DIRTY_SHIFT];
+extern u8 vdp1_ram_dirty[VRAM_DIRTY_PAGES];
+extern u8 vdp2_ram_dirty[VRAM_DIRTY_PAGES];
+extern vram_dirty_stats vram_stats;
 extern u8 *bup_ram;
 extern u8 *bios_rom;
 extern u8 *wii_vram;
@@ -345,6 +433,111 @@ extern u8 *Vdp1FrameBuffer;
 extern u8 *SoundRam;
 extern u32 *display_fb;
 
+/* Direct mapped pages, same 512KB granularity as the handler tables. Pages
+   with a host pointer are plain memory and are accessed with a single masked
+   load or store, the rest (base == NULL) go through the handlers. Work RAM
+   pages also point at their wram_code marks so SH2 cores still see writes
+   to decoded code, work RAM and VDP RAM pages at their dirty page map. */
+typedef struct {
+	u8 *base;
+	u8 *code;
+	u8 *dirty;
+	u32 mask;
+} mem_page;
+
+extern mem_page mem_read_page[0x100];
+extern mem_page mem_write_page[0x100];
+
+void mem_PageInit(void);
+void SH2WriteNotify(u32 start, u32 length);
+u32 mem_DirtyFlush(u8 *ram, u8 *dirty);
+u32 mem_DirtyTake(u8 *dirty, u32 bit);
+
+// Bytes left before addr leaves its 512k page or wraps the page mask
+static INLINE u32 mem_PageRoom(u32 addr, u32 mask)
+{
+	u32 to_wrap = mask + 1 - (addr & mask);
+	u32 to_page = 0x80000 - (addr & 0x7FFFF);
+	return (to_wrap < to_page) ? to_wrap : to_page;
+}
+
+static INLINE void mem_DirtyRange(u8 *dirty, u32 ofs, u32 len)
+{
+	u32 end = (ofs + len - 1) >> VRAM_DIRTY_SHIFT;
+	for (u32 i = ofs >> VRAM_DIRTY_SHIFT; i <= end; ++i) {
+		dirty[i] = VRAM_DIRTY_ALL;
+	}
+}
+
+static INLINE u8 mem_PageRead8(u32 addr)
+{
+	const mem_page *page = &mem_read_page[MEM_GET_FUNC_ADDR(addr)];
+	if (LIKELY(page->base != NULL))
+		return T2ReadByte(page->base, addr & page->mask);
+	return mem_read8_arr[MEM_GET_FUNC_ADDR(addr)](addr);
+}
+
+static INLINE u16 mem_PageRead16(u32 addr)
+{
+	const mem_page *page = &mem_read_page[MEM_GET_FUNC_ADDR(addr)];
+	if (LIKELY(page->base != NULL))
+		return T2ReadWord(page->base, addr & page->mask);
+	return mem_read16_arr[MEM_GET_FUNC_ADDR(addr)](addr);
+}
+
+static INLINE u32 mem_PageRead32(u32 addr)
+{
+	const mem_page *page = &mem_read_page[MEM_GET_FUNC_ADDR(addr)];
+	if (LIKELY(page->base != NULL))
+		return T2ReadLong(page->base, addr & page->mask);
+	return mem_read32_arr[MEM_GET_FUNC_ADDR(addr)](addr);
+}
+
+static INLINE void mem_PageWrite8(u32 addr, u8 val)
+{
+	const mem_page *page = &mem_write_page[MEM_GET_FUNC_ADDR(addr)];
+	if (LIKELY(page->base != NULL)) {
+		u32 ofs = addr & page->mask;
+		if (page->code && page->code[ofs >> WRAM_CODE_SHIFT])
+			SH2WriteNotify(addr, 1);
+		if (page->dirty)
+			page->dirty[ofs >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
+		T2WriteByte(page->base, ofs, val);
+		return;
+	}
+	mem_write8_arr[MEM_GET_FUNC_ADDR(addr)](addr, val);
+}
+
+static INLINE void mem_PageWrite16(u32 addr, u16 val)
+{
+	const mem_page *page = &mem_write_page[MEM_GET_FUNC_ADDR(addr)];
+	if (LIKELY(page->base != NULL)) {
+		u32 ofs = addr & page->mask;
+		if (page->code && page->code[ofs >> WRAM_CODE_SHIFT])
+			SH2WriteNotify(addr, 2);
+		if (page->dirty)
+			page->dirty[ofs >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
+		T2WriteWord(page->base, ofs, val);
+		return;
+	}
+	mem_write16_arr[MEM_GET_FUNC_ADDR(addr)](addr, val);
+}
+
+static INLINE void mem_PageWrite32(u32 addr, u32 val)
+{
+	const mem_page *page = &mem_write_page[MEM_GET_FUNC_ADDR(addr)];
+	if (LIKELY(page->base != NULL)) {
+		u32 ofs = addr & page->mask;
+		if (page->code && page->code[ofs >> WRAM_CODE_SHIFT])
+			SH2WriteNotify(addr, 4);
+		if (page->dirty)
+			page->dirty[ofs >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
+		T2WriteLong(page->base, ofs, val);
+		return;
+	}
+	mem_write32_arr[MEM_GET_FUNC_ADDR(addr)](addr, val);
+}
+
 int LoadBios(const char *filename);
 int LoadBackupRam(const char *filename);
 void FormatBackupRam(void *mem, u32 size);
@@ -1,5 +1,6 @@
 
 
+#include <string.h>
 #include "gui.h"
 
 
@@ -20,6 +21,10 @@ const u32 gui_palette[] = {
 	0x404040ff, 0xa0b0a0ff, 0x00d0d090, 0xFFFFFFFF, 0x0,
 };
 
+/*Text of the bottom strip*/
+static char gui_status[40] = {0};
+static u32 gui_status_len = 0;
+
 static inline void gui_DrawOptions(GuiElem *elem)
 {
 
@@ -51,10 +56,9 @@ void gui_Init(void)
 }
 
 
-static void gui_DrawItems(GuiItems *items, u32 width)
+/*Sets up the TEV to draw text in the given color*/
+static void gui_TextBegin(u32 color)
 {
-	u32 ofs_x = items->x, ofs_y = items->y;
-
 	GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
 	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
 	GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_NOOP);
@@ -67,40 +71,47 @@ static void gui_DrawItems(GuiItems *items, u32 width)
 	GX_InitTexObjLOD(&gui_tobj, GX_NEAR, GX_NEAR, 0, 0, 0, GX_DISABLE, GX_DISABLE, GX_ANISO_1);
 	GX_LoadTexObj(&gui_tobj, GX_TEXMAP0);
 
+	GX_SetTevKColor(GX_KCOLOR0, *((GXColor*) &gui_palette[color]));
+}
+
+
+/*Draws len characters of str at x, y (in 320x240 units)*/
+static void gui_DrawText(u32 x, u32 y, const char *str, u32 len)
+{
+	GX_Begin(GX_QUADS, GX_VTXFMT7, 4 * len);
+		while (len) {
+			//XXX: Use a texCoordGen for this.
+			f32 chr_x = (f32) ((*str) & 0x1F) * 0.03125;
+			f32 chr_y = (f32) (((*str) >> 5) & 0x3) * 0.125;
+			u32 spacing = 8;
+			x -= (8 - spacing);
+			GX_Position2u16(x <<1, y<<1);					// Top Left
+			GX_TexCoord2f32(chr_x, chr_y);
+			GX_Position2u16((x + 8)<<1, y<<1);			// Top Right
+			GX_TexCoord2f32(chr_x + 0.03125, chr_y);
+			GX_Position2u16((x + 8)<<1, (y + 8)<<1);	// Bottom Right
+			GX_TexCoord2f32(chr_x + 0.03125, chr_y + 0.125);
+			GX_Position2u16(x<<1, (y + 8)<<1);			// Bottom Left
+			GX_TexCoord2f32(chr_x, chr_y + 0.125);
+			x += 8;
+			++str;
+			--len;
+		}
+	GX_End();
+}
+
+
+static void gui_DrawItems(GuiItems *items, u32 width)
+{
+	u32 ofs_x = items->x, ofs_y = items->y;
+
 	u32 shown_entries = (items->count > items->disp_count ? items->disp_count : items->count);
 	u32 cursor_pos = items->cursor - items->disp_offset;
 
-	GX_SetTevColorIn(GX_TEVSTAGE0, GX_CC_ZERO, GX_CC_KONST, GX_CC_TEXC, GX_CC_ZERO);
-	GX_SetTevKColor(GX_KCOLOR0, *((GXColor*) &gui_palette[3]));
-	GX_SetVtxDesc(GX_VA_POS, GX_DIRECT);
-	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
-
+	gui_TextBegin(3);
 	for (int i = 0; i < shown_entries; ++i) {
-		u32 x = ofs_x + 8, y = (i * 10) + ofs_y;
-		u32 len = items->item[i + items->disp_offset].len;
-		u8 *str = items->item[i + items->disp_offset].data;
-
-		GX_Begin(GX_QUADS, GX_VTXFMT7, 4 * len);
-			/*not while m_ptr, must use index for this because of circular buffering*/
-			while (len) {
-				//XXX: Use a texCoordGen for this.
-				f32 chr_x = (f32) ((*str) & 0x1F) * 0.03125;
-				f32 chr_y = (f32) (((*str) >> 5) & 0x3) * 0.125;
-				u32 spacing = 8;
-				x -= (8 - spacing);
-				GX_Position2u16(x <<1, y<<1);					// Top Left
-				GX_TexCoord2f32(chr_x, chr_y);
-				GX_Position2u16((x + 8)<<1, y<<1);			// Top Right
-				GX_TexCoord2f32(chr_x + 0.03125, chr_y);
-				GX_Position2u16((x + 8)<<1, (y + 8)<<1);	// Bottom Right
-				GX_TexCoord2f32(chr_x + 0.03125, chr_y + 0.125);
-				GX_Position2u16(x<<1, (y + 8)<<1);			// Bottom Left
-				GX_TexCoord2f32(chr_x, chr_y + 0.125);
-				x += 8;
-				++str;
-				--len;
-			}
-		GX_End();
+		String *item = &items->item[i + items->disp_offset];
+		gui_DrawText(ofs_x + 8, (i * 10) + ofs_y, item->data, item->len);
 	}
 
 	GX_SetTevKColor(GX_KCOLOR0, *((GXColor*) &gui_palette[2]));
@@ -177,5 +188,16 @@ void gui_Draw(GuiItems *items)
 	GX_End();
 
 	gui_DrawItems(items, 200);
+	if (gui_status_len) {
+		gui_TextBegin(3);
+		gui_DrawText(8, 227, gui_status, gui_status_len);
+	}
 	GX_SetTevKColor(GX_KCOLOR0, *((GXColor*) &gui_palette[4]));
 }
+
+
+void gui_SetStatus(const char *str)
+{
+	strncpy(gui_status, str, sizeof(gui_status) - 1);
+	gui_status_len = strlen(gui_status);
+}
@@ -73,6 +73,8 @@ typedef struct GuiAnim {
 
 void gui_Init(void);
 void gui_Draw(GuiItems *items);
+//Text shown in the strip at the bottom of the menu
+void gui_SetStatus(const char *str);
 
 
 u32 gui_AnimSet(GuiAnim *anim, GuiElem *elems);
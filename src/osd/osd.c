@@ -27,7 +27,7 @@ GXTexObj osd_tobj;
 
 u8 msg_buffer[0x800];
 u32 msg_index = 0;
-u64 cycle_data[8];
+u64 cycle_data[OSD_CYCLES_NUM];
 
 extern u8 osd_texture_4bpp[];
 extern yabsys_struct yabsys;
@@ -140,7 +140,7 @@ void osd_MsgShow(void)
 
 	u32 cycle_x = 8;
 	u32 cycle_y = 440;
-	for (u32 i = 0; i < 5; ++i, cycle_x += 4) {
+	for (u32 i = 0; i < OSD_CYCLES_NUM; ++i, cycle_x += 4) {
 		GX_SetTevKColor(GX_KCOLOR0, *((GXColor*) &colors[i]));
 		GX_Begin(GX_QUADS, GX_VTXFMT7, 4);
 			GX_Position2u16(cycle_x + 4, cycle_y - cycle_data[i]);	// Top Left
@@ -17,6 +17,16 @@
 #define OSD_MSG_BG			0x01
 #define OSD_MSG_MONO		0x02
 
+//Indices for osd_CyclesSet, one per timed subsystem in YabauseEmulate
+#define OSD_CYCLES_MSH2		0
+#define OSD_CYCLES_SSH2		1
+#define OSD_CYCLES_SCU		2
+#define OSD_CYCLES_SMPC		3
+#define OSD_CYCLES_CDB		4
+#define OSD_CYCLES_VDP		5
+#define OSD_CYCLES_SCSP		6
+#define OSD_CYCLES_NUM		7
+
 
 void osd_MsgAdd(u32 x, u32 y, u32 color, char *str);
 void osd_MsgShow(void);
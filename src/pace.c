@@ -0,0 +1,172 @@
+/*
+ * pace.c
+ *--------------------
+ * Frame pacing. Every mode keeps the time the next frame is due; a frame is
+ * late when it is shown after that. In PACE_VSYNC a frame that is early
+ * waits for the retrace and the due time locks onto it. PACE_AUDIO waits
+ * while the audio queue holds more than a few frames and counts a frame as
+ * late when the queue is nearly empty, which keeps sound from underrunning
+ * when the refresh rate and the Saturn frame rate differ. With frameskip on
+ * a late frame makes the next one skip drawing, at most PACE_MAX_SKIP in a
+ * row so the screen never freezes.
+ */
+
+#include <unistd.h>
+#include <string.h>
+#include <gccore.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "pace.h"
+#include "yabause.h"
+#include "snd.h"
+
+#define PACE_AUDIO_RATE		(44100 * 4)	//Bytes of 16 bit stereo per second
+#define PACE_AUDIO_HIGH		3			//Frames of audio queued before waiting
+#define PACE_AUDIO_LOW		1			//Frames of audio queued before a frame is late
+
+static u32 pace_mode = PACE_VSYNC;
+static u32 pace_frameskip = 0;
+static u32 pace_skip = 0;			//The frame being emulated isn't drawn
+static u32 pace_skip_run = 0;
+static u64 pace_next;				//Time the frame being emulated is due
+static u64 pace_shown;				//Time the last drawn frame was shown
+static u32 pace_audio_frame;		//Bytes of audio in a frame
+static pace_stats pace_st;
+
+//////////////////////////////////////////////////////////////////////////////
+
+void pace_Reset(void)
+{
+	pace_audio_frame = (u32) ((u64) PACE_AUDIO_RATE * yabsys.OneFrameTime / yabsys.tickfreq);
+	pace_shown = YabauseGetTicks();
+	pace_next = pace_shown + yabsys.OneFrameTime;
+	pace_skip = 0;
+	pace_skip_run = 0;
+	memset(&pace_st, 0, sizeof(pace_st));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void pace_SetMode(u32 mode)
+{
+	pace_mode = mode;
+	pace_skip = 0;
+	pace_next = YabauseGetTicks() + yabsys.OneFrameTime;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 pace_GetMode(void)
+{
+	return pace_mode;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void pace_SetFrameskip(u32 on)
+{
+	pace_frameskip = on;
+	pace_skip = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 pace_Skip(void)
+{
+	return pace_skip;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 pace_WaitVSync(void)
+{
+	const u64 margin = yabsys.OneFrameTime >> 2;
+	u64 now = YabauseGetTicks();
+
+	if (now + margin >= pace_next) {
+		return 0;
+	}
+	do {
+		VIDEO_WaitVSync();
+		now = YabauseGetTicks();
+	} while (now + margin < pace_next);
+	return 1;
+}
+
+static u32 pace_WaitAudio(void)
+{
+	const u64 timeout = YabauseGetTicks() + (yabsys.OneFrameTime << 1);
+
+	if (snd_GetAudioQueued() <= PACE_AUDIO_HIGH * pace_audio_frame) {
+		return 0;
+	}
+	//The queue drains at a steady rate, give up if it doesn't
+	while (snd_GetAudioQueued() > PACE_AUDIO_HIGH * pace_audio_frame &&
+		YabauseGetTicks() < timeout) {
+		usleep(500);
+	}
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void pace_EndFrame(void)
+{
+	const u64 frame = yabsys.OneFrameTime;
+	u64 start = YabauseGetTicks();
+	u32 waited = 0;
+	u32 late;
+
+	if (!pace_skip) {
+		if (pace_mode == PACE_VSYNC) {
+			waited = pace_WaitVSync();
+		} else if (pace_mode == PACE_AUDIO) {
+			waited = pace_WaitAudio();
+		}
+	}
+
+	u64 now = YabauseGetTicks();
+	if (waited) {
+		pace_st.waited++;
+		pace_st.wait_ticks += now - start;
+		if (pace_mode == PACE_VSYNC) {
+			//Shown on this retrace
+			pace_next = now;
+		}
+	}
+	if (!pace_skip) {
+		u32 ms = (u32) ticks_to_millisecs(now - pace_shown);
+		pace_st.hist[ms < PACE_HIST_BINS ? ms : PACE_HIST_BINS - 1]++;
+		pace_shown = now;
+	} else {
+		pace_st.skipped++;
+	}
+	pace_st.frames++;
+
+	pace_next += frame;
+	if (pace_mode == PACE_AUDIO) {
+		late = snd_GetAudioQueued() < PACE_AUDIO_LOW * pace_audio_frame;
+	} else {
+		late = now > pace_next;
+	}
+	//Too far behind to catch up, start again from now
+	if (now > pace_next + PACE_MAX_SKIP * frame) {
+		pace_next = now + frame;
+	}
+
+	if (pace_frameskip && late && pace_mode != PACE_UNCAPPED &&
+		pace_skip_run < PACE_MAX_SKIP) {
+		pace_skip = 1;
+		pace_skip_run++;
+	} else {
+		pace_skip = 0;
+		pace_skip_run = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void pace_GetStats(pace_stats *stats)
+{
+	*stats = pace_st;
+}
@@ -0,0 +1,44 @@
+#ifndef __PACE_H__
+#define __PACE_H__
+
+/*
+ * pace.h
+ *--------------------
+ * Frame pacing: when a frame is shown, how long to wait for it and which
+ * frames are skipped to catch up
+ */
+
+#include "core.h"
+
+#define PACE_VSYNC			0	//One frame per OneFrameTime, waiting on the retrace
+#define PACE_AUDIO			1	//Waits while the audio queue is full enough
+#define PACE_UNCAPPED		2	//Never waits, for benchmarking
+
+#define PACE_MAX_SKIP		3	//Frames skipped in a row at most
+#define PACE_HIST_BINS		64	//Frame times in 1 ms bins, the last one counts the rest
+
+//Running totals since pace_Reset
+typedef struct {
+	u32 frames;
+	u32 skipped;			//Frames emulated without drawing
+	u32 waited;				//Frames that had to wait to be shown
+	u64 wait_ticks;
+	u32 hist[PACE_HIST_BINS];	//Time between frames shown, in ms
+} pace_stats;
+
+//Starts pacing from now, call when the frame time changes
+void pace_Reset(void);
+void pace_SetMode(u32 mode);
+u32 pace_GetMode(void);
+//Dynamic frameskip, off by default
+void pace_SetFrameskip(u32 on);
+//Returns 1 when the frame being emulated shouldn't be drawn
+u32 pace_Skip(void);
+//Call once the frame is drawn and before it is shown: waits as the mode
+//says and decides whether the next frame is skipped
+void pace_EndFrame(void);
+
+void pace_GetStats(pace_stats *stats);
+
+
+#endif /*__PACE_H__*/
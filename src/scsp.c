@@ -3284,8 +3284,6 @@ SCSScsp1Init(int coreid, void (*interrupt_handler)(void))
 int
 ScspChangeSoundCore (int coreid)
 {
-	int i;
-
 	//TODO: Dont deinit, just pause
     snd_DeInit();
 
@@ -66,6 +66,8 @@ typedef struct
 	void FASTCALL (*WriteWord)(u32 address, u16 data);
 	void FASTCALL (*WriteLong)(u32 address, u32 data);
 	M68KBreakpointInfo *(*M68KGetBreakpointList)(void);
+	void (*AddStateRegions)(void);		// NULL if snapshots aren't supported
+	void (*Sync)(void);					// Waits for a core thread to catch up, NULL without one
 } SCSPInterface_struct;
 
 extern SCSPInterface_struct *SCSCore;
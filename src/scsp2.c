@@ -27,6 +27,8 @@
 #include "m68kcore.h"
 #include "memory.h"
 #include "scsp.h"
+#include "state.h"
+#include "threads.h"
 #include "yabause.h"
 
 #include <math.h>
@@ -65,6 +67,8 @@ static void FASTCALL SCSScsp2WriteByte(u32 address, u8 data);
 static void FASTCALL SCSScsp2WriteWord(u32 address, u16 data);
 static void FASTCALL SCSScsp2WriteLong(u32 address, u32 data);
 static M68KBreakpointInfo *SCSScsp2M68KGetBreakpointList(void);
+static void SCSScsp2AddStateRegions(void);
+static void SCSScsp2Sync(void);
 
 SCSPInterface_struct SCSScsp2 = {
 SCSCORE_SCSP2,
@@ -95,7 +99,9 @@ SCSScsp2ReadLong,
 SCSScsp2WriteByte,
 SCSScsp2WriteWord,
 SCSScsp2WriteLong,
-SCSScsp2M68KGetBreakpointList
+SCSScsp2M68KGetBreakpointList,
+SCSScsp2AddStateRegions,
+SCSScsp2Sync
 };
 #endif
 
@@ -116,15 +122,13 @@ SCSScsp2M68KGetBreakpointList
 // both when clock_target is updated and when register writes, discussed
 // below, are submitted.
 //
-// Additionally, any register writes from outside the SCSP/M68K will be
-// processed synchronously in multithreaded mode, by passing the write
-// through a shared buffer (scsp_write_buffer_* variables).  When the
-// thread loop detects scsp_write_buffer_size nonzero, it processes the
-// write before its next ScspDoExec() iteration and clears ..._size; the
-// main thread then waits for ..._size to return to zero before returning
-// from the write operation.  (This will typically be no more expensive
-// than a pair of context switches, and it seems that SCSP register writes
-// from the SH-2 are uncommon.)
+// Additionally, any register writes from outside the SCSP/M68K are passed
+// to the thread in multithreaded mode through a single producer, single
+// consumer queue (scsp_write_queue).  The thread loop applies every queued
+// write before its next ScspDoExec() iteration, so they land at the same
+// point of the SCSP timeline as before, and the main thread only waits when
+// the queue is full or when it reads a register while writes are still
+// queued, so it always reads back what it wrote.
 //
 // The "PSP_*" macros scattered throughout the file are to support the
 // execution of the SCSP thread on the Media Engine CPU (ME) in the PSP.
@@ -573,14 +577,13 @@ PSP_SECTION(sc_write)
 PSP_SECTION(both_write)
    static volatile u8 scsp_main_interrupt_pending;
 
-// Buffer for external (SH-2) SCSP writes (only _size is written by both
-// CPUs, but we keep all three in the same section for cache safety)
+// Queue of external (SH-2) SCSP writes, each one is the access size in
+// bytes, the register address and the data (see ScspQueueWrite())
+#define SCSP_WRITE_QUEUE_SIZE  256
 PSP_SECTION(both_write)
-   static volatile u8 scsp_write_buffer_size;  // 0 = nothing buffered
+   static YabQueue scsp_write_queue;
 PSP_SECTION(both_write)
-   static volatile u16 scsp_write_buffer_address;
-PSP_SECTION(both_write)
-   static volatile u32 scsp_write_buffer_data;
+   static u64 scsp_write_queue_items[SCSP_WRITE_QUEUE_SIZE];
 
 // SCSP register value cache (caching handled separately)
 #ifdef PSP
@@ -656,6 +659,8 @@ static void ScspMidiOut(u8 data);
 static void ScspDoDMA(void);
 
 static void ScspSyncThread(void);
+static void ScspStopThread(void);
+static void ScspQueueWrite(u8 size, u32 address, u32 data);
 static void ScspRaiseInterrupt(int which, int target);
 static void ScspCheckInterrupts(u16 mask, int target);
 static void ScspClearInterrupts(u16 mask, int target);
@@ -683,6 +688,11 @@ static int scsp_volume = 100;
 // A couple of handy sub-macros:
 #define ADDRESS      (addr_counter >> SCSP_FREQ_LOW_BITS)
 #define ADDRESS_8BIT (ADDRESS)
+#ifdef WORDS_BIGENDIAN
+#define SAMPLE_16BIT(buf, addr) (((const s16 *)(buf))[addr])
+#else
+#define SAMPLE_16BIT(buf, addr) ((s16) BSWAP16(((const u16 *)(buf))[addr]))
+#endif
 #define ENV_POS      (env_counter >> SCSP_ENV_LOW_BITS)
 #define LFO_POS      ((slot->lfo_counter >> SCSP_LFO_LOW_BITS) & SCSP_LFO_MASK)
 
@@ -711,7 +721,7 @@ static void FASTCALL audiogen_##tag(SlotState *slot, u32 len)               \
          {                                                                  \
             s32 out;                                                        \
             if (S)                                                          \
-               out = (s32) ((const s16 *)slot->buf)[ADDRESS];               \
+               out = (s32) SAMPLE_16BIT(slot->buf, ADDRESS);                 \
             else                                                            \
                out = (s32) ((const s8 *)slot->buf)[ADDRESS_8BIT] << 8;      \
             out *= env;                                                     \
@@ -875,6 +885,10 @@ int SCSScsp2Init(int coreid, void (*interrupt_handler)(void))
    int i, j;
    double x;
 
+   // A thread left from an earlier init would run over what we set up here
+   if (scsp_thread_running)
+      ScspStopThread();
+
 	//SoundRam = AUDIO_RAM_BASE;
    memset(SoundRam, 0, 0x80000);
 
@@ -1031,9 +1045,9 @@ int SCSScsp2Init(int coreid, void (*interrupt_handler)(void))
    // Start a subthread if requested
 
    scsp_thread_running = 0;
-#if 0
    if (yabsys.UseThreads)
    {
+      YabQueueInit(&scsp_write_queue, scsp_write_queue_items, SCSP_WRITE_QUEUE_SIZE);
       scsp_thread_running = 1;  // Set now so the thread doesn't quit instantly
       PSP_FLUSH_ALL();
       if (YabThreadStart(YAB_THREAD_SCSP, ScspThread) < 0)
@@ -1042,7 +1056,6 @@ int SCSScsp2Init(int coreid, void (*interrupt_handler)(void))
          scsp_thread_running = 0;
       }
    }
-#endif
 
    // Successfully initialized!
 
@@ -1125,7 +1138,6 @@ void SCSScsp2Reset(void)
    scsp.sample_timer = 0;
 
    scsp_main_interrupt_pending = 0;
-   scsp_write_buffer_size = 0;
 
    cdda_next_in = 0;
    cdda_next_out = 0;
@@ -1296,6 +1308,8 @@ void ScspDeInit(void)
 void SCSScsp2DeInit(void)
 #endif
 {
+   if (scsp_thread_running)
+      ScspStopThread();
 	snd_DeInit();
 }
 
@@ -1323,7 +1337,6 @@ void SCSScsp2Exec(int decilines)
    new_target = scsp_clock_target + (scsp_clock_frac >> 20);
    scsp_clock_target = new_target;
    scsp_clock_frac &= 0xFFFFF;
-#if 0
    if (scsp_thread_running)
    {
 #ifdef PSP
@@ -1331,6 +1344,9 @@ void SCSScsp2Exec(int decilines)
           PSP_UC(scsp_clock_target) = new_target; // Push just this one through
 #endif
 
+      // Let the thread start on the new cycles now, only wait for it when
+      // it gets too far behind
+      YabThreadWake(YAB_THREAD_SCSP);
       while (new_target - PSP_UC(scsp_clock) > SCSP_CLOCK_MAX_EXEC)
       {
          YabThreadWake(YAB_THREAD_SCSP);
@@ -1343,7 +1359,6 @@ void SCSScsp2Exec(int decilines)
       }
    }
    else
-#endif
       ScspDoExec(new_target - scsp_clock);
 }
 
@@ -1354,16 +1369,16 @@ void SCSScsp2Exec(int decilines)
 
 static void ScspThread(void)
 {
-#if 0
    while (PSP_UC(scsp_thread_running))
    {
-      const u8 write_size = PSP_UC(scsp_write_buffer_size);
+      u64 write;
       u32 clock_cycles;
 
-      if (write_size != 0)
+      while (YabQueuePeek(&scsp_write_queue, &write))
       {
-         const u32 address = PSP_UC(scsp_write_buffer_address);
-         const u32 data = PSP_UC(scsp_write_buffer_data);
+         const u8 write_size = (u8)(write >> 48);
+         const u32 address = (u32)(write >> 32) & 0xFFF;
+         const u32 data = (u32)write;
          if (write_size == 1)
             ScspWriteByteDirect(address, data);
          else if (write_size == 2)
@@ -1371,9 +1386,9 @@ static void ScspThread(void)
          else
          {
             ScspWriteWordDirect(address, data >> 16);
-            ScspWriteWordDirect(address+2, data & 0xFFFF);
+            ScspWriteWordDirect((address+2) & 0xFFF, data & 0xFFFF);
          }
-         PSP_UC(scsp_write_buffer_size) = 0;
+         YabQueueDrop(&scsp_write_queue);
       }
 
       clock_cycles = PSP_UC(scsp_clock_target) - scsp_clock;
@@ -1385,13 +1400,8 @@ static void ScspThread(void)
          YabThreadYield();
       }
       else
-#ifndef GEKKO
-         YabThreadSleep();
-#else
          YabThreadSleep(YAB_THREAD_SCSP);
-#endif
    }
-#endif
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -1483,6 +1493,8 @@ static void ScspDoExec(u32 cycles)
 
    // Update scsp_clock last, so the main thread can use it as a signal
    // that we've finished processing to this point
+   if (scsp_thread_running)
+      YabThreadFence();
    scsp_clock += cycles;
 }
 
@@ -1709,6 +1721,12 @@ u16 FASTCALL SCSScsp2ReadWord(u32 address)
          return PSP_UC(scsp_regcache[address >> 1]);
    }
 #else
+   // Writes still queued for the thread have to land first
+   while (scsp_thread_running && !YabQueueEmpty(&scsp_write_queue))
+   {
+      YabThreadWake(YAB_THREAD_SCSP);
+      YabThreadYield();
+   }
    return ScspReadWordDirect(address & 0xFFF);
 #endif
 }
@@ -1734,20 +1752,11 @@ void FASTCALL ScspWriteByte(u32 address, u8 data)
 void FASTCALL SCSScsp2WriteByte(u32 address, u8 data)
 #endif
 {
-#if 0
    if (scsp_thread_running)
    {
-      PSP_UC(scsp_write_buffer_address) = address & 0xFFF;
-      PSP_UC(scsp_write_buffer_data) = data;
-      PSP_UC(scsp_write_buffer_size) = 1;
-      while (PSP_UC(scsp_write_buffer_size) != 0)
-      {
-         YabThreadWake(YAB_THREAD_SCSP);
-         YabThreadYield();
-      }
+      ScspQueueWrite(1, address, data);
       return;
    }
-#endif
    ScspWriteByteDirect(address & 0xFFF, data);
 }
 
@@ -1757,20 +1766,11 @@ void FASTCALL ScspWriteWord(u32 address, u16 data)
 void FASTCALL SCSScsp2WriteWord(u32 address, u16 data)
 #endif
 {
-#if 0
    if (scsp_thread_running)
    {
-      PSP_UC(scsp_write_buffer_address) = address & 0xFFF;
-      PSP_UC(scsp_write_buffer_data) = data;
-      PSP_UC(scsp_write_buffer_size) = 2;
-      while (PSP_UC(scsp_write_buffer_size) != 0)
-      {
-         YabThreadWake(YAB_THREAD_SCSP);
-         YabThreadYield();
-      }
+      ScspQueueWrite(2, address, data);
       return;
    }
-#endif
    ScspWriteWordDirect(address & 0xFFF, data);
 }
 
@@ -1780,20 +1780,11 @@ void FASTCALL ScspWriteLong(u32 address, u32 data)
 void FASTCALL SCSScsp2WriteLong(u32 address, u32 data)
 #endif
 {
-#if 0
    if (scsp_thread_running)
    {
-      PSP_UC(scsp_write_buffer_address) = address & 0xFFF;
-      PSP_UC(scsp_write_buffer_data) = data;
-      PSP_UC(scsp_write_buffer_size) = 4;
-      while (PSP_UC(scsp_write_buffer_size) != 0)
-      {
-         YabThreadWake(YAB_THREAD_SCSP);
-         YabThreadYield();
-      }
+      ScspQueueWrite(4, address, data);
       return;
    }
-#endif
    ScspWriteWordDirect(address & 0xFFF, data >> 16);
    ScspWriteWordDirect((address+2) & 0xFFF, data & 0xFFFF);
 }
@@ -2112,6 +2103,43 @@ int SCSSScsp2SoundLoadState(FILE *fp, int version, int size)
 
 //-------------------------------------------------------------------------
 
+// SCSScsp2AddStateRegions:  Add the SCSP and M68K state to the snapshot
+// being built by state_Create().  Unlike SoundSaveState() this covers every
+// internal variable, so a restored snapshot runs on exactly as before.  The
+// output buffer is left out, it only holds samples already generated.
+
+static void SCSScsp2AddStateRegions(void)
+{
+   state_AddRegion("SCSP", &scsp, sizeof(scsp));
+   state_AddRegion("SCSP-Regs", scsp_regcache, sizeof(scsp_regcache));
+   state_AddRegion("SCSP-Clock", (void *)&scsp_clock, sizeof(scsp_clock));
+   state_AddRegion("SCSP-Target", (void *)&scsp_clock_target, sizeof(scsp_clock_target));
+   state_AddRegion("SCSP-Frac", &scsp_clock_frac, sizeof(scsp_clock_frac));
+   state_AddRegion("SCSP-Irq", (void *)&scsp_main_interrupt_pending, sizeof(scsp_main_interrupt_pending));
+   state_AddRegion("SCSP-GenPos", &scsp_sound_genpos, sizeof(scsp_sound_genpos));
+   state_AddRegion("SCSP-Left", &scsp_sound_left, sizeof(scsp_sound_left));
+   state_AddRegion("CDDA", &cdda_buf, sizeof(cdda_buf));
+   state_AddRegion("CDDA-In", (void *)&cdda_next_in, sizeof(cdda_next_in));
+   state_AddRegion("CDDA-Out", (void *)&cdda_next_out, sizeof(cdda_next_out));
+   state_AddRegion("CDDA-Delay", &cdda_delay, sizeof(cdda_delay));
+   state_AddRegion("68K-Run", &m68k_running, sizeof(m68k_running));
+   state_AddRegion("68K-Cycles", &m68k_saved_cycles, sizeof(m68k_saved_cycles));
+   musashi_AddState();
+}
+
+//-------------------------------------------------------------------------
+
+// SCSScsp2Sync:  Wait for the SCSP subthread to catch up with the main
+// thread, so its state can be read or replaced.
+
+static void SCSScsp2Sync(void)
+{
+   if (scsp_thread_running)
+      ScspSyncThread();
+}
+
+//-------------------------------------------------------------------------
+
 // ScspSlotDebugStats:  Generate a string describing the given slot's state
 // and store it in the passed-in buffer (which is assumed to be large enough
 // to hold the result).
@@ -2895,13 +2923,42 @@ static void ScspDoDMA(void)
 static void ScspSyncThread(void)
 {
    PSP_FLUSH_ALL();
-#if 0
-   while (PSP_UC(scsp_clock) != scsp_clock_target)
+   while (PSP_UC(scsp_clock) != scsp_clock_target ||
+          !YabQueueEmpty(&scsp_write_queue))
+   {
+      YabThreadWake(YAB_THREAD_SCSP);
+      YabThreadYield();
+   }
+   YabThreadFence();
+}
+
+//-------------------------------------------------------------------------
+
+// ScspStopThread:  Let the SCSP subthread finish what it has pending, then
+// stop it and wait for it to exit.  Do not call if it is not running.
+
+static void ScspStopThread(void)
+{
+   ScspSyncThread();
+   scsp_thread_running = 0;
+   YabThreadWake(YAB_THREAD_SCSP);
+   YabThreadWait(YAB_THREAD_SCSP);
+}
+
+//-------------------------------------------------------------------------
+
+// ScspQueueWrite:  Pass an external register write to the SCSP subthread,
+// waiting for room if the queue is full.
+
+static void ScspQueueWrite(u8 size, u32 address, u32 data)
+{
+   const u64 write = (u64)size << 48 | (u64)(address & 0xFFF) << 32 | data;
+
+   while (!YabQueuePush(&scsp_write_queue, write))
    {
       YabThreadWake(YAB_THREAD_SCSP);
       YabThreadYield();
    }
-#endif
 }
 
 //-------------------------------------------------------------------------
@@ -52,6 +52,7 @@ static void FASTCALL SCSDummyWriteByte(u32 address, u8 data);
 static void FASTCALL SCSDummyWriteWord(u32 address, u16 data);
 static void FASTCALL SCSDummyWriteLong(u32 address, u32 data);
 static M68KBreakpointInfo *SCSDummyM68KGetBreakpointList(void);
+static void SCSDummyAddStateRegions(void);
 
 SCSPInterface_struct SCSDummy = {
 SCSCORE_DUMMY,
@@ -82,7 +83,9 @@ SCSDummyReadLong,
 SCSDummyWriteByte,
 SCSDummyWriteWord,
 SCSDummyWriteLong,
-SCSDummyM68KGetBreakpointList
+SCSDummyM68KGetBreakpointList,
+SCSDummyAddStateRegions,
+NULL
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -260,3 +263,10 @@ static M68KBreakpointInfo *SCSDummyM68KGetBreakpointList(void)
 }
 
 //////////////////////////////////////////////////////////////////////////////
+
+static void SCSDummyAddStateRegions(void)
+{
+   // No state besides sound RAM, which is added with the rest of memory
+}
+
+//////////////////////////////////////////////////////////////////////////////
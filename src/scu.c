@@ -154,59 +154,77 @@ void ScuReset(void) {
 
 #ifdef OPTIMIZED_DMA
 
-// Table of memory types for DMA optimization, in 512k (1<<19 byte) units:
-//    0x00 = no special handling
-//    0x12 = VDP1/2 RAM (8-bit organized, 16-bit copy unit)
-//    0x22 = M68K RAM (16-bit organized, 16-bit copy unit)
-//    0x23 = VDP2 color RAM (16-bit organized, 16-bit copy unit)
-//    0x24 = SH-2 RAM (16-bit organized, 32-bit copy unit)
-static const u8 DMAMemoryType[0x20000000>>19] = {
-   [0x00200000>>19] = 0x24,
-   [0x00280000>>19] = 0x24,
-   [0x05A00000>>19] = 0x22,
-   [0x05A80000>>19] = 0x22,
-   [0x05C00000>>19] = 0x12,
-   [0x05C00000>>19] = 0x12,
-   [0x05E00000>>19] = 0x12,
-   [0x05E80000>>19] = 0x12,
-   [0x05F00000>>19] = 0x23,
-   [0x06000000>>19] = 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-                      0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24, 0x24,
-};
-
-// Function to return the native pointer for an optimized address
-#ifdef __GNUC__
-__attribute__((always_inline))  // Force it inline for better performance
-#endif
-static INLINE void *DMAMemoryPointer(u32 address) {
-   u32 page = (address & 0x1FF80000) >> 19;
-   switch (DMAMemoryType[page]) {
-      case 0x12:
-         switch (page) {
-            case 0x05C00000>>19: return &Vdp1Ram[address & 0x7FFFF];
-            case 0x05E00000>>19: // fall through
-            case 0x05E80000>>19: return &Vdp2Ram[address & 0x7FFFF];
-            default: return NULL;
-         }
-      case 0x22:
-         return &SoundRam[address & 0x7FFFF];
-      case 0x23:
-         return &Vdp2ColorRam[address & 0xFFF];
-      case 0x24:
-         if (page == 0x00200000>>19) {
-            return &wram[address & 0xFFFFF];
-         } else {
-            return &wram[(address & 0xFFFFF) | 0x100000];
-         }
-      default:
-         return NULL;
+// Moves as many copy units as possible when both ends are direct mapped
+// pages (see mem_PageInit). Both keep Saturn byte order so nothing is
+// swapped, time and TransferNumber are charged exactly like the unit by unit
+// loops. Returns the number of units moved, 0 if the handlers are needed.
+static u32 ScuDmaBulkCopy(scudmainfo_struct *dma, int *time, u32 size, u32 write_add) {
+   const mem_page *src = &mem_read_page[MEM_GET_FUNC_ADDR(dma->ReadAddress)];
+   const mem_page *dst = &mem_write_page[MEM_GET_FUNC_ADDR(dma->WriteAddress)];
+   u32 units, room, len, i;
+   u8 *from, *to;
+
+   if (src->base == NULL || dst->base == NULL)
+      return 0;
+
+   units = (u32)*time;
+   room = ((u32)dma->TransferNumber + size - 1) / size;
+   if (room < units) units = room;
+   room = mem_PageRoom(dma->ReadAddress, src->mask) / size;
+   if (room < units) units = room;
+   room = mem_PageRoom(dma->WriteAddress, dst->mask);
+   if (room < size)
+      return 0;
+   if (write_add != 0) {
+      room = (room - size) / write_add + 1;
+      if (room < units) units = room;
+   }
+   if (units == 0)
+      return 0;
+
+   from = src->base + (dma->ReadAddress & src->mask);
+   to = dst->base + (dma->WriteAddress & dst->mask);
+   len = units * size;
+   if (write_add == size && (to <= from || to >= from + len)) {
+      memmove(to, from, len);
+   } else {
+      // Strided or overlapping, keep the order of the unit copies
+      for (i = 0; i < units; i++, from += size, to += write_add)
+         memmove(to, from, size);
    }
+   if (dst->dirty)
+      mem_DirtyRange(dst->dirty, dma->WriteAddress & dst->mask,
+                     (units - 1) * write_add + size);
+
+   dma->ReadAddress += len;
+   dma->WriteAddress += units * write_add;
+   dma->TransferNumber -= len;
+   *time -= units;
+   return units;
+}
+
+// A fill reading the CD block data port with the destination moving one
+// long at a time (write_add per 16-bit half on the B-Bus) is a sector data
+// transfer, checked once before the fill loop.
+static int ScuDmaFromCs2(const scudmainfo_struct *dma, u32 write_add) {
+   return dma->WriteAdd == write_add && (dma->ReadAddress & 0x0FFFFFFF) == 0x05818000;
+}
+
+// Moves sector data of a ScuDmaFromCs2 fill in bulk by Cs2DataPortDma,
+// charged like the fill loops. Returns the number of longs moved, 0 if the
+// loops are needed.
+static u32 ScuDmaCs2Copy(scudmainfo_struct *dma, int *time) {
+   u32 longs, moved;
+
+   longs = ((u32)dma->TransferNumber + 3) >> 2;
+   if ((u32)*time < longs)
+      longs = (u32)*time;
+   moved = Cs2DataPortDma(dma->ReadAddress, dma->WriteAddress, longs);
+
+   dma->WriteAddress += moved << 2;
+   dma->TransferNumber -= moved << 2;
+   *time -= moved;
+   return moved;
 }
 
 #endif  // OPTIMIZED_DMA
@@ -405,7 +423,7 @@ void dsp_dma01(scudspregs_struct *sc, u32 inst)
 	const u32 add = (1 << (mode & 0x2)) &~1;
 
 	for (i = 0; i < imm ; i++) {
-		sc->MD[sel][sc->CT[sel] & 0x3F] = mem_read32_arr[MEM_GET_FUNC_ADDR(sc->RA0M << 2)]((sc->RA0M << 2));
+		sc->MD[sel][sc->CT[sel] & 0x3F] = mem_PageRead32(sc->RA0M << 2);
 		sc->CT[sel] = (sc->CT[sel] + 1) & 0x3F;
 		sc->RA0M += (add >> 2);
 	}
@@ -450,6 +468,9 @@ void dsp_dma_write_d0bus(scudspregs_struct *sc, int sel, int add, int count)
 		for (i = 0; i < count; i++) {
 			u32 Val = sc->MD[sel][sc->CT[sel] & 0x3F];
 			Adr = (sc->WA0M << 2);
+			if (wram_code[((Adr & 0xFFFFC) | 0x100000) >> WRAM_CODE_SHIFT])
+				SH2WriteNotify(0x06000000 | (Adr & 0xFFFFC), 4);
+			wram_dirty[((Adr & 0xFFFFC) | 0x100000) >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
 			T2WriteLong(wram, (Adr & 0xFFFFC) | 0x100000, Val);
 			sc->CT[sel] = (sc->CT[sel] + 1) & 0x3F;
 			sc->WA0M += add;
@@ -488,11 +509,11 @@ void dsp_dma03(scudspregs_struct *sc, u32 inst)
 
 	for (i = 0; i < Counter; i++) {
 		if (sel == 0x04) {
-			sc->ProgramRam[index] = mem_read32_arr[MEM_GET_FUNC_ADDR(sc->RA0M << 2)](sc->RA0M << 2);
+			sc->ProgramRam[index] = mem_PageRead32(sc->RA0M << 2);
 			index++;
 		}
 		else {
-			sc->MD[sel][sc->CT[sel] & 0x3F] = mem_read32_arr[MEM_GET_FUNC_ADDR(sc->RA0M << 2)](sc->RA0M << 2);
+			sc->MD[sel][sc->CT[sel] & 0x3F] = mem_PageRead32(sc->RA0M << 2);
 			sc->CT[sel]++;
 			sc->CT[sel] &= 0x3F;
 		}
@@ -636,19 +657,19 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       if (constant_source) {
         u32 val;
         if (dma->ReadAddress & 2) {  // Avoid misaligned access
-          val = mem_read16_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]( (dma->ReadAddress&0x0FFFFFFF)) << 16
-            | mem_read16_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]( (dma->ReadAddress&0x0FFFFFFF) + 2);
+          val = mem_PageRead16(dma->ReadAddress & 0x0FFFFFFF) << 16
+            | mem_PageRead16((dma->ReadAddress & 0x0FFFFFFF) + 2);
         }
         else {
-          val = mem_read32_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
+          val = mem_PageRead32(dma->ReadAddress & 0x0FFFFFFF);
         }
 
         u32 start = dma->WriteAddress;
         while ( *time > 0 ) {
           *time -= 1;
-          mem_write16_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, (u16)(val >> 16));
+          mem_PageWrite16(dma->WriteAddress, (u16)(val >> 16));
           dma->WriteAddress += dma->WriteAdd;
-          mem_write16_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, (u16)val);
+          mem_PageWrite16(dma->WriteAddress, (u16)val);
           dma->WriteAddress += dma->WriteAdd;
           dma->TransferNumber -= 4;
           if (dma->TransferNumber <= 0 ) {
@@ -660,12 +681,24 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       }
       else {
         u32 start = dma->WriteAddress;
+#ifdef OPTIMIZED_DMA
+        int from_cs2 = ScuDmaFromCs2(dma, 2);
+#endif
         while ( *time > 0) {
+#ifdef OPTIMIZED_DMA
+          if (from_cs2 && ScuDmaCs2Copy(dma, time)) {
+            if (dma->TransferNumber <= 0) {
+              SH2WriteNotify(start, dma->WriteAddress - start);
+              return;
+            }
+            continue;
+          }
+#endif
           *time -= 1;
-          u32 tmp = mem_read32_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
-          mem_write16_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, (u16)(tmp >> 16));
+          u32 tmp = mem_PageRead32(dma->ReadAddress & 0x0FFFFFFF);
+          mem_PageWrite16(dma->WriteAddress, (u16)(tmp >> 16));
           dma->WriteAddress += dma->WriteAdd;
-          mem_write16_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, (u16)tmp);
+          mem_PageWrite16(dma->WriteAddress, (u16)tmp);
           dma->WriteAddress += dma->WriteAdd;
           dma->ReadAddress += dma->ReadAdd;
           dma->TransferNumber -= 4;
@@ -681,10 +714,10 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       // Fill in 32-bit units (always aligned).
       u32 start = dma->WriteAddress;
       if (constant_source) {
-        u32 val = mem_read32_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
+        u32 val = mem_PageRead32(dma->ReadAddress & 0x0FFFFFFF);
         while ( *time > 0) {
           *time -= 1;
-          mem_write32_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, val);
+          mem_PageWrite32(dma->WriteAddress, val);
           dma->ReadAddress += dma->ReadAdd;
           dma->WriteAddress += dma->WriteAdd;
           dma->TransferNumber -= 4;
@@ -695,10 +728,22 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
         }
       }
       else {
+#ifdef OPTIMIZED_DMA
+        int from_cs2 = ScuDmaFromCs2(dma, 4);
+#endif
         while (*time > 0) {
+#ifdef OPTIMIZED_DMA
+          if (from_cs2 && ScuDmaCs2Copy(dma, time)) {
+            if (dma->TransferNumber <= 0) {
+              SH2WriteNotify(start, dma->WriteAddress - start);
+              return;
+            }
+            continue;
+          }
+#endif
           *time -= 1;
-          u32 val = mem_read32_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
-          mem_write32_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, val);
+          u32 val = mem_PageRead32(dma->ReadAddress & 0x0FFFFFFF);
+          mem_PageWrite32(dma->WriteAddress, val);
           dma->ReadAddress += dma->ReadAdd;
           dma->WriteAddress += dma->WriteAdd;
           dma->TransferNumber -= 4;
@@ -720,9 +765,18 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       //u32 counter = 0;
       u32 start = dma->WriteAddress;
       while (*time > 0) {
+#ifdef OPTIMIZED_DMA
+        if (ScuDmaBulkCopy(dma, time, 2, dma->WriteAdd)) {
+          if (dma->TransferNumber <= 0) {
+            SH2WriteNotify(start, dma->WriteAddress - start);
+            return;
+          }
+          continue;
+        }
+#endif
         *time -= 1;
-        u16 tmp = mem_read16_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
-        mem_write16_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, tmp);
+        u16 tmp = mem_PageRead16(dma->ReadAddress & 0x0FFFFFFF);
+        mem_PageWrite16(dma->WriteAddress, tmp);
         dma->WriteAddress += dma->WriteAdd;
         dma->ReadAddress += 2;
         dma->TransferNumber -= 2;
@@ -736,9 +790,18 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
     else if (((dma->ReadAddress & 0x1FFFFFFF) >= 0x5A00000 && (dma->ReadAddress & 0x1FFFFFFF) < 0x5FF0000)) {
       u32 start = dma->WriteAddress;
       while ( *time > 0) {
+#ifdef OPTIMIZED_DMA
+        if (ScuDmaBulkCopy(dma, time, 2, dma->WriteAdd >> 1)) {
+          if (dma->TransferNumber <= 0) {
+            SH2WriteNotify(start, dma->WriteAddress - start);
+            return;
+          }
+          continue;
+        }
+#endif
         *time -= 1;
-        u16 tmp = mem_read16_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
-        mem_write16_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, tmp);
+        u16 tmp = mem_PageRead16(dma->ReadAddress & 0x0FFFFFFF);
+        mem_PageWrite16(dma->WriteAddress, tmp);
         dma->WriteAddress += (dma->WriteAdd >> 1);
         dma->ReadAddress += 2;
         dma->TransferNumber -= 2;
@@ -753,9 +816,18 @@ void SucDmaExec(scudmainfo_struct * dma, int * time ) {
       //u32 counter = 0;
       u32 start = dma->WriteAddress;
       while (*time > 0) {
+#ifdef OPTIMIZED_DMA
+        if (ScuDmaBulkCopy(dma, time, 4, dma->WriteAdd)) {
+          if (dma->TransferNumber <= 0) {
+            SH2WriteNotify(start, dma->WriteAddress - start);
+            return;
+          }
+          continue;
+        }
+#endif
         *time -= 1;
-        u32 val = mem_read32_arr[MEM_GET_FUNC_ADDR(dma->ReadAddress & 0x0FFFFFFF)]((dma->ReadAddress & 0x0FFFFFFF));
-        mem_write32_arr[MEM_GET_FUNC_ADDR(dma->WriteAddress & 0x0FFFFFFF)](dma->WriteAddress, val);
+        u32 val = mem_PageRead32(dma->ReadAddress & 0x0FFFFFFF);
+        mem_PageWrite32(dma->WriteAddress, val);
         dma->ReadAddress += 4;
         dma->WriteAddress += dma->WriteAdd;
         dma->TransferNumber -= 4;
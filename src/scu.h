@@ -134,6 +134,7 @@
     u32 MD[4][64];
     union {
       struct {
+#ifdef WORDS_BIGENDIAN
         u32 unused1 : 5;
         u32 PR : 1; // Pause cancel flag
         u32 EP : 1; // Temporary stop execution flag
@@ -149,6 +150,23 @@
         u32 LE : 1; // Program counter load enable bit
         u32 unused3 : 7;
         u32 P : 8;  // Program Ram Address
+#else
+        u32 P : 8;  // Program Ram Address
+        u32 unused3 : 7;
+        u32 LE : 1; // Program counter load enable bit
+        u32 EX : 1; // Program execute control bit
+        u32 ES : 1; // Program step execute control bit
+        u32 E : 1;  // Program end interrupt flag
+        u32 V : 1;  // Overflow flag
+        u32 C : 1;  // Carry flag
+        u32 Z : 1;  // Zero flag
+        u32 S : 1;  // Sine flag
+        u32 T0 : 1; // D0 bus use DMA execute flag
+        u32 unused2 : 1;
+        u32 EP : 1; // Temporary stop execution flag
+        u32 PR : 1; // Pause cancel flag
+        u32 unused1 : 5;
+#endif
       } part;
       u32 all;
     } ProgControlPort;
@@ -167,36 +185,60 @@
 
     union {
       struct {
+#ifdef WORDS_BIGENDIAN
         s64 unused : 16;
         s64 H : 16;
         s64 L : 32;
+#else
+        s64 L : 32;
+        s64 H : 16;
+        s64 unused : 16;
+#endif
       } part;
       s64 all;
     } AC;
 
     union {
       struct {
+#ifdef WORDS_BIGENDIAN
         s64 unused : 16;
         s64 H : 16;
         s64 L : 32;
+#else
+        s64 L : 32;
+        s64 H : 16;
+        s64 unused : 16;
+#endif
       } part;
       s64 all;
     } P;
 
     union {
       struct {
+#ifdef WORDS_BIGENDIAN
         s64 unused : 16;
         s64 H : 16;
         s64 L : 32;
+#else
+        s64 L : 32;
+        s64 H : 16;
+        s64 unused : 16;
+#endif
       } part;
       s64 all;
     } ALU;
 
     union {
       struct {
+#ifdef WORDS_BIGENDIAN
         s64 unused : 16;
         s64 H : 16;
         s64 L : 32;
+#else
+        s64 L : 32;
+        s64 H : 16;
+        s64 unused : 16;
+#endif
       } part;
       s64 all;
     } MUL;
@@ -209,6 +251,8 @@
 	u32 dmy;
 } scudspregs_struct;
 
+extern scudspregs_struct * ScuDsp;
+
 
 int ScuInit(void);
 void ScuDeInit(void);
@@ -57,7 +57,8 @@ do {								\
 static u16 tlut_14bpp_ram[0x800] ATTRIBUTE_ALIGN(32);
 static u16 tlut_8bpp_ram[0x800] ATTRIBUTE_ALIGN(32);
 static u16 tlut_4bpp_ram[0x800] ATTRIBUTE_ALIGN(32);
-static u8 tlut_dirty[0x80] ATTRIBUTE_ALIGN(32);
+static u8 tlut_dirty[0x80] ATTRIBUTE_ALIGN(32);	//One per 16 colors
+static sgx_tlut_stats tlut_stats;
 static GXTlutRegion tlut_region;	//XXX:tlut region for callback (can skip?)
 
 static GXTexRegion tex_region[3];
@@ -117,8 +118,11 @@ static GXTlutRegion* __SGX_CalcTlutRegion(u32 idx)
 
 static GXTexRegion* __SGX_CalcTexRegion(const GXTexObj *obj, u8 mapid)
 {
-	if (GX_GetTexObjFmt(obj) == GX_TF_RGBA8) {
+	switch (GX_GetTexObjFmt(obj)) {
+	case GX_TF_RGBA8:
 		return &tex_region[1];
+	case GX_TF_RGB565:		//Window texture
+		return &tex_region[2];
 	}
 	return &tex_region[0];
 }
@@ -131,6 +135,7 @@ void SGX_Init(void)
 	//Set the texcache regions
 	GX_InitTexCacheRegion(&tex_region[0], GX_FALSE, 0, GX_TEXCACHE_128K, 0, GX_TEXCACHE_NONE);
 	GX_InitTexCacheRegion(&tex_region[1], GX_FALSE, 0, GX_TEXCACHE_32K,  0x80000, GX_TEXCACHE_32K);
+	GX_InitTexCacheRegion(&tex_region[2], GX_FALSE, 0x88000, GX_TEXCACHE_32K, 0, GX_TEXCACHE_NONE);
 	GX_SetTexRegionCallback(__SGX_CalcTexRegion);
 	GX_SetTlutRegionCallback(__SGX_CalcTlutRegion);
 
@@ -209,11 +214,12 @@ void SGX_CellConverterSet(u32 cellsize, u32 bpp_id)
 }
 
 
-//Uses the sprite size (from 0 to 62) to make use of indirect textrue conversion
+//Uses the sprite size (from 0 to 62) to make use of indirect textrue conversion,
+//size 0 is for textures already in GX tile order
 void SGX_SpriteConverterSet(u32 wsize, u32 bpp_id, u32 align)
 {
 	//XXX: Do something with the bpp_id
-	if (bpp_id == SPRITE_16BPP) {
+	if (bpp_id == SPRITE_16BPP && wsize) {
 		GX_LoadTexObjPreloaded(&ind_texs[wsize][bpp_id][align], &ind_regions[wsize][bpp_id][align], GX_TEXMAP1);
 		GX_SetNumIndStages(1);
 		GX_SetIndTexOrder(GX_INDTEXSTAGE0, GX_TEXCOORD0, GX_TEXMAP1);
@@ -234,18 +240,35 @@ void SGX_SpriteConverterSet(u32 wsize, u32 bpp_id, u32 align)
 }
 
 
-//XXX: CHANGE THIS BACK TO THE WAY IT WAS BEFORE USING 4096 ENTRY TLUT
-//XXX: We can skip all this computation and do this while changing vdp2s color ram
+//Marks a 16 entry (32 byte) block of color ram for conversion on the next
+//SGX_TlutCRAMUpdate
 void SGX_ColorRamDirty(u32 pos)
 {
 	tlut_dirty[pos] = 1;
 }
 
+void SGX_ColorRamDirtyAll(void)
+{
+	memset(tlut_dirty, 1, sizeof(tlut_dirty));
+}
+
+void SGX_GetTlutStats(sgx_tlut_stats *stats)
+{
+	*stats = tlut_stats;
+}
 
+
+//Textures read from VDP1 and VDP2 RAM
 void SGX_InvalidateVRAM(void)
 {
 	GX_InvalidateTexRegion(&tex_region[0]);
+}
+
+//Textures copied out of the EFB, rewritten every frame
+void SGX_InvalidateCopies(void)
+{
 	GX_InvalidateTexRegion(&tex_region[1]);
+	GX_InvalidateTexRegion(&tex_region[2]);
 }
 
 void SGX_TlutLoadCRAMImm(u32 pos, u32 trn_code, u32 size)
@@ -267,47 +290,63 @@ void SGX_TlutLoadCRAMImm(u32 pos, u32 trn_code, u32 size)
 	}
 }
 
-void SGX_TlutCRAMUpdate(void)
+//Uploads the 256 entry blocks in blk_dirty to the tlut at type
+static void __SGX_TlutLoadBlocks(u16 *tlut_ram, u32 type, const u8 *blk_dirty)
 {
 	GXTlutObj tlut;
+	u32 n;
 
-	//14bpp tlut
-	volatile u32 *dst = (u32*) GX_RedirectWriteGatherPipe(tlut_14bpp_ram);
-	u32 *src = (u32*) Vdp2ColorRam;
-	for (u32 i = 0; i < 0x400; ++i) {
-		*dst = (*(src++)) | 0x80008000;
+	for (u32 b = 0; (n = SGX_TlutBlockRun(blk_dirty, &b)) != 0; b += n) {
+		GX_InitTlutObj(&tlut, tlut_ram + (b << 8), GX_TL_RGB5A3, n << 8);
+		GX_LoadTlut(&tlut, TLUT_INDX_BLK(type, b, n));
+		tlut_stats.loads++;
 	}
-	GX_RestoreWriteGatherPipe();
-	GX_InitTlutObj(&tlut, tlut_14bpp_ram, GX_TL_RGB5A3, 2048);
-	GX_LoadTlut(&tlut , TLUT_INDX(TLUT_TYPE_FULL, 0));
-
-	//8bpp tlut
-	dst = (u32*) GX_RedirectWriteGatherPipe(tlut_8bpp_ram);
-	src = (u32*) Vdp2ColorRam;
-	for (u32 i = 0; i < 0x400; ++i) {
-		if (i & 0x7F) {
-			*dst = (*(src++)) | 0x80008000;
-		} else {
-			*dst = ((*(src++)) | 0x8000) & 0xFFFF;
+}
+
+//Only the 16 color blocks written since the last frame are converted and only
+//the 256 color blocks holding them are loaded again. The tables are written
+//through the cache, the write gather pipe pads the last burst with zeros and
+//would clobber the block after a partial run.
+void SGX_TlutCRAMUpdate(void)
+{
+	u8 blk_dirty[8] = {0};
+
+	tlut_stats.entries = 0;
+	tlut_stats.loads = 0;
+	for (u32 c = 0; c < 0x80; ++c) {
+		if (!tlut_dirty[c]) {
+			continue;
 		}
-	}
-	GX_RestoreWriteGatherPipe();
-	GX_InitTlutObj(&tlut, tlut_8bpp_ram, GX_TL_RGB5A3, 2048);
-	GX_LoadTlut(&tlut, TLUT_INDX(TLUT_TYPE_8BPP, 0));
-
-	//4bpp tlut
-	dst = (u32*) GX_RedirectWriteGatherPipe(tlut_4bpp_ram);
-	src = (u32*) Vdp2ColorRam;
-	for (u32 i = 0; i < 0x400; ++i) {
-		if (i & 0x7) {
-			*dst = (*(src++)) | 0x80008000;
-		} else {
-			*dst = ((*(src++)) | 0x8000) & 0xFFFF;
+		tlut_dirty[c] = 0;
+		blk_dirty[c >> 4] = 1;
+		tlut_stats.entries += 16;
+
+		u32 *src = (u32*) Vdp2ColorRam + (c << 3);
+		u32 *dst14 = (u32*) tlut_14bpp_ram + (c << 3);
+		u32 *dst8 = (u32*) tlut_8bpp_ram + (c << 3);
+		u32 *dst4 = (u32*) tlut_4bpp_ram + (c << 3);
+		for (u32 i = 0; i < 8; ++i) {
+			u32 col = src[i] | 0x80008000;
+			dst14[i] = col;
+			dst8[i] = col;
+			dst4[i] = col;
+		}
+		//Color 0 of each palette is transparent
+		dst4[0] &= 0xFFFF;
+		if (!(c & 0xF)) {
+			dst8[0] &= 0xFFFF;
 		}
+		DCStoreRange(dst14, 32);
+		DCStoreRange(dst8, 32);
+		DCStoreRange(dst4, 32);
+	}
+
+	if (!tlut_stats.entries) {
+		return;
 	}
-	GX_RestoreWriteGatherPipe();
-	GX_InitTlutObj(&tlut, tlut_4bpp_ram, GX_TL_RGB5A3, 2048);
-	GX_LoadTlut(&tlut, TLUT_INDX(TLUT_TYPE_4BPP, 0));
+	__SGX_TlutLoadBlocks(tlut_14bpp_ram, TLUT_TYPE_FULL, blk_dirty);
+	__SGX_TlutLoadBlocks(tlut_8bpp_ram, TLUT_TYPE_8BPP, blk_dirty);
+	__SGX_TlutLoadBlocks(tlut_4bpp_ram, TLUT_TYPE_4BPP, blk_dirty);
 }
 
 
@@ -8,7 +8,9 @@
 #define	VTXFMT_GOUR_TEX			GX_VTXFMT3
 #define	VTXFMT_COLOR			GX_VTXFMT5
 
+//pos counts palettes of 16 entries, blk the 256 entry blocks of n * 256 entries
 #define TLUT_INDX(type, pos)	((GX_TLUT_2K << 10) | (((pos) + (type) + 0x200) & 0x3ff))
+#define TLUT_INDX_BLK(type, blk, n)	((((n) * GX_TLUT_256) << 10) | ((((blk) << 4) + (type) + 0x200) & 0x3ff))
 #define TLUT_INDX_IMM			((GX_TLUT_16 << 10) | (0x380 & 0x3ff))
 #define TLUT_INDX_IMM4			(((GX_TLUT_16) << 10) | (0x380 & 0x3ff))
 #define TLUT_INDX_IMM8			(((GX_TLUT_256) << 10) | (0x381 & 0x3ff))
@@ -22,6 +24,13 @@
 #define TLUT_TYPE_8BPP			0x100
 
 
+//Work done by the last SGX_TlutCRAMUpdate
+typedef struct {
+	u32 entries;		//Color ram entries converted
+	u32 loads;			//GX_LoadTlut calls over the three tables
+} sgx_tlut_stats;
+
+
 #define SPRITE_4BPP			0
 #define SPRITE_8BPP			1
 #define SPRITE_16BPP		2
@@ -54,10 +63,31 @@ void SGX_DrawBitmap(void);
 
 void SGX_Vdp2ColorRamLoad(void);
 void SGX_InvalidateVRAM(void);
+void SGX_InvalidateCopies(void);
 void SGX_SpriteConverterSet(u32 wsize, u32 bpp_id, u32 align);
 void SGX_TlutLoadCRAMImm(u32 pos, u32 trn_code, u32 size);
 void SGX_TlutCRAMUpdate(void);
 void SGX_ColorRamDirty(u32 pos);
+void SGX_ColorRamDirtyAll(void);
+void SGX_GetTlutStats(sgx_tlut_stats *stats);
+
+//Next run of dirty 256 entry blocks from *blk on, neighbouring blocks go in a
+//single load. Moves *blk to its first block and returns its length, 0 once
+//there are none left
+static inline u32 SGX_TlutBlockRun(const u8 *blk_dirty, u32 *blk)
+{
+	u32 b = *blk;
+	u32 n = 0;
+
+	while (b < 8 && !blk_dirty[b]) {
+		b++;
+	}
+	while (b + n < 8 && blk_dirty[b + n]) {
+		n++;
+	}
+	*blk = b;
+	return n;
+}
 
 
 #endif //__VID_GX_H__
@@ -1,771 +1,1193 @@
+/*
+ * compiler.c
+ *--------------------
+ * SH2 block recompiler front end. Finds a run of instructions starting at PC,
+ * handles delay slots, cycle accounting and SR.T and emits it through one of
+ * the backends. Instructions without a native translation call their
+ * interpreter handler, so blocks stay cycle exact with SH2InterpreterExec.
+ */
 
+#ifdef SH2_DYNAREC
 
-#include "emit_ppc.inc"
+#include <stddef.h>
+#include "../../sh2core.h"
+#include "../../sh2int.h"
+#include "../../memory.h"
+#include "compiler.h"
 
+u8 *drc_ptr = NULL;
 
-void sh2_jit_ADD(rn, rm)
-{
-	PPCC_ADD(rn, rn, rm);
-}
-
-void sh2_jit_ADDI(rn, imm)
-{
-	PPCC_ADDI(rn, rn, imm);		//NOTE: Must sign extend immidiate
-}
-
-void sh2_jit_ADDC(rn, rm)
-{
-	PPCC_RLWINM(GP_TMP, GP_SR, 29, 2, 2); 	/*Extract T*/ \
-	PPCC_MTXER(GP_TMP);  					/*Store T in XER[CA]*/ \
-	PPCC_ADDEO(rn, rn, rm); 				/*Add rn + rm + XER[CA]*/ \
-	PPCC_MFXER(GP_TMP); 					/*Load XER[CA] to TMP*/ \
-	PPCC_RLWIMI(GP_SR, GP_TMP, 3, 31, 31); 	/*Store T*/
-}
-
-void sh2_jit_ADDV(rn, rm)
-{
-	PPCC_ADDO(rn, rn, rm); 					/*Add rn + rm*/
-	PPCC_MFXER(GP_TMP); 					/*Load XER[CA] to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 2, 31, 31); 	/*Store T*/
-}
-
-
-void sh2_jit_SUB(rn, rm)
-{
-	PPCC_SUBF(rn, rm, rn);
-}
-
-void sh2_jit_SUBC(rn, rm)
-{
-	//XXX
-}
-
-void sh2_jit_SUBV(rn, rm)
-{
-	//XXX
-}
-
-
-void sh2_jit_AND(rn, rm)
-{
-	PPCC_AND(rn, rn, rm);
-}
-
-void sh2_jit_ANDI(imm)
-{
-	PPCC_ANDI(GP_R0, GP_R0, imm);
-}
-
-void sh2_jit_ANDM(imm)
-{
-	//XXX
-}
-
-void sh2_jit_OR(rn, rm)
-{
-	PPCC_OR(rn, rn, rm);
-}
-
-void sh2_jit_ORI(imm)
-{
-	PPCC_ORI(GP_R0, GP_R0, imm);
-}
-
-void sh2_jit_ORM(imm)
-{
-	//XXX
-}
-
-void sh2_jit_XOR(rn, rm)
-{
-	PPCC_XOR(rn, rn, rm);
-}
-
-void sh2_jit_XORI(imm)
-{
-	PPCC_XORI(GP_R0, GP_R0, imm);
-}
-
-void sh2_jit_XORM(imm)
-{
-	//XXX
-}
+/*Only x86-64 has a backend so far, emit_ppc.inc is the old unfinished one*/
+#if defined(__x86_64__)
+#include "emit_x64.inc"
+#else
+#error "SH2_DYNAREC has no recompiler backend for this host"
+#endif
 
+#define DRC_CACHE_SIZE		(4 << 20)
+#define DRC_BLOCK_SIZE		(32 << 10)	/*Room left before compiling a block*/
+#define DRC_HASH_BITS		14
+#define DRC_HASH			(1 << DRC_HASH_BITS)
+#define DRC_MAX_OPS			32
+#define DRC_GRANULES		(WRAM_SIZE >> WRAM_CODE_SHIFT)
+#define DRC_VOLATILE		32
 
-void sh2_jit_ROTCL(rn)
-{
-	//XXX
-}
+/*SH2_struct offsets*/
+#define CTX_R(n)			(offsetof(SH2_struct, regs.R) + ((n) << 2))
+#define CTX_SR				offsetof(SH2_struct, regs.SR)
+#define CTX_GBR				offsetof(SH2_struct, regs.GBR)
+#define CTX_VBR				offsetof(SH2_struct, regs.VBR)
+#define CTX_MACH			offsetof(SH2_struct, regs.MACH)
+#define CTX_MACL			offsetof(SH2_struct, regs.MACL)
+#define CTX_PR				offsetof(SH2_struct, regs.PR)
+#define CTX_PC				offsetof(SH2_struct, regs.PC)
+#define CTX_CYCLES			offsetof(SH2_struct, cycles)
+#define CTX_INSTRUCTION		offsetof(SH2_struct, instruction)
 
-void sh2_jit_ROTCR(rn)
-{
-	//XXX
-}
+/*Instruction flags*/
+#define OPF_WRITE			0x01	/*Writes memory, may hit compiled code*/
+#define OPF_PCREL			0x02	/*Reads PC*/
+#define OPF_DELAY			0x04	/*Has a delay slot*/
+#define OPF_COND			0x08	/*Conditional branch*/
+#define OPF_END				0x10	/*Handler moves PC itself*/
 
-void sh2_jit_ROTL(rn)
-{
-	PPCC_RLWIMI(GP_SR, rn, 1, 31, 31);	/*Store the T bit*/
-	PPCC_RLWINM(rn, rn, 1, 0, 31); 		/*Rotate Left by 1*/
-}
+typedef struct {
+	u16 mask;
+	u16 match;
+	u8 cycles;				/*Worst case, handlers account their own*/
+	u8 flags;
+	void (*emit)(u16 ins, u32 pc);		/*NULL calls the interpreter handler*/
+} drc_op;
 
-void sh2_jit_ROTR(rn)
-{
-	PPCC_RLWIMI(GP_SR, rn, 0, 31, 31);	/*Store the T bit*/
-	PPCC_RLWINM(rn, rn, 32-1, 0, 31); 	/*Rotate Right by 1*/
-}
+u32 drc_abort = 0;
 
-void sh2_jit_SHAL(rn)
-{
-	PPCC_RLWIMI(GP_SR, rn, 1, 31, 31);	/*Store the T bit*/
-	PPCC_RLWINM(rn, rn, 1, 0, 30); 		/*Shift Algebraic Left by 1*/
-}
+static u8 *drc_cache = NULL;
+static u8 *drc_end = NULL;
+static drc_block *drc_blocks = NULL;
+static u32 drc_ver[DRC_GRANULES];
+static u32 drc_ver_rom = 0;
+static u8 drc_optab[0x10000];
 
-void sh2_jit_SHAR(rn)
-{
-	PPCC_RLWIMI(GP_SR, rn, 0, 31, 31);	/*Store the T bit*/
-	PPCC_SRAWI(rn, rn, 1); 				/*Shift Algebraic Right by 1*/
-}
+static u32 drc_pend = 0;			/*Cycles not yet added to the context*/
+static u32 drc_target = 0;			/*Branch target when known at compile time*/
+static u32 drc_target_known = 0;
 
-void sh2_jit_SHLL(rn)
-{
-	PPCC_RLWIMI(GP_SR, rn, 1, 31, 31);	/*Store the T bit*/
-	PPCC_RLWINM(rn, rn, 1, 0, 30); 		/*Shift Logical Left by 1*/
-}
 
-void sh2_jit_SHLL2(rn)
-{
-	PPCC_RLWINM(rn, rn, 2, 0, 31-2);
-}
+//////////////////////////////////////////////////////////////////////////////
+// Helpers
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_SHLL8(rn)
+static void drc_LoadR(u32 t, u32 n)
 {
-	PPCC_RLWINM(rn, rn, 8, 0, 31-8);
+	emit_Load(t, CTX_R(n));
 }
 
-void sh2_jit_SHLL16(rn)
-{
-	PPCC_RLWINM(rn, rn, 16, 0, 31-16);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_SHLR(rn)
+static void drc_StoreR(u32 t, u32 n)
 {
-	PPCC_RLWIMI(GP_SR, rn, 0, 31, 31);	/*Store the T bit*/
-	PPCC_RLWINM(rn, rn, 32-1, 1, 31); 	/*Shift Logical Right by 1*/
+	emit_Store(t, CTX_R(n));
 }
 
-void sh2_jit_SHLR2(rn)
-{
-	PPCC_RLWINM(rn, rn, 32-2, 2, 31);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_SHLR8(rn)
-{
-	PPCC_RLWINM(rn, rn, 32-8, 8, 31);
-}
-void sh2_jit_SHLR16(rn)
+static void drc_LoadT(u32 t)
 {
-	PPCC_RLWINM(rn, rn, 32-16, 16, 31);
+	emit_Load(t, CTX_SR);
+	emit_OpImm(DRC_AND, t, 1);
 }
 
-void sh2_jit_NOT(rn, rm)
-{
-	PPCC_NOR(rn, rm, rm);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_NEG(rn, rm)
+//t holds 0 or 1 and can't be T2
+static void drc_StoreT(u32 t)
 {
-	PPCC_NEG(rn, rm);
+	emit_Load(DRC_T2, CTX_SR);
+	emit_OpImm(DRC_AND, DRC_T2, ~1);
+	emit_Op(DRC_OR, DRC_T2, t);
+	emit_Store(DRC_T2, CTX_SR);
 }
 
-void sh2_jit_NEGC(rn, rm)
-{
-	//XXX
-}
-
-void sh2_jit_DT(rn)
-{
-	//XXX
-}
-
-void sh2_jit_EXTSB(rn, rm)
-{
-	PPCC_EXTSB(rn, rm);
-}
-
-void sh2_jit_EXTSW(rn, rm)
-{
-	PPCC_EXTSH(rn, rm);
-}
-
-void sh2_jit_EXTUB(rn, rm)
-{
-	PPCC_ANDI(rn, rm, 0x00FF);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_EXTUW(rn, rm)
+//Load from the address in T0 into T0, sign extended
+static void drc_Read(u32 size)
 {
-	PPCC_ANDI(rn, rm, 0xFFFF);
+	switch (size) {
+		case 1:
+			emit_Call((void *) mem_Read8);
+			emit_Unary(DRC_EXTSB, DRC_T0, DRC_T0);
+			break;
+		case 2:
+			emit_Call((void *) mem_Read16);
+			emit_Unary(DRC_EXTSW, DRC_T0, DRC_T0);
+			break;
+		default:
+			emit_Call((void *) mem_Read32);
+			break;
+	}
 }
 
+//////////////////////////////////////////////////////////////////////////////
 
-/*Mult and Division*/
-void sh2_jit_DIV0S(rn, rm)
+//Store T1 to the address in T0
+static void drc_Write(u32 size)
 {
-	//XXX
+	switch (size) {
+		case 1:		emit_Call((void *) mem_Write8); break;
+		case 2:		emit_Call((void *) mem_Write16); break;
+		default:	emit_Call((void *) mem_Write32); break;
+	}
 }
 
-void sh2_jit_DIV0U()
-{
-	PPCC_ANDI(GP_SR, GP_SR, 0xFCFE);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_DIV1(rn, rm)
+static void drc_Exit(u32 store_pc, u32 pc)
 {
-	//XXX
+	if (drc_pend) {
+		emit_Load(DRC_T0, CTX_CYCLES);
+		emit_OpImm(DRC_ADD, DRC_T0, drc_pend);
+		emit_Store(DRC_T0, CTX_CYCLES);
+	}
+	if (store_pc) {
+		emit_Imm(DRC_T0, pc);
+		emit_Store(DRC_T0, CTX_PC);
+	}
+	emit_End();
 }
 
-void sh2_jit_DMULS(rn, rm)
-{
-	PPCC_MULHW(GP_MACH, rn, rm); 	/*Multiply for signed high word*/
-	PPCC_MULLW(GP_MACL, rn, rm); 	/*Multiply for low word*/
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_DMULU(rn, rm)
+//Leave at next if the last write invalidated compiled code
+static void drc_CheckAbort(u32 next)
 {
-	PPCC_MULHWU(GP_MACH, rn, rm); 	/*Multiply for unsigned high word*/
-	PPCC_MULLW(GP_MACL, rn, rm); 	/*Multiply for low word*/
+	emit_LoadAbs(DRC_T0, &drc_abort);
+	u8 *skip = emit_JumpZ(DRC_T0);
+	drc_Exit(1, next);
+	emit_Patch(skip);
 }
 
-void sh2_jit_MACL(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MACW(rn, rm)
+//Run the interpreter handler, it adds its own cycles and PC
+static void drc_Fallback(u16 ins, u32 pc)
 {
-	//XXX
+	emit_Imm(DRC_T0, pc);
+	emit_Store(DRC_T0, CTX_PC);
+	emit_Imm(DRC_T0, ins);
+	emit_Store16(DRC_T0, CTX_INSTRUCTION);
+	emit_CallCtx((void *) decode(ins));
 }
 
-void sh2_jit_MULL(rn, rm)
-{
-	PPCC_MULLW(GP_MACL, rn, rm);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MULS(rn, rm)
+static u32 drc_Size(u16 ins)
 {
-	//XXX
+	return 1 << (ins & 0x3);
 }
 
-void sh2_jit_MULU(rn, rm)
-{
-	//XXX
-}
 
+//////////////////////////////////////////////////////////////////////////////
+// Data transfer
+//////////////////////////////////////////////////////////////////////////////
 
-/*Set and Clear*/
-void sh2_jit_CLRMAC()
+static void drc_mov(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ANDI(GP_MACH, GP_TMP, 0x0); 	/*Clear MACH*/
-	PPCC_ANDI(GP_MACL, GP_TMP, 0x0); 	/*Clear MACL*/
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_CLRT()
-{
-	PPCC_ANDI(GP_SR, GP_SR, 0xFFFE);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_SETT()
+static void drc_movi(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(GP_SR, GP_SR, 0x0001);
+	emit_Imm(DRC_T0, (s32) (s8) ins);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
+//////////////////////////////////////////////////////////////////////////////
 
-/*Compare*/
-void sh2_jit_CMPEQ(rn, rm)
+static void drc_mova(u16 ins, u32 pc)
 {
-	PPCC_CMP(0, rn, rm); 					/*Compare rn and rm*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 3, 31, 31); 	/*Store EQ in T*/
+	emit_Imm(DRC_T0, ((pc + 4) & ~3) + (INSTRUCTION_CD(ins) << 2));
+	drc_StoreR(DRC_T0, 0);
 }
 
-void sh2_jit_CMPGE(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_CMPGT(rn, rm)
+//mov.w @(disp,PC),Rn
+static void drc_movwi(u16 ins, u32 pc)
 {
-	PPCC_CMP(0, rn, rm); 					/*Compare rn and rm*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 2, 31, 31); 	/*Store GT in T*/
+	emit_Imm(DRC_T0, pc + (INSTRUCTION_CD(ins) << 1) + 4);
+	drc_Read(2);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_CMPHI(rn, rm)
-{
-	PPCC_CMPL(0, rn, rm); 					/*Compare Unsigned rn and rm*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 2, 31, 31); 	/*Store GT in T*/
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_CMPHS(rn, rm)
+//mov.l @(disp,PC),Rn
+static void drc_movli(u16 ins, u32 pc)
 {
-	//XXX
+	emit_Imm(DRC_T0, ((pc + 4) & ~3) + (INSTRUCTION_CD(ins) << 2));
+	drc_Read(4);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_CMPPL(rn)
-{
-	PPCC_CMPI(0, rn, 0x0); 					/*Compare rn to 0*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 2, 31, 31); 	/*Store GT in T*/
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_CMPPZ(rn)
+//mov.x @Rm,Rn
+static void drc_movl(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	drc_Read(drc_Size(ins));
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_CMPSTR(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_CMPIM(imm)
+//mov.x @Rm+,Rn
+static void drc_movp(u16 ins, UNUSED u32 pc)
 {
-	//NOTE: Must sign extend immidiate
-	PPCC_CMPI(0, rn, imm); 					/*Compare rn to 0*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 3, 31, 31); 	/*Store EQ in T*/
+	u32 m = INSTRUCTION_C(ins);
+	u32 n = INSTRUCTION_B(ins);
+	drc_LoadR(DRC_T0, m);
+	drc_Read(drc_Size(ins));
+	drc_StoreR(DRC_T0, n);
+	if (n != m) {
+		drc_LoadR(DRC_T0, m);
+		emit_OpImm(DRC_ADD, DRC_T0, drc_Size(ins));
+		drc_StoreR(DRC_T0, m);
+	}
 }
 
-/*Load and Stores*/
-void sh2_jit_LDCSR(rm)
-{
-	PPCC_ANDI(GP_SR, rm, 0x03F3);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_LDCGBR(rm)
+//mov.x @(R0,Rm),Rn
+static void drc_movl0(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(GP_GBR, rm, 0x0);
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	drc_LoadR(DRC_T1, 0);
+	emit_Op(DRC_ADD, DRC_T0, DRC_T1);
+	drc_Read(drc_Size(ins));
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_LDCVBR(rm)
-{
-	PPCC_ORI(GP_VBR, rm, 0x0);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_LDCMSR(rm)
+//mov.b/w @(disp,Rm),R0
+static void drc_movl4(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 size = drc_Size(ins >> 8);
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	emit_OpImm(DRC_ADD, DRC_T0, INSTRUCTION_D(ins) * size);
+	drc_Read(size);
+	drc_StoreR(DRC_T0, 0);
 }
 
-void sh2_jit_LDCMGBR(rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_LDCMVBR(rm)
+//mov.l @(disp,Rm),Rn
+static void drc_movll4(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	emit_OpImm(DRC_ADD, DRC_T0, INSTRUCTION_D(ins) << 2);
+	drc_Read(4);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_LDSMACH(rm)
-{
-	PPCC_ORI(GP_MACH, rm, 0x0);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_LDSMACL(rm)
+//mov.x @(disp,GBR),R0
+static void drc_movlg(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(GP_MACL, rm, 0x0);
+	u32 size = drc_Size(ins >> 8);
+	emit_Load(DRC_T0, CTX_GBR);
+	emit_OpImm(DRC_ADD, DRC_T0, INSTRUCTION_CD(ins) * size);
+	drc_Read(size);
+	drc_StoreR(DRC_T0, 0);
 }
 
-void sh2_jit_LDSPR(rm)
-{
-	PPCC_ORI(GP_PR, rm, 0x0);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_LDSMMACH(rm)
+//mov.x Rm,@Rn
+static void drc_movs(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	drc_Write(drc_Size(ins));
 }
 
-void sh2_jit_LDSMMACL(rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_LDSMPR(rm)
+//mov.x Rm,@-Rn
+static void drc_movm(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 n = INSTRUCTION_B(ins);
+	u32 size = drc_Size(ins);
+	drc_LoadR(DRC_T0, n);
+	emit_OpImm(DRC_SUB, DRC_T0, size);
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	drc_Write(size);
+	drc_LoadR(DRC_T0, n);
+	emit_OpImm(DRC_SUB, DRC_T0, size);
+	drc_StoreR(DRC_T0, n);
 }
 
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_STCSR(rn)
+//mov.x Rm,@(R0,Rn)
+static void drc_movs0(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(rn, GP_SR, 0x0);
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	drc_LoadR(DRC_T1, 0);
+	emit_Op(DRC_ADD, DRC_T0, DRC_T1);
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	drc_Write(drc_Size(ins));
 }
 
-void sh2_jit_STCGBR(rn)
-{
-	PPCC_ORI(rn, GP_GBR, 0x0);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_STCVBR(rn)
+//mov.b/w R0,@(disp,Rn)
+static void drc_movs4(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(rn, GP_VBR, 0x0);
+	u32 size = drc_Size(ins >> 8);
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	emit_OpImm(DRC_ADD, DRC_T0, INSTRUCTION_D(ins) * size);
+	drc_LoadR(DRC_T1, 0);
+	drc_Write(size);
 }
 
-void sh2_jit_STCMSR(rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_STCMGBR(rn)
+//mov.l Rm,@(disp,Rn)
+static void drc_movls4(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_OpImm(DRC_ADD, DRC_T0, INSTRUCTION_D(ins) << 2);
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	drc_Write(4);
 }
 
-void sh2_jit_STCMVBR(rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_STSMACH(rn)
+//mov.x R0,@(disp,GBR)
+static void drc_movsg(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(rn, GP_MACH, 0x0);
+	u32 size = drc_Size(ins >> 8);
+	emit_Load(DRC_T0, CTX_GBR);
+	emit_OpImm(DRC_ADD, DRC_T0, INSTRUCTION_CD(ins) * size);
+	drc_LoadR(DRC_T1, 0);
+	drc_Write(size);
 }
 
-void sh2_jit_STSMACL(rn)
-{
-	PPCC_ORI(rn, GP_MACL, 0x0);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_STSPR(rn)
+static u32 drc_SysReg(u16 ins)
 {
-	PPCC_ORI(rn, GP_PR, 0x0);
+	switch (ins & 0xFF) {
+		case 0x02:	return CTX_SR;
+		case 0x12:
+		case 0x1E:	return CTX_GBR;
+		case 0x22:
+		case 0x2E:	return CTX_VBR;
+		case 0x0A:
+		case 0x06:	return CTX_MACH;
+		case 0x1A:
+		case 0x16:	return CTX_MACL;
+	}
+	return CTX_PR;
 }
 
-void sh2_jit_STSMMACH(rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_STSMMACL(rn)
+//sts/stc X,Rn
+static void drc_sts(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	emit_Load(DRC_T0, drc_SysReg(ins));
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_STSMPR(rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-/*Move Data*/
-void sh2_jit_MOV(rn, rm)
+//lds/ldc Rm,X
+static void drc_lds(u16 ins, UNUSED u32 pc)
 {
-	PPCC_ORI(rn, rm, 0x0);
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_Store(DRC_T0, drc_SysReg(ins));
 }
 
-void sh2_jit_MOVBS(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVWS(rn, rm)
+//sts.l X,@-Rn
+static void drc_stsm(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 n = INSTRUCTION_B(ins);
+	u32 reg = ((ins & 0xF0) == 0x00) ? CTX_MACH : ((ins & 0xF0) == 0x10) ? CTX_MACL : CTX_PR;
+	drc_LoadR(DRC_T0, n);
+	emit_OpImm(DRC_SUB, DRC_T0, 4);
+	drc_StoreR(DRC_T0, n);
+	emit_Load(DRC_T1, reg);
+	drc_Write(4);
 }
 
-void sh2_jit_MOVLS(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVBL(rn, rm)
+//lds.l @Rm+,X
+static void drc_ldsm(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 m = INSTRUCTION_B(ins);
+	drc_LoadR(DRC_T0, m);
+	drc_Read(4);
+	emit_Store(DRC_T0, drc_SysReg(ins));
+	drc_LoadR(DRC_T0, m);
+	emit_OpImm(DRC_ADD, DRC_T0, 4);
+	drc_StoreR(DRC_T0, m);
 }
 
-void sh2_jit_MOVWL(rn, rm)
-{
-	//XXX
-}
 
-void sh2_jit_MOVLL(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
+// Arithmetic and logic
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVBM(rn, rm)
+static void drc_AluRR(u32 op, u16 ins)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	emit_Op(op, DRC_T0, DRC_T1);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_MOVWM(rn, rm)
-{
-	//XXX
-}
+static void drc_add(u16 ins, UNUSED u32 pc) { drc_AluRR(DRC_ADD, ins); }
+static void drc_sub(u16 ins, UNUSED u32 pc) { drc_AluRR(DRC_SUB, ins); }
+static void drc_and(u16 ins, UNUSED u32 pc) { drc_AluRR(DRC_AND, ins); }
+static void drc_or(u16 ins, UNUSED u32 pc) { drc_AluRR(DRC_OR, ins); }
+static void drc_xor(u16 ins, UNUSED u32 pc) { drc_AluRR(DRC_XOR, ins); }
 
-void sh2_jit_MOVLM(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVBP(rn, rm)
+static void drc_addi(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_OpImm(DRC_ADD, DRC_T0, (s32) (s8) ins);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_MOVWP(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVLP(rn, rm)
+//and/xor/or #imm,R0
+static void drc_logici(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	static const u32 ops[3] = {DRC_AND, DRC_XOR, DRC_OR};
+	drc_LoadR(DRC_T0, 0);
+	emit_OpImm(ops[((ins >> 8) & 0x3) - 1], DRC_T0, INSTRUCTION_CD(ins));
+	drc_StoreR(DRC_T0, 0);
 }
 
-void sh2_jit_MOVBS0(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVWS0(rn, rm)
+//not, neg, swap and extend
+static void drc_unary(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 op;
+	switch (ins & 0xF) {
+		case 0x7:	op = DRC_NOT; break;
+		case 0x8:	op = DRC_SWAPB; break;
+		case 0x9:	op = DRC_SWAPW; break;
+		case 0xB:	op = DRC_NEG; break;
+		case 0xC:	op = DRC_EXTUB; break;
+		case 0xD:	op = DRC_EXTUW; break;
+		case 0xE:	op = DRC_EXTSB; break;
+		default:	op = DRC_EXTSW; break;
+	}
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	emit_Unary(op, DRC_T0, DRC_T0);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_MOVLS0(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVBL0(rn, rm)
+static void drc_xtrct(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_C(ins));
+	emit_Shift(DRC_SHL, DRC_T0, 16);
+	drc_LoadR(DRC_T1, INSTRUCTION_B(ins));
+	emit_Shift(DRC_SHR, DRC_T1, 16);
+	emit_Op(DRC_OR, DRC_T0, DRC_T1);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_MOVWL0(rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVLL0(rn, rm)
+static void drc_dt(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_OpImm(DRC_SUB, DRC_T0, 1);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
+	emit_Imm(DRC_T1, 0);
+	emit_SetCC(DRC_EQ, DRC_T0, DRC_T0, DRC_T1);
+	drc_StoreT(DRC_T0);
 }
 
-void sh2_jit_MOVI(rn, imm)
-{
-	PPCC_ADDI(rn, 0, imm);	//NOTE: Must sign extend immidiate
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVWI(d, rn)
+static void drc_mull(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	emit_Op(DRC_MUL, DRC_T0, DRC_T1);
+	emit_Store(DRC_T0, CTX_MACL);
 }
 
-void sh2_jit_MOVLI(d, rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVBLG(d)
+//mulu.w (2nmE), muls.w (2nmF)
+static void drc_mulw(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 ext = (ins & 1) ? DRC_EXTSW : DRC_EXTUW;
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_Unary(ext, DRC_T0, DRC_T0);
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	emit_Unary(ext, DRC_T1, DRC_T1);
+	emit_Op(DRC_MUL, DRC_T0, DRC_T1);
+	emit_Store(DRC_T0, CTX_MACL);
 }
 
-void sh2_jit_MOVWLG(d)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVLLG(d)
+static void drc_clrmac(UNUSED u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	emit_Imm(DRC_T0, 0);
+	emit_Store(DRC_T0, CTX_MACH);
+	emit_Store(DRC_T0, CTX_MACL);
 }
 
-void sh2_jit_MOVBSG(d)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVWSG(d)
+static void drc_nop(UNUSED u16 ins, UNUSED u32 pc)
 {
-	//XXX
 }
 
-void sh2_jit_MOVLSG(d)
-{
-	//XXX
-}
 
-void sh2_jit_MOVBS4(d, rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
+// Shifts, T bit and compares
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVWS4(d, rn)
+//shll, shal, shlr, shar, rotl, rotr
+static void drc_shift1(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 n = INSTRUCTION_B(ins);
+	u32 left = !(ins & 1);
+	u32 op;
+	switch (ins & 0xFF) {
+		case 0x00:
+		case 0x20:	op = DRC_SHL; break;
+		case 0x01:	op = DRC_SHR; break;
+		case 0x21:	op = DRC_SAR; break;
+		case 0x04:	op = DRC_ROL; break;
+		default:	op = DRC_ROR; break;
+	}
+	drc_LoadR(DRC_T0, n);
+	emit_Mov(DRC_T1, DRC_T0);
+	if (left) {
+		emit_Shift(DRC_SHR, DRC_T1, 31);
+	} else {
+		emit_OpImm(DRC_AND, DRC_T1, 1);
+	}
+	drc_StoreT(DRC_T1);
+	emit_Shift(op, DRC_T0, 1);
+	drc_StoreR(DRC_T0, n);
 }
 
-void sh2_jit_MOVLS4(d, rn, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVBL4(d, rm)
+//shll2/8/16, shlr2/8/16
+static void drc_shiftn(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	static const u32 bits[3] = {2, 8, 16};
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_Shift((ins & 1) ? DRC_SHR : DRC_SHL, DRC_T0, bits[(ins >> 4) & 0x3]);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_MOVWL4(d, rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVLL4(d, rn, rm)
+static void drc_clrt(UNUSED u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	emit_Load(DRC_T0, CTX_SR);
+	emit_OpImm(DRC_AND, DRC_T0, ~1);
+	emit_Store(DRC_T0, CTX_SR);
 }
 
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_MOVA(d)
+static void drc_sett(UNUSED u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	emit_Load(DRC_T0, CTX_SR);
+	emit_OpImm(DRC_OR, DRC_T0, 1);
+	emit_Store(DRC_T0, CTX_SR);
 }
 
-void sh2_jit_MOVT(rn)
-{
-	PPCC_ANDI(rn, GP_SR, 0x0001);
-}
+//////////////////////////////////////////////////////////////////////////////
 
-/*Branch and Jumps*/
-void sh2_jit_BF(d)
+static void drc_movt(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadT(DRC_T0);
+	drc_StoreR(DRC_T0, INSTRUCTION_B(ins));
 }
 
-void sh2_jit_BFS(d)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_BRA(d)
+//cmp/eq, cmp/hs, cmp/ge, cmp/hi, cmp/gt
+static void drc_cmp(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	u32 cc;
+	switch (ins & 0xF) {
+		case 0x0:	cc = DRC_EQ; break;
+		case 0x2:	cc = DRC_HS; break;
+		case 0x3:	cc = DRC_GE; break;
+		case 0x6:	cc = DRC_HI; break;
+		default:	cc = DRC_GT; break;
+	}
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	emit_SetCC(cc, DRC_T0, DRC_T0, DRC_T1);
+	drc_StoreT(DRC_T0);
 }
 
-void sh2_jit_BRAF(rm)
-{
-	//XXX
-}
-
-void sh2_jit_BSR(d)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_BSRF(rm)
+//cmp/pz (4n11), cmp/pl (4n15)
+static void drc_cmpz(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_Imm(DRC_T1, 0);
+	emit_SetCC((ins & 0x4) ? DRC_GT : DRC_GE, DRC_T0, DRC_T0, DRC_T1);
+	drc_StoreT(DRC_T0);
 }
 
-void sh2_jit_BT(d)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_BTS(d)
+static void drc_cmpim(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, 0);
+	emit_Imm(DRC_T1, (s32) (s8) ins);
+	emit_SetCC(DRC_EQ, DRC_T0, DRC_T0, DRC_T1);
+	drc_StoreT(DRC_T0);
 }
 
-void sh2_jit_JMP(rm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_JSR(rm)
+static void drc_tst(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	drc_LoadR(DRC_T1, INSTRUCTION_C(ins));
+	emit_SetCC(DRC_TST, DRC_T0, DRC_T0, DRC_T1);
+	drc_StoreT(DRC_T0);
 }
 
-void sh2_jit_RTE()
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_RTS()
+static void drc_tsti(u16 ins, UNUSED u32 pc)
 {
-	//XXX
+	drc_LoadR(DRC_T0, 0);
+	emit_Imm(DRC_T1, INSTRUCTION_CD(ins));
+	emit_SetCC(DRC_TST, DRC_T0, DRC_T0, DRC_T1);
+	drc_StoreT(DRC_T0);
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+// Delayed branches, PC (and PR) are set before the delay slot runs
+//////////////////////////////////////////////////////////////////////////////
 
-/*Other*/
-void sh2_jit_NOP()
-{
-	/*Does nothing*/
-}
-
-void sh2_jit_SLEEP()
+static void drc_SetPC(u32 target)
 {
-	//XXX
+	emit_Imm(DRC_T0, target);
+	emit_Store(DRC_T0, CTX_PC);
+	drc_target = target;
+	drc_target_known = 1;
 }
 
-void sh2_jit_SWAPB(rn, rm)
-{
-	PPCC_ORI(rn, rm, 0x0);					/*RN <- RM*/
-	PPCC_RLWINM(GP_TMP, rm, 8, 16, 31);		/*shift first 8 bits*/
-	PPCC_RLWINM(GP_TMP, rm, 32-8, 24, 31);	/*shift second 8 bits*/
-	PPCC_RLWINM(rn, GP_TMP, 0, 16, 31);		/*Store swap in rn*/
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_SWAPW(rn, rm)
+static void drc_SetPR(u32 pc)
 {
-	PPCC_RLWINM(rn, rm, 16, 0, 31);
+	emit_Imm(DRC_T0, pc + 4);
+	emit_Store(DRC_T0, CTX_PR);
 }
 
-void sh2_jit_TAS(rn)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_TRAPA(imm)
+static void drc_bra(u16 ins, u32 pc)
 {
-	//XXX
+	s32 disp = INSTRUCTION_BCD(ins);
+	disp |= (-(disp & 0x800));
+	if (INSTRUCTION_A(ins) == 0xB) {
+		drc_SetPR(pc);
+	}
+	drc_SetPC(pc + (disp << 1) + 4);
 }
 
-void sh2_jit_TST(rn, rm)
-{
-	PPCC_ANDp(rn, rn, rm);					/*Rn AND Rm and check if zero*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 3, 31, 31); 	/*Store EQ (Zero) in T*/
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_TSTI(imm)
+//braf, bsrf
+static void drc_braf(u16 ins, u32 pc)
 {
-	PPCC_ANDI(GP_R0, GP_R0, imm);			/*R0 AND imm and check if zero*/
-	PPCC_MFCR(GP_TMP); 						/*Load CR to TMP*/
-	PPCC_RLWIMI(GP_SR, GP_TMP, 3, 31, 31); 	/*Store EQ (Zero) in T*/
+	if (!(ins & 0x20)) {
+		drc_SetPR(pc);
+	}
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_OpImm(DRC_ADD, DRC_T0, pc + 4);
+	emit_Store(DRC_T0, CTX_PC);
+	drc_target_known = 0;
 }
 
-void sh2_jit_TSTM(imm)
-{
-	//XXX
-}
+//////////////////////////////////////////////////////////////////////////////
 
-void sh2_jit_XTRCT(rn, rm)
+//jmp, jsr
+static void drc_jmp(u16 ins, u32 pc)
 {
-	PPCC_RLWINM(rn, rn, 16, 16, 31); 	/*Shift Rn*/
-	PPCC_RLWIMI(rn, rm, 16, 0, 15); 	/*Store shifted Rm in Rn*/
+	if (!(ins & 0x20)) {
+		drc_SetPR(pc);
+	}
+	drc_LoadR(DRC_T0, INSTRUCTION_B(ins));
+	emit_Store(DRC_T0, CTX_PC);
+	drc_target_known = 0;
 }
 
+//////////////////////////////////////////////////////////////////////////////
 
-u32 sh2_jit_Recompile()
+static void drc_rts(UNUSED u16 ins, UNUSED u32 pc)
 {
-
-}
-
+	emit_Load(DRC_T0, CTX_PR);
+	emit_Store(DRC_T0, CTX_PC);
+	drc_target_known = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Like SH2delay, the slot sees PC already pointing at the branch target
+static void drc_Slot(u16 ins, const drc_op *op)
+{
+	if (op->emit && (!(op->flags & OPF_PCREL) || drc_target_known)) {
+		op->emit(ins, drc_target);
+		drc_pend += op->cycles;
+		return;
+	}
+	emit_Imm(DRC_T0, ins);
+	emit_Store16(DRC_T0, CTX_INSTRUCTION);
+	emit_CallCtx((void *) decode(ins));
+	emit_Load(DRC_T0, CTX_PC);
+	emit_OpImm(DRC_SUB, DRC_T0, 2);
+	emit_Store(DRC_T0, CTX_PC);
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Instruction table
+//////////////////////////////////////////////////////////////////////////////
+
+static const drc_op drc_ops[] = {
+	{0xFFFF, 0x0008, 1, 0, drc_clrt},
+	{0xFFFF, 0x0009, 1, 0, drc_nop},
+	{0xFFFF, 0x000B, 2, OPF_DELAY, drc_rts},
+	{0xFFFF, 0x0018, 1, 0, drc_sett},
+	{0xFFFF, 0x0019, 1, 0, NULL},					//div0u
+	{0xFFFF, 0x001B, 3, OPF_END, NULL},				//sleep
+	{0xFFFF, 0x0028, 1, 0, drc_clrmac},
+	{0xFFFF, 0x002B, 4, OPF_END, NULL},				//rte
+	{0xF0FF, 0x0002, 1, 0, drc_sts},				//stc sr
+	{0xF0FF, 0x0012, 1, 0, drc_sts},				//stc gbr
+	{0xF0FF, 0x0022, 1, 0, drc_sts},				//stc vbr
+	{0xF0FF, 0x0003, 2, OPF_DELAY, drc_braf},		//bsrf
+	{0xF0FF, 0x0023, 2, OPF_DELAY, drc_braf},
+	{0xF00F, 0x0004, 1, OPF_WRITE, drc_movs0},
+	{0xF00F, 0x0005, 1, OPF_WRITE, drc_movs0},
+	{0xF00F, 0x0006, 1, OPF_WRITE, drc_movs0},
+	{0xF00F, 0x0007, 2, 0, drc_mull},
+	{0xF0FF, 0x000A, 1, 0, drc_sts},				//sts mach
+	{0xF0FF, 0x001A, 1, 0, drc_sts},				//sts macl
+	{0xF0FF, 0x002A, 1, 0, drc_sts},				//sts pr
+	{0xF0FF, 0x0029, 1, 0, drc_movt},
+	{0xF00F, 0x000C, 1, 0, drc_movl0},
+	{0xF00F, 0x000D, 1, 0, drc_movl0},
+	{0xF00F, 0x000E, 1, 0, drc_movl0},
+	{0xF00F, 0x000F, 3, 0, NULL},					//mac.l
+
+	{0xF000, 0x1000, 1, OPF_WRITE, drc_movls4},
+
+	{0xF00F, 0x2000, 1, OPF_WRITE, drc_movs},
+	{0xF00F, 0x2001, 1, OPF_WRITE, drc_movs},
+	{0xF00F, 0x2002, 1, OPF_WRITE, drc_movs},
+	{0xF00F, 0x2004, 1, OPF_WRITE, drc_movm},
+	{0xF00F, 0x2005, 1, OPF_WRITE, drc_movm},
+	{0xF00F, 0x2006, 1, OPF_WRITE, drc_movm},
+	{0xF00F, 0x2007, 1, 0, NULL},					//div0s
+	{0xF00F, 0x2008, 1, 0, drc_tst},
+	{0xF00F, 0x2009, 1, 0, drc_and},
+	{0xF00F, 0x200A, 1, 0, drc_xor},
+	{0xF00F, 0x200B, 1, 0, drc_or},
+	{0xF00F, 0x200C, 1, 0, NULL},					//cmp/str
+	{0xF00F, 0x200D, 1, 0, drc_xtrct},
+	{0xF00F, 0x200E, 1, 0, drc_mulw},
+	{0xF00F, 0x200F, 1, 0, drc_mulw},
+
+	{0xF00F, 0x3000, 1, 0, drc_cmp},
+	{0xF00F, 0x3002, 1, 0, drc_cmp},
+	{0xF00F, 0x3003, 1, 0, drc_cmp},
+	{0xF00F, 0x3004, 1, 0, NULL},					//div1
+	{0xF00F, 0x3005, 2, 0, NULL},					//dmulu.l
+	{0xF00F, 0x3006, 1, 0, drc_cmp},
+	{0xF00F, 0x3007, 1, 0, drc_cmp},
+	{0xF00F, 0x3008, 1, 0, drc_sub},
+	{0xF00F, 0x300A, 1, 0, NULL},					//subc
+	{0xF00F, 0x300B, 1, 0, NULL},					//subv
+	{0xF00F, 0x300C, 1, 0, drc_add},
+	{0xF00F, 0x300D, 2, 0, NULL},					//dmuls.l
+	{0xF00F, 0x300E, 1, 0, NULL},					//addc
+	{0xF00F, 0x300F, 1, 0, NULL},					//addv
+
+	{0xF0FF, 0x4000, 1, 0, drc_shift1},				//shll
+	{0xF0FF, 0x4001, 1, 0, drc_shift1},				//shlr
+	{0xF0FF, 0x4002, 1, OPF_WRITE, drc_stsm},		//sts.l mach
+	{0xF0FF, 0x4003, 2, OPF_WRITE, NULL},			//stc.l sr
+	{0xF0FF, 0x4004, 1, 0, drc_shift1},				//rotl
+	{0xF0FF, 0x4005, 1, 0, drc_shift1},				//rotr
+	{0xF0FF, 0x4006, 1, 0, drc_ldsm},				//lds.l mach
+	{0xF0FF, 0x4007, 3, 0, NULL},					//ldc.l sr
+	{0xF0FF, 0x4008, 1, 0, drc_shiftn},
+	{0xF0FF, 0x4009, 1, 0, drc_shiftn},
+	{0xF0FF, 0x400A, 1, 0, drc_lds},				//lds mach
+	{0xF0FF, 0x400B, 2, OPF_DELAY, drc_jmp},		//jsr
+	{0xF0FF, 0x400E, 1, 0, NULL},					//ldc sr
+	{0xF00F, 0x400F, 3, 0, NULL},					//mac.w
+	{0xF0FF, 0x4010, 1, 0, drc_dt},
+	{0xF0FF, 0x4011, 1, 0, drc_cmpz},				//cmp/pz
+	{0xF0FF, 0x4012, 1, OPF_WRITE, drc_stsm},		//sts.l macl
+	{0xF0FF, 0x4013, 2, OPF_WRITE, NULL},			//stc.l gbr
+	{0xF0FF, 0x4015, 1, 0, drc_cmpz},				//cmp/pl
+	{0xF0FF, 0x4016, 1, 0, drc_ldsm},				//lds.l macl
+	{0xF0FF, 0x4017, 3, 0, NULL},					//ldc.l gbr
+	{0xF0FF, 0x4018, 1, 0, drc_shiftn},
+	{0xF0FF, 0x4019, 1, 0, drc_shiftn},
+	{0xF0FF, 0x401A, 1, 0, drc_lds},				//lds macl
+	{0xF0FF, 0x401B, 4, OPF_WRITE, NULL},			//tas.b
+	{0xF0FF, 0x401E, 1, 0, drc_lds},				//ldc gbr
+	{0xF0FF, 0x4020, 1, 0, drc_shift1},				//shal
+	{0xF0FF, 0x4021, 1, 0, drc_shift1},				//shar
+	{0xF0FF, 0x4022, 1, OPF_WRITE, drc_stsm},		//sts.l pr
+	{0xF0FF, 0x4023, 2, OPF_WRITE, NULL},			//stc.l vbr
+	{0xF0FF, 0x4024, 1, 0, NULL},					//rotcl
+	{0xF0FF, 0x4025, 1, 0, NULL},					//rotcr
+	{0xF0FF, 0x4026, 1, 0, drc_ldsm},				//lds.l pr
+	{0xF0FF, 0x4027, 3, 0, NULL},					//ldc.l vbr
+	{0xF0FF, 0x4028, 1, 0, drc_shiftn},
+	{0xF0FF, 0x4029, 1, 0, drc_shiftn},
+	{0xF0FF, 0x402A, 1, 0, drc_lds},				//lds pr
+	{0xF0FF, 0x402B, 2, OPF_DELAY, drc_jmp},
+	{0xF0FF, 0x402E, 1, 0, drc_lds},				//ldc vbr
+
+	{0xF000, 0x5000, 1, 0, drc_movll4},
+
+	{0xF00F, 0x6000, 1, 0, drc_movl},
+	{0xF00F, 0x6001, 1, 0, drc_movl},
+	{0xF00F, 0x6002, 1, 0, drc_movl},
+	{0xF00F, 0x6003, 1, 0, drc_mov},
+	{0xF00F, 0x6004, 1, 0, drc_movp},
+	{0xF00F, 0x6005, 1, 0, drc_movp},
+	{0xF00F, 0x6006, 1, 0, drc_movp},
+	{0xF00F, 0x6007, 1, 0, drc_unary},				//not
+	{0xF00F, 0x6008, 1, 0, drc_unary},				//swap.b
+	{0xF00F, 0x6009, 1, 0, drc_unary},				//swap.w
+	{0xF00F, 0x600A, 1, 0, NULL},					//negc
+	{0xF00F, 0x600B, 1, 0, drc_unary},				//neg
+	{0xF00F, 0x600C, 1, 0, drc_unary},				//extu.b
+	{0xF00F, 0x600D, 1, 0, drc_unary},				//extu.w
+	{0xF00F, 0x600E, 1, 0, drc_unary},				//exts.b
+	{0xF00F, 0x600F, 1, 0, drc_unary},				//exts.w
+
+	{0xF000, 0x7000, 1, 0, drc_addi},
+
+	{0xFF00, 0x8000, 1, OPF_WRITE, drc_movs4},
+	{0xFF00, 0x8100, 1, OPF_WRITE, drc_movs4},
+	{0xFF00, 0x8400, 1, 0, drc_movl4},
+	{0xFF00, 0x8500, 1, 0, drc_movl4},
+	{0xFF00, 0x8800, 1, 0, drc_cmpim},
+	{0xFF00, 0x8900, 3, OPF_COND, NULL},			//bt
+	{0xFF00, 0x8B00, 3, OPF_COND, NULL},			//bf
+	{0xFF00, 0x8D00, 2, OPF_COND | OPF_DELAY, NULL},	//bt/s
+	{0xFF00, 0x8F00, 2, OPF_COND | OPF_DELAY, NULL},	//bf/s
+
+	{0xF000, 0x9000, 1, OPF_PCREL, drc_movwi},
+	{0xF000, 0xA000, 2, OPF_DELAY, drc_bra},
+	{0xF000, 0xB000, 2, OPF_DELAY, drc_bra},		//bsr
+
+	{0xFF00, 0xC000, 1, OPF_WRITE, drc_movsg},
+	{0xFF00, 0xC100, 1, OPF_WRITE, drc_movsg},
+	{0xFF00, 0xC200, 1, OPF_WRITE, drc_movsg},
+	{0xFF00, 0xC300, 8, OPF_END, NULL},				//trapa
+	{0xFF00, 0xC400, 1, 0, drc_movlg},
+	{0xFF00, 0xC500, 1, 0, drc_movlg},
+	{0xFF00, 0xC600, 1, 0, drc_movlg},
+	{0xFF00, 0xC700, 1, OPF_PCREL, drc_mova},
+	{0xFF00, 0xC800, 1, 0, drc_tsti},
+	{0xFF00, 0xC900, 1, 0, drc_logici},				//and
+	{0xFF00, 0xCA00, 1, 0, drc_logici},				//xor
+	{0xFF00, 0xCB00, 1, 0, drc_logici},				//or
+	{0xFF00, 0xCC00, 3, 0, NULL},					//tst.b
+	{0xFF00, 0xCD00, 3, OPF_WRITE, NULL},			//and.b
+	{0xFF00, 0xCE00, 3, OPF_WRITE, NULL},			//xor.b
+	{0xFF00, 0xCF00, 3, OPF_WRITE, NULL},			//or.b
+
+	{0xF000, 0xD000, 1, OPF_PCREL, drc_movli},
+	{0xF000, 0xE000, 1, 0, drc_movi},
+};
+
+#define DRC_NUM_OPS		(sizeof(drc_ops) / sizeof(drc_ops[0]))
+
+//////////////////////////////////////////////////////////////////////////////
+
+//NULL for illegal instructions, left to the interpreter (BIOS calls use them)
+static INLINE const drc_op *drc_Decode(u16 ins)
+{
+	u32 i = drc_optab[ins];
+	return i ? &drc_ops[i - 1] : NULL;
+}
+
+
+//////////////////////////////////////////////////////////////////////////////
+// Block cache
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 *drc_Version(u32 addr)
+{
+	switch ((addr >> 20) & 0x0FF) {
+		case 0x000:
+			return &drc_ver_rom;
+		case 0x002:
+			return &drc_ver[(addr & 0xFFFFF) >> WRAM_CODE_SHIFT];
+	}
+	return &drc_ver[((addr & 0xFFFFF) | 0x100000) >> WRAM_CODE_SHIFT];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void drc_Mark(u32 *ver)
+{
+	if (ver != &drc_ver_rom) {
+		wram_code[ver - drc_ver] = 1;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void drc_Flush(void)
+{
+	for (u32 i = 0; i < DRC_HASH; ++i) {
+		drc_blocks[i].pc = 1;
+	}
+	memset(drc_ver, 0, sizeof(drc_ver));
+	memset(wram_code, 0, sizeof(wram_code));
+	drc_ptr = drc_cache;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static drc_block *drc_Compile(drc_block *blk, u32 pc)
+{
+	u32 region = (pc >> 20) & 0x0FF;
+
+	//Same cacheable regions as the block interpreter
+	if ((pc >> 29) > 1 || !(region == 0x000 || region == 0x002 || (region >= 0x060 && region <= 0x06F))) {
+		return NULL;
+	}
+	if (drc_ptr + DRC_BLOCK_SIZE > drc_end) {
+		drc_Flush();
+	}
+	blk->ver[0] = drc_Version(pc);
+	if (*blk->ver[0] >= DRC_VOLATILE) {
+		return NULL;
+	}
+
+	fetchfunc fetch = fetchlist[region];
+	u32 limit = (pc | 0xFFFFF) + 1;
+	u32 addr = pc;
+	u32 last = pc;
+	u32 num_ops = 0;
+	u32 cycles = 0;
+	u32 open = 1;
+	u8 *start = drc_ptr;
+
+	drc_pend = 0;
+	emit_Begin();
+	while (num_ops < DRC_MAX_OPS && addr < limit) {
+		u16 ins = fetch(addr);
+		const drc_op *op = drc_Decode(ins);
+		const drc_op *sop = NULL;
+		u16 slot = 0;
+		if (op == NULL) {
+			break;
+		}
+		if (op->flags & OPF_DELAY) {
+			if (addr + 2 >= limit) {
+				break;
+			}
+			slot = fetch(addr + 2);
+			sop = drc_Decode(slot);
+			if (sop == NULL || (sop->flags & (OPF_DELAY | OPF_COND | OPF_END))) {
+				break;
+			}
+			last = addr + 2;
+		} else {
+			last = addr;
+		}
+		++num_ops;
+
+		if (op->flags & OPF_COND) {
+			//Taken path leaves the block, not taken falls through
+			u32 pend = drc_pend;
+			u32 target = addr + 4 + ((s32) (s8) ins << 1);
+			drc_LoadT(DRC_T0);
+			u8 *skip = (ins & 0x0200) ? emit_JumpNZ(DRC_T0) : emit_JumpZ(DRC_T0);
+			if (op->flags & OPF_DELAY) {
+				drc_SetPC(target);
+				drc_pend += 2;
+				drc_Slot(slot, sop);
+				drc_Exit(0, 0);
+				cycles += 2 + sop->cycles;
+			} else {
+				drc_pend += 3;
+				drc_Exit(1, target);
+				cycles += 3;
+			}
+			emit_Patch(skip);
+			drc_pend = pend + 1;
+			addr += 2;
+			continue;
+		}
+
+		if (op->flags & OPF_DELAY) {
+			op->emit(ins, addr);
+			drc_pend += op->cycles;
+			drc_Slot(slot, sop);
+			drc_Exit(0, 0);
+			cycles += op->cycles + sop->cycles;
+			open = 0;
+			break;
+		}
+
+		cycles += op->cycles;
+		if (op->emit) {
+			op->emit(ins, addr);
+			drc_pend += op->cycles;
+		} else {
+			drc_Fallback(ins, addr);
+			if (op->flags & OPF_END) {
+				drc_Exit(0, 0);
+				open = 0;
+				break;
+			}
+		}
+		addr += 2;
+		if (op->flags & OPF_WRITE) {
+			drc_CheckAbort(addr);
+		}
+	}
+
+	if (num_ops == 0) {
+		drc_ptr = start;
+		blk->pc = 1;
+		return NULL;
+	}
+	if (open) {
+		drc_Exit(1, addr);
+	}
+	emit_Sync(start, drc_ptr);
+
+	blk->ver[1] = drc_Version(last);
+	if (*blk->ver[1] >= DRC_VOLATILE) {
+		drc_ptr = start;
+		blk->pc = 1;
+		return NULL;
+	}
+	blk->pc = pc;
+	blk->cycles = cycles;
+	blk->code = (drc_func) start;
+	blk->ver_val[0] = *blk->ver[0];
+	blk->ver_val[1] = *blk->ver[1];
+	drc_Mark(blk->ver[0]);
+	drc_Mark(blk->ver[1]);
+	return blk;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+drc_block *drc_Lookup(u32 pc)
+{
+	drc_block *blk = &drc_blocks[(pc >> 1) & (DRC_HASH - 1)];
+	if (blk->pc == pc && *blk->ver[0] == blk->ver_val[0] && *blk->ver[1] == blk->ver_val[1]) {
+		return blk;
+	}
+	return drc_Compile(blk, pc);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void drc_WriteNotify(u32 start, u32 length)
+{
+	u32 end = start + length;
+	for (u32 addr = start & ~((1 << WRAM_CODE_SHIFT) - 1); addr < end; addr += (1 << WRAM_CODE_SHIFT)) {
+		u32 a = addr & 0x0FFFFFFF;
+		if ((a & 0x0FF00000) != 0x00200000 && (a & 0x0E000000) != 0x06000000) {
+			continue;
+		}
+		u32 granule = ((a | ((a >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1)) >> WRAM_CODE_SHIFT;
+		if (wram_code[granule]) {
+			wram_code[granule] = 0;
+			drc_ver[granule]++;
+			drc_abort = 1;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int drc_Init(void)
+{
+	if (drc_cache == NULL) {
+		drc_cache = (u8 *) emit_Alloc(DRC_CACHE_SIZE);
+		drc_blocks = (drc_block *) malloc(sizeof(drc_block) * DRC_HASH);
+		if (drc_cache == NULL || drc_blocks == NULL) {
+			drc_DeInit();
+			return -1;
+		}
+		drc_end = drc_cache + DRC_CACHE_SIZE;
+		for (u32 ins = 0; ins < 0x10000; ++ins) {
+			drc_optab[ins] = 0;
+			for (u32 i = 0; i < DRC_NUM_OPS; ++i) {
+				if ((ins & drc_ops[i].mask) == drc_ops[i].match) {
+					drc_optab[ins] = i + 1;
+					break;
+				}
+			}
+		}
+	}
+	drc_Flush();
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void drc_DeInit(void)
+{
+	if (drc_cache) {
+		emit_Free(drc_cache, DRC_CACHE_SIZE);
+	}
+	free(drc_blocks);
+	drc_cache = NULL;
+	drc_blocks = NULL;
+	drc_ptr = NULL;
+	memset(wram_code, 0, sizeof(wram_code));
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * compiler.h
+ *--------------------
+ * SH2 block recompiler. The front end in compiler.c discovers blocks, handles
+ * delay slots, cycle accounting and SR.T, and drives a backend (only
+ * emit_x64.inc so far) through the emit_* interface below.
+ */
+
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include "../../sh2core.h"
+
+typedef void (*drc_func)(SH2_struct *);
+
+typedef struct {
+	u32 pc;
+	u32 cycles;			/*Worst case cycles, the block only runs if they fit*/
+	u32 *ver[2];
+	u32 ver_val[2];
+	drc_func code;
+} drc_block;
+
+extern u32 drc_abort;
+
+int drc_Init(void);
+void drc_DeInit(void);
+void drc_Flush(void);
+drc_block *drc_Lookup(u32 pc);
+void drc_WriteNotify(u32 start, u32 length);
+
+//===================================
+// Emitter interface
+//===================================
+/*
+ * Blocks are functions taking the SH2_struct, every SH2 register lives in the
+ * context and is moved through three temporaries. Calls clobber all of them
+ * and return in T0. Backends write to drc_ptr.
+ */
+#define DRC_T0		0
+#define DRC_T1		1
+#define DRC_T2		2
+
+/*emit_Op, emit_OpImm (no DRC_MUL)*/
+#define DRC_ADD		0
+#define DRC_SUB		1
+#define DRC_AND		2
+#define DRC_OR		3
+#define DRC_XOR		4
+#define DRC_MUL		5
+
+/*emit_Shift, 1 to 31 bits*/
+#define DRC_SHL		0
+#define DRC_SHR		1
+#define DRC_SAR		2
+#define DRC_ROL		3
+#define DRC_ROR		4
+
+/*emit_Unary*/
+#define DRC_NOT		0
+#define DRC_NEG		1
+#define DRC_EXTSB	2
+#define DRC_EXTSW	3
+#define DRC_EXTUB	4
+#define DRC_EXTUW	5
+#define DRC_SWAPB	6
+#define DRC_SWAPW	7
+
+/*emit_SetCC, td = (ta cc tb)*/
+#define DRC_EQ		0
+#define DRC_GE		1	/*signed*/
+#define DRC_GT		2	/*signed*/
+#define DRC_HS		3	/*unsigned*/
+#define DRC_HI		4	/*unsigned*/
+#define DRC_TST		5	/*(ta & tb) == 0*/
+
+extern u8 *drc_ptr;
+
+void emit_Begin(void);
+void emit_End(void);
+void emit_Load(u32 t, u32 ofs);
+void emit_Store(u32 t, u32 ofs);
+void emit_Store16(u32 t, u32 ofs);
+void emit_LoadAbs(u32 t, const void *addr);
+void emit_Imm(u32 t, u32 imm);
+void emit_Mov(u32 td, u32 ts);
+void emit_Op(u32 op, u32 td, u32 ts);
+void emit_OpImm(u32 op, u32 td, u32 imm);
+void emit_Shift(u32 op, u32 t, u32 n);
+void emit_Unary(u32 op, u32 td, u32 ts);
+void emit_SetCC(u32 cc, u32 td, u32 ta, u32 tb);
+void emit_Call(void *func);
+void emit_CallCtx(void *func);
+u8 *emit_JumpZ(u32 t);
+u8 *emit_JumpNZ(u32 t);
+void emit_Patch(u8 *jump);
+void *emit_Alloc(u32 size);
+void emit_Free(void *mem, u32 size);
+void emit_Sync(u8 *start, u8 *end);
+
+#endif
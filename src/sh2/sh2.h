@@ -1,12 +1,15 @@
+/*
+ * sh2.h
+ *--------------------
+ * SH2 recompiler core (SH2Dynarec) and on-chip register offsets.
+ */
 
+#ifndef SH2_H
+#define SH2_H
 
+#include "../sh2core.h"
 
-//===================================
-// SH2 Flags
-//===================================
-#define SH2_FLAG_SLAVE		0x01
-#define SH2_FLAG_IDLE		0x02
-#define SH2_FLAG_SLEEPING	0x04
+#define SH2CORE_DYNAREC		3
 
 //===================================
 // On-Chip peripheral modules (Addresses 0xFFFFFE00 - 0xFFFFFFFF)
@@ -79,6 +82,12 @@
 #define OC_RTCNT		0x1F4
 #define OC_RTCOR		0x1F8
 
+#ifdef SH2_DYNAREC
+int SH2DynarecInit(void);
+void SH2DynarecDeInit(void);
+void SH2DynarecReset(SH2_struct *context);
+void FASTCALL SH2DynarecExec(SH2_struct *context, u32 cycles);
+void SH2DynarecWriteNotify(u32 start, u32 length);
+#endif
 
-
-
+#endif
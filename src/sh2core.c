@@ -24,6 +24,9 @@
 #include "debug.h"
 #include "memory.h"
 #include "yabause.h"
+#ifdef OPTIMIZED_DMA
+#include "cs2.h"
+#endif
 
 SH2_struct *MSH2=NULL;
 SH2_struct *SSH2=NULL;
@@ -1737,6 +1740,26 @@ void DMATransfer(u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *VCRDMA)
          default: destInc = 0; break;
       }
 
+      i = 0;
+#ifdef OPTIMIZED_DMA
+      // Long and 16 byte units from the CD block data port into memory
+      // moving forward are sector data transfers, copied in bulk
+      if (srcInc == 0 && destInc == 1 && (*CHCR & 0x0800)) {
+         u32 unit = (*CHCR & 0x0400) ? 3 : 0;
+         u32 n;
+         while (i < *TCR && (n = Cs2DataPortDma(*SAR, *DAR, *TCR - i)) != 0) {
+            *DAR += n << 2;
+            i += n;
+         }
+         // The loop below moves whole 16 byte units, finish the one the
+         // sector data ran out in
+         for (; (i & unit) && i < *TCR; i++) {
+            mem_Write32(*DAR, mem_Read32(*SAR));
+            *DAR += 4;
+         }
+      }
+#endif
+
       switch (size = ((*CHCR & 0x0C00) >> 10)) {
          case 0:
             for (i = 0; i < *TCR; i++) {
@@ -1763,7 +1786,7 @@ void DMATransfer(u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *VCRDMA)
             destInc *= 4;
             srcInc *= 4;
 
-            for (i = 0; i < *TCR; i++) {
+            for (; i < *TCR; i++) {
                mem_Write32(*DAR, mem_Read32(*SAR));
                *DAR += destInc;
                *SAR += srcInc;
@@ -1775,7 +1798,7 @@ void DMATransfer(u32 *CHCR, u32 *SAR, u32 *DAR, u32 *TCR, u32 *VCRDMA)
             destInc *= 4;
             srcInc *= 4;
 
-            for (i = 0; i < *TCR; i+=4) {
+            for (; i < *TCR; i+=4) {
                for(i2 = 0; i2 < 4; i2++) {
                   mem_Write32(*DAR, mem_Read32(*SAR));
                   *DAR += destInc;
@@ -67,6 +67,7 @@ typedef struct
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 reserved1:22;
       u32 M:1;
       u32 Q:1;
@@ -74,6 +75,15 @@ typedef struct
       u32 reserved0:2;
       u32 S:1;
       u32 T:1;
+#else
+      u32 T:1;
+      u32 S:1;
+      u32 reserved0:2;
+      u32 I:4;
+      u32 Q:1;
+      u32 M:1;
+      u32 reserved1:22;
+#endif
     } part;
     u32 all;
   } SR;
@@ -99,8 +109,13 @@ typedef struct
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u16 H:8; // 0xFFFFFE12
       u16 L:8; // 0xFFFFFE13
+#else
+      u16 L:8; // 0xFFFFFE13
+      u16 H:8; // 0xFFFFFE12
+#endif
     } part;
     u16 all;
   } FRC;
@@ -137,16 +152,26 @@ typedef struct
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 H:16; // 0xFFFFFF40
       u32 L:16; // 0xFFFFFF42
+#else
+      u32 L:16; // 0xFFFFFF42
+      u32 H:16; // 0xFFFFFF40
+#endif
     } part;
     u16 all;
   } BARA;
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 H:16; // 0xFFFFFF44
       u32 L:16; // 0xFFFFFF46
+#else
+      u32 L:16; // 0xFFFFFF46
+      u32 H:16; // 0xFFFFFF44
+#endif
     } part;
     u16 all;
   } BAMRA;
@@ -155,16 +180,26 @@ typedef struct
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 H:16; // 0xFFFFFF60
       u32 L:16; // 0xFFFFFF62
+#else
+      u32 L:16; // 0xFFFFFF62
+      u32 H:16; // 0xFFFFFF60
+#endif
     } part;
     u16 all;
   } BARB;
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 H:16; // 0xFFFFFF64
       u32 L:16; // 0xFFFFFF66
+#else
+      u32 L:16; // 0xFFFFFF66
+      u32 H:16; // 0xFFFFFF64
+#endif
     } part;
     u16 all;
   } BAMRB;
@@ -173,16 +208,26 @@ typedef struct
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 H:16; // 0xFFFFFF70
       u32 L:16; // 0xFFFFFF72
+#else
+      u32 L:16; // 0xFFFFFF72
+      u32 H:16; // 0xFFFFFF70
+#endif
     } part;
     u16 all;
   } BDRB;
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 H:16; // 0xFFFFFF74
       u32 L:16; // 0xFFFFFF76
+#else
+      u32 L:16; // 0xFFFFFF76
+      u32 H:16; // 0xFFFFFF74
+#endif
     } part;
     u16 all;
   } BDMRB;
@@ -359,6 +404,25 @@ static INLINE void SH2HandleBreakpoints(SH2_struct *context)
    }
 }
 
+static INLINE void SH2HandleInterrupts(SH2_struct *context)
+{
+   if (context->NumberOfInterrupts != 0)
+   {
+      if (context->interrupts[context->NumberOfInterrupts-1].level > context->regs.SR.part.I)
+      {
+         context->regs.R[15] -= 4;
+         mem_Write32(context->regs.R[15], context->regs.SR.all);
+         context->regs.R[15] -= 4;
+         mem_Write32(context->regs.R[15], context->regs.PC);
+         context->regs.SR.part.I = context->interrupts[context->NumberOfInterrupts-1].level;
+         context->regs.PC = mem_Read32(context->regs.VBR + (context->interrupts[context->NumberOfInterrupts-1].vector << 2));
+         context->NumberOfInterrupts--;
+         context->isIdle = 0;
+         context->isSleeping = 0;
+      }
+   }
+}
+
 int SH2AddMemoryBreakpoint(SH2_struct *context, u32 addr, u32 flags);
 int SH2DelMemoryBreakpoint(SH2_struct *context, u32 addr);
 memorybreakpoint_struct *SH2GetMemoryBreakpointList(SH2_struct *context);
@@ -391,8 +455,4 @@ void FASTCALL SSH2InputCaptureWriteWord(u32 addr, u16 data);
 extern SH2Interface_struct SH2Dynarec;
 #endif
 
-#if defined(SH2_DYNAREC)
-extern SH2Interface_struct SH2Dynarec;
-#endif
-
 #endif
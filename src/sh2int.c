@@ -111,6 +111,42 @@ SH2Interface_struct SH2DebugInterpreter = {
    NULL  // SH2WriteNotify not used
 };
 
+SH2Interface_struct SH2BlockInterpreter = {
+   SH2CORE_BLOCKINTERPRETER,
+   "SH2 Block Interpreter",
+
+   SH2BlockInterpreterInit,
+   SH2BlockInterpreterDeInit,
+   SH2BlockInterpreterReset,
+   SH2BlockInterpreterExec,
+
+   SH2InterpreterGetRegisters,
+   SH2InterpreterGetGPR,
+   SH2InterpreterGetSR,
+   SH2InterpreterGetGBR,
+   SH2InterpreterGetVBR,
+   SH2InterpreterGetMACH,
+   SH2InterpreterGetMACL,
+   SH2InterpreterGetPR,
+   SH2InterpreterGetPC,
+
+   SH2InterpreterSetRegisters,
+   SH2InterpreterSetGPR,
+   SH2InterpreterSetSR,
+   SH2InterpreterSetGBR,
+   SH2InterpreterSetVBR,
+   SH2InterpreterSetMACH,
+   SH2InterpreterSetMACL,
+   SH2InterpreterSetPR,
+   SH2InterpreterSetPC,
+
+   SH2InterpreterSendInterrupt,
+   SH2InterpreterGetInterrupts,
+   SH2InterpreterSetInterrupts,
+
+   SH2BlockInterpreterWriteNotify
+};
+
 fetchfunc fetchlist[0x100];
 
 //////////////////////////////////////////////////////////////////////////////
@@ -205,16 +241,17 @@ static void FASTCALL SH2addi(SH2_struct * sh)
 //25 inst -> 20 inst
 static void FASTCALL SH2addc(SH2_struct * sh)
 {
-   u32 tmp;//0, tmp1;
    s32 m = INSTRUCTION_C(sh->instruction);
    s32 n = INSTRUCTION_B(sh->instruction);
-#if 0
-   tmp1 = sh->regs.R[source] + sh->regs.R[dest];
-   tmp0 = sh->regs.R[dest];
+#ifndef __PPC__
+   u32 tmp0, tmp1;
+   tmp1 = sh->regs.R[m] + sh->regs.R[n];
+   tmp0 = sh->regs.R[n];
 
-   sh->regs.R[dest] = tmp1 + sh->regs.SR.part.T;
-   sh->regs.SR.part.T = (tmp0 > tmp1) | (tmp1 > sh->regs.R[dest]);
+   sh->regs.R[n] = tmp1 + sh->regs.SR.part.T;
+   sh->regs.SR.part.T = (tmp0 > tmp1) | (tmp1 > sh->regs.R[n]);
 #else
+	u32 tmp;
 	asm("rlwinm %0, %2, 29, 2, 2\n\t"
 		"mtxer %0\n\t"
 		"addo %1, %1, %3\n\t"
@@ -233,11 +270,10 @@ static void FASTCALL SH2addc(SH2_struct * sh)
 //23 inst -> 18 inst
 static void FASTCALL SH2addv(SH2_struct * sh)
 {
-	u32 tmp;
    u32 n = INSTRUCTION_B(sh->instruction);
    u32 m = INSTRUCTION_C(sh->instruction);
 
-#if 0
+#ifndef __PPC__
       s32 dest,src,ans;
 
    dest = ((s32) sh->regs.R[n] < 0);
@@ -247,6 +283,7 @@ static void FASTCALL SH2addv(SH2_struct * sh)
 
 	sh->regs.SR.part.T = ans & !(src & 1);
 #else
+	u32 tmp;
 	asm("addo %1, %1, %3\n\t"			/*Add rn + rm*/
 		"mfxer %0\n\t"					/*Load XER[CA] to TMP*/
 		"rlwimi %2, %0, 2, 31, 31"		/*Store T*/
@@ -450,7 +487,7 @@ static void FASTCALL SH2cmpeq(SH2_struct * sh)
 	//u32 tmp;
 	u32 n = INSTRUCTION_B(sh->instruction);
 	u32 m = INSTRUCTION_C(sh->instruction);
-#if 0
+#ifndef __PPC__
 	sh->regs.SR.part.T = (sh->regs.R[n] == sh->regs.R[m]);
 #else
 	u32 tmp;
@@ -616,7 +653,7 @@ static void FASTCALL SH2dmuls(SH2_struct * sh)
 	u32 m = INSTRUCTION_C(sh->instruction);
 	u32 n = INSTRUCTION_B(sh->instruction);
 
-#if 1
+#ifdef __PPC__
 	asm("mulhw %0, %2, %3\n\t"
 		"mullw %1, %2, %3"
 		: "=r" (sh->regs.MACH), "=r" (sh->regs.MACL)
@@ -676,7 +713,7 @@ static void FASTCALL SH2dmulu(SH2_struct * sh)
 {
    u32 m = INSTRUCTION_C(sh->instruction);
    u32 n = INSTRUCTION_B(sh->instruction);
-#if 1
+#ifdef __PPC__
 	asm("mulhwu %0, %2, %3\n\t"
 		"mullw %1, %2, %3"
 		: "=r" (sh->regs.MACH), "=r" (sh->regs.MACL)
@@ -930,7 +967,7 @@ static void FASTCALL SH2macl(SH2_struct * sh)
 {
 	u32 m = INSTRUCTION_C(sh->instruction);
 	u32 n = INSTRUCTION_B(sh->instruction);
-#if 1
+#ifdef __PPC__
 	u32 tmp_h, tmp_l;
 	u32 mem_n = mem_Read32(sh->regs.R[n]);
 	sh->regs.R[n] += 4;
@@ -1625,7 +1662,7 @@ static void FASTCALL SH2rotcr(SH2_struct * sh)
 static void FASTCALL SH2rotl(SH2_struct * sh)
 {
 	u32 n = INSTRUCTION_B(sh->instruction);
-#if 1
+#ifdef __PPC__
 	asm("rlwimi %0, %1, 1, 31, 31\n\t"
 		"rlwinm %1, %1, 1, 0, 31"
 		: "+r" (sh->regs.SR.all), "+r" (sh->regs.R[n])
@@ -2652,27 +2689,6 @@ static INLINE void SH2UBCInterrupt(SH2_struct *context, u32 flag)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static INLINE void SH2HandleInterrupts(SH2_struct *context)
-{
-   if (context->NumberOfInterrupts != 0)
-   {
-      if (context->interrupts[context->NumberOfInterrupts-1].level > context->regs.SR.part.I)
-      {
-         context->regs.R[15] -= 4;
-         mem_Write32(context->regs.R[15], context->regs.SR.all);
-         context->regs.R[15] -= 4;
-         mem_Write32(context->regs.R[15], context->regs.PC);
-         context->regs.SR.part.I = context->interrupts[context->NumberOfInterrupts-1].level;
-         context->regs.PC = mem_Read32(context->regs.VBR + (context->interrupts[context->NumberOfInterrupts-1].vector << 2));
-         context->NumberOfInterrupts--;
-         context->isIdle = 0;
-         context->isSleeping = 0;
-      }
-   }
-}
-
-//////////////////////////////////////////////////////////////////////////////
-
 FASTCALL void SH2DebugInterpreterExec(SH2_struct *context, u32 cycles)
 {
 #ifdef SH2_TRACE
@@ -2781,6 +2797,250 @@ FASTCALL void SH2InterpreterExec(SH2_struct *context, u32 cycles)
    }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// Block interpreter
+//
+// Runs of code from the BIOS and work RAM are fetched and decoded once into a
+// block of handler/opcode pairs, which is then replayed without going through
+// fetchlist[] and opcode_arr[] again. Both CPUs share the same cache. Blocks
+// are looked up by PC in a direct mapped table and carry the version of the
+// (at most two) work RAM granules they were decoded from; a write to one of
+// those granules bumps its version, so the block is decoded again the next
+// time it is reached. Granules that keep getting rewritten (data sharing a
+// granule with code, self modifying loops) stop being cached and are simply
+// interpreted. Handlers still account their own cycles and the budget is
+// checked after every instruction, exactly like SH2InterpreterExec.
+//////////////////////////////////////////////////////////////////////////////
+
+#define SH2BLK_HASH_BITS		12
+#define SH2BLK_HASH				(1 << SH2BLK_HASH_BITS)
+#define SH2BLK_MAX_OPS			32
+#define SH2BLK_GRANULES			(WRAM_SIZE >> WRAM_CODE_SHIFT)
+#define SH2BLK_VOLATILE			32
+
+typedef struct {
+	opcodefunc func;
+	u16 instruction;
+} sh2blk_op;
+
+typedef struct {
+	u32 pc;
+	u32 num_ops;
+	u32 *ver[2];
+	u32 ver_val[2];
+	sh2blk_op ops[SH2BLK_MAX_OPS];
+} sh2blk;
+
+static sh2blk *blk_cache = NULL;
+static u32 blk_ver[SH2BLK_GRANULES];
+static u32 blk_ver_rom = 0;		//BIOS code never changes
+static u32 blk_abort = 0;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2BlockFlush(void)
+{
+	for (u32 i = 0; i < SH2BLK_HASH; ++i) {
+		blk_cache[i].pc = 1;	//PC is always even, never matches
+	}
+	memset(blk_ver, 0, sizeof(blk_ver));
+	memset(wram_code, 0, sizeof(wram_code));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Unconditional branches, the handler runs the delay slot and moves PC away
+static INLINE int SH2BlockIsEnd(u16 instruction)
+{
+	switch (INSTRUCTION_A(instruction)) {
+		case 0x0:
+			switch (INSTRUCTION_CD(instruction)) {
+				case 0x03:	//bsrf
+				case 0x0B:	//rts
+				case 0x1B:	//sleep
+				case 0x23:	//braf
+				case 0x2B:	//rte
+					return 1;
+			}
+			return 0;
+		case 0x4:	//jsr, jmp
+			return (INSTRUCTION_CD(instruction) == 0x0B || INSTRUCTION_CD(instruction) == 0x2B);
+		case 0xA:	//bra
+		case 0xB:	//bsr
+			return 1;
+		case 0xC:	//trapa
+			return (INSTRUCTION_B(instruction) == 0x3);
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 *SH2BlockVersion(u32 addr)
+{
+	switch ((addr >> 20) & 0x0FF) {
+		case 0x000:
+			return &blk_ver_rom;
+		case 0x002:
+			return &blk_ver[(addr & 0xFFFFF) >> WRAM_CODE_SHIFT];
+	}
+	return &blk_ver[((addr & 0xFFFFF) | 0x100000) >> WRAM_CODE_SHIFT];
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void SH2BlockMark(u32 *ver)
+{
+	if (ver != &blk_ver_rom) {
+		wram_code[ver - blk_ver] = 1;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static sh2blk *SH2BlockCompile(sh2blk *blk, u32 pc)
+{
+	u32 region = (pc >> 20) & 0x0FF;
+
+	//Only cacheable code from the BIOS and work RAM, everything else
+	//(cartridge, data array) is interpreted one instruction at a time
+	if ((pc >> 29) > 1 || !(region == 0x000 || region == 0x002 || (region >= 0x060 && region <= 0x06F))) {
+		return NULL;
+	}
+
+	blk->ver[0] = SH2BlockVersion(pc);
+	if (*blk->ver[0] >= SH2BLK_VOLATILE) {
+		return NULL;
+	}
+
+	fetchfunc fetch = fetchlist[region];
+	u32 addr = pc;
+	u32 num_ops = 0;
+	//Stay within the 1MB region selected by the first fetch
+	u32 limit = (pc | 0xFFFFF) - pc + 1;
+	while (num_ops < SH2BLK_MAX_OPS && (num_ops << 1) < limit) {
+		u16 instruction = fetch(addr);
+		blk->ops[num_ops].instruction = instruction;
+		blk->ops[num_ops].func = decode(instruction);
+		++num_ops;
+		addr += 2;
+		if (SH2BlockIsEnd(instruction)) {
+			break;
+		}
+	}
+
+	blk->ver[1] = SH2BlockVersion(pc + ((num_ops - 1) << 1));
+	if (*blk->ver[1] >= SH2BLK_VOLATILE) {
+		blk->pc = 1;
+		return NULL;
+	}
+	blk->pc = pc;
+	blk->num_ops = num_ops;
+	blk->ver_val[0] = *blk->ver[0];
+	blk->ver_val[1] = *blk->ver[1];
+	SH2BlockMark(blk->ver[0]);
+	SH2BlockMark(blk->ver[1]);
+	return blk;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE sh2blk *SH2BlockLookup(u32 pc)
+{
+	sh2blk *blk = &blk_cache[(pc >> 1) & (SH2BLK_HASH - 1)];
+	if (blk->pc == pc && *blk->ver[0] == blk->ver_val[0] && *blk->ver[1] == blk->ver_val[1]) {
+		return blk;
+	}
+	return SH2BlockCompile(blk, pc);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int SH2BlockInterpreterInit(void)
+{
+	SH2InterpreterInit();
+	if (blk_cache == NULL) {
+		blk_cache = (sh2blk *) malloc(sizeof(sh2blk) * SH2BLK_HASH);
+		if (blk_cache == NULL) {
+			return -1;
+		}
+	}
+	SH2BlockFlush();
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2BlockInterpreterDeInit(void)
+{
+	free(blk_cache);
+	blk_cache = NULL;
+	memset(wram_code, 0, sizeof(wram_code));
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2BlockInterpreterReset(UNUSED SH2_struct *context)
+{
+	//Work RAM is cleared on reset
+	SH2BlockFlush();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void SH2BlockInterpreterWriteNotify(u32 start, u32 length)
+{
+	u32 end = start + length;
+	for (u32 addr = start & ~((1 << WRAM_CODE_SHIFT) - 1); addr < end; addr += (1 << WRAM_CODE_SHIFT)) {
+		u32 a = addr & 0x0FFFFFFF;
+		if ((a & 0x0FF00000) != 0x00200000 && (a & 0x0E000000) != 0x06000000) {
+			continue;
+		}
+		u32 granule = ((a | ((a >> 6) & HIGH_WRAM_SIZE)) & (WRAM_SIZE - 1)) >> WRAM_CODE_SHIFT;
+		if (wram_code[granule]) {
+			wram_code[granule] = 0;
+			blk_ver[granule]++;
+			blk_abort = 1;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+FASTCALL void SH2BlockInterpreterExec(SH2_struct *context, u32 cycles)
+{
+   SH2HandleInterrupts(context);
+
+   if (context->isIdle)
+      SH2idleParse(context, cycles);
+   else
+      SH2idleCheck(context, cycles);
+
+   while(context->cycles < cycles)
+   {
+      sh2blk *blk = SH2BlockLookup(context->regs.PC);
+      if (blk == NULL)
+      {
+         context->instruction = fetchlist[(context->regs.PC >> 20) & 0x0FF](context->regs.PC);
+         decode(context->instruction)(context);
+         continue;
+      }
+
+      // Leave as soon as PC goes anywhere but the next decoded instruction or
+      // a write lands on code that has been decoded
+      sh2blk_op *op = blk->ops;
+      sh2blk_op *end = op + blk->num_ops;
+      u32 pc = context->regs.PC;
+      blk_abort = 0;
+      do {
+         context->instruction = op->instruction;
+         op->func(context);
+         pc += 2;
+         ++op;
+      } while (op < end && context->regs.PC == pc && context->cycles < cycles && !blk_abort);
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////////
 
 void SH2InterpreterGetRegisters(SH2_struct *context, sh2regs_struct *regs)
@@ -23,6 +23,7 @@
 
 #define SH2CORE_INTERPRETER             0
 #define SH2CORE_DEBUGINTERPRETER        1
+#define SH2CORE_BLOCKINTERPRETER        2
 
 #define INSTRUCTION_A(x) ((x & 0xF000) >> 12)
 #define INSTRUCTION_B(x) ((x & 0x0F00) >> 8)
@@ -33,10 +34,15 @@
 
 int SH2InterpreterInit(void);
 int SH2DebugInterpreterInit(void);
+int SH2BlockInterpreterInit(void);
 void SH2InterpreterDeInit(void);
+void SH2BlockInterpreterDeInit(void);
 void SH2InterpreterReset(SH2_struct *context);
+void SH2BlockInterpreterReset(SH2_struct *context);
 void FASTCALL SH2InterpreterExec(SH2_struct *context, u32 cycles);
 void FASTCALL SH2DebugInterpreterExec(SH2_struct *context, u32 cycles);
+void FASTCALL SH2BlockInterpreterExec(SH2_struct *context, u32 cycles);
+void SH2BlockInterpreterWriteNotify(u32 start, u32 length);
 void SH2InterpreterGetRegisters(SH2_struct *context, sh2regs_struct *regs);
 u32 SH2InterpreterGetGPR(SH2_struct *context, int num);
 u32 SH2InterpreterGetSR(SH2_struct *context);
@@ -63,6 +69,7 @@ void SH2InterpreterSetInterrupts(SH2_struct *context, int num_interrupts,
 
 extern SH2Interface_struct SH2Interpreter;
 extern SH2Interface_struct SH2DebugInterpreter;
+extern SH2Interface_struct SH2BlockInterpreter;
 
 typedef u32 (FASTCALL *fetchfunc)(u32);
 extern fetchfunc fetchlist[0x100];
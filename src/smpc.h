@@ -34,6 +34,7 @@
 #define REGION_CENTRALSOUTHAMERICAPAL   13
 
 extern u8 smpc_regs[0x80];
+extern int intback_wait_for_line;
 
 #define SMPC_REG_IREG(x)	(*(smpc_regs + 0x01 + ((x) << 1)))
 #define SMPC_REG_COMREG		(*(smpc_regs + 0x1F))
@@ -153,6 +153,14 @@ u32 snd_GetAudioSpace(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
+//Bytes written and not yet handed to the voice
+u32 snd_GetAudioQueued(void)
+{
+	return bytesBuffered;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
 void snd_MuteAudio()
 {
 	AESND_Pause(1);
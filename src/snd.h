@@ -12,6 +12,7 @@ int snd_Reset(void);
 int snd_ChangeVideoFormat(int vertfreq);
 void snd_UpdateAudio(u32 *leftchanbuffer, u32 *rightchanbuffer, u32 num_samples);
 u32 snd_GetAudioSpace(void);
+u32 snd_GetAudioQueued(void);
 void snd_MuteAudio();
 void snd_UnMuteAudio();
 
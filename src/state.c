@@ -0,0 +1,300 @@
+/*
+ * state.c
+ *--------------------
+ * In memory snapshots of the whole machine. A snapshot is a list of regions
+ * (work RAM, VRAM, sound RAM, the register and internal structures of every
+ * chip) and a copy of each. Saving only copies the 4KB pages written since
+ * the snapshot was last saved: work RAM and VDP RAM pages are taken from
+ * their dirty maps (VRAM_DIRTY_STATE), the other regions are compared page
+ * by page. Restoring compares against the copy and writes back what differs,
+ * so snapshots taken a few frames apart cost a fraction of the RAM size.
+ */
+
+#include <gccore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "state.h"
+#include "memory.h"
+#include "cs0.h"
+#include "cs2.h"
+#include "scsp.h"
+#include "scu.h"
+#include "sh2core.h"
+#include "smpc.h"
+#include "vdp1.h"
+#include "vdp2.h"
+#include "yabause.h"
+#include "sgx/sgx.h"
+
+#define STATE_MAX_REGIONS	64
+
+typedef struct {
+	const char *name;
+	u8 *live;
+	u8 *copy;
+	u32 size;
+	u32 sh2addr;		//Work RAM is reported to the SH2 cores when restored
+	u8 *dirty;			//Dirty page map of the RAM, marked again when restored
+	u8 *pending;		//Pages taken from the map this snapshot has not copied yet
+} state_region;
+
+struct state_snapshot {
+	state_region region[STATE_MAX_REGIONS];
+	u32 num;
+	u32 valid;
+	state_stats stats;
+	state_snapshot *next;
+};
+
+static state_snapshot *state_building = NULL;
+//Every snapshot, a page taken from a dirty map is pending for all of them
+static state_snapshot *state_list = NULL;
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void state_AddCode(const char *name, void *ptr, u32 size, u32 sh2addr, u8 *dirty)
+{
+	state_snapshot *snap = state_building;
+	if (snap == NULL || snap->num >= STATE_MAX_REGIONS) {
+		if (snap) {
+			snap->valid = ~0;	//Marks the layout as broken
+		}
+		return;
+	}
+
+	state_region *r = &snap->region[snap->num++];
+	r->name = name;
+	r->live = (u8*) ptr;
+	r->size = size;
+	r->sh2addr = sh2addr;
+	r->dirty = dirty;
+	r->copy = (u8*) memalign(32, size);
+	r->pending = NULL;
+	if (dirty) {
+		r->pending = (u8*) calloc((size + STATE_PAGE_SIZE - 1) >> STATE_PAGE_SHIFT, 1);
+	}
+	if (r->copy == NULL || (dirty && r->pending == NULL)) {
+		snap->valid = ~0;
+	}
+	snap->stats.pages += (size + STATE_PAGE_SIZE - 1) >> STATE_PAGE_SHIFT;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void state_AddRegion(const char *name, void *ptr, u32 size)
+{
+	state_AddCode(name, ptr, size, 0, NULL);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+state_snapshot *state_Create(void)
+{
+	state_snapshot *snap;
+
+	if (SCSCore == NULL || SCSCore->AddStateRegions == NULL) {
+		return NULL;
+	}
+	snap = calloc(1, sizeof(state_snapshot));
+	if (snap == NULL) {
+		return NULL;
+	}
+
+	state_building = snap;
+
+	//Memory
+	state_AddCode("WRAM-L", wram, LOW_WRAM_SIZE, 0x00200000, wram_dirty);
+	state_AddCode("WRAM-H", wram + LOW_WRAM_SIZE, HIGH_WRAM_SIZE, 0x06000000,
+		wram_dirty + (LOW_WRAM_SIZE >> VRAM_DIRTY_SHIFT));
+	state_AddRegion("BUP", bup_ram, BACKUP_RAM_SIZE);
+	state_AddRegion("SoundRAM", SoundRam, 0x80000);
+	CartAddState();
+
+	//SH2s and SCU
+	state_AddRegion("MSH2", MSH2, sizeof(SH2_struct));
+	state_AddRegion("SSH2", SSH2, sizeof(SH2_struct));
+	state_AddRegion("SCU", ScuRegs, sizeof(Scu));
+	state_AddRegion("SCU-DSP", ScuDsp, sizeof(scudspregs_struct));
+
+	//VDP1
+	state_AddCode("VDP1-RAM", Vdp1Ram, 0x80000, 0, vdp1_ram_dirty);
+	state_AddRegion("VDP1-FB", Vdp1FrameBuffer, 0x80000);
+	state_AddRegion("VDP1-Regs", Vdp1Regs, sizeof(Vdp1));
+	state_AddRegion("VDP1-Ext", &Vdp1External, sizeof(Vdp1External));
+
+	//VDP2
+	state_AddCode("VDP2-RAM", Vdp2Ram, 0x80000, 0, vdp2_ram_dirty);
+	state_AddRegion("VDP2-CRAM", Vdp2ColorRam, 0x1000);
+	state_AddRegion("VDP2-Regs", Vdp2Regs, sizeof(Vdp2));
+	state_AddRegion("VDP2-Int", &Vdp2Internal, sizeof(Vdp2Internal));
+	state_AddRegion("VDP2-Ext", &Vdp2External, sizeof(Vdp2External));
+	state_AddRegion("VDP2-Lines", vdp2_lines, sizeof(vdp2_lines));
+
+	//SMPC
+	state_AddRegion("SMPC-Regs", smpc_regs, sizeof(smpc_regs));
+	state_AddRegion("SMPC-Int", SmpcInternalVars, sizeof(SmpcInternal));
+	state_AddRegion("SMPC-Wait", &intback_wait_for_line, sizeof(intback_wait_for_line));
+
+	//CD block
+	state_AddRegion("CS2", Cs2Area, sizeof(Cs2));
+	state_AddRegion("CS2-IP", cdip, sizeof(ip_struct));
+
+	//SCSP and 68K
+	SCSCore->AddStateRegions();
+
+	//Frame timing
+	state_AddRegion("System", &yabsys, sizeof(yabsys));
+	state_AddRegion("Frames", &framecounter, sizeof(framecounter));
+	state_AddRegion("LagFrames", &lagframecounter, sizeof(lagframecounter));
+	state_AddRegion("Centicycles", &saved_centicycles, sizeof(saved_centicycles));
+
+	state_building = NULL;
+
+	if (snap->valid) {
+		state_Free(snap);
+		return NULL;
+	}
+	snap->stats.regions = snap->num;
+	snap->next = state_list;
+	state_list = snap;
+	return snap;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void state_Free(state_snapshot *snap)
+{
+	if (snap == NULL) {
+		return;
+	}
+	for (state_snapshot **s = &state_list; *s; s = &(*s)->next) {
+		if (*s == snap) {
+			*s = snap->next;
+			break;
+		}
+	}
+	for (u32 i = 0; i < snap->num; ++i) {
+		free(snap->region[i].copy);
+		free(snap->region[i].pending);
+	}
+	free(snap);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Moves the pages written since the last save of any snapshot from the dirty
+//map of region i to the pending pages of every snapshot
+static void state_TakeDirty(u32 i, u8 *dirty, u32 pages)
+{
+	for (u32 p = 0; p < pages; ++p) {
+		if (!(dirty[p] & VRAM_DIRTY_STATE)) {
+			continue;
+		}
+		dirty[p] &= ~VRAM_DIRTY_STATE;
+		for (state_snapshot *s = state_list; s; s = s->next) {
+			if (i < s->num && s->region[i].dirty == dirty) {
+				s->region[i].pending[p] = 1;
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void state_Save(state_snapshot *snap)
+{
+	//The SCSP thread must be idle for its state to be copied
+	if (SCSCore->Sync) {
+		SCSCore->Sync();
+	}
+	snap->stats.copied = 0;
+	for (u32 i = 0; i < snap->num; ++i) {
+		state_region *r = &snap->region[i];
+		if (r->dirty) {
+			state_TakeDirty(i, r->dirty, (r->size + STATE_PAGE_SIZE - 1) >> STATE_PAGE_SHIFT);
+		}
+		for (u32 ofs = 0; ofs < r->size; ofs += STATE_PAGE_SIZE) {
+			u32 len = r->size - ofs < STATE_PAGE_SIZE ? r->size - ofs : STATE_PAGE_SIZE;
+			if (r->pending) {
+				u8 *pending = &r->pending[ofs >> STATE_PAGE_SHIFT];
+				if (snap->valid && !*pending) {
+					continue;
+				}
+				*pending = 0;
+			} else if (snap->valid && !memcmp(r->copy + ofs, r->live + ofs, len)) {
+				continue;
+			}
+			memcpy(r->copy + ofs, r->live + ofs, len);
+			snap->stats.copied++;
+		}
+	}
+	snap->valid = 1;
+	snap->stats.saves++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int state_Load(state_snapshot *snap)
+{
+	if (!snap->valid) {
+		return -1;
+	}
+	//The SCSP thread must not run over the state being replaced
+	if (SCSCore->Sync) {
+		SCSCore->Sync();
+	}
+
+	snap->stats.copied = 0;
+	for (u32 i = 0; i < snap->num; ++i) {
+		state_region *r = &snap->region[i];
+		for (u32 ofs = 0; ofs < r->size; ofs += STATE_PAGE_SIZE) {
+			u32 len = r->size - ofs < STATE_PAGE_SIZE ? r->size - ofs : STATE_PAGE_SIZE;
+			if (!memcmp(r->copy + ofs, r->live + ofs, len)) {
+				continue;
+			}
+			memcpy(r->live + ofs, r->copy + ofs, len);
+			DCFlushRange(r->live + ofs, len);
+			if (r->sh2addr) {
+				SH2WriteNotify(r->sh2addr + ofs, len);
+			}
+			if (r->dirty) {
+				mem_DirtyRange(r->dirty, ofs, len);
+			}
+			snap->stats.copied++;
+		}
+	}
+
+	//The palettes are rebuilt from color ram
+	SGX_ColorRamDirtyAll();
+
+	snap->stats.loads++;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Returns the first region that differs or NULL when both hold the same state
+const char *state_Compare(const state_snapshot *a, const state_snapshot *b)
+{
+	if (a->num != b->num) {
+		return "layout";
+	}
+	for (u32 i = 0; i < a->num; ++i) {
+		if (a->region[i].size != b->region[i].size ||
+			memcmp(a->region[i].copy, b->region[i].copy, a->region[i].size)) {
+			return a->region[i].name;
+		}
+	}
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void state_GetStats(const state_snapshot *snap, state_stats *stats)
+{
+	*stats = snap->stats;
+}
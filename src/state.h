@@ -0,0 +1,39 @@
+#ifndef __STATE_H__
+#define __STATE_H__
+
+/*
+ * state.h
+ *--------------------
+ * In memory snapshots of the whole machine
+ */
+
+#include "core.h"
+
+#define STATE_PAGE_SHIFT	12
+#define STATE_PAGE_SIZE		(1 << STATE_PAGE_SHIFT)
+
+typedef struct state_snapshot state_snapshot;
+
+typedef struct {
+	u32 regions;
+	u32 pages;			//Pages covering every region
+	u32 copied;			//Pages the last save or load had to copy
+	u64 saves;
+	u64 loads;
+} state_stats;
+
+//Only valid while the snapshot layout is being built, i.e. from the module
+//hooks state_Create calls. ptr must stay valid for the life of the snapshot.
+void state_AddRegion(const char *name, void *ptr, u32 size);
+
+//Snapshots hold raw copies of the emulator's own structures, they only make
+//sense for the running session and must be taken between YabauseEmulate calls
+state_snapshot *state_Create(void);
+void state_Free(state_snapshot *snap);
+void state_Save(state_snapshot *snap);
+int state_Load(state_snapshot *snap);
+const char *state_Compare(const state_snapshot *a, const state_snapshot *b);
+void state_GetStats(const state_snapshot *snap, state_stats *stats);
+
+
+#endif /*__STATE_H__*/
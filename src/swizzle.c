@@ -0,0 +1,360 @@
+/*
+ * swizzle.c
+ *--------------------
+ * Reference tiling of Saturn textures into GX layouts. Every format comes down
+ * to gathering 4 byte pieces of 8 rows (4bpp tiles) or 8 byte pieces of 4 rows
+ * (8bpp and 16bpp tiles), so each implementation only provides those two
+ * kernels. The write gather pipe loops in vidsoft.c produce the same layout
+ * straight into memory on the Wii, these run anywhere and are what the host
+ * build measures and checks them against.
+ */
+
+#include <string.h>
+
+#include "swizzle.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SWIZZLE_HAVE_X86
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define SWIZZLE_HAVE_NEON
+#endif
+
+//Gathers tiles from rows pitch bytes apart
+typedef void (*swizzle_kernel)(u8 *dst, const u8 *src, u32 pitch, u32 tiles);
+
+static const swizzle_impl *swizzle_cur;
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE void swizzle_DoLinear(u8 *dst, const u8 *src, u32 fmt, u32 w, u32 h,
+	swizzle_kernel k4x8, swizzle_kernel k8x4)
+{
+	u32 pitch = (w << fmt) >> 1;
+	if (fmt == SWIZZLE_4BPP) {
+		for (u32 y = 0; y < h; y += 8) {
+			k4x8(dst, src, pitch, pitch >> 2);
+			src += pitch << 3;
+			dst += pitch << 3;
+		}
+	} else {
+		for (u32 y = 0; y < h; y += 4) {
+			k8x4(dst, src, pitch, pitch >> 3);
+			src += pitch << 2;
+			dst += pitch << 2;
+		}
+	}
+}
+
+//4bpp cells already are CI4 tiles. 8bpp and 16bpp cells hold the tiles of
+//two tile rows, the top half of every cell in a row is gathered first. A half
+//8bpp cell is a whole contiguous tile.
+static INLINE void swizzle_DoCells(u8 *dst, const u8 *src, u32 fmt, u32 w, u32 h,
+	swizzle_kernel k8x4)
+{
+	u32 cells = w >> 3;
+	u32 cell_size = 32 << fmt;
+	u32 cell_pitch = 4 << fmt;
+
+	if (fmt == SWIZZLE_4BPP) {
+		memcpy(dst, src, (w * h) >> 1);
+		return;
+	}
+	u32 tiles = fmt;	//Tiles in a half cell
+	for (u32 y = 0; y < h; y += 8) {
+		for (u32 half = 0; half < 2; ++half) {
+			const u8 *cell = src + half * (cell_pitch << 2);
+			for (u32 x = 0; x < cells; ++x) {
+				if (fmt == SWIZZLE_8BPP) {
+					memcpy(dst, cell, 32);
+				} else {
+					k8x4(dst, cell, cell_pitch, tiles);
+				}
+				dst += tiles << 5;
+				cell += cell_size;
+			}
+		}
+		src += cells * cell_size;
+	}
+}
+
+#define SWIZZLE_IMPL(sfx, name, k4x8, k8x4)											\
+static void swizzle_Linear4##sfx(u8 *dst, const u8 *src, u32 w, u32 h)			\
+{ swizzle_DoLinear(dst, src, SWIZZLE_4BPP, w, h, k4x8, k8x4); }					\
+static void swizzle_Linear8##sfx(u8 *dst, const u8 *src, u32 w, u32 h)			\
+{ swizzle_DoLinear(dst, src, SWIZZLE_8BPP, w, h, k4x8, k8x4); }					\
+static void swizzle_Linear16##sfx(u8 *dst, const u8 *src, u32 w, u32 h)			\
+{ swizzle_DoLinear(dst, src, SWIZZLE_16BPP, w, h, k4x8, k8x4); }				\
+static void swizzle_Cells4##sfx(u8 *dst, const u8 *src, u32 w, u32 h)			\
+{ swizzle_DoCells(dst, src, SWIZZLE_4BPP, w, h, k8x4); }						\
+static void swizzle_Cells8##sfx(u8 *dst, const u8 *src, u32 w, u32 h)			\
+{ swizzle_DoCells(dst, src, SWIZZLE_8BPP, w, h, k8x4); }						\
+static void swizzle_Cells16##sfx(u8 *dst, const u8 *src, u32 w, u32 h)			\
+{ swizzle_DoCells(dst, src, SWIZZLE_16BPP, w, h, k8x4); }						\
+static const swizzle_impl swizzle_impl##sfx = {									\
+	name,																		\
+	{swizzle_Linear4##sfx, swizzle_Linear8##sfx, swizzle_Linear16##sfx},		\
+	{swizzle_Cells4##sfx, swizzle_Cells8##sfx, swizzle_Cells16##sfx}			\
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Scalar
+
+static void swizzle_Kernel4x8(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	for (u32 t = 0; t < tiles; ++t, src += 4) {
+		for (u32 r = 0; r < 8; ++r, dst += 4) {
+			memcpy(dst, src + r * pitch, 4);
+		}
+	}
+}
+
+static void swizzle_Kernel8x4(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	for (u32 t = 0; t < tiles; ++t, src += 8) {
+		for (u32 r = 0; r < 4; ++r, dst += 8) {
+			memcpy(dst, src + r * pitch, 8);
+		}
+	}
+}
+
+SWIZZLE_IMPL(Scalar, "scalar", swizzle_Kernel4x8, swizzle_Kernel8x4)
+
+//////////////////////////////////////////////////////////////////////////////
+// SSE2, four 4bpp or two 8 byte wide tiles per step
+
+#ifdef SWIZZLE_HAVE_X86
+
+#define LOADU(p)		_mm_loadu_si128((const __m128i*) (p))
+#define STOREU(p, v)	_mm_storeu_si128((__m128i*) (p), (v))
+
+__attribute__((target("sse2")))
+static void swizzle_Kernel4x8SSE2(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	u32 t = 0;
+	for (; t + 4 <= tiles; t += 4, src += 16, dst += 128) {
+		for (u32 half = 0; half < 2; ++half) {
+			const u8 *s = src + half * (pitch << 2);
+			__m128i r0 = LOADU(s);
+			__m128i r1 = LOADU(s + pitch);
+			__m128i r2 = LOADU(s + pitch * 2);
+			__m128i r3 = LOADU(s + pitch * 3);
+			__m128i a = _mm_unpacklo_epi32(r0, r1);
+			__m128i b = _mm_unpacklo_epi32(r2, r3);
+			__m128i c = _mm_unpackhi_epi32(r0, r1);
+			__m128i d = _mm_unpackhi_epi32(r2, r3);
+			u8 *o = dst + (half << 4);
+			STOREU(o, _mm_unpacklo_epi64(a, b));
+			STOREU(o + 32, _mm_unpackhi_epi64(a, b));
+			STOREU(o + 64, _mm_unpacklo_epi64(c, d));
+			STOREU(o + 96, _mm_unpackhi_epi64(c, d));
+		}
+	}
+	swizzle_Kernel4x8(dst, src, pitch, tiles - t);
+}
+
+__attribute__((target("sse2")))
+static void swizzle_Kernel8x4SSE2(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	u32 t = 0;
+	for (; t + 2 <= tiles; t += 2, src += 16, dst += 64) {
+		__m128i r0 = LOADU(src);
+		__m128i r1 = LOADU(src + pitch);
+		__m128i r2 = LOADU(src + pitch * 2);
+		__m128i r3 = LOADU(src + pitch * 3);
+		STOREU(dst, _mm_unpacklo_epi64(r0, r1));
+		STOREU(dst + 16, _mm_unpacklo_epi64(r2, r3));
+		STOREU(dst + 32, _mm_unpackhi_epi64(r0, r1));
+		STOREU(dst + 48, _mm_unpackhi_epi64(r2, r3));
+	}
+	swizzle_Kernel8x4(dst, src, pitch, tiles - t);
+}
+
+SWIZZLE_IMPL(SSE2, "sse2", swizzle_Kernel4x8SSE2, swizzle_Kernel8x4SSE2)
+
+//////////////////////////////////////////////////////////////////////////////
+// AVX2, same shuffles on both 128 bit lanes then the lanes are regrouped
+
+#define LOADU256(p)		_mm256_loadu_si256((const __m256i*) (p))
+#define STOREU256(p, v)	_mm256_storeu_si256((__m256i*) (p), (v))
+
+__attribute__((target("avx2")))
+static void swizzle_Kernel4x8AVX2(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	u32 t = 0;
+	for (; t + 8 <= tiles; t += 8, src += 32, dst += 256) {
+		__m256i q[2][4];
+		for (u32 half = 0; half < 2; ++half) {
+			const u8 *s = src + half * (pitch << 2);
+			__m256i r0 = LOADU256(s);
+			__m256i r1 = LOADU256(s + pitch);
+			__m256i r2 = LOADU256(s + pitch * 2);
+			__m256i r3 = LOADU256(s + pitch * 3);
+			__m256i a = _mm256_unpacklo_epi32(r0, r1);
+			__m256i b = _mm256_unpacklo_epi32(r2, r3);
+			__m256i c = _mm256_unpackhi_epi32(r0, r1);
+			__m256i d = _mm256_unpackhi_epi32(r2, r3);
+			q[half][0] = _mm256_unpacklo_epi64(a, b);
+			q[half][1] = _mm256_unpackhi_epi64(a, b);
+			q[half][2] = _mm256_unpacklo_epi64(c, d);
+			q[half][3] = _mm256_unpackhi_epi64(c, d);
+		}
+		//Low lanes hold tiles 0-3, high lanes tiles 4-7
+		for (u32 i = 0; i < 4; ++i) {
+			STOREU256(dst + (i << 5), _mm256_permute2x128_si256(q[0][i], q[1][i], 0x20));
+			STOREU256(dst + ((i + 4) << 5), _mm256_permute2x128_si256(q[0][i], q[1][i], 0x31));
+		}
+	}
+	//The tail runs legacy SSE code, leaving the upper halves dirty stalls it
+	_mm256_zeroupper();
+	swizzle_Kernel4x8SSE2(dst, src, pitch, tiles - t);
+}
+
+__attribute__((target("avx2")))
+static void swizzle_Kernel8x4AVX2(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	u32 t = 0;
+	for (; t + 4 <= tiles; t += 4, src += 32, dst += 128) {
+		__m256i r0 = LOADU256(src);
+		__m256i r1 = LOADU256(src + pitch);
+		__m256i r2 = LOADU256(src + pitch * 2);
+		__m256i r3 = LOADU256(src + pitch * 3);
+		__m256i lo01 = _mm256_unpacklo_epi64(r0, r1);
+		__m256i lo23 = _mm256_unpacklo_epi64(r2, r3);
+		__m256i hi01 = _mm256_unpackhi_epi64(r0, r1);
+		__m256i hi23 = _mm256_unpackhi_epi64(r2, r3);
+		STOREU256(dst, _mm256_permute2x128_si256(lo01, lo23, 0x20));
+		STOREU256(dst + 32, _mm256_permute2x128_si256(hi01, hi23, 0x20));
+		STOREU256(dst + 64, _mm256_permute2x128_si256(lo01, lo23, 0x31));
+		STOREU256(dst + 96, _mm256_permute2x128_si256(hi01, hi23, 0x31));
+	}
+	_mm256_zeroupper();
+	swizzle_Kernel8x4SSE2(dst, src, pitch, tiles - t);
+}
+
+SWIZZLE_IMPL(AVX2, "avx2", swizzle_Kernel4x8AVX2, swizzle_Kernel8x4AVX2)
+
+#endif //SWIZZLE_HAVE_X86
+
+//////////////////////////////////////////////////////////////////////////////
+// NEON, the SSE2 shuffles with zips
+
+#ifdef SWIZZLE_HAVE_NEON
+
+static void swizzle_Kernel4x8NEON(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	u32 t = 0;
+	for (; t + 4 <= tiles; t += 4, src += 16, dst += 128) {
+		for (u32 half = 0; half < 2; ++half) {
+			const u8 *s = src + half * (pitch << 2);
+			uint32x4_t r0 = vreinterpretq_u32_u8(vld1q_u8(s));
+			uint32x4_t r1 = vreinterpretq_u32_u8(vld1q_u8(s + pitch));
+			uint32x4_t r2 = vreinterpretq_u32_u8(vld1q_u8(s + pitch * 2));
+			uint32x4_t r3 = vreinterpretq_u32_u8(vld1q_u8(s + pitch * 3));
+			uint64x2_t a = vreinterpretq_u64_u32(vzip1q_u32(r0, r1));
+			uint64x2_t b = vreinterpretq_u64_u32(vzip1q_u32(r2, r3));
+			uint64x2_t c = vreinterpretq_u64_u32(vzip2q_u32(r0, r1));
+			uint64x2_t d = vreinterpretq_u64_u32(vzip2q_u32(r2, r3));
+			u8 *o = dst + (half << 4);
+			vst1q_u8(o, vreinterpretq_u8_u64(vzip1q_u64(a, b)));
+			vst1q_u8(o + 32, vreinterpretq_u8_u64(vzip2q_u64(a, b)));
+			vst1q_u8(o + 64, vreinterpretq_u8_u64(vzip1q_u64(c, d)));
+			vst1q_u8(o + 96, vreinterpretq_u8_u64(vzip2q_u64(c, d)));
+		}
+	}
+	swizzle_Kernel4x8(dst, src, pitch, tiles - t);
+}
+
+static void swizzle_Kernel8x4NEON(u8 *dst, const u8 *src, u32 pitch, u32 tiles)
+{
+	u32 t = 0;
+	for (; t + 2 <= tiles; t += 2, src += 16, dst += 64) {
+		uint64x2_t r0 = vreinterpretq_u64_u8(vld1q_u8(src));
+		uint64x2_t r1 = vreinterpretq_u64_u8(vld1q_u8(src + pitch));
+		uint64x2_t r2 = vreinterpretq_u64_u8(vld1q_u8(src + pitch * 2));
+		uint64x2_t r3 = vreinterpretq_u64_u8(vld1q_u8(src + pitch * 3));
+		vst1q_u8(dst, vreinterpretq_u8_u64(vzip1q_u64(r0, r1)));
+		vst1q_u8(dst + 16, vreinterpretq_u8_u64(vzip1q_u64(r2, r3)));
+		vst1q_u8(dst + 32, vreinterpretq_u8_u64(vzip2q_u64(r0, r1)));
+		vst1q_u8(dst + 48, vreinterpretq_u8_u64(vzip2q_u64(r2, r3)));
+	}
+	swizzle_Kernel8x4(dst, src, pitch, tiles - t);
+}
+
+SWIZZLE_IMPL(NEON, "neon", swizzle_Kernel4x8NEON, swizzle_Kernel8x4NEON)
+
+#endif //SWIZZLE_HAVE_NEON
+
+//////////////////////////////////////////////////////////////////////////////
+
+const swizzle_impl *swizzle_GetImpl(u32 id)
+{
+	switch (id) {
+		case SWIZZLE_SCALAR:
+			return &swizzle_implScalar;
+#ifdef SWIZZLE_HAVE_X86
+		case SWIZZLE_SSE2:
+			return __builtin_cpu_supports("sse2") ? &swizzle_implSSE2 : NULL;
+		case SWIZZLE_AVX2:
+			return __builtin_cpu_supports("avx2") ? &swizzle_implAVX2 : NULL;
+#endif
+#ifdef SWIZZLE_HAVE_NEON
+		case SWIZZLE_NEON:
+			return &swizzle_implNEON;
+#endif
+	}
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void swizzle_Init(void)
+{
+	static const u32 pref[] = {SWIZZLE_AVX2, SWIZZLE_SSE2, SWIZZLE_NEON, SWIZZLE_SCALAR};
+	for (u32 i = 0; i < sizeof(pref) / sizeof(pref[0]); ++i) {
+		if ((swizzle_cur = swizzle_GetImpl(pref[i])) != NULL) {
+			return;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void swizzle_SetImpl(u32 id)
+{
+	const swizzle_impl *impl = swizzle_GetImpl(id);
+	if (impl) {
+		swizzle_cur = impl;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 swizzle_TileHeight(u32 fmt)
+{
+	return fmt == SWIZZLE_4BPP ? 8 : 4;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void swizzle_Linear(u8 *dst, const u8 *src, u32 fmt, u32 w, u32 h)
+{
+	if (swizzle_cur == NULL) {
+		swizzle_Init();
+	}
+	swizzle_cur->linear[fmt](dst, src, w, h);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void swizzle_Cells(u8 *dst, const u8 *src, u32 fmt, u32 w, u32 h)
+{
+	if (swizzle_cur == NULL) {
+		swizzle_Init();
+	}
+	swizzle_cur->cells[fmt](dst, src, w, h);
+}
@@ -0,0 +1,46 @@
+#ifndef __SWIZZLE_H__
+#define __SWIZZLE_H__
+
+/*
+ * swizzle.h
+ *--------------------
+ * Saturn linear and cell textures to GX tiles, without GX
+ */
+
+#include "core.h"
+
+//Texel formats, all of them keep the Saturn bytes as they are
+#define SWIZZLE_4BPP		0	//I4/CI4, 8x8 tiles
+#define SWIZZLE_8BPP		1	//I8/CI8, 8x4 tiles
+#define SWIZZLE_16BPP		2	//RGB5A3, 4x4 tiles
+#define SWIZZLE_FMT_NUM		3
+
+#define SWIZZLE_SCALAR		0
+#define SWIZZLE_SSE2		1
+#define SWIZZLE_AVX2		2
+#define SWIZZLE_NEON		3
+#define SWIZZLE_IMPL_NUM	4
+
+//Width is in pixels and a multiple of 8. Height is a multiple of the tile
+//height for linear textures and of 8 for cells, which are 8x8 pixel blocks
+//stored one after the other in rows of w / 8.
+typedef void (*swizzle_func)(u8 *dst, const u8 *src, u32 w, u32 h);
+
+typedef struct {
+	const char *name;
+	swizzle_func linear[SWIZZLE_FMT_NUM];
+	swizzle_func cells[SWIZZLE_FMT_NUM];
+} swizzle_impl;
+
+//Picks the fastest implementation this CPU runs
+void swizzle_Init(void);
+//NULL when the implementation isn't built in or the CPU lacks it
+const swizzle_impl *swizzle_GetImpl(u32 id);
+void swizzle_SetImpl(u32 id);
+u32 swizzle_TileHeight(u32 fmt);
+
+void swizzle_Linear(u8 *dst, const u8 *src, u32 fmt, u32 w, u32 h);
+void swizzle_Cells(u8 *dst, const u8 *src, u32 fmt, u32 w, u32 h);
+
+
+#endif /*__SWIZZLE_H__*/
@@ -0,0 +1,109 @@
+/*
+ * threads.c
+ *--------------------
+ * Core threads. Each id has one thread at a time, with a mutex and condition
+ * variable behind YabThreadSleep/YabThreadWake and a flag so a wake that
+ * comes before the sleep isn't lost. The threads run at the priority of the
+ * main thread, on the Wii that is what lets YabThreadYield switch to them.
+ */
+
+#include "threads.h"
+
+#define YAB_THREAD_STACK	(64 * 1024)
+#define YAB_THREAD_PRIO		64		//libogc's main thread
+
+typedef struct {
+	lwp_t lwp;
+	void (*func)(void);
+	YabMutex lock;
+	YabCond wake;
+	u32 woken;
+	u32 running;
+} yab_thread;
+
+static yab_thread yab_threads[YAB_NUM_THREADS];
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void *YabThreadEntry(void *arg)
+{
+	yab_thread *t = (yab_thread *) arg;
+	t->func();
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int YabThreadStart(u32 id, void (*func)(void))
+{
+	if (id >= YAB_NUM_THREADS || yab_threads[id].running) {
+		return -1;
+	}
+	yab_thread *t = &yab_threads[id];
+	t->func = func;
+	t->woken = 0;
+	if (YabMutexInit(&t->lock) < 0) {
+		return -1;
+	}
+	if (YabCondInit(&t->wake) < 0) {
+		YabMutexDestroy(t->lock);
+		return -1;
+	}
+	if (LWP_CreateThread(&t->lwp, YabThreadEntry, t, NULL, YAB_THREAD_STACK, YAB_THREAD_PRIO) < 0) {
+		YabCondDestroy(t->wake);
+		YabMutexDestroy(t->lock);
+		return -1;
+	}
+	t->running = 1;
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadWait(u32 id)
+{
+	if (id >= YAB_NUM_THREADS || !yab_threads[id].running) {
+		return;
+	}
+	yab_thread *t = &yab_threads[id];
+	LWP_JoinThread(t->lwp, NULL);
+	YabCondDestroy(t->wake);
+	YabMutexDestroy(t->lock);
+	t->running = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadYield(void)
+{
+	LWP_YieldThread();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadSleep(u32 id)
+{
+	yab_thread *t = &yab_threads[id];
+
+	YabMutexLock(t->lock);
+	while (!t->woken) {
+		YabCondWait(t->wake, t->lock);
+	}
+	t->woken = 0;
+	YabMutexUnlock(t->lock);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void YabThreadWake(u32 id)
+{
+	yab_thread *t = &yab_threads[id];
+
+	if (!t->running) {
+		return;
+	}
+	YabMutexLock(t->lock);
+	t->woken = 1;
+	YabCondSignal(t->wake);
+	YabMutexUnlock(t->lock);
+}
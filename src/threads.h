@@ -0,0 +1,107 @@
+#ifndef __THREADS_H__
+#define __THREADS_H__
+
+/*
+ * threads.h
+ *--------------------
+ * Threads for the cores that can run beside the main loop, on libogc LWP
+ * threads. The host build gets the same calls on pthreads through the
+ * headers in src/host/include/ogc.
+ */
+
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+
+#include "core.h"
+
+#define YAB_THREAD_SCSP		0
+#define YAB_NUM_THREADS		1
+
+//Runs func on thread id. Returns -1 when it can't or id is already running
+int YabThreadStart(u32 id, void (*func)(void));
+//Waits for thread id to return from its function
+void YabThreadWait(u32 id);
+void YabThreadYield(void);
+//Called from thread id, blocks until YabThreadWake(id). A wake that comes
+//first isn't lost, the next sleep returns at once
+void YabThreadSleep(u32 id);
+void YabThreadWake(u32 id);
+
+//Orders the memory accesses before it against the ones after it for every
+//thread, for data shared through volatile flags
+#define YabThreadFence()	__atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+//////////////////////////////////////////////////////////////////////////////
+
+typedef mutex_t YabMutex;
+typedef cond_t YabCond;
+
+static inline s32 YabMutexInit(YabMutex *mutex) { return LWP_MutexInit(mutex, false); }
+static inline s32 YabMutexDestroy(YabMutex mutex) { return LWP_MutexDestroy(mutex); }
+static inline s32 YabMutexLock(YabMutex mutex) { return LWP_MutexLock(mutex); }
+static inline s32 YabMutexUnlock(YabMutex mutex) { return LWP_MutexUnlock(mutex); }
+
+static inline s32 YabCondInit(YabCond *cond) { return LWP_CondInit(cond); }
+static inline s32 YabCondDestroy(YabCond cond) { return LWP_CondDestroy(cond); }
+static inline s32 YabCondWait(YabCond cond, YabMutex mutex) { return LWP_CondWait(cond, mutex); }
+static inline s32 YabCondSignal(YabCond cond) { return LWP_CondSignal(cond); }
+static inline s32 YabCondBroadcast(YabCond cond) { return LWP_CondBroadcast(cond); }
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Lock free queue between one producer and one consumer thread. The consumer
+//peeks an item and drops it once it is done with it, so when the producer
+//sees the queue empty the last item has also been handled.
+typedef struct {
+	u64 *items;
+	u32 mask;				//Size - 1, the size is a power of two
+	u32 head;				//Next item to read, only the consumer writes it
+	u32 tail;				//Next free slot, only the producer writes it
+} YabQueue;
+
+static inline void YabQueueInit(YabQueue *queue, u64 *items, u32 size)
+{
+	queue->items = items;
+	queue->mask = size - 1;
+	queue->head = 0;
+	queue->tail = 0;
+}
+
+//Producer, returns 0 when the queue is full
+static inline u32 YabQueuePush(YabQueue *queue, u64 item)
+{
+	u32 tail = queue->tail;
+	if (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) > queue->mask) {
+		return 0;
+	}
+	queue->items[tail & queue->mask] = item;
+	__atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+//Producer, 1 once the consumer has dropped every item
+static inline u32 YabQueueEmpty(YabQueue *queue)
+{
+	return __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == queue->tail;
+}
+
+//Consumer, returns 0 when there is nothing to read
+static inline u32 YabQueuePeek(YabQueue *queue, u64 *item)
+{
+	u32 head = queue->head;
+	if (head == __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	*item = queue->items[head & queue->mask];
+	return 1;
+}
+
+//Consumer, frees the item YabQueuePeek returned
+static inline void YabQueueDrop(YabQueue *queue)
+{
+	__atomic_store_n(&queue->head, queue->head + 1, __ATOMIC_RELEASE);
+}
+
+
+#endif /*__THREADS_H__*/
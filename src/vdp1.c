@@ -39,6 +39,11 @@ u8 *Vdp1FrameBuffer;
 Vdp1 *Vdp1Regs;
 Vdp1External_struct Vdp1External;
 
+static vdp1cmdlist_struct vdp1_cmdlist;
+static u32 vdp1_cmdlist_valid = 0;
+static u8 vdp1_cmdlist_pages[VRAM_DIRTY_PAGES];	//VRAM_DIRTY_CMD on pages the walk read
+const vdp1cmd_struct *vdp1_curcmd;
+
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -62,18 +67,21 @@ u32 FASTCALL Vdp1RamReadLong(u32 addr) {
 //////////////////////////////////////////////////////////////////////////////
 
 void FASTCALL Vdp1RamWriteByte(u32 addr, u8 val) {
+	vdp1_ram_dirty[(addr & 0x7FFFF) >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
 	T1WriteByte(Vdp1Ram, (addr & 0x7FFFF), val);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 void FASTCALL Vdp1RamWriteWord(u32 addr, u16 val) {
+	vdp1_ram_dirty[(addr & 0x7FFFF) >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
 	T1WriteWord(Vdp1Ram, addr & 0x7FFFF, val);
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
 void FASTCALL Vdp1RamWriteLong(u32 addr, u32 val) {
+	vdp1_ram_dirty[(addr & 0x7FFFF) >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
 	T1WriteLong(Vdp1Ram, addr & 0x7FFFF, val);
 }
 
@@ -168,6 +176,7 @@ void Vdp1Reset(void) {
 	Vdp1Regs->PTMR = 0;
 	Vdp1Regs->MODR = 0x1000; // VDP1 Version 1
 	Vdp1Regs->ENDR = 0;
+	vdp1_cmdlist_valid = 0;
 	VIDSoftVdp1Reset();
 
 	Vdp1Regs->userclipX1 = 0;
@@ -180,7 +189,7 @@ void Vdp1Reset(void) {
 	Vdp1Regs->systemclipY2 = 0;
 
 	// Safe tarminator for Radient silvergun with no bios
-	T1WriteWord(Vdp1Ram, 0x40000, 0x8000);
+	Vdp1RamWriteWord(0x40000, 0x8000);
 
 	////XXX
 	//vdp1_clock = 0;
@@ -308,35 +317,39 @@ void FASTCALL Vdp1WriteLong(u32 addr, UNUSED u32 val) {
 
 //////////////////////////////////////////////////////////////////////////////
 
-//Builds Vram for wii textures and palettes
-//XXX: Todo: Add palettes
-void vdp1_BuildVram(void) {
-	u32 returnAddr;
-	u32 commandCounter;
-	u16 command;
+static INLINE void vdp1_CmdListPage(u32 addr)
+{
+	vdp1_cmdlist_pages[(addr & 0x7FFFF) >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_CMD;
+	vdp1_cmdlist_pages[((addr + 0x1F) & 0x7FFFF) >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_CMD;
+}
 
+//Walks the command table from address 0 and decodes every command it runs
+static void vdp1_BuildCommandList(void) {
+	vdp1cmdlist_struct *list = &vdp1_cmdlist;
 	u32 addr = 0;
-	returnAddr = 0xFFFFFFFF;
-	commandCounter = 0;
-
-	command = T1ReadWord(Vdp1Ram, addr);
-
-	while (!(command & 0x8000) && commandCounter < 2000) { // fix me
-		// First, process the command
-		if (!(command & 0x4000)) { // if (!skip)
-			switch (command & 0x000F) {
-			case 0: // normal sprite draw
-			case 1: // scaled sprite draw
-			case 2: // distorted sprite draw
-			case 3: //Mirror Distorted sprite
-			case 4: // polygon draw
-				VidSoftTexConvert(addr);
-						break;
-			default: // Abort or useless
-				if ((command & 0x000F) > 11) {
-					return;
-				}
+	u32 returnAddr = 0xFFFFFFFF;
+	u32 commandCounter = 0;
+	u16 command;
+
+	memset(vdp1_cmdlist_pages, 0, sizeof(vdp1_cmdlist_pages));
+	list->num = 0;
+	list->end = VDP1_CMDLIST_END;
+	list->end_lopr = 0;
+	vdp1_cmdlist_valid = 1;
+	vram_stats.cmd_built++;
+
+	vdp1_CmdListPage(0);
+	command = T1ReadWord(Vdp1Ram, 0);
+	while (!(command & 0x8000) && commandCounter < VDP1_CMDLIST_MAX) {
+		if (!(command & 0x4000)) {
+			if ((command & 0x000F) > 11) {
+				list->end = VDP1_CMDLIST_ABORT;
+				list->end_addr = addr;
+				return;
 			}
+			vdp1cmdlist_entry *e = &list->entry[list->num++];
+			e->addr = addr;
+			Vdp1ReadCommand(&e->cmd, addr);
 		}
 
 		// Next, determine where to go next
@@ -345,13 +358,12 @@ void vdp1_BuildVram(void) {
 			addr += 0x20;
 			break;
 		case 1: // ASSIGN, jump to CMDLINK
-			addr = T1ReadWord(Vdp1Ram, addr + 2) * 8;
+			addr = T1ReadWord(Vdp1Ram, (addr + 2) & 0x7FFFF) * 8;
 			break;
 		case 2: // CALL, call a subroutine
 			if (returnAddr == 0xFFFFFFFF)
 				returnAddr = addr + 0x20;
-
-			addr = T1ReadWord(Vdp1Ram, addr + 2) * 8;
+			addr = T1ReadWord(Vdp1Ram, (addr + 2) & 0x7FFFF) * 8;
 			break;
 		case 3: // RETURN, return from subroutine
 			if (returnAddr != 0xFFFFFFFF) {
@@ -362,18 +374,75 @@ void vdp1_BuildVram(void) {
 				addr += 0x20;
 			break;
 		}
-		command = T1ReadWord(Vdp1Ram, addr);
+		if (addr == 0) {
+			list->end = VDP1_CMDLIST_LINK0;
+			list->end_addr = 0;
+			return;
+		}
+
+		vdp1_CmdListPage(addr);
+		command = T1ReadWord(Vdp1Ram, addr & 0x7FFFF);
 		commandCounter++;
+		if (command & 0x8000) {
+			list->end_lopr = 1;
+		}
+	}
+	list->end_addr = addr;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Decoded command list, walked again only when a page it was read from has
+//been written since
+const vdp1cmdlist_struct *vdp1_GetCommandList(void) {
+	if (vdp1_cmdlist_valid) {
+		for (u32 i = 0; i < VRAM_DIRTY_PAGES; ++i) {
+			if (vdp1_cmdlist_pages[i] & vdp1_ram_dirty[i]) {
+				vdp1_cmdlist_valid = 0;
+				break;
+			}
+		}
+	}
+	mem_DirtyTake(vdp1_ram_dirty, VRAM_DIRTY_CMD);
+	if (!vdp1_cmdlist_valid) {
+		vdp1_BuildCommandList();
+	}
+	return &vdp1_cmdlist;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Builds Vram for wii textures and palettes
+//XXX: Todo: Add palettes
+void vdp1_BuildVram(void) {
+	const vdp1cmdlist_struct *list = vdp1_GetCommandList();
+
+	for (u32 i = 0; i < list->num; ++i) {
+		if ((list->entry[i].cmd.CMDCTRL & 0x000F) <= 4) {
+			VidSoftTexConvert(list->entry[i].addr);
+		}
 	}
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp1_GetFrameSize(u32 *width, u32 *height) {
+	u32 bit0 = Vdp1Regs->TVMR & 1;		//8 bits per pixel
+	u32 bit1 = (Vdp1Regs->TVMR >> 1) & 1;	//Rotation
+
+	//Normal and HDTV 512x256, 8 bit high resolution 1024x256,
+	//16 bit rotation 512x256 and 8 bit rotation 512x512
+	*width = 512 << (bit0 & (bit1 ^ 1));
+	*height = 256 << (bit0 & bit1);
+	return 2 - bit0;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 
 void Vdp1Draw(void) {
-   u32 returnAddr;
-   u32 commandCounter;
-   u16 command;
+	const vdp1cmdlist_struct *list;
 
 
 	if (!Vdp1External.disptoggle) {
@@ -381,14 +450,12 @@ void Vdp1Draw(void) {
 		return;
 	}
 
+	list = vdp1_GetCommandList();
 	VIDSoftVdp1DrawStart();
 	//Transform textures to wii format
 	//vdp1_BuildVram();
 	//DCFlushRange(wii_vram, 0x80000);
-	DCFlushRange(Vdp1Ram, 0x80000);
-	Vdp1Regs->addr = 0;
-	returnAddr = 0xFFFFFFFF;
-	commandCounter = 0;
+	vram_stats.vdp1_flushed += mem_DirtyFlush(Vdp1Ram, vdp1_ram_dirty);
 
    // beginning of a frame
    // BEF <- CEF
@@ -397,23 +464,18 @@ void Vdp1Draw(void) {
    /* this should be done after a frame change or a plot trigger */
    Vdp1Regs->COPR = 0;
 
-   command = T1ReadWord(Vdp1Ram, Vdp1Regs->addr);
-
-   while (!(command & 0x8000) && commandCounter < 2048) { // fix me
-      // First, process the command
-      if (!(command & 0x4000)) { // if (!skip)
-         switch (command & 0x000F) {
+	for (u32 i = 0; i < list->num; ++i) {
+		Vdp1Regs->addr = list->entry[i].addr;
+		vdp1_curcmd = &list->entry[i].cmd;
+		switch (vdp1_curcmd->CMDCTRL & 0x000F) {
             case 0: // normal sprite draw
-				//VidSoftTexConvert(Vdp1Regs->addr);
 				VIDSoftVdp1NormalSpriteDraw();
 				break;
             case 1: // scaled sprite draw
-				//VidSoftTexConvert(Vdp1Regs->addr);
 				VIDSoftVdp1ScaledSpriteDraw();
 				break;
             case 2: // distorted sprite draw
             case 3: //Mirror Distorted sprite
-				//VidSoftTexConvert(Vdp1Regs->addr);
 				VIDSoftVdp1DistortedSpriteDraw();
 				break;
             case 4: // polygon draw
@@ -445,55 +507,26 @@ void Vdp1Draw(void) {
             case 11: //Mirror Local Coordinate
                VIDSoftVdp1UserClipping();
                break;
-            default: // Abort
-               Vdp1Regs->EDSR |= 2;
-               VIDSoftVdp1DrawEnd();
-               Vdp1Regs->LOPR = Vdp1Regs->addr >> 3;
-               Vdp1Regs->COPR = Vdp1Regs->addr >> 3;
-               return;
-         }
-      }
-
-		if (Vdp1Regs->EDSR & 0x02){
-			Vdp1Regs->LOPR = Vdp1Regs->addr >> 3;
-			Vdp1Regs->COPR = Vdp1Regs->addr >> 3;
-			return;
 		}
+	}
 
-		// Next, determine where to go next
-		switch ((command & 0x3000) >> 12) {
-		case 0: // NEXT, jump to following table
-			Vdp1Regs->addr += 0x20;
-			break;
-		case 1: // ASSIGN, jump to CMDLINK
-			Vdp1Regs->addr = T1ReadWord(Vdp1Ram, (Vdp1Regs->addr + 2)  & 0x7FFFF) * 8;
-			if (Vdp1Regs->addr == 0) {return;}
-			break;
-		case 2: // CALL, call a subroutine
-			if (returnAddr == 0xFFFFFFFF)
-				returnAddr = Vdp1Regs->addr + 0x20;
-
-			Vdp1Regs->addr = T1ReadWord(Vdp1Ram, (Vdp1Regs->addr + 2)  & 0x7FFFF) * 8;
-			if (Vdp1Regs->addr == 0) {return;}
-			break;
-		case 3: // RETURN, return from subroutine
-			if (returnAddr != 0xFFFFFFFF) {
-				Vdp1Regs->addr = returnAddr;
-				returnAddr = 0xFFFFFFFF;
-			}
-			else
-				Vdp1Regs->addr += 0x20;
-			if (Vdp1Regs->addr == 0) {return;}
-			break;
-		}
+	//Draws what is still batched
+	VIDSoftVdp1DrawEnd();
 
-		command = T1ReadWord(Vdp1Ram, Vdp1Regs->addr & 0x7FFFF);
-		commandCounter++;
-		if (command & 0x8000) {
+	Vdp1Regs->addr = list->end_addr;
+	switch (list->end) {
+		case VDP1_CMDLIST_ABORT:
+			Vdp1Regs->EDSR |= 2;
 			Vdp1Regs->LOPR = Vdp1Regs->addr >> 3;
 			Vdp1Regs->COPR = Vdp1Regs->addr >> 3;
-		}
-   }
+			return;
+		case VDP1_CMDLIST_LINK0:
+			return;
+	}
+	if (list->end_lopr) {
+		Vdp1Regs->LOPR = Vdp1Regs->addr >> 3;
+		Vdp1Regs->COPR = Vdp1Regs->addr >> 3;
+	}
 	//Get vram out of the cache
 	//DCFlushRange(wii_vram, 0x80000);
 
@@ -506,14 +539,8 @@ void Vdp1Draw(void) {
 //////////////////////////////////////////////////////////////////////////////
 
 void Vdp1NoDraw(void) {
-   u32 returnAddr;
-   u32 commandCounter;
-   u16 command;
-
+	const vdp1cmdlist_struct *list = vdp1_GetCommandList();
 
-   Vdp1Regs->addr = 0;
-   returnAddr = 0xFFFFFFFF;
-   commandCounter = 0;
 
    // beginning of a frame (ST-013-R3-061694 page 53)
    // BEF <- CEF
@@ -522,21 +549,10 @@ void Vdp1NoDraw(void) {
    /* this should be done after a frame change or a plot trigger */
    Vdp1Regs->COPR = 0;
 
-   command = T1ReadWord(Vdp1Ram, Vdp1Regs->addr);
-
-   while (!(command & 0x8000) && commandCounter < 2000) { // fix me
-      // First, process the command
-      if (!(command & 0x4000)) { // if (!skip)
-         switch (command & 0x000F) {
-            case 0: // normal sprite draw
-            case 1: // scaled sprite draw
-            case 2: // distorted sprite draw
-            case 3: // distorted sprite draw
-            case 4: // polygon draw
-            case 5: // polyline draw
-            case 6: // line draw
-            case 7:
-               break;
+	for (u32 i = 0; i < list->num; ++i) {
+		Vdp1Regs->addr = list->entry[i].addr;
+		vdp1_curcmd = &list->entry[i].cmd;
+		switch (vdp1_curcmd->CMDCTRL & 0x000F) {
             case 8: // user clipping coordinates
                VIDSoftVdp1UserClipping();
                break;
@@ -549,42 +565,17 @@ void Vdp1NoDraw(void) {
             case 11: // undocumented mirror
                VIDSoftVdp1UserClipping();
                break;
-            default: // Abort
-               Vdp1Regs->EDSR |= 2;
-               VIDSoftVdp1DrawEnd();
-               Vdp1Regs->LOPR = Vdp1Regs->addr >> 3;
-               Vdp1Regs->COPR = Vdp1Regs->addr >> 3;
-               return;
-         }
-      }
-
-		// Next, determine where to go next
-		switch ((command & 0x3000) >> 12) {
-		case 0: // NEXT, jump to following table
-			Vdp1Regs->addr += 0x20;
-			break;
-		case 1: // ASSIGN, jump to CMDLINK
-			Vdp1Regs->addr = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 2) * 8;
-			break;
-		case 2: // CALL, call a subroutine
-			if (returnAddr == 0xFFFFFFFF)
-				returnAddr = Vdp1Regs->addr + 0x20;
-
-			Vdp1Regs->addr = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 2) * 8;
-			break;
-		case 3: // RETURN, return from subroutine
-			if (returnAddr != 0xFFFFFFFF) {
-				Vdp1Regs->addr = returnAddr;
-				returnAddr = 0xFFFFFFFF;
-			}
-			else
-				Vdp1Regs->addr += 0x20;
-			break;
 		}
+	}
 
-      command = T1ReadWord(Vdp1Ram, Vdp1Regs->addr);
-      commandCounter++;
-   }
+	Vdp1Regs->addr = list->end_addr;
+	if (list->end == VDP1_CMDLIST_ABORT) {
+		Vdp1Regs->EDSR |= 2;
+		VIDSoftVdp1DrawEnd();
+		Vdp1Regs->LOPR = Vdp1Regs->addr >> 3;
+		Vdp1Regs->COPR = Vdp1Regs->addr >> 3;
+		return;
+	}
 
    // we set two bits to 1
    Vdp1Regs->EDSR |= 2;
@@ -121,6 +121,29 @@ typedef struct
    u16 CMDGRDA;
 } vdp1cmd_struct;
 
+#define VDP1_CMDLIST_MAX		2048
+
+#define VDP1_CMDLIST_END		0	//Reached an end command or the command limit
+#define VDP1_CMDLIST_ABORT		1	//Stopped on an invalid command
+#define VDP1_CMDLIST_LINK0		2	//Jumped to address 0
+
+typedef struct {
+   u32 addr;				//Table entry the command was read from
+   vdp1cmd_struct cmd;
+} vdp1cmdlist_entry;
+
+//Commands the table runs, in order and without the skipped ones
+typedef struct {
+   u32 num;
+   u32 end;				//VDP1_CMDLIST_*
+   u32 end_addr;			//Entry the walk stopped on
+   u32 end_lopr;			//The walk read an end command after the first entry
+   vdp1cmdlist_entry entry[VDP1_CMDLIST_MAX];
+} vdp1cmdlist_struct;
+
+//Command the draw callbacks are run for
+extern const vdp1cmd_struct *vdp1_curcmd;
+
 int Vdp1Init(void);
 void Vdp1DeInit(void);
 int VideoInit(int coreid);
@@ -137,6 +160,9 @@ void FASTCALL	Vdp1WriteLong(u32, u32);
 void Vdp1Draw(void);
 void Vdp1NoDraw(void);
 void FASTCALL Vdp1ReadCommand(vdp1cmd_struct *cmd, u32 addr);
+const vdp1cmdlist_struct *vdp1_GetCommandList(void);
+//Framebuffer size in pixels for the TVMR mode, returns the bytes per pixel
+u32 vdp1_GetFrameSize(u32 *width, u32 *height);
 void ToggleVDP1(void);
 
 #endif
@@ -0,0 +1,99 @@
+/*
+ * vdp1batch.c
+ *--------------------
+ * VDP1 draw batcher. The draw callbacks describe the GX state of each
+ * primitive in a block of bytes; while it doesn't change vertices are
+ * buffered, and they are sent in a single GX_Begin when the state changes or
+ * the buffer fills. State changes and FIFO headers go from one per primitive
+ * to one per run of primitives drawn alike.
+ */
+
+#include <string.h>
+#include <gccore.h>
+
+#include "vdp1batch.h"
+
+static vdp1batch_vtx batch_vtx[VDP1BATCH_MAX_VERTS];
+static u32 batch_num = 0;
+static u32 batch_valid = 0;			//The current state was set
+static u32 batch_prim;
+static u32 batch_tex;
+static u32 batch_size;
+static u8 batch_state[VDP1BATCH_STATE_SIZE];
+static vdp1batch_stats batch_stats;
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1batch_Begin(void)
+{
+	vdp1batch_Flush();
+	batch_valid = 0;
+	batch_stats.frames++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp1batch_SetState(u32 prim, u32 tex, const void *state, u32 size)
+{
+	if (size > VDP1BATCH_STATE_SIZE) {
+		size = VDP1BATCH_STATE_SIZE;
+	}
+	if (batch_valid && batch_prim == prim && batch_tex == tex &&
+		batch_size == size && !memcmp(batch_state, state, size)) {
+		return 0;
+	}
+	vdp1batch_Flush();
+	batch_valid = 1;
+	batch_prim = prim;
+	batch_tex = tex;
+	batch_size = size;
+	memcpy(batch_state, state, size);
+	batch_stats.states++;
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1batch_Add(const vdp1batch_vtx *v, u32 n)
+{
+	if (batch_num + n > VDP1BATCH_MAX_VERTS) {
+		vdp1batch_Flush();
+	}
+	memcpy(batch_vtx + batch_num, v, n * sizeof(vdp1batch_vtx));
+	batch_num += n;
+	batch_stats.prims++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1batch_Flush(void)
+{
+	const vdp1batch_vtx *v = batch_vtx;
+
+	if (!batch_num) {
+		return;
+	}
+	GX_Begin(batch_prim, GX_VTXFMT2, batch_num);
+	if (batch_tex) {
+		for (u32 i = 0; i < batch_num; ++i, ++v) {
+			GX_Position2s16(v->x, v->y);
+			GX_Color1u32(v->color);
+			GX_TexCoord1u16(v->tex);
+		}
+	} else {
+		for (u32 i = 0; i < batch_num; ++i, ++v) {
+			GX_Position2s16(v->x, v->y);
+			GX_Color1u32(v->color);
+		}
+	}
+	GX_End();
+	batch_num = 0;
+	batch_stats.batches++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1batch_GetStats(vdp1batch_stats *stats)
+{
+	*stats = batch_stats;
+}
@@ -0,0 +1,47 @@
+#ifndef __VDP1BATCH_H__
+#define __VDP1BATCH_H__
+
+/*
+ * vdp1batch.h
+ *--------------------
+ * Batches consecutive VDP1 primitives that share their GX state into one
+ * GX_Begin
+ */
+
+#include "core.h"
+
+#define VDP1BATCH_MAX_VERTS		4096	//Vertices sent in one GX_Begin
+#define VDP1BATCH_STATE_SIZE	64		//Bytes of state a primitive can be keyed by
+
+typedef struct {
+	s16 x, y;
+	u32 color;
+	u16 tex;
+} vdp1batch_vtx;
+
+//Running totals
+typedef struct {
+	u32 frames;
+	u32 prims;
+	u32 batches;			//GX_Begin calls
+	u32 states;				//Times the GX state had to be set
+} vdp1batch_stats;
+
+//Forgets the current state, call when the VDP1 GX state is set up again
+void vdp1batch_Begin(void);
+//Switches to the state of the next primitives: prim is GX_QUADS or GX_LINES,
+//tex whether vertices carry a texture coordinate and state the bytes the
+//rest of the GX state is built from. Returns 1 when it differs from the
+//current one, the primitives batched so far are drawn then and the caller
+//sets the new GX state.
+u32 vdp1batch_SetState(u32 prim, u32 tex, const void *state, u32 size);
+//Adds a primitive of n vertices in the current state
+void vdp1batch_Add(const vdp1batch_vtx *v, u32 n);
+//Draws the batched primitives, call before any GX state change the batcher
+//doesn't know about
+void vdp1batch_Flush(void);
+
+void vdp1batch_GetStats(vdp1batch_stats *stats);
+
+
+#endif /*__VDP1BATCH_H__*/
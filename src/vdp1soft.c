@@ -0,0 +1,832 @@
+/*
+ * vdp1soft.c
+ *--------------------
+ * Software VDP1 rasteriser. The command list vdp1.c decoded for Vdp1Draw is
+ * first turned into a flat array of draw operations with the local
+ * coordinates and the clipping rectangles in effect already applied. The framebuffer is then cut in bands of lines and
+ * each band replays the whole array in order, drawing only the pixels that
+ * fall in it, so the bands can be drawn by different threads and still give
+ * the same framebuffer as a single pass.
+ *
+ * Sprites and polygons are drawn as the hardware does: lines are stepped
+ * from the A-D edge to the B-C edge and gaps between lines are filled, one
+ * texture row per line. Results are written to Vdp1FrameBuffer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include <gccore.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "vdp1soft.h"
+#include "vdp1.h"
+
+#define SOFT_BAND_STACK		(16 * 1024)
+#define SOFT_BAND_PRIO		60
+
+#define SOFT_OP_QUAD		0		//Sprites and polygons
+#define SOFT_OP_LINE		1		//Lines, polylines are split in four
+
+#define SOFT_NO_DOT			0xFFFFFFFF
+//Coordinates are 13 bit signed, the hardware ignores the bits above
+#define SOFT_COORD(v)		((s32) ((u32) (v) << 19) >> 19)
+//Vertices are clamped this far around the framebuffer, which is 1024 wide at
+//most, so 16.16 stepping can't overflow and edges take few enough steps
+#define SOFT_GUARD			2048
+#define SOFT_MAX_STEPS		(SOFT_GUARD * 2 + 1024)
+#define SOFT_OP_SLOTS		(VDP1SOFT_MAX_OPS * 4)	//Polylines take four
+
+typedef struct {
+	u16 type;
+	u16 pmod;
+	u16 colr;
+	u16 flip;				//CMDCTRL direction bits: 1 horizontal, 2 vertical
+	u16 tw, th;				//Texture size, 0 when untextured
+	u32 srca;
+	s32 x[4], y[4];
+	u16 grd[4];				//Gouraud colour of each vertex
+	s32 ymin, ymax;			//Rows the operation can touch
+	s32 sys_x2, sys_y2;
+	s32 usr_x1, usr_y1, usr_x2, usr_y2;
+} soft_op;
+
+typedef struct {
+	u32 y0, y1;
+	u32 seen;
+	u64 pixels;
+	u64 culled;
+} soft_band;
+
+//State of the line being drawn
+typedef struct {
+	const soft_op *op;
+	soft_band *b;
+	u32 row;				//Offset of the texture row in texels
+	u32 rowend;				//Texels from here on follow the second end code
+	u32 u, ustep;			//16.16 texel along the line
+	s32 g[3], gstep[3];		//16.16 Gouraud offsets along the line
+} soft_line;
+
+static soft_op *soft_ops = NULL;
+static u32 soft_op_num;
+static u32 soft_fbw;
+static u32 soft_fbh;
+static u32 soft_fb8;		//8 bits per pixel framebuffer
+static vdp1soft_stats soft_stats;
+
+static soft_band soft_bands[VDP1SOFT_MAX_BANDS];
+static u32 soft_band_num = 0;
+static lwp_t soft_threads[VDP1SOFT_MAX_BANDS];
+static mutex_t soft_lock;
+static cond_t soft_start;
+static cond_t soft_done;
+static u32 soft_gen;
+static u32 soft_pending;
+static u32 soft_quit;
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_Dot(u32 mode, u32 srca, u32 ofs)
+{
+	switch (mode) {
+		case 0:
+		case 1: {
+			u32 b = Vdp1Ram[(srca + (ofs >> 1)) & 0x7FFFF];
+			return (ofs & 1) ? b & 0xF : b >> 4;
+		}
+		case 2:
+		case 3:
+		case 4:
+			return Vdp1Ram[(srca + ofs) & 0x7FFFF];
+		default:
+			return T1ReadWord(Vdp1Ram, (srca + (ofs << 1)) & 0x7FFFE);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Texel where the second end code of a texture row is, the rest of the row
+//isn't drawn
+static u32 soft_RowEnd(const soft_op *op, u32 row)
+{
+	static const u16 endcodes[8] = {0xF, 0xF, 0xFF, 0xFF, 0xFF, 0x7FFF, 0, 0};
+	u32 mode = (op->pmod >> 3) & 0x7;
+	u32 code = endcodes[mode];
+	u32 found = 0;
+
+	if ((op->pmod & 0x80) || !code) {
+		return op->tw;
+	}
+	for (u32 u = 0; u < op->tw; ++u) {
+		if (soft_Dot(mode, op->srca, row + u) == code && ++found == 2) {
+			return u;
+		}
+	}
+	return op->tw;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Colour code of texel u of the current row, SOFT_NO_DOT when nothing is drawn
+static INLINE u32 soft_Texel(const soft_op *op, const soft_line *l, u32 u)
+{
+	u32 mode = (op->pmod >> 3) & 0x7;
+	u32 spd = op->pmod & 0x40;
+	u32 dot;
+
+	if (u >= l->rowend) {
+		return SOFT_NO_DOT;
+	}
+	dot = soft_Dot(mode, op->srca, l->row + u);
+	switch (mode) {
+		case 0:
+			if ((!dot && !spd) || (dot == 0xF && !(op->pmod & 0x80))) {
+				return SOFT_NO_DOT;
+			}
+			return (op->colr & 0xFFF0) | dot;
+		case 1:
+			if ((!dot && !spd) || (dot == 0xF && !(op->pmod & 0x80))) {
+				return SOFT_NO_DOT;
+			}
+			return T1ReadWord(Vdp1Ram, ((op->colr << 3) + (dot << 1)) & 0x7FFFE);
+		case 2:
+		case 3:
+		case 4:
+			if ((!dot && !spd) || (dot == 0xFF && !(op->pmod & 0x80))) {
+				return SOFT_NO_DOT;
+			}
+			return (op->colr & (0xFFC0 << (mode - 2))) | (dot & (0xFF >> (4 - mode)));
+		case 5:
+			if ((!dot && !spd) || (dot == 0x7FFF && !(op->pmod & 0x80))) {
+				return SOFT_NO_DOT;
+			}
+			return dot;
+		default:
+			return SOFT_NO_DOT;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE void soft_Pixel(soft_line *l, s32 x, s32 y)
+{
+	const soft_op *op = l->op;
+	u32 pmod = op->pmod;
+	u32 c;
+
+	if (y < (s32) l->b->y0 || y >= (s32) l->b->y1 || x < 0 || y < 0 ||
+		x > op->sys_x2 || y > op->sys_y2 || x >= (s32) soft_fbw || y >= (s32) soft_fbh) {
+		return;
+	}
+	if (pmod & 0x400) {
+		u32 inside = x >= op->usr_x1 && x <= op->usr_x2 && y >= op->usr_y1 && y <= op->usr_y2;
+		if (inside == ((pmod >> 9) & 1)) {
+			return;
+		}
+	}
+	if ((pmod & 0x100) && ((x ^ y) & 1)) {
+		return;
+	}
+
+	if (op->tw) {
+		u32 u = l->u >> 16;
+		c = soft_Texel(op, l, (op->flip & 1) ? op->tw - 1 - u : u);
+		if (c == SOFT_NO_DOT) {
+			return;
+		}
+	} else {
+		c = op->colr;
+	}
+
+	u32 addr = y * soft_fbw + x;
+	l->b->pixels++;
+	if (soft_fb8) {
+		Vdp1FrameBuffer[addr & 0x3FFFF] = c;
+		return;
+	}
+
+	addr = (addr << 1) & 0x3FFFE;
+	if (pmod & 0x8000) {
+		T1WriteWord(Vdp1FrameBuffer, addr, T1ReadWord(Vdp1FrameBuffer, addr) | 0x8000);
+		return;
+	}
+	if ((pmod & 0x4) && (c & 0x8000)) {
+		u32 rgb = 0x8000;
+		for (u32 k = 0; k < 3; ++k) {
+			s32 ch = ((c >> (k * 5)) & 0x1F) + (l->g[k] >> 16);
+			rgb |= (ch < 0 ? 0 : (ch > 0x1F ? 0x1F : ch)) << (k * 5);
+		}
+		c = rgb;
+	}
+	switch (pmod & 0x3) {
+		case 1: {		//Shadow
+			u32 dst = T1ReadWord(Vdp1FrameBuffer, addr);
+			if (dst & 0x8000) {
+				T1WriteWord(Vdp1FrameBuffer, addr, ((dst & 0x7BDE) >> 1) | 0x8000);
+			}
+			return;
+		}
+		case 2:			//Half luminance
+			if (c & 0x8000) {
+				c = ((c & 0x7BDE) >> 1) | 0x8000;
+			}
+			break;
+		case 3: {		//Half transparency
+			u32 dst = T1ReadWord(Vdp1FrameBuffer, addr);
+			if ((dst & 0x8000) && (c & 0x8000)) {
+				c = (((c & 0x7BDE) + (dst & 0x7BDE)) >> 1) | 0x8000;
+			}
+		} break;
+	}
+	T1WriteWord(Vdp1FrameBuffer, addr, c);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Steps from x0, y0 to x1, y1 one pixel a step. With fill, a pixel is added
+//where the line moves diagonally so that lines next to it leave no holes.
+static void soft_Line(soft_line *l, s32 x0, s32 y0, s32 x1, s32 y1, u32 fill)
+{
+	s32 dx = x1 - x0;
+	s32 dy = y1 - y0;
+	s32 n = MIN(MAX(abs(dx), abs(dy)), SOFT_MAX_STEPS);
+	s32 xs = n ? (dx * 65536) / n : 0;
+	s32 ys = n ? (dy * 65536) / n : 0;
+	s32 xacc = x0 * 65536 + 0x8000;
+	s32 yacc = y0 * 65536 + 0x8000;
+	s32 px = x0, py = y0;
+
+	for (s32 k = 0; k <= n; ++k) {
+		s32 x = xacc >> 16;
+		s32 y = yacc >> 16;
+		if (fill && x != px && y != py) {
+			soft_Pixel(l, px, y);
+		}
+		soft_Pixel(l, x, y);
+		px = x;
+		py = y;
+		xacc += xs;
+		yacc += ys;
+		l->u += l->ustep;
+		l->g[0] += l->gstep[0];
+		l->g[1] += l->gstep[1];
+		l->g[2] += l->gstep[2];
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE s32 soft_Channel(u32 c, u32 k)
+{
+	return (s32) ((c >> (k * 5)) & 0x1F) - 16;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Sets up texel and Gouraud stepping of a line of n + 1 pixels, g0 and g1 are
+//the 16.16 Gouraud offsets at both ends
+static INLINE void soft_LineSetup(soft_line *l, s32 n, u32 tw, const s32 *g0, const s32 *g1)
+{
+	l->u = 0;
+	l->ustep = (tw << 16) / (n + 1);
+	for (u32 k = 0; k < 3; ++k) {
+		l->g[k] = g0[k] + 0x8000;
+		l->gstep[k] = n ? (g1[k] - g0[k]) / n : 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Whether a line between both points can't have pixels in the band
+static INLINE u32 soft_LineOut(const soft_op *op, const soft_band *b, s32 x0, s32 y0, s32 x1, s32 y1)
+{
+	return MAX(y0, y1) < (s32) b->y0 || MIN(y0, y1) >= (s32) b->y1 ||
+		MAX(x0, x1) < 0 || MIN(x0, x1) > op->sys_x2;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_DrawLineOp(const soft_op *op, soft_band *b)
+{
+	soft_line l;
+	s32 g0[3], g1[3];
+	s32 n = MIN(MAX(abs(op->x[1] - op->x[0]), abs(op->y[1] - op->y[0])), SOFT_MAX_STEPS);
+
+	if (soft_LineOut(op, b, op->x[0], op->y[0], op->x[1], op->y[1])) {
+		return;
+	}
+	for (u32 k = 0; k < 3; ++k) {
+		g0[k] = soft_Channel(op->grd[0], k) << 16;
+		g1[k] = soft_Channel(op->grd[1], k) << 16;
+	}
+	l.op = op;
+	l.b = b;
+	l.row = 0;
+	l.rowend = 0;
+	soft_LineSetup(&l, n, 0, g0, g1);
+	soft_Line(&l, op->x[0], op->y[0], op->x[1], op->y[1], 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_DrawQuadOp(const soft_op *op, soft_band *b)
+{
+	soft_line l;
+	s32 nl = MAX(abs(op->x[3] - op->x[0]), abs(op->y[3] - op->y[0]));
+	s32 nr = MAX(abs(op->x[2] - op->x[1]), abs(op->y[2] - op->y[1]));
+	s32 n = MIN(MAX(nl, nr), SOFT_MAX_STEPS);
+	s32 step[4][2];			//16.16 edge steps: A to D and B to C, x and y
+	s32 acc[4][2];
+	s32 gl[3], gr[3], gls[3], grs[3];
+	u32 v = 0, vstep;
+	u32 last_row = SOFT_NO_DOT;
+
+	for (u32 k = 0; k < 2; ++k) {
+		u32 from = k, to = 3 - k;		//A-D, then B-C
+		step[k][0] = n ? ((op->x[to] - op->x[from]) * 65536) / n : 0;
+		step[k][1] = n ? ((op->y[to] - op->y[from]) * 65536) / n : 0;
+		acc[k][0] = op->x[from] * 65536 + 0x8000;
+		acc[k][1] = op->y[from] * 65536 + 0x8000;
+	}
+	for (u32 k = 0; k < 3; ++k) {
+		gl[k] = soft_Channel(op->grd[0], k) << 16;
+		gr[k] = soft_Channel(op->grd[1], k) << 16;
+		gls[k] = n ? ((soft_Channel(op->grd[3], k) << 16) - gl[k]) / n : 0;
+		grs[k] = n ? ((soft_Channel(op->grd[2], k) << 16) - gr[k]) / n : 0;
+	}
+	vstep = (op->th << 16) / (n + 1);
+
+	l.op = op;
+	l.b = b;
+	l.row = 0;
+	l.rowend = op->tw;
+	for (s32 i = 0; i <= n; ++i) {
+		s32 x0 = acc[0][0] >> 16, y0 = acc[0][1] >> 16;
+		s32 x1 = acc[1][0] >> 16, y1 = acc[1][1] >> 16;
+
+		if (!soft_LineOut(op, b, x0, y0, x1, y1)) {
+			if (op->tw) {
+				u32 vr = v >> 16;
+				u32 row = ((op->flip & 2) ? op->th - 1 - vr : vr) * op->tw;
+				if (row != last_row) {
+					l.row = row;
+					l.rowend = soft_RowEnd(op, row);
+					last_row = row;
+				}
+			}
+			soft_LineSetup(&l, MAX(abs(x1 - x0), abs(y1 - y0)), op->tw, gl, gr);
+			soft_Line(&l, x0, y0, x1, y1, 1);
+		}
+
+		for (u32 k = 0; k < 2; ++k) {
+			acc[k][0] += step[k][0];
+			acc[k][1] += step[k][1];
+		}
+		for (u32 k = 0; k < 3; ++k) {
+			gl[k] += gls[k];
+			gr[k] += grs[k];
+		}
+		v += vstep;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_RasterBand(soft_band *b)
+{
+	for (u32 i = 0; i < soft_op_num; ++i) {
+		const soft_op *op = &soft_ops[i];
+		if (op->ymax < (s32) b->y0 || op->ymin >= (s32) b->y1) {
+			b->culled++;
+			continue;
+		}
+		if (op->type == SOFT_OP_QUAD) {
+			soft_DrawQuadOp(op, b);
+		} else {
+			soft_DrawLineOp(op, b);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void *soft_BandThread(void *arg)
+{
+	soft_band *b = (soft_band*) arg;
+
+	LWP_MutexLock(soft_lock);
+	while (!soft_quit) {
+		if (b->seen == soft_gen) {
+			LWP_CondWait(soft_start, soft_lock);
+			continue;
+		}
+		b->seen = soft_gen;
+		LWP_MutexUnlock(soft_lock);
+
+		soft_RasterBand(b);
+
+		LWP_MutexLock(soft_lock);
+		if (--soft_pending == 0) {
+			LWP_CondSignal(soft_done);
+		}
+	}
+	LWP_MutexUnlock(soft_lock);
+
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	s32 local_x, local_y;
+	s32 sys_x2, sys_y2;
+	s32 usr_x1, usr_y1, usr_x2, usr_y2;
+} soft_parse_state;
+
+//Appends an operation with the clipping in effect and the rows it spans
+static soft_op *soft_AddOp(const soft_parse_state *st, const vdp1cmd_struct *cmd, u32 type)
+{
+	if (soft_op_num >= SOFT_OP_SLOTS) {
+		return NULL;
+	}
+	soft_op *op = &soft_ops[soft_op_num++];
+
+	op->type = type;
+	op->pmod = cmd->CMDPMOD;
+	op->colr = cmd->CMDCOLR;
+	op->flip = (cmd->CMDCTRL >> 4) & 0x3;
+	op->tw = op->th = 0;
+	op->srca = cmd->CMDSRCA << 3;
+	op->sys_x2 = st->sys_x2;
+	op->sys_y2 = st->sys_y2;
+	op->usr_x1 = st->usr_x1;
+	op->usr_y1 = st->usr_y1;
+	op->usr_x2 = st->usr_x2;
+	op->usr_y2 = st->usr_y2;
+	if (op->pmod & 0x4) {
+		u32 grda = cmd->CMDGRDA << 3;
+		for (u32 k = 0; k < 4; ++k) {
+			op->grd[k] = T1ReadWord(Vdp1Ram, (grda + (k << 1)) & 0x7FFFE);
+		}
+	} else {
+		op->grd[0] = op->grd[1] = op->grd[2] = op->grd[3] = 0x4210;
+	}
+	return op;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Clamps the vertices to the guard band and finds the rows they span
+static void soft_OpRows(soft_op *op, u32 points)
+{
+	for (u32 k = 0; k < points; ++k) {
+		op->x[k] = MAX(-SOFT_GUARD, MIN(op->x[k], SOFT_GUARD + 1024));
+		op->y[k] = MAX(-SOFT_GUARD, MIN(op->y[k], SOFT_GUARD + 1024));
+	}
+	op->ymin = op->ymax = op->y[0];
+	for (u32 k = 1; k < points; ++k) {
+		op->ymin = MIN(op->ymin, op->y[k]);
+		op->ymax = MAX(op->ymax, op->y[k]);
+	}
+	op->ymin = MAX(op->ymin, 0);
+	op->ymax = MIN(op->ymax, op->sys_y2);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_AddSprite(const soft_parse_state *st, const vdp1cmd_struct *cmd, u32 scaled)
+{
+	s32 w = ((cmd->CMDSIZE >> 8) & 0x3F) << 3;
+	s32 h = cmd->CMDSIZE & 0xFF;
+	s32 x0 = SOFT_COORD(cmd->CMDXA), y0 = SOFT_COORD(cmd->CMDYA);
+	s32 x1 = w, y1 = h;			//Size on screen
+
+	if (!w || !h) {
+		return;
+	}
+	if (scaled) {
+		u32 zp = (cmd->CMDCTRL >> 8) & 0xF;
+		if (zp == 0 || (zp & 0x3) == 0 || (zp & 0xC) == 0) {
+			//Only two coordinates, or an invalid zoom point
+			x1 = SOFT_COORD(cmd->CMDXC) - x0 + 1;
+			y1 = SOFT_COORD(cmd->CMDYC) - y0 + 1;
+		} else {
+			x1 = SOFT_COORD(cmd->CMDXB);
+			y1 = SOFT_COORD(cmd->CMDYB);
+			//Zoom point: bits 0-1 horizontal, 2-3 vertical
+			if ((zp & 0x3) == 2) {
+				x0 -= x1 / 2;
+			} else if ((zp & 0x3) == 3) {
+				x0 -= x1;
+			}
+			if ((zp & 0xC) == 0x8) {
+				y0 -= y1 / 2;
+			} else if ((zp & 0xC) == 0xC) {
+				y0 -= y1;
+			}
+			x1++;
+			y1++;
+		}
+	}
+
+	soft_op *op = soft_AddOp(st, cmd, SOFT_OP_QUAD);
+	if (op == NULL) {
+		return;
+	}
+	op->tw = w;
+	op->th = h;
+	x0 += st->local_x;
+	y0 += st->local_y;
+	op->x[0] = op->x[3] = x0;
+	op->x[1] = op->x[2] = x0 + x1 - 1;
+	op->y[0] = op->y[1] = y0;
+	op->y[2] = op->y[3] = y0 + y1 - 1;
+	soft_OpRows(op, 4);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_AddQuad(const soft_parse_state *st, const vdp1cmd_struct *cmd, u32 textured)
+{
+	const s16 *pts = &cmd->CMDXA;
+	soft_op *op;
+
+	if (textured && (!(cmd->CMDSIZE & 0x3F00) || !(cmd->CMDSIZE & 0xFF))) {
+		return;
+	}
+	op = soft_AddOp(st, cmd, SOFT_OP_QUAD);
+	if (op == NULL) {
+		return;
+	}
+	if (textured) {
+		op->tw = ((cmd->CMDSIZE >> 8) & 0x3F) << 3;
+		op->th = cmd->CMDSIZE & 0xFF;
+	}
+	for (u32 k = 0; k < 4; ++k) {
+		op->x[k] = SOFT_COORD(pts[k << 1]) + st->local_x;
+		op->y[k] = SOFT_COORD(pts[(k << 1) + 1]) + st->local_y;
+	}
+	soft_OpRows(op, 4);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_AddLines(const soft_parse_state *st, const vdp1cmd_struct *cmd, u32 lines)
+{
+	const s16 *pts = &cmd->CMDXA;
+
+	for (u32 i = 0; i < lines; ++i) {
+		u32 a = i, b = (i + 1) & 0x3;
+		soft_op *op = soft_AddOp(st, cmd, SOFT_OP_LINE);
+		if (op == NULL) {
+			return;
+		}
+		op->x[0] = SOFT_COORD(pts[a << 1]) + st->local_x;
+		op->y[0] = SOFT_COORD(pts[(a << 1) + 1]) + st->local_y;
+		op->x[1] = SOFT_COORD(pts[b << 1]) + st->local_x;
+		op->y[1] = SOFT_COORD(pts[(b << 1) + 1]) + st->local_y;
+		u16 ga = op->grd[a], gb = op->grd[b];
+		op->grd[0] = ga;
+		op->grd[1] = gb;
+		soft_OpRows(op, 2);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Turns the decoded command list into draw operations
+static void soft_Parse(void)
+{
+	const vdp1cmdlist_struct *list = vdp1_GetCommandList();
+	const vdp1cmd_struct *cmd;
+	soft_parse_state st;
+	u32 i;
+
+	st.local_x = SOFT_COORD(Vdp1Regs->localX);
+	st.local_y = SOFT_COORD(Vdp1Regs->localY);
+	st.sys_x2 = Vdp1Regs->systemclipX2;
+	st.sys_y2 = Vdp1Regs->systemclipY2;
+	st.usr_x1 = Vdp1Regs->userclipX1;
+	st.usr_y1 = Vdp1Regs->userclipY1;
+	st.usr_x2 = Vdp1Regs->userclipX2;
+	st.usr_y2 = Vdp1Regs->userclipY2;
+	soft_op_num = 0;
+
+	for (i = 0; i < list->num && i < VDP1SOFT_MAX_OPS; i++) {
+		cmd = &list->entry[i].cmd;
+		switch (cmd->CMDCTRL & 0x000F) {
+			case 0:
+				soft_AddSprite(&st, cmd, 0);
+				break;
+			case 1:
+				soft_AddSprite(&st, cmd, 1);
+				break;
+			case 2:
+			case 3:
+				soft_AddQuad(&st, cmd, 1);
+				break;
+			case 4:
+				soft_AddQuad(&st, cmd, 0);
+				break;
+			case 5:
+			case 7:
+				soft_AddLines(&st, cmd, 4);
+				break;
+			case 6:
+				soft_AddLines(&st, cmd, 1);
+				break;
+			case 8:
+			case 11:
+				st.usr_x1 = (u16) cmd->CMDXA;
+				st.usr_y1 = (u16) cmd->CMDYA;
+				st.usr_x2 = (u16) cmd->CMDXC;
+				st.usr_y2 = (u16) cmd->CMDYC;
+				break;
+			case 9:
+				st.sys_x2 = (u16) cmd->CMDXC;
+				st.sys_y2 = (u16) cmd->CMDYC;
+				break;
+			case 10:
+				st.local_x = SOFT_COORD(cmd->CMDXA);
+				st.local_y = SOFT_COORD(cmd->CMDYA);
+				break;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_FrameSize(void)
+{
+	soft_fb8 = vdp1_GetFrameSize(&soft_fbw, &soft_fbh) == 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int vdp1soft_Init(u32 bands)
+{
+	if (soft_ops) {
+		vdp1soft_DeInit();
+	}
+	if (bands < 1) {
+		bands = 1;
+	} else if (bands > VDP1SOFT_MAX_BANDS) {
+		bands = VDP1SOFT_MAX_BANDS;
+	}
+
+	soft_ops = (soft_op*) memalign(32, SOFT_OP_SLOTS * sizeof(soft_op));
+	if (soft_ops == NULL) {
+		return -1;
+	}
+	soft_op_num = 0;
+	memset(&soft_stats, 0, sizeof(soft_stats));
+	memset(soft_bands, 0, sizeof(soft_bands));
+
+	soft_gen = 0;
+	soft_quit = 0;
+	if (bands > 1) {
+		LWP_MutexInit(&soft_lock, false);
+		LWP_CondInit(&soft_start);
+		LWP_CondInit(&soft_done);
+	}
+	soft_band_num = 1;
+	//The first band is rasterised by the caller
+	for (u32 i = 1; i < bands; ++i) {
+		if (LWP_CreateThread(&soft_threads[i], soft_BandThread, &soft_bands[i], NULL,
+								SOFT_BAND_STACK, SOFT_BAND_PRIO) < 0) {
+			break;
+		}
+		soft_band_num++;
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1soft_DeInit(void)
+{
+	if (soft_ops == NULL) {
+		return;
+	}
+	if (soft_band_num > 1) {
+		LWP_MutexLock(soft_lock);
+		soft_quit = 1;
+		LWP_CondBroadcast(soft_start);
+		LWP_MutexUnlock(soft_lock);
+		for (u32 i = 1; i < soft_band_num; ++i) {
+			LWP_JoinThread(soft_threads[i], NULL);
+		}
+		LWP_CondDestroy(soft_done);
+		LWP_CondDestroy(soft_start);
+		LWP_MutexDestroy(soft_lock);
+	}
+	soft_band_num = 0;
+	free(soft_ops);
+	soft_ops = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1soft_Draw(void)
+{
+	if (soft_ops == NULL) {
+		return;
+	}
+
+	u64 start = gettime();
+	soft_FrameSize();
+	soft_Parse();
+	u64 parsed = gettime();
+
+	for (u32 i = 0; i < soft_band_num; ++i) {
+		soft_bands[i].y0 = (soft_fbh * i) / soft_band_num;
+		soft_bands[i].y1 = (soft_fbh * (i + 1)) / soft_band_num;
+	}
+	if (soft_band_num > 1) {
+		LWP_MutexLock(soft_lock);
+		soft_pending = soft_band_num - 1;
+		soft_gen++;
+		LWP_CondBroadcast(soft_start);
+		LWP_MutexUnlock(soft_lock);
+	}
+	soft_RasterBand(&soft_bands[0]);
+	if (soft_band_num > 1) {
+		LWP_MutexLock(soft_lock);
+		while (soft_pending) {
+			LWP_CondWait(soft_done, soft_lock);
+		}
+		LWP_MutexUnlock(soft_lock);
+	}
+
+	for (u32 i = 0; i < soft_band_num; ++i) {
+		soft_stats.pixels += soft_bands[i].pixels;
+		soft_stats.culled += soft_bands[i].culled;
+		soft_bands[i].pixels = 0;
+		soft_bands[i].culled = 0;
+	}
+	soft_stats.ops += soft_op_num;
+	soft_stats.parse_ticks += parsed - start;
+	soft_stats.raster_ticks += gettime() - parsed;
+	soft_stats.frames++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1soft_Erase(void)
+{
+	u32 x0 = (Vdp1Regs->EWLR >> 6) & 0x1F8;
+	u32 y0 = Vdp1Regs->EWLR & 0x1FF;
+	u32 x1 = ((Vdp1Regs->EWRR >> 6) & 0x3F8) + 8;
+	u32 y1 = (Vdp1Regs->EWRR & 0x1FF) + 1;
+
+	if (soft_ops == NULL) {
+		return;
+	}
+	soft_FrameSize();
+	if (soft_fb8) {
+		//Each erase unit covers twice the pixels
+		x1 = (Vdp1Regs->EWRR >> 9) << 4;
+	}
+	x1 = MIN(x1, soft_fbw);
+	y1 = MIN(y1, soft_fbh);
+	for (u32 y = y0; y < y1; ++y) {
+		for (u32 x = x0; x < x1; ++x) {
+			u32 addr = y * soft_fbw + x;
+			if (soft_fb8) {
+				Vdp1FrameBuffer[addr & 0x3FFFF] = Vdp1Regs->EWDR & 0xFF;
+			} else {
+				T1WriteWord(Vdp1FrameBuffer, (addr << 1) & 0x3FFFE, Vdp1Regs->EWDR);
+			}
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp1soft_Hash(void)
+{
+	u32 hash = 2166136261u;
+	u32 size;
+
+	if (soft_ops == NULL) {
+		return 0;
+	}
+	soft_FrameSize();
+	size = MIN((soft_fbw * soft_fbh) << (soft_fb8 ^ 1), 0x40000);
+	for (u32 i = 0; i < size; ++i) {
+		hash = (hash ^ Vdp1FrameBuffer[i]) * 16777619u;
+	}
+	return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp1soft_GetStats(vdp1soft_stats *stats)
+{
+	*stats = soft_stats;
+}
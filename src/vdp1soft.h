@@ -0,0 +1,41 @@
+#ifndef __VDP1SOFT_H__
+#define __VDP1SOFT_H__
+
+/*
+ * vdp1soft.h
+ *--------------------
+ * Software VDP1 rasteriser, draws the command list into the VDP1 framebuffer
+ */
+
+#include "core.h"
+
+#define VDP1SOFT_MAX_BANDS		8
+#define VDP1SOFT_MAX_OPS		2048
+
+//Running totals since vdp1soft_Init
+typedef struct {
+	u32 frames;
+	u64 ops;				//Draw operations parsed from the command lists
+	u64 culled;				//Operations skipped by a band for not touching it
+	u64 pixels;				//Pixels written to the framebuffer
+	u64 parse_ticks;
+	u64 raster_ticks;		//Wall time of the rasterisation, all bands together
+} vdp1soft_stats;
+
+//Splits the framebuffer in bands scanline bands, all but the first one
+//rasterised by worker threads. Returns -1 when the draw list can't be
+//allocated.
+int vdp1soft_Init(u32 bands);
+void vdp1soft_DeInit(void);
+//Parses the command list in VDP1 RAM and draws it, does nothing before
+//vdp1soft_Init
+void vdp1soft_Draw(void);
+//Fills the erase area set in EWLR/EWRR with EWDR
+void vdp1soft_Erase(void);
+
+//FNV-1a of the framebuffer area the current TVMR mode uses
+u32 vdp1soft_Hash(void);
+void vdp1soft_GetStats(vdp1soft_stats *stats);
+
+
+#endif /*__VDP1SOFT_H__*/
@@ -31,6 +31,7 @@
 #include "yui.h"
 #include "yabause.h"
 #include "osd/osd.h"
+#include "pace.h"
 
 u8 * Vdp2Ram;
 u8 * Vdp2ColorRam;
@@ -88,6 +89,7 @@ u32 FASTCALL Vdp2RamReadLong(u32 addr) {
 //DONE
 void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
    addr &= 0x7FFFF;
+   vdp2_ram_dirty[addr >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
    T1WriteByte(Vdp2Ram, addr, val);
 }
 
@@ -95,6 +97,7 @@ void FASTCALL Vdp2RamWriteByte(u32 addr, u8 val) {
 //DONE
 void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
    addr &= 0x7FFFF;
+   vdp2_ram_dirty[addr >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
    T1WriteWord(Vdp2Ram, addr, val);
 }
 
@@ -102,6 +105,7 @@ void FASTCALL Vdp2RamWriteWord(u32 addr, u16 val) {
 //DONE
 void FASTCALL Vdp2RamWriteLong(u32 addr, u32 val) {
    addr &= 0x7FFFF;
+   vdp2_ram_dirty[addr >> VRAM_DIRTY_SHIFT] = VRAM_DIRTY_ALL;
    T1WriteLong(Vdp2Ram, addr, val);
 }
 
@@ -146,6 +150,7 @@ void FASTCALL Vdp2ColorRamWriteWord(u32 addr, u16 val) {
 	//}
 	SGX_ColorRamDirty(addr >> 5);
 	if (Vdp2Internal.ColorMode == 0 ) {
+		SGX_ColorRamDirty((addr | 0x800) >> 5);
 		T2WriteWord(Vdp2ColorRam, addr | 0x800, val);
 	}
 	T2WriteWord(Vdp2ColorRam, addr, val);
@@ -160,6 +165,7 @@ void FASTCALL Vdp2ColorRamWriteLong(u32 addr, u32 val) {
 	SGX_ColorRamDirty(addr >> 5);
 	T2WriteLong(Vdp2ColorRam, addr, val);
    	if (Vdp2Internal.ColorMode == 0 ) {
+		SGX_ColorRamDirty((addr | 0x800) >> 5);
 		T2WriteLong(Vdp2ColorRam, addr | 0x800, val);
 	}
 }
@@ -335,17 +341,24 @@ static void FPSDisplay(void)
 
 //////////////////////////////////////////////////////////////////////////////
 
-static u64 current_ticks = 0;
-
 void Vdp2VBlankOUT(void)
 {
 	Vdp2Regs->TVSTAT = (Vdp2Regs->TVSTAT & ~0x0008) | 0x0002;
 
 
-	DCFlushRange(Vdp2Ram, 0x80000);
+	vram_stats.vdp2_flushed += mem_DirtyFlush(Vdp2Ram, vdp2_ram_dirty);
 	DCFlushRange(Vdp2ColorRam, 0x1000);
 	VIDSoftVdp2DrawStart();
-	SGX_InvalidateVRAM();
+	//Textures read straight from VDP RAM stay cached until either RAM changes
+	u32 tex_pages = mem_DirtyTake(vdp1_ram_dirty, VRAM_DIRTY_TEX) +
+					mem_DirtyTake(vdp2_ram_dirty, VRAM_DIRTY_TEX);
+	if (tex_pages) {
+		SGX_InvalidateVRAM();
+		vram_stats.tex_pages += tex_pages;
+	} else {
+		vram_stats.tex_kept++;
+	}
+	SGX_InvalidateCopies();
 	//GX_InvalidateTexAll();
 	SGX_TlutCRAMUpdate();
 
@@ -353,7 +366,9 @@ void Vdp2VBlankOUT(void)
 	GX_SetTevColorS10(GX_TEVREG1, ocolor_B);
 
 
-	if (Vdp2Regs->TVMD & 0x8000) {
+	//Skipped frames keep the register side effects of VDP1 only
+	u32 skip = pace_Skip();
+	if ((Vdp2Regs->TVMD & 0x8000) && !skip) {
 		//Generate sprite Window texture
 		GX_SetZMode(GX_DISABLE, GX_ALWAYS, GX_FALSE);
 		gfx_WindowTextureGen();
@@ -374,18 +389,15 @@ void Vdp2VBlankOUT(void)
 	}
 
 	VIDSoftVdp1SwapFrameBuffer();
-	FPSDisplay();
-	osd_MsgShow();
-
-
-	//XXX: Limit FPS.. we can do better than this
-	if (YabauseGetTicks() - current_ticks < yabsys.OneFrameTime - 32) {
-		VIDEO_WaitVSync();
+	if (!skip) {
+		FPSDisplay();
+		osd_MsgShow();
 	}
-	//VIDEO_WaitVSync();
-	current_ticks = YabauseGetTicks();
 
-	YuiSwapBuffers();
+	pace_EndFrame();
+	if (!skip) {
+		YuiSwapBuffers();
+	}
 
 
 	/* this should be done after a frame change or a plot trigger */
@@ -104,16 +104,26 @@ typedef struct {
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 I:16; // 0x25F80078
       u32 D:16; // 0x25F8007A
+#else
+      u32 D:16; // 0x25F8007A
+      u32 I:16; // 0x25F80078
+#endif
     } part;
     u32 all;
   } ZMXN0;
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 I:16; // 0x25F8007C
       u32 D:16; // 0x25F8007E
+#else
+      u32 D:16; // 0x25F8007E
+      u32 I:16; // 0x25F8007C
+#endif
     } part;
     u32 all;
   } ZMYN0;
@@ -126,16 +136,26 @@ typedef struct {
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 I:16; // 0x25F80088
       u32 D:16; // 0x25F8008A
+#else
+      u32 D:16; // 0x25F8008A
+      u32 I:16; // 0x25F80088
+#endif
     } part;
     u32 all;
   } ZMXN1;
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 I:16; // 0x25F8008C
       u32 D:16; // 0x25F8008E
+#else
+      u32 D:16; // 0x25F8008E
+      u32 I:16; // 0x25F8008C
+#endif
     } part;
     u32 all;
   } ZMYN1;
@@ -149,32 +169,52 @@ typedef struct {
 
    union {
       struct {
+#ifdef WORDS_BIGENDIAN
          u32 U:16; // 0x25F8009C
          u32 L:16; // 0x25F8009E
+#else
+         u32 L:16; // 0x25F8009E
+         u32 U:16; // 0x25F8009C
+#endif
       } part;
       u32 all;
    } VCSTA;
 
    union {
       struct {
+#ifdef WORDS_BIGENDIAN
          u32 U:16; // 0x25F800A0
          u32 L:16; // 0x25F800A2
+#else
+         u32 L:16; // 0x25F800A2
+         u32 U:16; // 0x25F800A0
+#endif
       } part;
       u32 all;
    } LSTA0;
 
    union {
       struct {
+#ifdef WORDS_BIGENDIAN
          u32 U:16; // 0x25F800A4
          u32 L:16; // 0x25F800A6
+#else
+         u32 L:16; // 0x25F800A6
+         u32 U:16; // 0x25F800A4
+#endif
       } part;
       u32 all;
    } LSTA1;
 
    union {
       struct {
+#ifdef WORDS_BIGENDIAN
          u32 U:16; // 0x25F800A8
          u32 L:16; // 0x25F800AA
+#else
+         u32 L:16; // 0x25F800AA
+         u32 U:16; // 0x25F800A8
+#endif
       } part;
       u32 all;
    } LCTA;
@@ -191,8 +231,13 @@ typedef struct {
 
    union {
       struct {
+#ifdef WORDS_BIGENDIAN
          u32 U:16; // 0x25F800BC
          u32 L:16; // 0x25F800BE
+#else
+         u32 L:16; // 0x25F800BE
+         u32 U:16; // 0x25F800BC
+#endif
       } part;
       u32 all;
    } RPTA;
@@ -212,16 +257,26 @@ typedef struct {
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 U:16; // 0x25F800D8
       u32 L:16; // 0x25F800DA
+#else
+      u32 L:16; // 0x25F800DA
+      u32 U:16; // 0x25F800D8
+#endif
     } part;
     u32 all;
   } LWTA0;
 
   union {
     struct {
+#ifdef WORDS_BIGENDIAN
       u32 U:16; // 0x25F800DC
       u32 L:16; // 0x25F800DE
+#else
+      u32 L:16; // 0x25F800DE
+      u32 U:16; // 0x25F800DC
+#endif
     } part;
     u32 all;
   } LWTA1;
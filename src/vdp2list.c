@@ -0,0 +1,215 @@
+/*
+ * vdp2list.c
+ *--------------------
+ * Display lists of the VDP2 scroll screens. The quads of a scroll screen only
+ * depend on its settings, the scroll position to the cell and the VRAM its
+ * walk reads (pattern names and the blank cell test), so the GX commands are
+ * recorded once and the list is called on the next frames until one of them
+ * changes. Settings are hashed into a key; the VRAM pages the walk read are
+ * kept with a hash of their generations, a page gets a new generation on
+ * every frame it was written in.
+ */
+
+#include <string.h>
+#include <malloc.h>
+#include <gccore.h>
+
+#include "vdp2list.h"
+#include "memory.h"
+
+#define LIST_MASK_WORDS		(VRAM_DIRTY_PAGES / 32)
+
+typedef struct {
+	u8 *buf;
+	u32 size;				//Bytes recorded, 0 when the list can't be called
+	u32 key;
+	u32 full;				//The screen overflowed the buffer for this key
+	u32 gens;				//Hash of the generations of the pages read
+	u32 pages[LIST_MASK_WORDS];
+} list_entry;
+
+static list_entry list_layers[VDP2LIST_LAYERS];
+static list_entry *list_rec = NULL;
+static u32 list_gen[VRAM_DIRTY_PAGES];
+static vdp2list_stats list_stats;
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 list_GenHash(const list_entry *l)
+{
+	u32 hash = 2166136261u;
+	for (u32 w = 0; w < LIST_MASK_WORDS; ++w) {
+		u32 bits = l->pages[w];
+		while (bits) {
+			u32 b = __builtin_ctz(bits);
+			bits &= bits - 1;
+			hash = (hash ^ list_gen[(w << 5) + b]) * 16777619u;
+		}
+	}
+	return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int vdp2list_Init(void)
+{
+	vdp2list_DeInit();
+	for (u32 i = 0; i < VDP2LIST_LAYERS; ++i) {
+		list_layers[i].buf = (u8 *) memalign(32, VDP2LIST_SIZE);
+		if (!list_layers[i].buf) {
+			vdp2list_DeInit();
+			return -1;
+		}
+	}
+	memset(list_gen, 0, sizeof(list_gen));
+	memset(&list_stats, 0, sizeof(list_stats));
+	vdp2list_Invalidate();
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2list_DeInit(void)
+{
+	for (u32 i = 0; i < VDP2LIST_LAYERS; ++i) {
+		free(list_layers[i].buf);
+		list_layers[i].buf = NULL;
+	}
+	list_rec = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2list_BeginFrame(void)
+{
+	for (u32 i = 0; i < VRAM_DIRTY_PAGES; ++i) {
+		if (vdp2_ram_dirty[i] & VRAM_DIRTY_LIST) {
+			vdp2_ram_dirty[i] &= ~VRAM_DIRTY_LIST;
+			list_gen[i]++;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp2list_Key(const vdp2draw_struct *info, const u32 *planetbl, u32 w, u32 h)
+{
+	const u32 mask_xy = (8 << info->patternwh_bits) - 1;
+	const u32 fields[] = {
+		w, h,
+		info->x & ~mask_xy, info->y & ~mask_xy,
+		*(const u32 *) &info->coordincx, *(const u32 *) &info->coordincy,
+		info->cellw, info->cellh, info->mapwh,
+		info->planew_bits, info->planeh_bits, info->pagewh_bits,
+		info->patternwh, info->patternwh_bits,
+		info->patterndatasize, info->patterndatasize_bits,
+		info->supplementdata, info->auxmode, info->colornumber,
+		info->transparencyenable, info->coloroffset, info->alpha,
+		info->specialcolormode, info->specialcode,
+		info->priority, info->prioffs
+	};
+	u32 hash = 2166136261u;
+
+	for (u32 i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+		hash = (hash ^ fields[i]) * 16777619u;
+	}
+	for (u32 i = 0; i < (u32) (info->mapwh * info->mapwh); ++i) {
+		hash = (hash ^ planetbl[i]) * 16777619u;
+	}
+	return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp2list_Call(u32 layer, u32 key)
+{
+	list_entry *l = &list_layers[layer];
+
+	if (!l->size) {
+		return 0;
+	}
+	if (l->key != key) {
+		l->size = 0;
+		list_stats.stale_key++;
+		return 0;
+	}
+	if (l->gens != list_GenHash(l)) {
+		l->size = 0;
+		list_stats.stale_vram++;
+		return 0;
+	}
+	GX_CallDisplayList(l->buf, l->size);
+	list_stats.called++;
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp2list_Record(u32 layer, u32 key)
+{
+	list_entry *l = &list_layers[layer];
+
+	if (!l->buf || (l->full && l->key == key)) {
+		return 0;
+	}
+	l->size = 0;
+	l->key = key;
+	l->full = 0;
+	memset(l->pages, 0, sizeof(l->pages));
+	list_rec = l;
+
+	DCInvalidateRange(l->buf, VDP2LIST_SIZE);
+	GX_BeginDisplayList(l->buf, VDP2LIST_SIZE);
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2list_Page(u32 addr, u32 size)
+{
+	if (list_rec) {
+		u32 end = ((addr + size - 1) & 0x7FFFF) >> VRAM_DIRTY_SHIFT;
+		for (u32 i = (addr & 0x7FFFF) >> VRAM_DIRTY_SHIFT; i <= end; ++i) {
+			list_rec->pages[i >> 5] |= 1 << (i & 0x1F);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp2list_End(void)
+{
+	list_entry *l = list_rec;
+
+	if (!l) {
+		return 0;
+	}
+	list_rec = NULL;
+	l->size = GX_EndDisplayList();
+	if (!l->size) {
+		l->full = 1;
+		list_stats.overflows++;
+		return 0;
+	}
+	l->gens = list_GenHash(l);
+	GX_CallDisplayList(l->buf, l->size);
+	list_stats.recorded++;
+	return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2list_Invalidate(void)
+{
+	for (u32 i = 0; i < VDP2LIST_LAYERS; ++i) {
+		list_layers[i].size = 0;
+		list_layers[i].full = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2list_GetStats(vdp2list_stats *stats)
+{
+	*stats = list_stats;
+}
@@ -0,0 +1,59 @@
+#ifndef __VDP2LIST_H__
+#define __VDP2LIST_H__
+
+/*
+ * vdp2list.h
+ *--------------------
+ * GX display lists of the VDP2 scroll screens, replayed while the screen
+ * settings and the VRAM they were recorded from don't change
+ */
+
+#include "core.h"
+#include "vidshared.h"
+
+#define VDP2LIST_NBG0			0
+#define VDP2LIST_NBG1			1
+#define VDP2LIST_NBG2			2
+#define VDP2LIST_NBG3			3
+#define VDP2LIST_LAYERS			4
+
+#define VDP2LIST_SIZE			0x40000		//Bytes of GX commands a screen can record
+
+//Running totals since vdp2list_Init
+typedef struct {
+	u32 called;				//Screens drawn by calling a recorded list
+	u32 recorded;
+	u32 overflows;			//Screens too big to record, drawn immediately
+	u32 stale_key;			//Lists dropped because the screen settings changed
+	u32 stale_vram;			//Lists dropped because a page they read was written
+} vdp2list_stats;
+
+//Returns -1 when the list buffers can't be allocated. Without them every
+//screen is drawn immediately.
+int vdp2list_Init(void);
+void vdp2list_DeInit(void);
+//Moves the VDP2 RAM pages written since the last frame to a new generation,
+//call once per frame before the screens are drawn
+void vdp2list_BeginFrame(void);
+
+//Hash of the settings the quads of a scroll screen depend on. x and y only
+//count to the cell, the fine scroll goes in the position matrix.
+u32 vdp2list_Key(const vdp2draw_struct *info, const u32 *planetbl, u32 w, u32 h);
+//Calls the list of the layer when it was recorded with key and the pages it
+//read are unchanged, returns 0 when the screen has to be drawn instead
+u32 vdp2list_Call(u32 layer, u32 key);
+//Starts recording the layer, returns 0 when the list is unavailable and the
+//commands go straight to the FIFO
+u32 vdp2list_Record(u32 layer, u32 key);
+//Marks VDP2 RAM read by the walk of the screen being recorded
+void vdp2list_Page(u32 addr, u32 size);
+//Stops recording and calls the list. Returns 0 when it overflowed, nothing
+//was drawn then and the screen has to be drawn again immediately.
+u32 vdp2list_End(void);
+//Drops every list, for when something the keys don't cover changed
+void vdp2list_Invalidate(void);
+
+void vdp2list_GetStats(vdp2list_stats *stats);
+
+
+#endif /*__VDP2LIST_H__*/
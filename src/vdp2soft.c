@@ -0,0 +1,1122 @@
+/*
+ * vdp2soft.c
+ *--------------------
+ * Software VDP2 compositor. NBG0-3 and RBG0 are rendered a scanline at a time
+ * from VDP2 RAM into per-layer line buffers, windows are applied on the line
+ * and the layers are then composited by priority with colour calculation, the
+ * line colour and back screens and colour offset into 0xRRGGBB pixels.
+ *
+ * Unzoomed tile maps are fetched a character row at a time: the pattern name
+ * is decoded once per cell and its 8 dots are expanded in one fixed length
+ * loop. Zoomed screens, bitmaps and the rotation screen go a pixel at a time
+ * with the last pattern name cached.
+ *
+ * Lines only depend on the registers and RAM, so the frame is cut in bands of
+ * lines that worker threads render at the same time. Sprites are drawn by GX
+ * and are not part of the image.
+ */
+
+#include <string.h>
+#include <malloc.h>
+#include <gccore.h>
+#include <ogc/lwp.h>
+#include <ogc/mutex.h>
+#include <ogc/cond.h>
+#include <ogc/lwp_watchdog.h>
+
+#include "vdp2soft.h"
+#include "vdp2.h"
+#include "vidshared.h"
+#include "yabause.h"
+
+#define SOFT_LAYERS			5
+#define SOFT_LINE_PAD		16		//Room for the cell the line starts in
+#define SOFT_BAND_STACK		(16 * 1024)
+#define SOFT_BAND_PRIO		60
+
+//Layer pixels: 0xRRGGBB, the priority above it (0 is transparent) and
+//whether colour calculation applies
+#define SOFT_PRI_SHIFT		24
+#define SOFT_CC				0x08000000
+
+#define SOFT_RGB555(c)		((((c) & 0x1F) << 19) | (((c) & 0x3E0) << 6) | (((c) & 0x7C00) >> 7))
+
+typedef struct {
+	u32 key;				//Cell coordinates the entry was decoded for
+	u32 charaddr;
+	u32 pal;
+	u32 flip;
+	u32 sf;					//Special priority function
+	u32 scf;				//Special colour calculation function
+} soft_pattern;
+
+typedef struct {
+	vdp2draw_struct info;	//Map and character setup, as the GX renderer reads it
+	u32 planetbl[16];
+	u32 xmask;
+	u32 ymask;
+	soft_pattern bitmap;	//Palette and special bits of bitmap screens
+} soft_map;
+
+typedef struct {
+	u32 enable;
+	u32 bgon;				//BGON bits checked on every line
+	u32 sfpr_shift;			//Position in SFPRMD
+	u32 cn;					//Character colour number
+	u32 cbits;				//log2 of the bytes per row of a cell / 4
+	u32 transparent;
+	u32 craof;
+	u32 pri;
+	u32 spcode;
+	u32 sccmode;
+	u32 ccen;
+	u32 ratio;
+	u32 linescreen;
+	u32 wctl;
+	u32 mosaic_x;
+	u32 mosaic_y;
+	//Normal screens
+	fixed32 sx, sy;
+	fixed32 zx, zy;
+	u32 linescroll;
+	u32 lstbl;
+	u32 lsshift;
+	u32 lsentry;
+	//Rotation screen
+	u32 rpmd;
+	u32 rp_used;			//Bit per rotation parameter read on every line
+	vdp2rotationparameterfp_struct param[2];
+	soft_map map[2];		//One per rotation parameter, normal screens use map[0]
+} soft_layer;
+
+typedef struct {
+	s32 xs;
+	s32 xe;					//Inclusive, empty when xe < xs
+} soft_span;
+
+typedef struct {
+	u32 y0, y1;
+	u32 seen;
+	u32 line[SOFT_LAYERS][VDP2SOFT_MAX_W + SOFT_LINE_PAD] ATTRIBUTE_ALIGN(32);
+	u64 pixels[VDP2SOFT_LAYER_NUM];
+	u64 ticks[VDP2SOFT_LAYER_NUM];
+} soft_band;
+
+static const u8 soft_cbits[8] = {0, 1, 2, 2, 3, 3, 3, 3};
+static const u16 soft_widths[4] = {320, 352, 640, 704};
+
+static u32 *soft_frame = NULL;
+static u32 soft_w;
+static u32 soft_h;
+static u32 soft_pal[0x800];
+static soft_layer soft_layers[SOFT_LAYERS];
+static s32 soft_offset[SOFT_LAYERS + 1][3];	//Colour offset of each layer and the back screen
+static u32 soft_win_y[2][2];
+static s32 soft_win_x[2][2];
+static u32 soft_win_line[2];
+static u32 soft_back_addr;
+static u32 soft_back_inc;
+static u32 soft_lc_addr;
+static u32 soft_lc_inc;
+static u32 soft_ccctl;
+static u32 soft_back_ratio;
+static u32 soft_lc_ratio;
+static vdp2soft_stats soft_stats;
+
+static soft_band *soft_bands[VDP2SOFT_MAX_BANDS];
+static u32 soft_band_num = 0;
+static lwp_t soft_threads[VDP2SOFT_MAX_BANDS];
+static mutex_t soft_lock;
+static cond_t soft_start;
+static cond_t soft_done;
+static u32 soft_gen;
+static u32 soft_pending;
+static u32 soft_quit;
+static u32 soft_sync = 0;		//Lock and conditions created
+
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_PatternDecode(const vdp2draw_struct *info, u32 addr, soft_pattern *pat)
+{
+	u32 chr;
+
+	if (info->patterndatasize == 1) {
+		u32 tmp = T1ReadWord(Vdp2Ram, addr & 0x7FFFE);
+		u32 sup = info->supplementdata;
+		pat->sf = (sup >> 9) & 1;
+		pat->scf = (sup >> 8) & 1;
+		if (info->colornumber) {
+			pat->pal = (tmp & 0x7000) >> 4;
+		} else {
+			pat->pal = ((tmp & 0xF000) >> 8) | ((sup & 0xE0) << 3);
+		}
+		if (!info->auxmode) {
+			pat->flip = (tmp >> 10) & 0x3;
+			if (info->patternwh == 1) {
+				chr = (tmp & 0x3FF) | ((sup & 0x1F) << 10);
+			} else {
+				chr = ((tmp & 0x3FF) << 2) | (sup & 0x3) | ((sup & 0x1C) << 10);
+			}
+		} else {
+			pat->flip = 0;
+			if (info->patternwh == 1) {
+				chr = (tmp & 0xFFF) | ((sup & 0x1C) << 10);
+			} else {
+				chr = ((tmp & 0xFFF) << 2) | (sup & 0x3) | ((sup & 0x10) << 10);
+			}
+		}
+	} else {
+		u32 tmp1 = T1ReadWord(Vdp2Ram, addr & 0x7FFFC);
+		u32 tmp2 = T1ReadWord(Vdp2Ram, (addr + 2) & 0x7FFFE);
+		chr = tmp2 & 0x7FFF;
+		pat->flip = (tmp1 >> 14) & 0x3;
+		pat->pal = info->colornumber ? (tmp1 & 0x70) << 4 : (tmp1 & 0x7F) << 4;
+		pat->sf = (tmp1 >> 13) & 1;
+		pat->scf = (tmp1 >> 12) & 1;
+	}
+
+	if (!(Vdp2Regs->VRSIZE & 0x8000)) {
+		chr &= 0x3FFF;
+	}
+	pat->charaddr = chr << 5;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Looks up the pattern name of the cell holding map pixel x, y
+static void soft_MapPattern(const soft_map *m, u32 x, u32 y, u32 key, soft_pattern *pat)
+{
+	const vdp2draw_struct *info = &m->info;
+	u32 pw_bits = 9 + info->planew_bits;
+	u32 ph_bits = 9 + info->planeh_bits;
+	u32 cellwh = 3 + info->patternwh_bits;
+	u32 plane = (y >> ph_bits) * info->mapwh + (x >> pw_bits);
+	u32 x0 = x & ((1 << pw_bits) - 1);
+	u32 y0 = y & ((1 << ph_bits) - 1);
+	u32 idx = ((((y0 >> 9) << info->planew_bits) + (x0 >> 9)) << (info->pagewh_bits << 1)) +
+				(((y0 & 511) >> cellwh) << info->pagewh_bits) + ((x0 & 511) >> cellwh);
+
+	soft_PatternDecode(info, m->planetbl[plane] + (idx << (info->patterndatasize_bits + 1)), pat);
+	pat->key = key;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_ReadDot(u32 cn, u32 base, u32 k)
+{
+	switch (cn) {
+		case 0: {
+			u32 b = Vdp2Ram[(base + (k >> 1)) & 0x7FFFF];
+			return (k & 1) ? b & 0xF : b >> 4;
+		}
+		case 1:
+			return Vdp2Ram[(base + k) & 0x7FFFF];
+		case 2:
+		case 3:
+			return T1ReadWord(Vdp2Ram, (base + (k << 1)) & 0x7FFFE);
+		default:
+			return T1ReadLong(Vdp2Ram, (base + (k << 2)) & 0x7FFFC);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Expands one 8 dot row of a cell
+static INLINE u32 soft_CellRow(u32 cn, u32 addr, u32 *dots)
+{
+	const u8 *src = Vdp2Ram + (addr & 0x7FFFF);
+	u32 any = 0;
+
+	switch (cn) {
+		case 0:
+			for (u32 k = 0; k < 4; ++k) {
+				dots[(k << 1)] = src[k] >> 4;
+				dots[(k << 1) + 1] = src[k] & 0xF;
+			}
+			break;
+		case 1:
+			for (u32 k = 0; k < 8; ++k) {
+				dots[k] = src[k];
+			}
+			break;
+		case 2:
+		case 3:
+			for (u32 k = 0; k < 8; ++k) {
+				dots[k] = (src[k << 1] << 8) | src[(k << 1) + 1];
+			}
+			break;
+		default:
+			for (u32 k = 0; k < 8; ++k) {
+				dots[k] = (src[k << 2] << 24) | (src[(k << 2) + 1] << 16) |
+						(src[(k << 2) + 2] << 8) | src[(k << 2) + 3];
+			}
+			break;
+	}
+	for (u32 k = 0; k < 8; ++k) {
+		any |= dots[k];
+	}
+	return any;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_DotColor(const soft_layer *l, const soft_pattern *pat, u32 dot, u32 sprimode)
+{
+	u32 c;
+	u32 pri;
+	u32 cc = 0;
+
+	switch (l->cn) {
+		case 0:
+		case 1:
+			if (!dot && l->transparent) {
+				return 0;
+			}
+			c = soft_pal[(l->craof + (pat->pal | dot)) & 0x7FF];
+			break;
+		case 2:
+			if (!dot && l->transparent) {
+				return 0;
+			}
+			c = soft_pal[(l->craof + dot) & 0x7FF];
+			break;
+		case 3:
+			if (!(dot & 0x8000) && l->transparent) {
+				return 0;
+			}
+			c = SOFT_RGB555(dot) | ((dot & 0x8000) << 16);
+			break;
+		default:
+			if (!(dot & 0x80000000) && l->transparent) {
+				return 0;
+			}
+			c = (dot & 0x80000000) | ((dot & 0xFF) << 16) | (dot & 0xFF00) | ((dot >> 16) & 0xFF);
+			break;
+	}
+
+	pri = l->pri;
+	if (sprimode == 1) {
+		pri = (pri & 0x6) | pat->sf;
+	} else if (sprimode == 2) {
+		pri = (pri & 0x6) | (pat->sf & (l->spcode >> ((dot & 0xF) >> 1)));
+	}
+	if (!pri) {
+		return 0;
+	}
+
+	if (l->ccen) {
+		switch (l->sccmode) {
+			case 0: cc = 1; break;
+			case 1: cc = pat->scf; break;
+			case 2: cc = pat->scf & (l->spcode >> ((dot & 0xF) >> 1)); break;
+			case 3: cc = c >> 31; break;
+		}
+	}
+	return (c & 0xFFFFFF) | (pri << SOFT_PRI_SHIFT) | ((cc & 1) ? SOFT_CC : 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Pixel x, y of a map or bitmap, both already wrapped to its size
+static INLINE u32 soft_MapPixel(const soft_layer *l, const soft_map *m, soft_pattern *pat,
+								u32 x, u32 y, u32 sprimode)
+{
+	const vdp2draw_struct *info = &m->info;
+
+	if (info->isbitmap) {
+		return soft_DotColor(l, &m->bitmap, soft_ReadDot(l->cn, info->charaddr, y * info->cellw + x), sprimode);
+	}
+
+	u32 cellwh = 3 + info->patternwh_bits;
+	u32 key = ((y >> cellwh) << 16) | (x >> cellwh);
+	if (key != pat->key) {
+		soft_MapPattern(m, x, y, key, pat);
+	}
+	u32 size_mask = (8 << info->patternwh_bits) - 1;
+	u32 px = x & size_mask;
+	u32 py = y & size_mask;
+	if (pat->flip & 1) {
+		px ^= size_mask;
+	}
+	if (pat->flip & 2) {
+		py ^= size_mask;
+	}
+	u32 cell = ((py >> 3) << 1) | (px >> 3);
+	u32 dot = soft_ReadDot(l->cn, pat->charaddr + (cell << (5 + l->cbits)), ((py & 7) << 3) | (px & 7));
+	return soft_DotColor(l, pat, dot, sprimode);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Unzoomed tile map row, a cell at a time. Returns where the line starts in out.
+static u32 *soft_MapRow(const soft_layer *l, const soft_map *m, u32 *out, u32 x, u32 y, u32 w, u32 sprimode)
+{
+	const vdp2draw_struct *info = &m->info;
+	u32 cellwh = 3 + info->patternwh_bits;
+	u32 size_mask = (8 << info->patternwh_bits) - 1;
+	u32 rowbytes = 4 << l->cbits;
+	u32 fine = x & 7;
+	u32 dots[8];
+	soft_pattern pat;
+
+	pat.key = ~0;
+	x -= fine;
+	for (u32 i = 0; i < w + fine; i += 8, x = (x + 8) & m->xmask) {
+		u32 key = ((y >> cellwh) << 16) | (x >> cellwh);
+		if (key != pat.key) {
+			soft_MapPattern(m, x, y, key, &pat);
+		}
+		u32 px = x & size_mask;
+		u32 py = y & size_mask;
+		u32 hflip = pat.flip & 1;
+		if (hflip) {
+			px ^= size_mask;
+		}
+		if (pat.flip & 2) {
+			py ^= size_mask;
+		}
+		u32 addr = pat.charaddr + (((((py >> 3) << 1) | (px >> 3))) << (5 + l->cbits)) + (py & 7) * rowbytes;
+		u32 *dst = out + i;
+		if (!soft_CellRow(l->cn, addr, dots) && l->transparent && l->cn < 3) {
+			memset(dst, 0, 8 * sizeof(u32));
+			continue;
+		}
+		if (hflip) {
+			for (u32 k = 0; k < 8; ++k) {
+				dst[k] = soft_DotColor(l, &pat, dots[7 - k], sprimode);
+			}
+		} else {
+			for (u32 k = 0; k < 8; ++k) {
+				dst[k] = soft_DotColor(l, &pat, dots[k], sprimode);
+			}
+		}
+	}
+	return out + fine;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 *soft_DrawNBG(const soft_layer *l, u32 line, u32 *out, u32 sprimode)
+{
+	const soft_map *m = &l->map[0];
+	u32 y = line - line % l->mosaic_y;
+	fixed32 x16 = l->sx;
+	fixed32 y16 = l->sy + (fixed32) y * l->zy;
+	fixed32 zx = l->zx;
+
+	if (l->linescroll) {
+		u32 addr = l->lstbl + (y >> l->lsshift) * l->lsentry;
+		if (l->linescroll & 0x1) {
+			x16 += T1ReadLong(Vdp2Ram, addr & 0x7FFFC) & 0x07FFFF00;
+			addr += 4;
+		}
+		if (l->linescroll & 0x2) {
+			y16 += T1ReadLong(Vdp2Ram, addr & 0x7FFFC) & 0x07FFFF00;
+			addr += 4;
+		}
+		if (l->linescroll & 0x4) {
+			zx = T1ReadLong(Vdp2Ram, addr & 0x7FFFC) & 0x7FF00;
+		}
+	}
+
+	u32 my = (u32) (y16 >> 16) & m->ymask;
+	if (zx == 0x10000 && !m->info.isbitmap) {
+		out = soft_MapRow(l, m, out, (u32) (x16 >> 16) & m->xmask, my, soft_w, sprimode);
+	} else {
+		soft_pattern pat;
+		pat.key = ~0;
+		for (u32 i = 0; i < soft_w; ++i, x16 += zx) {
+			out[i] = soft_MapPixel(l, m, &pat, (u32) (x16 >> 16) & m->xmask, my, sprimode);
+		}
+	}
+
+	if (l->mosaic_x > 1) {
+		for (u32 i = 0; i < soft_w; ++i) {
+			out[i] = out[i - i % l->mosaic_x];
+		}
+	}
+	return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_WindowHide(u32 wctl, const soft_span *span, s32 x)
+{
+	u32 en0 = (wctl >> 1) & 1;
+	u32 en1 = (wctl >> 3) & 1;
+	u32 h0 = (x >= span[0].xs && x <= span[0].xe) ^ (wctl & 1);
+	u32 h1 = (x >= span[1].xs && x <= span[1].xe) ^ ((wctl >> 2) & 1);
+
+	if (wctl & 0x80) {
+		return ((en0 ^ 1) | h0) & ((en1 ^ 1) | h1);
+	}
+	return (en0 & h0) | (en1 & h1);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static u32 *soft_DrawRBG0(const soft_layer *l, u32 line, u32 *out, u32 sprimode, const soft_span *span)
+{
+	vdp2rotationparameterfp_struct p[2];
+	fixed32 xmul[2], ymul[2], C[2], F[2];
+	s64 ka[2];
+	soft_pattern pat[2];
+
+	for (u32 k = 0; k < 2; ++k) {
+		if (!(l->rp_used & (1 << k))) {
+			continue;
+		}
+		p[k] = l->param[k];
+		pat[k].key = ~0;
+		xmul[k] = p[k].Xst - p[k].Px + (fixed32) line * p[k].deltaXst;
+		ymul[k] = p[k].Yst - p[k].Py + (fixed32) line * p[k].deltaYst;
+		C[k] = mulfixed(p[k].C, (p[k].Zst - p[k].Pz));
+		F[k] = mulfixed(p[k].F, (p[k].Zst - p[k].Pz));
+		ka[k] = (s64) line * p[k].deltaKAst;
+		if (p[k].coefenab && p[k].deltaKAx == 0) {
+			Vdp2ReadCoefficientFP(&p[k], p[k].coeftbladdr + (u32) (ka[k] >> 16) * p[k].coefdatasize);
+		}
+	}
+
+	for (u32 i = 0; i < soft_w; ++i) {
+		for (u32 k = 0; k < 2; ++k) {
+			if ((l->rp_used & (1 << k)) && p[k].coefenab && p[k].deltaKAx != 0) {
+				Vdp2ReadCoefficientFP(&p[k], p[k].coeftbladdr +
+					(u32) ((ka[k] + (s64) i * p[k].deltaKAx) >> 16) * p[k].coefdatasize);
+			}
+		}
+
+		u32 k = l->rpmd == 1;
+		if (l->rpmd == 2) {
+			k = p[0].coefenab && p[0].msb;
+		} else if (l->rpmd == 3) {
+			k = soft_WindowHide(Vdp2Regs->WCTLD, span, i);
+		}
+		if (p[k].coefenab && p[k].msb) {
+			out[i] = 0;
+			continue;
+		}
+
+		const soft_map *m = &l->map[k];
+		u32 x = GenerateRotatedXPosFP(&p[k], i, xmul[k], ymul[k], C[k]);
+		u32 y = GenerateRotatedYPosFP(&p[k], i, xmul[k], ymul[k], F[k]);
+		if ((p[k].screenover == 2 && (x > m->xmask || y > m->ymask)) ||
+			(p[k].screenover == 3 && (x >= 512 || y >= 512))) {
+			out[i] = 0;
+			continue;
+		}
+		out[i] = soft_MapPixel(l, m, &pat[k], x & m->xmask, y & m->ymask, sprimode);
+	}
+	return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_Blend(u32 top, u32 under, u32 ratio)
+{
+	u32 a = 31 - ratio;
+	u32 b = ratio + 1;
+	u32 rb = (((top & 0xFF00FF) * a + (under & 0xFF00FF) * b) >> 5) & 0xFF00FF;
+	u32 g = (((top & 0xFF00) * a + (under & 0xFF00) * b) >> 5) & 0xFF00;
+	return rb | g;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_Add(u32 top, u32 under)
+{
+	u32 r = ((top >> 16) & 0xFF) + ((under >> 16) & 0xFF);
+	u32 g = ((top >> 8) & 0xFF) + ((under >> 8) & 0xFF);
+	u32 b = (top & 0xFF) + (under & 0xFF);
+	return ((r > 0xFF ? 0xFF : r) << 16) | ((g > 0xFF ? 0xFF : g) << 8) | (b > 0xFF ? 0xFF : b);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE u32 soft_Offset(u32 c, const s32 *ofs)
+{
+	s32 r = (s32) ((c >> 16) & 0xFF) + ofs[0];
+	s32 g = (s32) ((c >> 8) & 0xFF) + ofs[1];
+	s32 b = (s32) (c & 0xFF) + ofs[2];
+	r = r < 0 ? 0 : (r > 0xFF ? 0xFF : r);
+	g = g < 0 ? 0 : (g > 0xFF ? 0xFF : g);
+	b = b < 0 ? 0 : (b > 0xFF ? 0xFF : b);
+	return (r << 16) | (g << 8) | b;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_ComposeLine(u32 *dst, u32 line, u32 **lines, const u32 *ids, u32 num)
+{
+	u32 back = SOFT_RGB555(T1ReadWord(Vdp2Ram, (soft_back_addr + line * soft_back_inc) & 0x7FFFE));
+	u32 back_out = soft_Offset(back, soft_offset[SOFT_LAYERS]);
+	u32 lc = soft_pal[T1ReadWord(Vdp2Ram, (soft_lc_addr + line * soft_lc_inc) & 0x7FFFE) & 0x7FF] & 0xFFFFFF;
+	u32 add = soft_ccctl & 0x100;
+	u32 second_ratio = soft_ccctl & 0x200;
+
+	for (u32 x = 0; x < soft_w; ++x) {
+		u32 top = back, sec = back;
+		u32 tp = 0, sp = 0;
+		u32 ti = SOFT_LAYERS, si = SOFT_LAYERS;
+
+		//Ties go to the layer listed first
+		for (u32 n = 0; n < num; ++n) {
+			u32 px = lines[n][x];
+			u32 p = px >> SOFT_PRI_SHIFT & 0x7;
+			if (p > tp) {
+				sec = top; sp = tp; si = ti;
+				top = px; tp = p; ti = ids[n];
+			} else if (p > sp) {
+				sec = px; sp = p; si = ids[n];
+			}
+		}
+
+		if (ti == SOFT_LAYERS) {
+			dst[x] = back_out;
+			continue;
+		}
+
+		const soft_layer *l = &soft_layers[ti];
+		u32 c = top & 0xFFFFFF;
+		if (top & SOFT_CC) {
+			u32 under = sec & 0xFFFFFF;
+			u32 ratio = l->ratio;
+			if (l->linescreen) {
+				under = lc;
+				ratio = second_ratio ? soft_lc_ratio : ratio;
+			} else if (second_ratio) {
+				ratio = si == SOFT_LAYERS ? soft_back_ratio : soft_layers[si].ratio;
+			}
+			c = add ? soft_Add(c, under) : soft_Blend(c, under, ratio);
+		}
+		dst[x] = soft_Offset(c, soft_offset[ti]);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static INLINE s32 soft_WindowX(u32 x)
+{
+	switch ((Vdp2Regs->TVMD >> 1) & 0x3) {
+		case 0: return (x >> 1) & 0x1FF;
+		case 1: return x & 0x3FF;
+		case 2: return x & 0x1FF;
+		default: return (x & 0x3FF) >> 1;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_WindowSpans(u32 line, soft_span *span)
+{
+	for (u32 k = 0; k < 2; ++k) {
+		span[k].xs = 1;
+		span[k].xe = 0;
+		if (line < soft_win_y[k][0] || line > soft_win_y[k][1]) {
+			continue;
+		}
+		if (soft_win_line[k]) {
+			u32 addr = soft_win_line[k] + (line << 2);
+			u32 xs = T1ReadWord(Vdp2Ram, addr & 0x7FFFE);
+			u32 xe = T1ReadWord(Vdp2Ram, (addr + 2) & 0x7FFFE);
+			//0xFFFF ends turn the window off for the line (3D Baseball, Panzer Dragoon Saga)
+			if (xe != 0xFFFF) {
+				span[k].xs = soft_WindowX(xs);
+				span[k].xe = soft_WindowX(xe);
+			}
+		} else {
+			span[k].xs = soft_win_x[k][0];
+			span[k].xe = soft_win_x[k][1];
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_RenderBand(soft_band *b)
+{
+	//Layers in the order they win priority ties
+	static const u32 order[SOFT_LAYERS] = {
+		VDP2SOFT_RBG0, VDP2SOFT_NBG0, VDP2SOFT_NBG1, VDP2SOFT_NBG2, VDP2SOFT_NBG3
+	};
+	u32 *lines[SOFT_LAYERS];
+	u32 ids[SOFT_LAYERS];
+	soft_span span[2];
+
+	for (u32 line = b->y0; line < b->y1; ++line) {
+		u32 bgon = line < 270 ? vdp2_lines[line].BGON : Vdp2Regs->BGON;
+		u32 sfprmd = line < 270 ? vdp2_lines[line].SFPRMD : Vdp2Regs->SFPRMD;
+		u32 num = 0;
+
+		soft_WindowSpans(line, span);
+		for (u32 n = 0; n < SOFT_LAYERS; ++n) {
+			u32 id = order[n];
+			const soft_layer *l = &soft_layers[id];
+			if (!l->enable || !(bgon & l->bgon)) {
+				continue;
+			}
+			u64 start = gettime();
+			u32 sprimode = (sfprmd >> l->sfpr_shift) & 0x3;
+			u32 *out;
+			if (id == VDP2SOFT_RBG0) {
+				out = soft_DrawRBG0(l, line, b->line[id], sprimode, span);
+			} else {
+				out = soft_DrawNBG(l, line, b->line[id], sprimode);
+			}
+			if (l->wctl & 0xA) {
+				for (u32 x = 0; x < soft_w; ++x) {
+					if (soft_WindowHide(l->wctl, span, x)) {
+						out[x] = 0;
+					}
+				}
+			}
+			lines[num] = out;
+			ids[num++] = id;
+			b->pixels[id] += soft_w;
+			b->ticks[id] += gettime() - start;
+		}
+
+		u64 start = gettime();
+		soft_ComposeLine(soft_frame + line * VDP2SOFT_MAX_W, line, lines, ids, num);
+		b->pixels[VDP2SOFT_COMPOSE] += soft_w;
+		b->ticks[VDP2SOFT_COMPOSE] += gettime() - start;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void *soft_BandThread(void *arg)
+{
+	soft_band *b = (soft_band*) arg;
+
+	LWP_MutexLock(soft_lock);
+	while (!soft_quit) {
+		if (b->seen == soft_gen) {
+			LWP_CondWait(soft_start, soft_lock);
+			continue;
+		}
+		b->seen = soft_gen;
+		LWP_MutexUnlock(soft_lock);
+
+		soft_RenderBand(b);
+
+		LWP_MutexLock(soft_lock);
+		if (--soft_pending == 0) {
+			LWP_CondSignal(soft_done);
+		}
+	}
+	LWP_MutexUnlock(soft_lock);
+
+	return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_MapSetup(soft_map *m)
+{
+	vdp2draw_struct *info = &m->info;
+
+	if (info->isbitmap) {
+		m->xmask = info->cellw - 1;
+		m->ymask = info->cellh - 1;
+		return;
+	}
+	for (int i = 0; i < info->mapwh * info->mapwh; ++i) {
+		info->PlaneAddr(info, i);
+		m->planetbl[i] = info->addr;
+	}
+	m->xmask = (info->mapwh << (9 + info->planew_bits)) - 1;
+	m->ymask = (info->mapwh << (9 + info->planeh_bits)) - 1;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+//Settings every screen has in the same place, n is the BGON bit
+static void soft_LayerCommon(soft_layer *l, u32 n, u32 cn, u32 pri, u32 ratio, u32 craof, u32 wctl)
+{
+	l->bgon = 1 << n;
+	l->sfpr_shift = n << 1;
+	l->cn = cn;
+	l->cbits = soft_cbits[cn & 0x7];
+	l->transparent = !(Vdp2Regs->BGON & (0x100 << n));
+	l->pri = pri & 0x7;
+	l->ratio = ratio & 0x1F;
+	l->craof = (craof & 0x7) << 8;
+	l->wctl = wctl & 0xFF;
+	l->ccen = (Vdp2Regs->CCCTL >> n) & 1;
+	l->sccmode = (Vdp2Regs->SFCCMD >> (n << 1)) & 0x3;
+	l->spcode = (Vdp2Regs->SFSEL >> n) & 1 ? Vdp2Regs->SFCODE >> 8 : Vdp2Regs->SFCODE & 0xFF;
+	l->linescreen = (Vdp2Regs->LNCLEN >> n) & 1;
+	l->mosaic_x = l->mosaic_y = 1;
+	if (Vdp2Regs->MZCTL & (1 << n)) {
+		l->mosaic_x = ((Vdp2Regs->MZCTL >> 8) & 0xF) + 1;
+		l->mosaic_y = ((Vdp2Regs->MZCTL >> 12) & 0xF) + 1;
+	}
+	l->enable = Vdp2Regs->BGON & (1 << n);
+
+	//Colour offset, a 9 bit signed value per channel
+	s32 *ofs = soft_offset[n];
+	ofs[0] = ofs[1] = ofs[2] = 0;
+	if (Vdp2Regs->CLOFEN & (1 << n)) {
+		const u16 *co = (Vdp2Regs->CLOFSL & (1 << n)) ? &Vdp2Regs->COBR : &Vdp2Regs->COAR;
+		for (u32 k = 0; k < 3; ++k) {
+			ofs[k] = (co[k] & 0xFF) | -(co[k] & 0x100);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_SetupNBG(soft_layer *l, u32 n)
+{
+	static void FASTCALL (* const plane_addr[4])(vdp2draw_struct *, int) = {
+		Vdp2NBG0PlaneAddr, Vdp2NBG1PlaneAddr, Vdp2NBG2PlaneAddr, Vdp2NBG3PlaneAddr
+	};
+	soft_map *m = &l->map[0];
+	vdp2draw_struct *info = &m->info;
+	u32 hi = (n & 1) << 3;		//NBG1 and NBG3 take the high byte of shared registers
+	u32 chctl, cn;
+
+	memset(info, 0, sizeof(vdp2draw_struct));
+	if (n < 2) {
+		chctl = Vdp2Regs->CHCTLA >> hi;
+		cn = (chctl >> 4) & (n ? 0x3 : 0x7);
+		info->isbitmap = chctl & 0x2;
+	} else {
+		chctl = Vdp2Regs->CHCTLB >> ((n & 1) << 2);
+		cn = (chctl >> 1) & 0x1;
+	}
+	soft_LayerCommon(l, n, cn, (&Vdp2Regs->PRINA)[n >> 1] >> hi, (&Vdp2Regs->CCRNA)[n >> 1] >> hi,
+		Vdp2Regs->CRAOFA >> (n << 2), (&Vdp2Regs->WCTLA)[n >> 1] >> hi);
+	info->colornumber = cn;
+
+	if (info->isbitmap) {
+		u32 bmpn = Vdp2Regs->BMPNA >> hi;
+		ReadBitmapSize(info, chctl >> 2, 0x3);
+		info->charaddr = ((Vdp2Regs->MPOFN >> (n << 2)) & 0x7) * 0x20000;
+		m->bitmap.pal = (bmpn & 0x7) << 8;
+		m->bitmap.scf = (bmpn >> 4) & 1;
+		m->bitmap.sf = (bmpn >> 5) & 1;
+	} else {
+		info->mapwh = 2;
+		ReadPlaneSize(info, Vdp2Regs->PLSZ >> (n << 1));
+		ReadPatternData(info, (&Vdp2Regs->PNCN0)[n], chctl & 0x1);
+		info->PlaneAddr = (void FASTCALL (*)(void *, int)) plane_addr[n];
+	}
+	soft_MapSetup(m);
+
+	l->linescroll = 0;
+	l->zx = l->zy = 0x10000;
+	switch (n) {
+		case 0:
+		case 1: {
+			const u16 *sc = n ? &Vdp2Regs->SCXIN1 : &Vdp2Regs->SCXIN0;
+			u32 zx = n ? Vdp2Regs->ZMXN1.all : Vdp2Regs->ZMXN0.all;
+			u32 zy = n ? Vdp2Regs->ZMYN1.all : Vdp2Regs->ZMYN0.all;
+			u32 scrctl = (Vdp2Regs->SCRCTL >> hi) & 0xFF;
+			l->sx = ((sc[0] & 0x7FF) << 16) | (sc[1] & 0xFF00);
+			l->sy = ((sc[2] & 0x7FF) << 16) | (sc[3] & 0xFF00);
+			if (zx & 0x7FF00) {
+				l->zx = zx & 0x7FF00;
+			}
+			if (zy & 0x7FF00) {
+				l->zy = zy & 0x7FF00;
+			}
+			l->linescroll = (scrctl >> 1) & 0x7;
+			l->lstbl = ((n ? Vdp2Regs->LSTA1.all : Vdp2Regs->LSTA0.all) & 0x7FFFE) << 1;
+			l->lsshift = (scrctl >> 4) & 0x3;
+			l->lsentry = (((l->linescroll >> 2) & 1) + ((l->linescroll >> 1) & 1) + (l->linescroll & 1)) << 2;
+		} break;
+		case 2:
+			l->sx = (Vdp2Regs->SCXN2 & 0x7FF) << 16;
+			l->sy = (Vdp2Regs->SCYN2 & 0x7FF) << 16;
+			break;
+		default:
+			l->sx = (Vdp2Regs->SCXN3 & 0x7FF) << 16;
+			l->sy = (Vdp2Regs->SCYN3 & 0x7FF) << 16;
+			break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_SetupRBG0(soft_layer *l)
+{
+	u32 chctl = Vdp2Regs->CHCTLB >> 8;
+	u32 cn = (chctl >> 4) & 0x7;
+
+	soft_LayerCommon(l, 4, cn, Vdp2Regs->PRIR, Vdp2Regs->CCRR, Vdp2Regs->CRAOFB, Vdp2Regs->WCTLC);
+	l->rpmd = Vdp2Regs->RPMD & 0x3;
+	l->rp_used = l->rpmd == 0 ? 0x1 : (l->rpmd == 1 ? 0x2 : 0x3);
+	if (!l->enable) {
+		return;
+	}
+
+	for (u32 k = 0; k < 2; ++k) {
+		soft_map *m = &l->map[k];
+		vdp2draw_struct *info = &m->info;
+		vdp2rotationparameterfp_struct *p = &l->param[k];
+
+		if (!(l->rp_used & (1 << k))) {
+			continue;
+		}
+		memset(info, 0, sizeof(vdp2draw_struct));
+		info->colornumber = cn;
+		info->isbitmap = chctl & 0x2;
+		if (info->isbitmap) {
+			ReadBitmapSize(info, chctl >> 2, 0x1);
+			info->charaddr = k ? (Vdp2Regs->MPOFR & 0x70) * 0x2000 : (Vdp2Regs->MPOFR & 0x7) * 0x20000;
+			m->bitmap.pal = (Vdp2Regs->BMPNB & 0x7) << 8;
+			m->bitmap.scf = (Vdp2Regs->BMPNB >> 4) & 1;
+			m->bitmap.sf = (Vdp2Regs->BMPNB >> 5) & 1;
+		} else {
+			info->mapwh = 4;
+			ReadPlaneSize(info, Vdp2Regs->PLSZ >> (8 + (k << 2)));
+			ReadPatternData(info, Vdp2Regs->PNCR, chctl & 0x1);
+			info->PlaneAddr = (void FASTCALL (*)(void *, int)) (k ? Vdp2ParameterBPlaneAddr : Vdp2ParameterAPlaneAddr);
+		}
+		soft_MapSetup(m);
+
+		Vdp2ReadRotationTableFP(k, p);
+		CalculateRotationValuesFP(p);
+		//Both banks split and no bank given to the coefficients: no per dot
+		//coefficients (Sonic R, All-Star Baseball 97)
+		if (((Vdp2Regs->RAMCTL >> 8) & 3) == 3 && !(Vdp2Regs->RAMCTL & ((Vdp2Regs->RAMCTL & 0xAA) >> 1)) &&
+			p->coefenab && p->coefmode == 0) {
+			p->deltaKAx = 0;
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+static void soft_SetupFrame(void)
+{
+	u32 vres = (Vdp2Regs->TVMD >> 4) & 0x3;
+
+	soft_w = soft_widths[Vdp2Regs->TVMD & 0x3];
+	soft_h = vres == 0 ? 224 : (vres == 1 || !yabsys.IsPal ? 240 : 256);
+
+	//Palette in the current colour RAM mode, the MSB is kept in bit 31
+	if (Vdp2Internal.ColorMode == 2) {
+		for (u32 i = 0; i < 0x800; ++i) {
+			u32 c = T2ReadLong(Vdp2ColorRam, (i << 2) & 0xFFF);
+			soft_pal[i] = (c & 0x80000000) | ((c & 0xFF) << 16) | (c & 0xFF00) | ((c >> 16) & 0xFF);
+		}
+	} else {
+		for (u32 i = 0; i < 0x800; ++i) {
+			u32 c = T2ReadWord(Vdp2ColorRam, (i << 1) & 0xFFF);
+			soft_pal[i] = SOFT_RGB555(c) | ((c & 0x8000) << 16);
+		}
+	}
+
+	for (u32 n = 0; n < 4; ++n) {
+		soft_SetupNBG(&soft_layers[n], n);
+	}
+	soft_SetupRBG0(&soft_layers[VDP2SOFT_RBG0]);
+
+	//Screens the colour modes of NBG0 and NBG1 take the VRAM cycles of
+	u32 cn0 = soft_layers[VDP2SOFT_NBG0].enable ? soft_layers[VDP2SOFT_NBG0].cn : 0;
+	u32 cn1 = soft_layers[VDP2SOFT_NBG1].enable ? soft_layers[VDP2SOFT_NBG1].cn : 0;
+	if (cn0 == 4) {
+		soft_layers[VDP2SOFT_NBG1].enable = 0;
+	}
+	if (cn0 >= 2) {
+		soft_layers[VDP2SOFT_NBG2].enable = 0;
+	}
+	if (cn0 == 4 || cn1 >= 2) {
+		soft_layers[VDP2SOFT_NBG3].enable = 0;
+	}
+	//RBG1 takes over NBG0 and isn't rendered
+	if (Vdp2Regs->BGON & 0x20) {
+		soft_layers[VDP2SOFT_NBG0].enable = 0;
+	}
+
+	//Windows
+	for (u32 k = 0; k < 2; ++k) {
+		clipping_struct clip;
+		u32 lwta = k ? Vdp2Regs->LWTA1.all : Vdp2Regs->LWTA0.all;
+		ReadWindowCoordinates(k, &clip);
+		soft_win_x[k][0] = clip.xstart;
+		soft_win_x[k][1] = clip.xend;
+		soft_win_y[k][0] = clip.ystart;
+		soft_win_y[k][1] = clip.yend;
+		soft_win_line[k] = (lwta & 0x80000000) ? (lwta & 0x7FFFE) << 1 : 0;
+	}
+
+	//Back and line colour screens, and the offset of the back screen
+	soft_back_addr = (((Vdp2Regs->BKTAU & ((Vdp2Regs->VRSIZE & 0x8000) ? 0x7 : 0x3)) << 16) | Vdp2Regs->BKTAL) << 1;
+	soft_back_inc = (Vdp2Regs->BKTAU & 0x8000) ? 2 : 0;
+	soft_lc_addr = (Vdp2Regs->LCTA.all & (0x3FFFF | ((Vdp2Regs->VRSIZE & 0x8000) << 3))) << 1;
+	soft_lc_inc = (Vdp2Regs->LCTA.part.U & 0x8000) ? 2 : 0;
+	soft_ccctl = Vdp2Regs->CCCTL;
+	soft_lc_ratio = Vdp2Regs->CCRLB & 0x1F;
+	soft_back_ratio = (Vdp2Regs->CCRLB >> 8) & 0x1F;
+
+	s32 *ofs = soft_offset[SOFT_LAYERS];
+	ofs[0] = ofs[1] = ofs[2] = 0;
+	if (Vdp2Regs->CLOFEN & 0x20) {
+		const u16 *co = (Vdp2Regs->CLOFSL & 0x20) ? &Vdp2Regs->COBR : &Vdp2Regs->COAR;
+		for (u32 k = 0; k < 3; ++k) {
+			ofs[k] = (co[k] & 0xFF) | -(co[k] & 0x100);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+int vdp2soft_Init(u32 bands)
+{
+	if (soft_frame) {
+		vdp2soft_DeInit();
+	}
+	if (bands < 1) {
+		bands = 1;
+	} else if (bands > VDP2SOFT_MAX_BANDS) {
+		bands = VDP2SOFT_MAX_BANDS;
+	}
+
+	soft_frame = (u32*) memalign(32, VDP2SOFT_MAX_W * VDP2SOFT_MAX_H * sizeof(u32));
+	if (soft_frame == NULL) {
+		return -1;
+	}
+	memset(soft_frame, 0, VDP2SOFT_MAX_W * VDP2SOFT_MAX_H * sizeof(u32));
+	memset(&soft_stats, 0, sizeof(soft_stats));
+	soft_w = 320;
+	soft_h = 224;
+
+	soft_gen = 0;
+	soft_quit = 0;
+	soft_sync = bands > 1;
+	if (soft_sync) {
+		LWP_MutexInit(&soft_lock, false);
+		LWP_CondInit(&soft_start);
+		LWP_CondInit(&soft_done);
+	}
+	soft_band_num = 0;
+	for (u32 i = 0; i < bands; ++i) {
+		soft_band *b = (soft_band*) memalign(32, sizeof(soft_band));
+		if (b == NULL) {
+			break;
+		}
+		memset(b, 0, sizeof(soft_band));
+		soft_bands[i] = b;
+		//The first band is rendered by the caller
+		if (i && LWP_CreateThread(&soft_threads[i], soft_BandThread, b, NULL,
+									SOFT_BAND_STACK, SOFT_BAND_PRIO) < 0) {
+			free(b);
+			break;
+		}
+		soft_band_num++;
+	}
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2soft_DeInit(void)
+{
+	if (soft_frame == NULL) {
+		return;
+	}
+	if (soft_band_num > 1) {
+		LWP_MutexLock(soft_lock);
+		soft_quit = 1;
+		LWP_CondBroadcast(soft_start);
+		LWP_MutexUnlock(soft_lock);
+		for (u32 i = 1; i < soft_band_num; ++i) {
+			LWP_JoinThread(soft_threads[i], NULL);
+		}
+	}
+	for (u32 i = 0; i < soft_band_num; ++i) {
+		free(soft_bands[i]);
+	}
+	if (soft_sync) {
+		LWP_CondDestroy(soft_done);
+		LWP_CondDestroy(soft_start);
+		LWP_MutexDestroy(soft_lock);
+		soft_sync = 0;
+	}
+	soft_band_num = 0;
+	free(soft_frame);
+	soft_frame = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2soft_Render(void)
+{
+	if (soft_frame == NULL) {
+		return;
+	}
+
+	soft_SetupFrame();
+	for (u32 i = 0; i < soft_band_num; ++i) {
+		soft_bands[i]->y0 = (soft_h * i) / soft_band_num;
+		soft_bands[i]->y1 = (soft_h * (i + 1)) / soft_band_num;
+	}
+
+	if (soft_band_num > 1) {
+		LWP_MutexLock(soft_lock);
+		soft_pending = soft_band_num - 1;
+		soft_gen++;
+		LWP_CondBroadcast(soft_start);
+		LWP_MutexUnlock(soft_lock);
+	}
+	soft_RenderBand(soft_bands[0]);
+	if (soft_band_num > 1) {
+		LWP_MutexLock(soft_lock);
+		while (soft_pending) {
+			LWP_CondWait(soft_done, soft_lock);
+		}
+		LWP_MutexUnlock(soft_lock);
+	}
+
+	for (u32 i = 0; i < soft_band_num; ++i) {
+		soft_band *b = soft_bands[i];
+		for (u32 j = 0; j < VDP2SOFT_LAYER_NUM; ++j) {
+			soft_stats.pixels[j] += b->pixels[j];
+			soft_stats.ticks[j] += b->ticks[j];
+			b->pixels[j] = 0;
+			b->ticks[j] = 0;
+		}
+	}
+	soft_stats.frames++;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+const u32 *vdp2soft_GetFrame(u32 *width, u32 *height)
+{
+	*width = soft_w;
+	*height = soft_h;
+	return soft_frame;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+u32 vdp2soft_Hash(void)
+{
+	u32 hash = 2166136261u;
+
+	if (soft_frame == NULL) {
+		return 0;
+	}
+	for (u32 y = 0; y < soft_h; ++y) {
+		const u32 *row = soft_frame + y * VDP2SOFT_MAX_W;
+		for (u32 x = 0; x < soft_w; ++x) {
+			for (u32 k = 0; k < 24; k += 8) {
+				hash = (hash ^ ((row[x] >> k) & 0xFF)) * 16777619u;
+			}
+		}
+	}
+	return hash;
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void vdp2soft_GetStats(vdp2soft_stats *stats)
+{
+	*stats = soft_stats;
+}
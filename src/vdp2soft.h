@@ -0,0 +1,47 @@
+#ifndef __VDP2SOFT_H__
+#define __VDP2SOFT_H__
+
+/*
+ * vdp2soft.h
+ *--------------------
+ * Software VDP2 compositor, renders the background screens on the CPU
+ */
+
+#include "core.h"
+
+#define VDP2SOFT_MAX_W			704
+#define VDP2SOFT_MAX_H			256
+#define VDP2SOFT_MAX_BANDS		8
+
+//Stats slots, the screens in BGON order and then the final composition
+#define VDP2SOFT_NBG0			0
+#define VDP2SOFT_NBG1			1
+#define VDP2SOFT_NBG2			2
+#define VDP2SOFT_NBG3			3
+#define VDP2SOFT_RBG0			4
+#define VDP2SOFT_COMPOSE		5
+#define VDP2SOFT_LAYER_NUM		6
+
+//Running totals since vdp2soft_Init
+typedef struct {
+	u32 frames;
+	u64 pixels[VDP2SOFT_LAYER_NUM];		//Pixels produced by each layer
+	u64 ticks[VDP2SOFT_LAYER_NUM];		//Time spent in each layer, summed over bands
+} vdp2soft_stats;
+
+//Splits the frame in bands scanline bands, all but the first one rendered by
+//worker threads. Returns -1 when the frame buffer can't be allocated.
+int vdp2soft_Init(u32 bands);
+void vdp2soft_DeInit(void);
+//Renders the screens as the registers and VDP2 RAM stand, does nothing
+//before vdp2soft_Init
+void vdp2soft_Render(void);
+
+//0xRRGGBB pixels, VDP2SOFT_MAX_W pixels per row
+const u32 *vdp2soft_GetFrame(u32 *width, u32 *height);
+//FNV-1a of the visible part of the last frame
+u32 vdp2soft_Hash(void);
+void vdp2soft_GetStats(vdp2soft_stats *stats);
+
+
+#endif /*__VDP2SOFT_H__*/
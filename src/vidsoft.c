@@ -26,6 +26,8 @@
 #include "debug.h"
 #include "vdp1.h"
 #include "vdp2.h"
+#include "vdp2list.h"
+#include "vdp1batch.h"
 #include "osd/osd.h"
 
 #ifdef HAVE_LIBGL
@@ -154,7 +156,7 @@ GXTlutObj tlut_obj;
 //vram clone for converted textures
 //Double VRAM because of tiles
 u8 *wii_vram;
-u32 tex_dirty[0x200];
+vdp1cmd_struct cmd;
 
 //Vdp1 Framebuffer copy for vpd2
 //u32 display_fb[640 * 480] ATTRIBUTE_ALIGN(32);
@@ -177,10 +179,10 @@ typedef struct
 
 //////////////////////////////////////////////////////////////////////////////
 //Converts saturn bitmap 4bpp textures
-static void wii_sat2tex4bpp(u32 addr, u32 w, u32 h)
+static void wii_sat2tex4bpp(u8 *dst, u32 addr, u32 w, u32 h)
 {
 	w >>= 3;
-	volatile f32 *tmem = (f32*) GX_RedirectWriteGatherPipe(wii_vram + addr);
+	volatile f32 *tmem = (f32*) GX_RedirectWriteGatherPipe(dst);
 	f32 *src0 = (f32*) (Vdp1Ram + addr);
 	f32 *src1 = src0 + w;
 	f32 *src2 = src1 + w;
@@ -210,10 +212,10 @@ static void wii_sat2tex4bpp(u32 addr, u32 w, u32 h)
 
 
 //Converts saturn bitmap 16bpp textures
-static void wii_sat2texRGBA(u32 addr, u32 w, u32 h)
+static void wii_sat2texRGBA(u8 *dst, u32 addr, u32 w, u32 h)
 {
 	w >>= 2;
-	volatile f64 *tmem = (f64*) GX_RedirectWriteGatherPipe(wii_vram + addr);
+	volatile f64 *tmem = (f64*) GX_RedirectWriteGatherPipe(dst);
 	f64 *src0 = (f64*) (Vdp1Ram + addr);
 	f64 *src1 = src0 + w;
 	f64 *src2 = src1 + w;
@@ -238,6 +240,258 @@ static void wii_sat2texRGBA(u32 addr, u32 w, u32 h)
 }
 
 
+//////////////////////////////////////////////////////////////////////////////
+//VDP1 texture cache
+//Sprites are converted once to GX tiles in wii_vram and drawn from there for
+//as long as none of the VDP1 RAM pages they were read from is written again.
+//Entries are keyed by CMDSRCA, CMDSIZE and texel format, the color bank is
+//applied through the tlut when drawing so it doesn't take part in the key.
+
+#define TEXC_ENTRIES		1024
+#define TEXC_HASH_SIZE		1024
+#define TEXC_NONE			0xFFFF
+#define TEXC_POOL_SIZE		0x80000
+
+#define TEXC_FMT_4BPP		0
+#define TEXC_FMT_8BPP		1
+#define TEXC_FMT_16BPP		2
+
+typedef struct {
+	u32 key;			//CMDSRCA << 16 | CMDSIZE << 2 | format
+	u32 ofs;			//Offset in wii_vram
+	u32 size;
+	u32 gen;			//texc_clock when converted
+	u32 last_use;		//texc_frame when last drawn
+	u16 page_first;
+	u16 page_last;
+	u16 hash_next;
+	u16 lru_prev;		//Towards the most recently used
+	u16 lru_next;
+	u16 order;			//Position in texc_order
+} texc_entry;
+
+static texc_entry texc[TEXC_ENTRIES];
+static u16 texc_hash[TEXC_HASH_SIZE];
+static u16 texc_order[TEXC_ENTRIES];	//Live entries sorted by ofs
+static u32 texc_live;
+static u16 texc_free;
+static u16 texc_lru_head;
+static u16 texc_lru_tail;
+static u32 texc_page_gen[VRAM_DIRTY_PAGES];
+static u32 texc_clock;
+static u32 texc_frame;
+static vdp1_texcache_stats texc_stats;
+
+
+static INLINE u32 texc_Hash(u32 key)
+{
+	return ((key >> 16) ^ (key >> 2) ^ (key >> 13)) & (TEXC_HASH_SIZE - 1);
+}
+
+static void texc_Reset(void)
+{
+	memset(texc_hash, 0xFF, sizeof(texc_hash));
+	memset(texc_page_gen, 0, sizeof(texc_page_gen));
+	for (u32 i = 0; i < TEXC_ENTRIES; ++i) {
+		texc[i].hash_next = (i + 1 < TEXC_ENTRIES) ? i + 1 : TEXC_NONE;
+	}
+	texc_free = 0;
+	texc_live = 0;
+	texc_lru_head = texc_lru_tail = TEXC_NONE;
+	texc_clock = 0;
+	memset(&texc_stats, 0, sizeof(texc_stats));
+}
+
+static void texc_LruUnlink(u32 i)
+{
+	texc_entry *e = &texc[i];
+	if (e->lru_prev != TEXC_NONE) {
+		texc[e->lru_prev].lru_next = e->lru_next;
+	} else {
+		texc_lru_head = e->lru_next;
+	}
+	if (e->lru_next != TEXC_NONE) {
+		texc[e->lru_next].lru_prev = e->lru_prev;
+	} else {
+		texc_lru_tail = e->lru_prev;
+	}
+}
+
+static void texc_LruPush(u32 i)
+{
+	texc[i].lru_prev = TEXC_NONE;
+	texc[i].lru_next = texc_lru_head;
+	if (texc_lru_head != TEXC_NONE) {
+		texc[texc_lru_head].lru_prev = i;
+	} else {
+		texc_lru_tail = i;
+	}
+	texc_lru_head = i;
+}
+
+static void texc_Evict(u32 i)
+{
+	texc_entry *e = &texc[i];
+	u16 *link = &texc_hash[texc_Hash(e->key)];
+	while (*link != i) {
+		link = &texc[*link].hash_next;
+	}
+	*link = e->hash_next;
+	texc_LruUnlink(i);
+
+	texc_live--;
+	for (u32 o = e->order; o < texc_live; ++o) {
+		texc_order[o] = texc_order[o + 1];
+		texc[texc_order[o]].order = o;
+	}
+	e->hash_next = texc_free;
+	texc_free = i;
+	texc_stats.evicted++;
+}
+
+//First fit in wii_vram. Least recently used entries are dropped until the
+//texture fits, but never the ones drawn this frame as the GPU may still read
+//them. Returns the slot to insert at in texc_order or ~0.
+static u32 texc_Alloc(u32 size, u32 *ofs)
+{
+	for (;;) {
+		u32 end = 0;
+		for (u32 o = 0; o <= texc_live; ++o) {
+			u32 next = (o < texc_live) ? texc[texc_order[o]].ofs : TEXC_POOL_SIZE;
+			if (next - end >= size) {
+				*ofs = end;
+				return o;
+			}
+			if (o < texc_live) {
+				end = texc[texc_order[o]].ofs + texc[texc_order[o]].size;
+			}
+		}
+		if (texc_lru_tail == TEXC_NONE || texc[texc_lru_tail].last_use == texc_frame) {
+			return ~0;
+		}
+		texc_Evict(texc_lru_tail);
+	}
+}
+
+//Called once per VDP1 frame, turns the pages written since the last one into
+//a new generation
+static void texc_BeginFrame(void)
+{
+	u32 gen = texc_clock + 1;
+	for (u32 i = 0; i < VRAM_DIRTY_PAGES; ++i) {
+		if (vdp1_ram_dirty[i] & VRAM_DIRTY_TEXC) {
+			vdp1_ram_dirty[i] &= ~VRAM_DIRTY_TEXC;
+			texc_page_gen[i] = gen;
+			texc_clock = gen;
+		}
+	}
+	texc_frame++;
+}
+
+static u32 texc_Valid(const texc_entry *e)
+{
+	for (u32 p = e->page_first; p <= e->page_last; ++p) {
+		if (texc_page_gen[p] > e->gen) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void texc_Convert(u8 *dst, u32 src, u32 fmt, u32 w, u32 h)
+{
+	switch (fmt) {
+		case TEXC_FMT_4BPP:  wii_sat2tex4bpp(dst, src, w, h); break;
+		case TEXC_FMT_8BPP:  wii_sat2texRGBA(dst, src, w >> 1, h); break;
+		case TEXC_FMT_16BPP: wii_sat2texRGBA(dst, src, w, h); break;
+	}
+}
+
+//Returns the converted texture for the current command or NULL when it
+//can't be cached and has to be read from VDP1 RAM
+static u8 *texc_Get(u32 fmt)
+{
+	u32 src = ((u32) cmd.CMDSRCA << 3) & 0x7FFF8;
+	u32 w = (cmd.CMDSIZE & 0x3F00) >> 5;
+	u32 h = ((cmd.CMDSIZE & 0xFF) + 7) & ~7;
+	u32 size = ((w * h) << fmt) >> 1;
+	if (!size || src + size > 0x80000) {
+		return NULL;
+	}
+
+	u32 key = ((u32) cmd.CMDSRCA << 16) | ((cmd.CMDSIZE & 0x3FFF) << 2) | fmt;
+	u16 *bucket = &texc_hash[texc_Hash(key)];
+	u32 i = *bucket;
+	while (i != TEXC_NONE && texc[i].key != key) {
+		i = texc[i].hash_next;
+	}
+
+	if (i != TEXC_NONE) {
+		texc_entry *e = &texc[i];
+		if (e->last_use != texc_frame) {
+			texc_LruUnlink(i);
+			texc_LruPush(i);
+			e->last_use = texc_frame;
+		}
+		if (e->gen == texc_clock || texc_Valid(e)) {
+			e->gen = texc_clock;
+			texc_stats.hits++;
+			return wii_vram + e->ofs;
+		}
+		//Same key and size, converted again in place
+		texc_stats.stale++;
+	} else {
+		u32 ofs;
+		if (texc_free == TEXC_NONE) {
+			if (texc[texc_lru_tail].last_use == texc_frame) {
+				texc_stats.failed++;
+				return NULL;
+			}
+			texc_Evict(texc_lru_tail);
+		}
+		u32 o = texc_Alloc(size, &ofs);
+		if (o == ~0u) {
+			texc_stats.failed++;
+			return NULL;
+		}
+		i = texc_free;
+		texc_free = texc[i].hash_next;
+
+		texc_entry *e = &texc[i];
+		e->key = key;
+		e->ofs = ofs;
+		e->size = size;
+		e->page_first = src >> VRAM_DIRTY_SHIFT;
+		e->page_last = (src + size - 1) >> VRAM_DIRTY_SHIFT;
+		e->last_use = texc_frame;
+		e->hash_next = *bucket;
+		*bucket = i;
+		texc_LruPush(i);
+		for (u32 n = texc_live; n > o; --n) {
+			texc_order[n] = texc_order[n - 1];
+			texc[texc_order[n]].order = n;
+		}
+		texc_order[o] = i;
+		e->order = o;
+		texc_live++;
+		texc_stats.misses++;
+	}
+
+	texc_entry *e = &texc[i];
+	texc_Convert(wii_vram + e->ofs, src, fmt, w, h);
+	e->gen = texc_clock;
+	texc_stats.converted += size;
+	//The GX texture cache may still hold what was there before
+	SGX_InvalidateVRAM();
+	return wii_vram + e->ofs;
+}
+
+void VIDSoftGetTexCacheStats(vdp1_texcache_stats *stats)
+{
+	*stats = texc_stats;
+}
+
+
 //////////////////////////////////////////////////////////////////////////////
 
 //HALF-DONE
@@ -1014,25 +1268,10 @@ static void FASTCALL gfx_DrawBitmap(vdp2draw_struct *info)
 }
 
 
-//Draws NBG2 and NBG3 scroll screen using GX quads
-static void FASTCALL gfx_DrawScroll(vdp2draw_struct *info)
+//Emits the quads of the cells of a scroll screen, the GX state and the
+//position matrix are already set
+static void gfx_EmitScroll(vdp2draw_struct *info, screeninfo_struct *sinfo, u32 trn_code, u32 block_size)
 {
-	screeninfo_struct sinfo;
-
-	//Dont draw if increments are zero
-	if (info->coordincy == 0.0 || info->coordincy == 0.0) {
-		return;
-	}
-
-	SetupScreenVars(info, &sinfo, info->PlaneAddr);
-
-	gfx_DrawWindowTex(info->wctl, (info->priority << 4) + info->prioffs);
-
-	GX_SetVtxDesc(GX_VA_POS,  GX_DIRECT);
-	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
-	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-
-	//XXX: ADD WINDOW SUPPORT (Just draw window and use Z-compare)
 	const u32 pagesize_bits = info->pagewh_bits << 1;
 	const u32 cellwh = (3 + info->patternwh_bits);
 	const u32 inc_xy = 8 << info->patternwh_bits;
@@ -1040,50 +1279,17 @@ static void FASTCALL gfx_DrawScroll(vdp2draw_struct *info)
 	const u32 pix_h = (disp.h + inc_xy) * info->coordincy;
 	const u32 pix_w = (disp.w + inc_xy) * info->coordincx;
 
-	GX_SetScissor(0, 0, disp.w, disp.h);
-	GX_SetNumTevStages(1);
-	GX_SetTevAlphaOp(GX_TEVSTAGE0, GX_TEV_COMP_A8_GT, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
-	GX_SetTevAlphaIn(GX_TEVSTAGE0, GX_CA_TEXA, GX_CA_ZERO, GX_CA_KONST, GX_CA_ZERO);
-	GX_SetTevKAlphaSel(GX_TEVSTAGE0, GX_TEV_KASEL_K0_A);
-
-	u32 block_size = 32 << (info->patternwh_bits * 2);
-	//XXX: hack, should use other TLUT instead with transparent 0 bit
-	u32 trn_code = info->transparencyenable << 7;
-	GX_SetTexCoordScaleManually(GX_TEXCOORD0, GX_TRUE, inc_xy, inc_xy);
-	if (info->colornumber) {
-		//Only change format...
-		//GX_InitTexObjCI(&tobj_ci, Vdp2Ram, inc_xy, inc_xy, GX_TF_CI8, GX_CLAMP, GX_CLAMP, GX_FALSE, 0);
-		SGX_BeginVdp2Scroll(GX_TF_CI8, inc_xy);
-		trn_code <<= 1;
-		block_size <<= 1;
-		SGX_CellConverterSet(info->patternwh_bits, SPRITE_8BPP);
-	} else {
-		//GX_InitTexObjCI(&tobj_ci, Vdp2Ram, inc_xy, inc_xy, GX_TF_CI4, GX_CLAMP, GX_CLAMP, GX_FALSE, 0);
-		SGX_BeginVdp2Scroll(GX_TF_CI4, inc_xy);
-	}
-	//GX_InitTexObjFilterMode(&tobj_ci, GX_NEAR, GX_NEAR);
-
-	mat[GXMTX_VDP2_BG][0][0] = 1.0 / info->coordincx;
-	mat[GXMTX_VDP2_BG][1][1] = 1.0 / info->coordincy;
-	mat[GXMTX_VDP2_BG][0][3] = -((f32) (info->x & mask_xy));
-	mat[GXMTX_VDP2_BG][1][3] = -((f32) (info->y & mask_xy));
-	GX_LoadPosMtxImm(mat[GXMTX_VDP2_BG], GXMTX_VDP2_BG);
-	GX_SetCurrentMtx(GXMTX_VDP2_BG);
-
-	SGX_SetZOffset((info->priority << 4) + info->prioffs);
-
-	u32 blankchar = 0xffffffff;
 	u32 y = info->y & ~mask_xy;
 	GXColor konst = {0, 0, 0, 0};
 
 	for (s32 j = 0; j < pix_h; j += inc_xy, y += inc_xy) {
-		y &= sinfo.ymask;
+		y &= sinfo->ymask;
 		//XXX: this should be mostly useless
 		u32 x = info->x & ~mask_xy;
 		info->LoadLineParams(info, j);
 		//u8 line_alpha = (info->enable ? 0xFF : 0x00);	//This goes in the clipping window values
 		for (s32 i = 0; i < pix_w; i += inc_xy, x += inc_xy) {
-			x &= sinfo.xmask;
+			x &= sinfo->xmask;
 			//u8 alpha = line_alpha;
 
 
@@ -1091,27 +1297,31 @@ static void FASTCALL gfx_DrawScroll(vdp2draw_struct *info)
 			//XXX: Per-Pixel Priority still not implemented
 			//XXX: Alpha Still not implemented
 			// Calculate which plane we're dealing with
-			u32 planenum = ((y >> sinfo.planepixelheight_bits) * info->mapwh) + (x >> sinfo.planepixelwidth_bits);
+			u32 planenum = ((y >> sinfo->planepixelheight_bits) * info->mapwh) + (x >> sinfo->planepixelwidth_bits);
 			//XXX: useless?
-			u32 x0 = x & sinfo.planepixelwidth_mask;
-			u32 y0 = y & sinfo.planepixelheight_mask;
+			u32 x0 = x & sinfo->planepixelwidth_mask;
+			u32 y0 = y & sinfo->planepixelheight_mask;
 
 			// Fetch and decode pattern name data
-			info->addr = sinfo.planetbl[planenum];
+			info->addr = sinfo->planetbl[planenum];
 
 			// Figure out which page it's on(if plane size is not 1x1)
-			info->addr += ((  ((y0 >> sinfo.pagepixelwh_bits) << pagesize_bits) << info->planew_bits) +
-							(   (x0 >> sinfo.pagepixelwh_bits) << pagesize_bits) +
-							(((y0 & sinfo.pagepixelwh_mask) >> cellwh) << info->pagewh_bits) +
-							((x0 & sinfo.pagepixelwh_mask) >> cellwh)) << (info->patterndatasize_bits+1);
+			info->addr += ((  ((y0 >> sinfo->pagepixelwh_bits) << pagesize_bits) << info->planew_bits) +
+							(   (x0 >> sinfo->pagepixelwh_bits) << pagesize_bits) +
+							(((y0 & sinfo->pagepixelwh_mask) >> cellwh) << info->pagewh_bits) +
+							((x0 & sinfo->pagepixelwh_mask) >> cellwh)) << (info->patterndatasize_bits+1);
+			vdp2list_Page(info->addr, 2 << info->patterndatasize_bits);
 			//XXX: Optimize this function
 			Vdp2PatternAddr(info);
 
 
 			//test if the char address is a blank tile
 			//XXX: make this better
-			if (trn_code && memIsZeroTest((u32*) (Vdp2Ram + info->charaddr), block_size)) {
-				continue;
+			if (trn_code) {
+				vdp2list_Page(info->charaddr, block_size);
+				if (memIsZeroTest((u32*) (Vdp2Ram + info->charaddr), block_size)) {
+					continue;
+				}
 			}
 			SGX_SetZOffset((info->priority << 4) + info->prioffs);
 
@@ -1155,6 +1365,72 @@ static void FASTCALL gfx_DrawScroll(vdp2draw_struct *info)
 			GX_End();
 		}
 	}
+}
+
+
+//Draws NBG2 and NBG3 scroll screen using GX quads, the quads are recorded in
+//a display list of the layer and called again while the screen is unchanged
+static void FASTCALL gfx_DrawScroll(vdp2draw_struct *info, u32 layer)
+{
+	screeninfo_struct sinfo;
+
+	//Dont draw if increments are zero
+	if (info->coordincy == 0.0 || info->coordincy == 0.0) {
+		return;
+	}
+
+	SetupScreenVars(info, &sinfo, info->PlaneAddr);
+
+	gfx_DrawWindowTex(info->wctl, (info->priority << 4) + info->prioffs);
+
+	GX_SetVtxDesc(GX_VA_POS,  GX_DIRECT);
+	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+
+	//XXX: ADD WINDOW SUPPORT (Just draw window and use Z-compare)
+	const u32 inc_xy = 8 << info->patternwh_bits;
+	const u32 mask_xy = (8 << info->patternwh_bits) - 1;
+
+	GX_SetScissor(0, 0, disp.w, disp.h);
+	GX_SetNumTevStages(1);
+	GX_SetTevAlphaOp(GX_TEVSTAGE0, GX_TEV_COMP_A8_GT, GX_TB_ZERO, GX_CS_SCALE_1, GX_TRUE, GX_TEVPREV);
+	GX_SetTevAlphaIn(GX_TEVSTAGE0, GX_CA_TEXA, GX_CA_ZERO, GX_CA_KONST, GX_CA_ZERO);
+	GX_SetTevKAlphaSel(GX_TEVSTAGE0, GX_TEV_KASEL_K0_A);
+
+	u32 block_size = 32 << (info->patternwh_bits * 2);
+	//XXX: hack, should use other TLUT instead with transparent 0 bit
+	u32 trn_code = info->transparencyenable << 7;
+	GX_SetTexCoordScaleManually(GX_TEXCOORD0, GX_TRUE, inc_xy, inc_xy);
+	if (info->colornumber) {
+		//Only change format...
+		//GX_InitTexObjCI(&tobj_ci, Vdp2Ram, inc_xy, inc_xy, GX_TF_CI8, GX_CLAMP, GX_CLAMP, GX_FALSE, 0);
+		SGX_BeginVdp2Scroll(GX_TF_CI8, inc_xy);
+		trn_code <<= 1;
+		block_size <<= 1;
+		SGX_CellConverterSet(info->patternwh_bits, SPRITE_8BPP);
+	} else {
+		//GX_InitTexObjCI(&tobj_ci, Vdp2Ram, inc_xy, inc_xy, GX_TF_CI4, GX_CLAMP, GX_CLAMP, GX_FALSE, 0);
+		SGX_BeginVdp2Scroll(GX_TF_CI4, inc_xy);
+	}
+	//GX_InitTexObjFilterMode(&tobj_ci, GX_NEAR, GX_NEAR);
+
+	mat[GXMTX_VDP2_BG][0][0] = 1.0 / info->coordincx;
+	mat[GXMTX_VDP2_BG][1][1] = 1.0 / info->coordincy;
+	mat[GXMTX_VDP2_BG][0][3] = -((f32) (info->x & mask_xy));
+	mat[GXMTX_VDP2_BG][1][3] = -((f32) (info->y & mask_xy));
+	GX_LoadPosMtxImm(mat[GXMTX_VDP2_BG], GXMTX_VDP2_BG);
+	GX_SetCurrentMtx(GXMTX_VDP2_BG);
+
+	SGX_SetZOffset((info->priority << 4) + info->prioffs);
+
+	u32 key = vdp2list_Key(info, sinfo.planetbl, disp.w, disp.h);
+	if (!vdp2list_Call(layer, key)) {
+		u32 rec = vdp2list_Record(layer, key);
+		gfx_EmitScroll(info, &sinfo, trn_code, block_size);
+		if (rec && !vdp2list_End()) {
+			gfx_EmitScroll(info, &sinfo, trn_code, block_size);
+		}
+	}
 
 	SGX_SpriteConverterSet(1, SPRITE_4BPP, 0);
 	GX_SetTexCoordScaleManually(GX_TEXCOORD0, GX_FALSE, 1, 1);
@@ -1724,7 +2000,7 @@ static void Vdp2DrawNBG0(void)
 		if (info.isbitmap) {
 			gfx_DrawBitmap(&info);
 		} else {
-			gfx_DrawScroll(&info);
+			gfx_DrawScroll(&info, VDP2LIST_NBG0);
 		}
 	}
 	else {
@@ -1841,7 +2117,7 @@ static void Vdp2DrawNBG1(void)
 	info.LoadLineParams = (void (*)(void *, u32)) LoadLineParamsNBG1;
 
 	//XXX: Not implemented yet
-	gfx_DrawScroll(&info);
+	gfx_DrawScroll(&info, VDP2LIST_NBG1);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1917,7 +2193,7 @@ static void Vdp2DrawNBG2(void)
 
 	info.LoadLineParams = (void (*)(void *, u32)) LoadLineParamsNBG2;
 
-	gfx_DrawScroll(&info);
+	gfx_DrawScroll(&info, VDP2LIST_NBG2);
 	/*
 	Vdp2DrawScrollSimple(&info, bg_tex[2], bg_alpha_tex[2], win_tex);
 	//XXX: This must be stored to make the rendering more accurate
@@ -2006,7 +2282,7 @@ static void Vdp2DrawNBG3(void)
 	info.isbitmap = 0;
 
 	info.LoadLineParams = (void (*)(void *, u32)) LoadLineParamsNBG3;
-		gfx_DrawScroll(&info);
+		gfx_DrawScroll(&info, VDP2LIST_NBG3);
 	/*
 	Vdp2DrawScrollSimple(&info, bg_tex[3], bg_alpha_tex[2], win_tex);
 	//XXX: This must be stored to make the rendering more accurate
@@ -2181,7 +2457,7 @@ int VIDSoftInit(void)
 	//GX_LoadPosMtxIdx(0, GX_PNMTX0);
 	GX_LoadPosMtxImm(mat[GXMTX_IDENTITY], GXMTX_IDENTITY);
 	GX_SetCurrentMtx(GXMTX_IDENTITY);
-	memset(tex_dirty, 0, 0x200 << 2);
+	texc_Reset();
 
 	// //GX_InitTexObj(&tex_obj_bg[2], bg_tex[2], 1, 1, GX_TF_CI4, GX_CLAMP, GX_CLAMP, GX_FALSE);
 	GX_InitTexObjLOD(&tex_obj_bg[2], GX_NEAR, GX_NEAR, 0, 0, 0, GX_DISABLE, GX_DISABLE, GX_ANISO_1);
@@ -2208,6 +2484,8 @@ int VIDSoftInit(void)
 
 	if ((win_tex = (u8 *)memalign(32, 704 * 512 * sizeof(u16))) == NULL)
       return -1;
+	//Without display lists the screens are still drawn immediately
+	vdp2list_Init();
 
 
    vdp1backframebuffer = vdp1framebuffer[0];
@@ -2231,6 +2509,7 @@ int VIDSoftInit(void)
 void VIDSoftDeInit(void)
 {
 	free(win_tex);
+	vdp2list_DeInit();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2252,16 +2531,15 @@ u8 colorcalc_arr[8];
 
 void VIDSoftVdp1DrawStart(void)
 {
-	u32 bit0 = Vdp1Regs->TVMR & 1;
-	u32 bit1 = (Vdp1Regs->TVMR >> 1) & 1;
+	u32 width, height;
 	vdp1interlace = (Vdp1Regs->FBCR >> 3) & 1;
-	// Rotation 8-bit, Unused, will make standard
-	vdp1width = 512 << (bit1 & bit0);
-	vdp1height = 512 >> (bit1 | (bit0 ^ 1));
-	vdp1pixelsize = 2 - bit0;
+	vdp1pixelsize = vdp1_GetFrameSize(&width, &height);
+	vdp1width = width;
+	vdp1height = height;
 
 	//XXX: Useless??
 	VIDSoftVdp1EraseFrameBuffer();
+	texc_BeginFrame();
 
 	//GX_LoadPosMtxIdx(0, GX_PNMTX0);
 	//Load vdp1 matrix... should we clear the values?
@@ -2291,6 +2569,7 @@ void VIDSoftVdp1DrawStart(void)
 	GX_SetBlendMode(GX_BM_BLEND, GX_BL_SRCALPHA, GX_BL_INVSRCALPHA, GX_LO_CLEAR);
 
 	SGX_BeginVdp1();
+	vdp1batch_Begin();
 	//XXX: we can make this faster
 	priority_arr[0] = (Vdp2Regs->PRISA & 0x7) << 4;
 	priority_arr[1] = ((Vdp2Regs->PRISA >> 8) & 0x7) << 4;
@@ -2317,12 +2596,11 @@ void VIDSoftVdp1DrawStart(void)
 
 void VIDSoftVdp1DrawEnd(void)
 {
+	vdp1batch_Flush();
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-vdp1cmd_struct cmd;
-
 
 static void getGouraudColors(u32 *c)
 {
@@ -2352,43 +2630,22 @@ static void vid_ExtendPolygon(s16 ax, s16 ay, s16 *bx, s16 *by)
 
 
 
+//Converts the texture of the command at ram_addr ahead of drawing it
 void VidSoftTexConvert(u32 ram_addr)
 {
-	//Address to valid vdp1 RAM range
-	//XXX: This function is too much for now, but maybe its useful for other things
 	Vdp1ReadCommand(&cmd, ram_addr);
-	u32 char_addr = (((u32) cmd.CMDSRCA) << 3) & 0x7FFE0;
-	//u32 color_lut = (cmd.CMDCOLR << 3) & 0x7FFE0;
-	u32 spr_w = ((cmd.CMDSIZE & 0x3F00) >> 5);
-	//XXX: Is this right?
-	u32 spr_h = (cmd.CMDSIZE & 0xFF);// + (cmd.CMDSIZE & 0x7 ? 0x8 : 0x0);
-	//u32 is_solid = cmd.CMDPMOD & 0x40;
-
-	u32 bit_tex = 1 << ((char_addr >> 5) & 0x1F);
-	//u32 bit_clr = 1 << ((color_lut >> 5) & 0x1F);
-	u32 dirty_tex = char_addr >> 10;
-	//u32 dirty_clr = color_lut >> 10;
-	if (!spr_w || !spr_h) {
-		return;
-	}
-	if (tex_dirty[dirty_tex] & bit_tex) {
-		return;
-	}
-	tex_dirty[dirty_tex] |= bit_tex;
-
-
 	switch ((cmd.CMDPMOD >> 3) & 0x7) {
-		case 0: // Colorbank 4-bit		RED
-		case 1: // LUT 4-bit 			Green
-			wii_sat2tex4bpp(char_addr, spr_w, spr_h);
+		case 0: // Colorbank 4-bit
+		case 1: // LUT 4-bit
+			texc_Get(TEXC_FMT_4BPP);
 			break;
-		case 2: // Colorbank 8-bit (6)	BLUE
-		case 3: // Colorbank 8-bit (7)	MAGENTA
-		case 4: // Colorbank 8-bit (8)	CYAN
-			wii_sat2texRGBA(char_addr, spr_w >> 1, spr_h);
+		case 2: // Colorbank 6-bit
+		case 3: // Colorbank 7-bit
+		case 4: // Colorbank 8-bit
+			texc_Get(TEXC_FMT_8BPP);
 			break;
-		case 5: // RGB					WHITE
-			wii_sat2texRGBA(char_addr, spr_w, spr_h);
+		case 5: // RGB
+			texc_Get(TEXC_FMT_16BPP);
 			break;
 	}
 }
@@ -2416,7 +2673,32 @@ static void Tev_SetTexturedPart(void)
 	GX_SetTevAlphaIn(GX_TEVSTAGE0, GX_CA_TEXA, GX_CA_ZERO, GX_CA_KONST, GX_CA_ZERO);
 }
 
-static u32 modeToColor(void)
+#define VID_TLUT_NONE	0
+#define VID_TLUT_CRAM	1		//Colour bank, from the CRAM tluts
+#define VID_TLUT_LUT	2		//16 colour table in VDP1 RAM
+
+//GX state a VDP1 primitive is drawn with. Primitives with the same state are
+//batched, so everything set between GX_Begin calls has to be in here.
+typedef struct {
+	u32 textured;
+	u32 kasel;
+	u32 konst;				//Colour of untextured primitives
+	u32 zofs;
+	u8 *tex;				//NULL keeps the texture of the last sprite
+	u32 fmt;
+	u32 w, h;
+	u32 tlut_mode;
+	u32 tlut_pos;
+	u32 tlut_trn;
+	u32 tlut_size;
+	u32 conv_w;
+	u32 conv_bpp;
+	u32 conv_align;
+} vid_vdp1state;
+
+//Fills the texture part of the state of the current command, returns the
+//vertex colour or 0 when the colour mode has no texture
+static u32 vid_TexState(vid_vdp1state *st)
 {
 	//Address to valid vdp1 RAM range
 	u8 *chr_addr = Vdp1Ram + ((cmd.CMDSRCA & 0xFFFC) << 3);
@@ -2430,94 +2712,139 @@ static u32 modeToColor(void)
 	if ((tex_mode != 1) && (tex_mode != 5)) {
 		Vdp1GetSpritePixelInfo(Vdp2Regs->SPCTL & 0xF, &cmd.CMDCOLR, &spi);
 	}
-	//Set priority
-	SGX_SetZOffset(priority_arr[spi.priority] + 14);
 	//Check transparent code
 	u32 trn_code = ((cmd.CMDPMOD & 0x40) ^ 0x40) << 1;
 	u32 tlut_pos = cmd.CMDCOLR + ((Vdp2Regs->CRAOFB << 4) & 0x700);
 
-	//XXX: this can be optimized
+	//Sprites already converted to tiles are read without the indirect stage
+	u8 *tex;
 	switch (tex_mode) {
 		case 0: // Colorbank 4-bit
-			SGX_TlutLoadCRAMImm(tlut_pos & 0x7F0, trn_code, GX_TLUT_16);
-			//Change address and size
-			SGX_SetTex(chr_addr, GX_TF_CI4, spr_w, spr_h, TLUT_INDX_IMM4);
-			SGX_SpriteConverterSet(spr_w >> 3, SPRITE_4BPP, cmd.CMDSRCA & 3);
-			return 0x7f7f7f00; break;
 		case 1: // LUT 4-bit
-			u32 colorlut = (cmd.CMDCOLR << 3) & 0x7FFFF;
-			//Upload palette
-			//XXX: palette uploading should be done once per frame (for color bank, the other will be done per sprite)
-			if (trn_code) {
-				u32 *pal = MEM_K0_TO_K1(Vdp1Ram + colorlut);
-				*pal &= 0xFFFFu;
-			}
-			GX_InitTlutObj(&tlut_obj, Vdp1Ram + colorlut, GX_TL_RGB5A3, 16);
-			GX_LoadTlut(&tlut_obj, TLUT_INDX_IMM4);
-			//Change address and size
-			SGX_SetTex(chr_addr, GX_TF_CI4, spr_w, spr_h, TLUT_INDX_IMM4);
-			SGX_SpriteConverterSet(spr_w >> 3, SPRITE_4BPP, cmd.CMDSRCA & 3);
-			return 0x7f7f7f00; break;
+			tex = texc_Get(TEXC_FMT_4BPP);
+			break;
+		case 2: // Colorbank 6-bit
+		case 3: // Colorbank 7-bit
+		case 4: // Colorbank 8-bit
+			tex = texc_Get(TEXC_FMT_8BPP);
+			break;
+		case 5: // RGB
+			tex = texc_Get(TEXC_FMT_16BPP);
+			break;
+		default:
+			tex = NULL;
+			break;
+	}
+	if (tex) {
+		chr_addr = tex;
+		spr_h = ((cmd.CMDSIZE & 0xFF) + 7) & ~7;
+	}
+
+	st->textured = 1;
+	st->zofs = priority_arr[spi.priority] + 14;
+	st->w = spr_w;
+	st->h = spr_h;
+	st->conv_w = tex ? 0 : spr_w >> 3;
+	st->conv_align = cmd.CMDSRCA & 3;
+	switch (tex_mode) {
+		case 0: // Colorbank 4-bit
+			st->tlut_mode = VID_TLUT_CRAM;
+			st->tlut_pos = tlut_pos & 0x7F0;
+			st->tlut_trn = trn_code;
+			st->tlut_size = GX_TLUT_16;
+			st->tex = chr_addr;
+			st->fmt = GX_TF_CI4;
+			st->conv_bpp = SPRITE_4BPP;
+			return 0x7f7f7f00;
+		case 1: // LUT 4-bit
+			st->tlut_mode = VID_TLUT_LUT;
+			st->tlut_pos = (cmd.CMDCOLR << 3) & 0x7FFFF;
+			st->tlut_trn = trn_code;
+			st->tex = chr_addr;
+			st->fmt = GX_TF_CI4;
+			st->conv_bpp = SPRITE_4BPP;
+			return 0x7f7f7f00;
 		case 2: // Colorbank 6-bit
 		case 3: // Colorbank 7-bit
 		case 4: // Colorbank 8-bit
-			SGX_TlutLoadCRAMImm(tlut_pos & 0x7F0, trn_code, GX_TLUT_256);
-			//Change address and size
-			SGX_SetTex(chr_addr, GX_TF_CI8, spr_w, spr_h, TLUT_INDX_IMM8);
-			SGX_SpriteConverterSet(spr_w >> 3, SPRITE_8BPP, cmd.CMDSRCA & 3);
-			return 0x7f7f7f00; break;
+			st->tlut_mode = VID_TLUT_CRAM;
+			st->tlut_pos = tlut_pos & 0x7F0;
+			st->tlut_trn = trn_code;
+			st->tlut_size = GX_TLUT_256;
+			st->tex = chr_addr;
+			st->fmt = GX_TF_CI8;
+			st->conv_bpp = SPRITE_8BPP;
+			return 0x7f7f7f00;
 		case 5: // RGB
-			SGX_TlutLoadCRAMImm(0, 0, GX_TLUT_16);	//XXX: prevents flickering... for now
-			SGX_SetTex(chr_addr, GX_TF_RGB5A3, spr_w, spr_h, 0);
-			SGX_SpriteConverterSet(spr_w >> 3, SPRITE_16BPP, cmd.CMDSRCA & 3);
-			return 0x7f7f7f00; break;
+			//XXX: prevents flickering... for now
+			st->tlut_mode = VID_TLUT_CRAM;
+			st->tlut_size = GX_TLUT_16;
+			st->tex = chr_addr;
+			st->fmt = GX_TF_RGB5A3;
+			st->conv_bpp = SPRITE_16BPP;
+			return 0x7f7f7f00;
 	}
 	return 0;	//Non textured
 }
 
-//HALF-DONE
-void VIDSoftVdp1NormalSpriteDraw()
+//Untextured state of the current command
+static void vid_KonstState(vid_vdp1state *st)
 {
-	s16 ax,ay,bx,by,cx,cy,dx,dy;
-	Vdp1ReadCommand(&cmd, Vdp1Regs->addr);
-	u32 spriteWidth = ((cmd.CMDSIZE & 0x3F00) >> 8);
-	u32 spriteHeight = (cmd.CMDSIZE & 0xFF);
-	if (!spriteWidth || !spriteHeight) {
+	st->textured = 0;
+	st->konst = cmd.CMDCOLR & 0x7FFF;
+}
+
+//Makes st the state of the next primitives, the GX state is only set when it
+//differs from the batch being built
+static void vid_SetState(const vid_vdp1state *st, u32 prim)
+{
+	if (!vdp1batch_SetState(prim, st->textured, st, sizeof(*st))) {
 		return;
 	}
 
-	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
+	GX_SetVtxDesc(GX_VA_TEX0, st->textured ? GX_DIRECT : GX_NONE);
 	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-	//THIS DEFINES THE SQUARE
-	ax = cmd.CMDXA;
-	ay = cmd.CMDYA;
-	cx = ax + (spriteWidth << 3);
-	cy = ay + spriteHeight;
-
-	//UNECESARY INFO?
-	bx = cx;
-	by = ay;
-	dx = ax;
-	dy = cy;
+	if (!st->textured) {
+		Tev_SetNonTexturedPart();
+		GXColor konst = {(st->konst & 0x1F) << 3, (st->konst & 0x3E0) >> 2, (st->konst & 0x7C00) >> 7, 0};
+		GX_SetTevKColor(GX_KCOLOR0, konst);
+		GX_SetTevKColorSel(GX_TEVSTAGE0, GX_TEV_KCSEL_K0);
+		//GX_TEV_KASEL_1 -> 0
+		//GX_TEV_KASEL_1_2 -> 4
+		GX_SetTevKAlphaSel(GX_TEVSTAGE0, st->kasel);
+		return;
+	}
 
 	Tev_SetTexturedPart();
-	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
-	u32 mesh = (cmd.CMDPMOD & 0x0100) >> 6;
-	//GX_TEV_KASEL_1 -> 0
-	//GX_TEV_KASEL_1_2 -> 4
-	//COLOR CALCULATION
-	GX_SetTevKAlphaSel(GX_TEVSTAGE0, mesh);
-
-	//Get Colors... XXX: this is unecesary since this is textured
-	u32 col[4];
-	col[3] = col[2] = col[1] = col[0] = modeToColor();
-	//XXX: has gouraud?
-	if (cmd.CMDPMOD & 0x4) {
-		getGouraudColors(col);
+	GX_SetTevKAlphaSel(GX_TEVSTAGE0, st->kasel);
+	if (!st->tex) {
+		return;
 	}
+	//Set priority
+	SGX_SetZOffset(st->zofs);
+	if (st->tlut_mode == VID_TLUT_CRAM) {
+		SGX_TlutLoadCRAMImm(st->tlut_pos, st->tlut_trn, st->tlut_size);
+	} else if (st->tlut_mode == VID_TLUT_LUT) {
+		//Upload palette
+		//XXX: palette uploading should be done once per frame (for color bank, the other will be done per sprite)
+		if (st->tlut_trn) {
+			u32 *pal = MEM_K0_TO_K1(Vdp1Ram + st->tlut_pos);
+			*pal &= 0xFFFFu;
+		}
+		GX_InitTlutObj(&tlut_obj, Vdp1Ram + st->tlut_pos, GX_TL_RGB5A3, 16);
+		GX_LoadTlut(&tlut_obj, TLUT_INDX_IMM4);
+	}
+	//Change address and size
+	u32 tlut = (st->fmt == GX_TF_CI4) ? TLUT_INDX_IMM4 : (st->fmt == GX_TF_CI8) ? TLUT_INDX_IMM8 : 0;
+	SGX_SetTex(st->tex, st->fmt, st->w, st->h, tlut);
+	SGX_SpriteConverterSet(st->conv_w, st->conv_bpp, st->conv_align);
+}
 
+//Queues the quad a, b, c, d of the current command with its texture
+//coordinates
+static void vid_AddSpriteQuad(const s16 *xy, const u32 *col)
+{
 	//Flip the sprite
-	//XXX: using s16 is inefficient, use the whole u32
 	u32 tex_flip = 0x0000;
 	u32 spr_size = cmd.CMDSIZE & 0x3FFF;
 	if (cmd.CMDCTRL & 0x10) {
@@ -2527,37 +2854,72 @@ void VIDSoftVdp1NormalSpriteDraw()
 		tex_flip |= 0x00FF;
 	}
 
-	GX_Begin(GX_QUADS, GX_VTXFMT2, 4);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(col[0]);
-		GX_TexCoord1u16(spr_size & (0x0000 ^ tex_flip));
-		GX_Position2s16(bx, by);
-		GX_Color1u32(col[1]);
-		GX_TexCoord1u16(spr_size & (0x3F00 ^ tex_flip));
-		GX_Position2s16(cx, cy);
-		GX_Color1u32(col[2]);
-		GX_TexCoord1u16(spr_size & (0x3FFF ^ tex_flip));
-		GX_Position2s16(dx, dy);
-		GX_Color1u32(col[3]);
-		GX_TexCoord1u16(spr_size & (0x00FF ^ tex_flip));
-	GX_End();
+	vdp1batch_vtx v[4] = {
+		{xy[0], xy[1], col[0], spr_size & (0x0000 ^ tex_flip)},
+		{xy[2], xy[3], col[1], spr_size & (0x3F00 ^ tex_flip)},
+		{xy[4], xy[5], col[2], spr_size & (0x3FFF ^ tex_flip)},
+		{xy[6], xy[7], col[3], spr_size & (0x00FF ^ tex_flip)}
+	};
+	vdp1batch_Add(v, 4);
+}
+
+//Fills the state of a sprite of the current command and queues its quad
+static void vid_DrawSprite(const s16 *xy)
+{
+	vid_vdp1state st;
+	memset(&st, 0, sizeof(st));
+	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
+	st.kasel = (cmd.CMDPMOD & 0x0100) >> 6;
+
+	//Get Colors... XXX: this is unecesary since this is textured
+	u32 col[4];
+	col[3] = col[2] = col[1] = col[0] = vid_TexState(&st);
+	//XXX: has gouraud?
+	if (cmd.CMDPMOD & 0x4) {
+		getGouraudColors(col);
+	}
+	vid_SetState(&st, GX_QUADS);
+	vid_AddSpriteQuad(xy, col);
+}
+
+//HALF-DONE
+void VIDSoftVdp1NormalSpriteDraw()
+{
+	s16 xy[8];
+	cmd = *vdp1_curcmd;
+	u32 spriteWidth = ((cmd.CMDSIZE & 0x3F00) >> 8);
+	u32 spriteHeight = (cmd.CMDSIZE & 0xFF);
+	if (!spriteWidth || !spriteHeight) {
+		return;
+	}
+
+	//THIS DEFINES THE SQUARE
+	xy[0] = cmd.CMDXA;
+	xy[1] = cmd.CMDYA;
+	xy[4] = xy[0] + (spriteWidth << 3);
+	xy[5] = xy[1] + spriteHeight;
+
+	//UNECESARY INFO?
+	xy[2] = xy[4];
+	xy[3] = xy[1];
+	xy[6] = xy[0];
+	xy[7] = xy[5];
+
+	vid_DrawSprite(xy);
 }
 
 //HALF-DONE
 void VIDSoftVdp1ScaledSpriteDraw()
 {
-	s32 ax,ay,bx,by,cx,cy,dx,dy;
+	s16 xy[8];
 	int x0,y0,x1,y1;
-	Vdp1ReadCommand(&cmd, Vdp1Regs->addr);
+	cmd = *vdp1_curcmd;
 	u32 spriteWidth = ((cmd.CMDSIZE & 0x3F00) >> 8);
 	u32 spriteHeight = (cmd.CMDSIZE & 0xFF);
 	if (!spriteWidth || !spriteHeight) {
 		return;
 	}
 
-	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
-	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-
 	x0 = cmd.CMDXA;
 	y0 = cmd.CMDYA;
 
@@ -2633,200 +2995,86 @@ void VIDSoftVdp1ScaledSpriteDraw()
 			break;
 	}
 
-	ax = x0;
-	ay = y0;
+	xy[0] = x0;
+	xy[1] = y0;
 
-	bx = x1 + x0;
-	by = ay;
+	xy[2] = x1 + x0;
+	xy[3] = y0;
 
-	cx = x1 + x0;
-	cy = y1 + y0;
+	xy[4] = x1 + x0;
+	xy[5] = y1 + y0;
 
-	dx = ax;
-	dy = y1 + y0;
-
-
-	Tev_SetTexturedPart();
-	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
-	u32 mesh = (cmd.CMDPMOD & 0x0100) >> 6;
-	//GX_TEV_KASEL_1 -> 0
-	//GX_TEV_KASEL_1_2 -> 4
-	//COLOR CALCULATION
-	GX_SetTevKAlphaSel(GX_TEVSTAGE0, mesh);
-
-	//Get Colors... XXX: this is unecesary since this is textured
-	u32 col[4];
-	col[3] = col[2] = col[1] = col[0] = modeToColor();
-	//XXX: has gouraud?
-	if (cmd.CMDPMOD & 0x4) {
-		getGouraudColors(col);
-	}
+	xy[6] = x0;
+	xy[7] = y1 + y0;
 
-	//Flip the sprite
-	//XXX: using s16 is inefficient, use the whole u32
-	u32 tex_flip = 0x0000;
-	u32 spr_size = cmd.CMDSIZE & 0x3FFF;
-	if (cmd.CMDCTRL & 0x10) {
-		tex_flip |= 0x3F00;
-	}
-	if (cmd.CMDCTRL & 0x20) {
-		tex_flip |= 0x00FF;
-	}
-
-	GX_Begin(GX_QUADS, GX_VTXFMT2, 4);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(col[0]);
-		GX_TexCoord1u16(spr_size & (0x0000 ^ tex_flip));
-		GX_Position2s16(bx, by);
-		GX_Color1u32(col[1]);
-		GX_TexCoord1u16(spr_size & (0x3F00 ^ tex_flip));
-		GX_Position2s16(cx, cy);
-		GX_Color1u32(col[2]);
-		GX_TexCoord1u16(spr_size & (0x3FFF ^ tex_flip));
-		GX_Position2s16(dx, dy);
-		GX_Color1u32(col[3]);
-		GX_TexCoord1u16(spr_size & (0x00FF ^ tex_flip));
-	GX_End();
+	vid_DrawSprite(xy);
 }
 
 //HALF-DONE
 void VIDSoftVdp1DistortedSpriteDraw()
 {
-	s16 ax, ay, bx, by, cx, cy, dx, dy;
-	Vdp1ReadCommand(&cmd, Vdp1Regs->addr);
+	s16 xy[8];
+	cmd = *vdp1_curcmd;
 	u32 spriteWidth = ((cmd.CMDSIZE & 0x3F00) >> 8);
 	u32 spriteHeight = (cmd.CMDSIZE & 0xFF);
 	if (!spriteWidth || !spriteHeight) {
 		return;
 	}
 	//XXX: modify the points to fill leftsize pixels
-    ax = cmd.CMDXA;
-    ay = cmd.CMDYA;
-    bx = cmd.CMDXB;
-    by = cmd.CMDYB;
-    cx = cmd.CMDXC;
-    cy = cmd.CMDYC;
-    dx = cmd.CMDXD;
-    dy = cmd.CMDYD;
-
-	GX_SetVtxDesc(GX_VA_TEX0, GX_DIRECT);
-	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-
-	u32 col[4] = {0};
-	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
-	u32 alpha = (cmd.CMDPMOD & 0x0100) >> 6;
-	//GX_TEV_KASEL_1 -> 0
-	//GX_TEV_KASEL_1_2 -> 4
-	//COLOR CALCULATION
-
-	//Get Colors... XXX: this is unecesary since this is textured
-	if (cmd.CMDCTRL & 0x4) {
-		//XXX: use konst colors
-		Tev_SetNonTexturedPart();
-		u32 msb = (cmd.CMDCOLR >> 15);
-		if (msb) {
-			GX_SetTevKAlphaSel(GX_TEVSTAGE0, alpha);
-		} else {
-			//XXX: Get colorbank value
-			GX_SetTevKAlphaSel(GX_TEVSTAGE0, GX_TEV_KASEL_K0_A);
-		}
-
-		GXColor konst = {(cmd.CMDCOLR & 0x1F) << 3, (cmd.CMDCOLR & 0x3E0) >> 2, (cmd.CMDCOLR & 0x7C00) >> 7, 0};
-		GX_SetTevKColor(GX_KCOLOR0, konst);
-		GX_SetTevKAlphaSel(GX_TEVSTAGE0, alpha);
-		GX_SetTevKColorSel(GX_TEVSTAGE0, GX_TEV_KCSEL_K0);
-	} else {
-		Tev_SetTexturedPart();
-		GX_SetTevKAlphaSel(GX_TEVSTAGE0, alpha);
-		col[3] = col[2] = col[1] = col[0] = modeToColor();
+	xy[0] = cmd.CMDXA;
+	xy[1] = cmd.CMDYA;
+	xy[2] = cmd.CMDXB;
+	xy[3] = cmd.CMDYB;
+	xy[4] = cmd.CMDXC;
+	xy[5] = cmd.CMDYC;
+	xy[6] = cmd.CMDXD;
+	xy[7] = cmd.CMDYD;
+
+	if (!(cmd.CMDCTRL & 0x4)) {
+		vid_DrawSprite(xy);
+		return;
 	}
 
-
+	//XXX: use konst colors
+	vid_vdp1state st;
+	memset(&st, 0, sizeof(st));
+	st.kasel = (cmd.CMDPMOD & 0x0100) >> 6;
+	vid_KonstState(&st);
+	u32 col[4] = {0};
 	//XXX: has gouraud?
 	if (cmd.CMDPMOD & 0x4) {
 		getGouraudColors(col);
 	}
-
-	//Flip the sprite
-	//XXX: using s16 is inefficient, use the whole u32
-	u32 tex_flip = 0x0000;
-	u32 spr_size = cmd.CMDSIZE & 0x3FFF;
-	if (cmd.CMDCTRL & 0x10) {
-		tex_flip |= 0x3F00;
-	}
-	if (cmd.CMDCTRL & 0x20) {
-		tex_flip |= 0x00FF;
-	}
-
-	GX_Begin(GX_QUADS, GX_VTXFMT2, 4);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(col[0]);
-		GX_TexCoord1u16(spr_size & (0x0000 ^ tex_flip));
-		GX_Position2s16(bx, by);
-		GX_Color1u32(col[1]);
-		GX_TexCoord1u16(spr_size & (0x3F00 ^ tex_flip));
-		GX_Position2s16(cx, cy);
-		GX_Color1u32(col[2]);
-		GX_TexCoord1u16(spr_size & (0x3FFF ^ tex_flip));
-		GX_Position2s16(dx, dy);
-		GX_Color1u32(col[3]);
-		GX_TexCoord1u16(spr_size & (0x00FF ^ tex_flip));
-	GX_End();
+	vid_SetState(&st, GX_QUADS);
+	vid_AddSpriteQuad(xy, col);
 }
 
 void vid_Vdp1PolygonDraw()
 {
-	s16 ax, ay, bx, by, cx, cy, dx, dy;
-	Vdp1ReadCommand(&cmd, Vdp1Regs->addr);
-
-	//XXX: modify the points to fill leftsize pixels
-    ax = cmd.CMDXA;
-    ay = cmd.CMDYA;
-    bx = cmd.CMDXB;
-    by = cmd.CMDYB;
-    cx = cmd.CMDXC;
-    cy = cmd.CMDYC;
-    dx = cmd.CMDXD;
-    dy = cmd.CMDYD;
-
-	GX_SetVtxDesc(GX_VA_TEX0, GX_NONE);
-	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
+	cmd = *vdp1_curcmd;
 
 	u32 col[4] = {0};
+	vid_vdp1state st;
+	memset(&st, 0, sizeof(st));
 	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
-	u32 alpha = (cmd.CMDPMOD & 0x0100) >> 6;
-
-	Tev_SetNonTexturedPart();
-	u32 msb = (cmd.CMDCOLR >> 15);
-	if (msb) {
-		GX_SetTevKAlphaSel(GX_TEVSTAGE0, alpha);
-	} else {
-		//XXX: Get colorbank value
-		GX_SetTevKAlphaSel(GX_TEVSTAGE0, GX_TEV_KASEL_K0_A);
-	}
-
-	GXColor konst = {(cmd.CMDCOLR & 0x1F) << 3, (cmd.CMDCOLR & 0x3E0) >> 2, (cmd.CMDCOLR & 0x7C00) >> 7, 0};
-	GX_SetTevKColor(GX_KCOLOR0, konst);
-	GX_SetTevKAlphaSel(GX_TEVSTAGE0, alpha);
-	GX_SetTevKColorSel(GX_TEVSTAGE0, GX_TEV_KCSEL_K0);
+	//XXX: Get colorbank value when the MSB is clear
+	st.kasel = (cmd.CMDPMOD & 0x0100) >> 6;
+	vid_KonstState(&st);
 
 	//XXX: has gouraud?
 	if (cmd.CMDPMOD & 0x4) {
 		getGouraudColors(col);
 	}
 
-	//Send command
-	GX_Begin(GX_QUADS, GX_VTXFMT2, 4);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(col[0]);
-		GX_Position2s16(bx, by);
-		GX_Color1u32(col[1]);
-		GX_Position2s16(cx, cy);
-		GX_Color1u32(col[2]);
-		GX_Position2s16(dx, dy);
-		GX_Color1u32(col[3]);
-	GX_End();
-
+	//XXX: modify the points to fill leftsize pixels
+	vdp1batch_vtx v[4] = {
+		{cmd.CMDXA, cmd.CMDYA, col[0], 0},
+		{cmd.CMDXB, cmd.CMDYB, col[1], 0},
+		{cmd.CMDXC, cmd.CMDYC, col[2], 0},
+		{cmd.CMDXD, cmd.CMDYD, col[3], 0}
+	};
+	vid_SetState(&st, GX_QUADS);
+	vdp1batch_Add(v, 4);
 }
 
 
@@ -2835,80 +3083,42 @@ void vid_Vdp1PolygonDraw()
 //HALF-DONE
 void VIDSoftVdp1PolylineDraw(void)
 {
-	s16 ax, ay, bx, by, cx, cy, dx, dy;
-
-	Vdp1ReadCommand(&cmd, Vdp1Regs->addr);
-
-    ax = cmd.CMDXA;
-    ay = cmd.CMDYA;
-    bx = cmd.CMDXB;
-    by = cmd.CMDYB;
-    cx = cmd.CMDXC;
-    cy = cmd.CMDYC;
-    dx = cmd.CMDXD;
-    dy = cmd.CMDYD;
-
-	GX_SetVtxDesc(GX_VA_TEX0, GX_NONE);
-	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-
-	Tev_SetNonTexturedPart();
-	GXColor konst = {(cmd.CMDCOLR & 0x1F) << 3, (cmd.CMDCOLR & 0x3E0) >> 2, (cmd.CMDCOLR & 0x7C00) >> 7, 0};
-	GX_SetTevKColor(GX_KCOLOR0, konst);
-	GX_SetTevKColorSel(GX_TEVSTAGE0, GX_TEV_KCSEL_K0);
+	cmd = *vdp1_curcmd;
 
+	vid_vdp1state st;
+	memset(&st, 0, sizeof(st));
 	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
-	u32 mesh = (cmd.CMDPMOD & 0x0100) >> 6;
-	//GX_TEV_KASEL_1 -> 0
-	//GX_TEV_KASEL_1_2 -> 4
-	//COLOR CALCULATION
-	GX_SetTevKAlphaSel(GX_TEVSTAGE0, mesh);
-
-	GX_Begin(GX_LINESTRIP, GX_VTXFMT2, 5);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(0);
-		GX_Position2s16(bx, by);
-		GX_Color1u32(0);
-		GX_Position2s16(cx, cy);
-		GX_Color1u32(0);
-		GX_Position2s16(dx, dy);
-		GX_Color1u32(0);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(0);
-	GX_End();
+	st.kasel = (cmd.CMDPMOD & 0x0100) >> 6;
+	vid_KonstState(&st);
+
+	//The strip goes as separate lines so polylines batch with lines
+	vdp1batch_vtx v[8] = {
+		{cmd.CMDXA, cmd.CMDYA, 0, 0}, {cmd.CMDXB, cmd.CMDYB, 0, 0},
+		{cmd.CMDXB, cmd.CMDYB, 0, 0}, {cmd.CMDXC, cmd.CMDYC, 0, 0},
+		{cmd.CMDXC, cmd.CMDYC, 0, 0}, {cmd.CMDXD, cmd.CMDYD, 0, 0},
+		{cmd.CMDXD, cmd.CMDYD, 0, 0}, {cmd.CMDXA, cmd.CMDYA, 0, 0}
+	};
+	vid_SetState(&st, GX_LINES);
+	vdp1batch_Add(v, 8);
 }
 
 //HALF-DONE
 void VIDSoftVdp1LineDraw(void)
 {
-	s16 ax, ay, bx, by;
-	Vdp1ReadCommand(&cmd, Vdp1Regs->addr);
-
-    ax = cmd.CMDXA;
-    ay = cmd.CMDYA;
-    bx = cmd.CMDXB;
-    by = cmd.CMDYB;
-
-	GX_SetVtxDesc(GX_VA_TEX0, GX_NONE);
-	GX_SetVtxDesc(GX_VA_CLR0, GX_DIRECT);
-
-	Tev_SetNonTexturedPart();
-	GXColor konst = {(cmd.CMDCOLR & 0x1F) << 3, (cmd.CMDCOLR & 0x3E0) >> 2, (cmd.CMDCOLR & 0x7C00) >> 7, 0};
-	GX_SetTevKColor(GX_KCOLOR0, konst);
-	GX_SetTevKColorSel(GX_TEVSTAGE0, GX_TEV_KCSEL_K0);
+	cmd = *vdp1_curcmd;
 
+	vid_vdp1state st;
+	memset(&st, 0, sizeof(st));
 	//XXX: Combine these effects for half transaprency (Half luminence/transparency/shadow)
-	u32 mesh = (cmd.CMDPMOD & 0x0100) >> 6;
-	//GX_TEV_KASEL_1 -> 0
-	//GX_TEV_KASEL_1_2 -> 4
-	//COLOR CALCULATION
-	GX_SetTevKAlphaSel(GX_TEVSTAGE0, mesh);
-
-	GX_Begin(GX_LINES, GX_VTXFMT2, 2);
-		GX_Position2s16(ax, ay);
-		GX_Color1u32(0);
-		GX_Position2s16(bx, by);
-		GX_Color1u32(0);
-	GX_End();
+	st.kasel = (cmd.CMDPMOD & 0x0100) >> 6;
+	vid_KonstState(&st);
+
+	vdp1batch_vtx v[2] = {
+		{cmd.CMDXA, cmd.CMDYA, 0, 0},
+		{cmd.CMDXB, cmd.CMDYB, 0, 0}
+	};
+	vid_SetState(&st, GX_LINES);
+	vdp1batch_Add(v, 2);
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -2916,10 +3126,10 @@ void VIDSoftVdp1LineDraw(void)
 //HALF-DONE
 void VIDSoftVdp1UserClipping(void)
 {
-   Vdp1Regs->userclipX1 = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0xC);
-   Vdp1Regs->userclipY1 = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0xE);
-   Vdp1Regs->userclipX2 = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0x14);
-   Vdp1Regs->userclipY2 = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0x16);
+   Vdp1Regs->userclipX1 = vdp1_curcmd->CMDXA;
+   Vdp1Regs->userclipY1 = vdp1_curcmd->CMDYA;
+   Vdp1Regs->userclipX2 = vdp1_curcmd->CMDXC;
+   Vdp1Regs->userclipY2 = vdp1_curcmd->CMDYC;
 }
 
 
@@ -2928,11 +3138,12 @@ void VIDSoftVdp1UserClipping(void)
 //HALF-DONE
 void VIDSoftVdp1SystemClipping(void)
 {
-	u32 sysclip_x = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0x14);
-	u32 sysclip_y = T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0x16);
+	u32 sysclip_x = (u16) vdp1_curcmd->CMDXC;
+	u32 sysclip_y = (u16) vdp1_curcmd->CMDYC;
 	//XXX: limit to screen
 	sysclip_x = (sysclip_x > vdp2width ? sysclip_x : vdp2width);
 	sysclip_y = (sysclip_y > vdp2height ? sysclip_y : vdp2height);
+	vdp1batch_Flush();
 	GX_SetScissor(0, 0, sysclip_x, sysclip_y);
 }
 
@@ -2941,8 +3152,9 @@ void VIDSoftVdp1SystemClipping(void)
 //HALF-DONE
 void VIDSoftVdp1LocalCoordinate(void)
 {
-	mat[GXMTX_VDP1][0][3] = (f32) ((s16) T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0xC));
-	mat[GXMTX_VDP1][1][3] = (f32) ((s16) T1ReadWord(Vdp1Ram, Vdp1Regs->addr + 0xE));
+	vdp1batch_Flush();
+	mat[GXMTX_VDP1][0][3] = (f32) vdp1_curcmd->CMDXA;
+	mat[GXMTX_VDP1][1][3] = (f32) vdp1_curcmd->CMDYA;
 	//DCStoreRange(mat, 0x20);
 	//GX_LoadPosMtxIdx(0, GX_PNMTX0);
 	//mat[GXMTX_VDP1][2][3] = (f32) (pritority);
@@ -2956,7 +3168,8 @@ void VIDSoftVdp1LocalCoordinate(void)
 //DONE??
 int VIDSoftVdp2Reset(void)
 {
-   return 0;
+	vdp2list_Invalidate();
+	return 0;
 }
 
 
@@ -3060,6 +3273,7 @@ void VIDSoftVdp2DrawEnd(void)
 //HALF-DONE
 void VIDSoftVdp2DrawScreens(void)
 {
+	vdp2list_BeginFrame();
 	//Set up Tev stages and everything we need
 	GX_ClearVtxDesc();
 	GX_SetVtxDesc(GX_VA_POS,  GX_DIRECT);
@@ -30,7 +30,16 @@
 #endif
 
 extern u32 *dispbuffer;
-extern u32 tex_dirty[0x200];
+
+//Running totals of the VDP1 texture cache
+typedef struct {
+	u32 hits;
+	u32 misses;			//Textures seen for the first time
+	u32 stale;			//Converted again after their VRAM pages were written
+	u32 evicted;
+	u32 failed;			//Drawn from VDP1 RAM for lack of room
+	u32 converted;		//Bytes written to wii_vram
+} vdp1_texcache_stats;
 
 int VIDSoftInit(void);
 void VIDSoftDeInit(void);
@@ -57,6 +66,9 @@ void VIDSoftVdp1EraseFrameBuffer(void);
 
 
 void VidSoftTexConvert(u32 ram_addr);
+//Draws the sprite window into its texture, before the sprites
+void gfx_WindowTextureGen(void);
+void VIDSoftGetTexCacheStats(vdp1_texcache_stats *stats);
 
 void vid_Vdp1PolygonDraw(void);
 //external use
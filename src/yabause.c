@@ -41,6 +41,7 @@
 #include "vidsoft.h"
 #include "yui.h"
 #include "bios.h"
+#include "pace.h"
 
 
 #ifdef HAVE_LIBSDL
@@ -268,6 +269,9 @@ int	YabauseInit(yabauseinit_struct *init)
       return -1;
    }
 
+   //VDP2 RAM only exists now, map it directly
+   mem_PageInit();
+
    if (SmpcInit(init->regionid, init->clocksync, init->basetime) != 0)
    {
       YabSetError(YAB_ERR_CANNOTINIT, "SMPC");
@@ -293,13 +297,6 @@ int	YabauseInit(yabauseinit_struct *init)
 
    yabsys.usequickload = 0;
 
-   #if defined(SH2_DYNAREC)
-   if(SH2Core->id==2) {
-     sh2_dynarec_init();
-   }
-   #endif
-
-
    YabauseResetNoLoad();
 
    if (yabsys.usequickload || yabsys.emulatebios)
@@ -350,6 +347,7 @@ void YabauseResetNoLoad(void) {
 
    YabauseStopSlave();
    memset(wram, 0, 0x200000);
+   memset(wram_dirty, VRAM_DIRTY_ALL, sizeof(wram_dirty));
 
    // Reset CS0 area here
    // Reset CS1 area here
@@ -483,17 +481,7 @@ int YabauseEmulate(void) {
 	framecounter++;
 	LagFrameFlag = 1;
 
-   #if defined(SH2_DYNAREC)
-   if(SH2Core->id==2) {
-     if (yabsys.IsPal)
-       YabauseDynarecOneFrameExec(722,0); // m68kcycles,m68kcenticycles
-     else
-       YabauseDynarecOneFrameExec(716,20);
-     return 0;
-   }
-   #endif
-	char str[128] = {0};
-	u64 prof_cycles[8] = {0};
+	u64 prof_cycles[OSD_CYCLES_NUM] = {0};
 	u64 cycles_start;
 	while (!oneframeexec) {
       PROFILE_START("Total Emulation");
@@ -510,16 +498,16 @@ int YabauseEmulate(void) {
          cycles_start = gettime();
          SH2Exec(MSH2, sh2cycles);
          PROFILE_STOP("MSH2");
-         prof_cycles[0] += gettime() - cycles_start;
-		 osd_CyclesSet(0, prof_cycles[0]);
+         prof_cycles[OSD_CYCLES_MSH2] += gettime() - cycles_start;
+		 osd_CyclesSet(OSD_CYCLES_MSH2, prof_cycles[OSD_CYCLES_MSH2]);
 
          PROFILE_START("SSH2");
          cycles_start = gettime();
          if (yabsys.IsSSH2Running)
             SH2Exec(SSH2, sh2cycles);
          PROFILE_STOP("SSH2");
-         prof_cycles[1] += gettime() - cycles_start;
-		 osd_CyclesSet(1, prof_cycles[1]);
+         prof_cycles[OSD_CYCLES_SSH2] += gettime() - cycles_start;
+		 osd_CyclesSet(OSD_CYCLES_SSH2, prof_cycles[OSD_CYCLES_SSH2]);
 
 #ifndef SCSP_PLUGIN
 #ifdef USE_SCSP2
@@ -531,8 +519,11 @@ int YabauseEmulate(void) {
          if(SCSCore->id == SCSCORE_SCSP2)
          {
             PROFILE_START("SCSP");
+            cycles_start = gettime();
             SCSCore->Exec(1);
             PROFILE_STOP("SCSP");
+            prof_cycles[OSD_CYCLES_SCSP] += gettime() - cycles_start;
+            osd_CyclesSet(OSD_CYCLES_SCSP, prof_cycles[OSD_CYCLES_SCSP]);
          }
 #endif
 
@@ -553,8 +544,8 @@ int YabauseEmulate(void) {
          cycles_start = gettime();
          ScuExec(sh2cycles / 2);
          PROFILE_STOP("SCU");
-         prof_cycles[2] += gettime() - cycles_start;
-		 osd_CyclesSet(2, prof_cycles[2]);
+         prof_cycles[OSD_CYCLES_SCU] += gettime() - cycles_start;
+		 osd_CyclesSet(OSD_CYCLES_SCU, prof_cycles[OSD_CYCLES_SCU]);
 
       }
 
@@ -611,7 +602,10 @@ int YabauseEmulate(void) {
          {
             // VBlankOUT
             PROFILE_START("VDP1/VDP2");
+            cycles_start = gettime();
             Vdp2VBlankOUT();
+            prof_cycles[OSD_CYCLES_VDP] += gettime() - cycles_start;
+            osd_CyclesSet(OSD_CYCLES_VDP, prof_cycles[OSD_CYCLES_VDP]);
             yabsys.LineCount = 0;
             oneframeexec = 1;
             PROFILE_STOP("VDP1/VDP2");
@@ -623,15 +617,15 @@ int YabauseEmulate(void) {
       cycles_start = gettime();
       SmpcExec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
       PROFILE_STOP("SMPC");
-      prof_cycles[3] += gettime() - cycles_start;
-		osd_CyclesSet(2, prof_cycles[3]);
+      prof_cycles[OSD_CYCLES_SMPC] += gettime() - cycles_start;
+		osd_CyclesSet(OSD_CYCLES_SMPC, prof_cycles[OSD_CYCLES_SMPC]);
 
       PROFILE_START("CDB");
       cycles_start = gettime();
       Cs2Exec(yabsys.UsecFrac >> YABSYS_TIMING_BITS);
       PROFILE_STOP("CDB");
-      prof_cycles[4] += gettime() - cycles_start;
-	  osd_CyclesSet(2, prof_cycles[4]);
+      prof_cycles[OSD_CYCLES_CDB] += gettime() - cycles_start;
+	  osd_CyclesSet(OSD_CYCLES_CDB, prof_cycles[OSD_CYCLES_CDB]);
       yabsys.UsecFrac &= YABSYS_TIMING_MASK;
 
 #ifndef SCSP_PLUGIN
@@ -728,6 +722,7 @@ void YabauseSetVideoFormat(int type) {
    ScspChangeVideoFormat(type);
    YabauseChangeTiming(yabsys.CurSH2FreqType);
    lastticks = YabauseGetTicks();
+   pace_Reset();
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -884,7 +879,7 @@ int YabauseQuickLoadGame(void)
       return -1;
 
    // Make sure we're dealing with a saturn game
-   buffer = lgpartition->block[lgpartition->numblocks - 1]->data;
+   buffer = Cs2PartitionBlock(lgpartition, lgpartition->numblocks - 1)->data;
 
    YabauseSpeedySetup();
 
@@ -908,9 +903,7 @@ int YabauseQuickLoadGame(void)
 
       // Free Block
       lgpartition->size = 0;
-      Cs2FreeBlock(lgpartition->block[lgpartition->numblocks - 1]);
-      lgpartition->blocknum[lgpartition->numblocks - 1] = 0xFF;
-      lgpartition->numblocks = 0;
+      Cs2PartitionDelete(lgpartition, 0, lgpartition->numblocks);
 
       // Copy over ip to 0x06002000
       for (i = 0; i < blocks; i++)
@@ -918,7 +911,7 @@ int YabauseQuickLoadGame(void)
          if ((lgpartition = Cs2ReadUnFilteredSector(150+i)) == NULL)
             return -1;
 
-         buffer = lgpartition->block[lgpartition->numblocks - 1]->data;
+         buffer = Cs2PartitionBlock(lgpartition, lgpartition->numblocks - 1)->data;
 
          if (size >= 2048)
          {
@@ -935,9 +928,7 @@ int YabauseQuickLoadGame(void)
 
          // Free Block
          lgpartition->size = 0;
-         Cs2FreeBlock(lgpartition->block[lgpartition->numblocks - 1]);
-         lgpartition->blocknum[lgpartition->numblocks - 1] = 0xFF;
-         lgpartition->numblocks = 0;
+         Cs2PartitionDelete(lgpartition, 0, lgpartition->numblocks);
       }
 
       SH2WriteNotify(0x6002000, blocks<<11);
@@ -952,19 +943,17 @@ int YabauseQuickLoadGame(void)
       // Figure out root directory's location
 
       // Retrieve directory record's lba
-      Cs2CopyDirRecord(lgpartition->block[lgpartition->numblocks - 1]->data + 0x9C, &dirrec);
+      Cs2CopyDirRecord(Cs2PartitionBlock(lgpartition, lgpartition->numblocks - 1)->data + 0x9C, &dirrec);
 
       // Free Block
       lgpartition->size = 0;
-      Cs2FreeBlock(lgpartition->block[lgpartition->numblocks - 1]);
-      lgpartition->blocknum[lgpartition->numblocks - 1] = 0xFF;
-      lgpartition->numblocks = 0;
+      Cs2PartitionDelete(lgpartition, 0, lgpartition->numblocks);
 
       // Now then, fetch the root directory's records
       if ((lgpartition = Cs2ReadUnFilteredSector(dirrec.lba+150)) == NULL)
          return -1;
 
-      buffer = lgpartition->block[lgpartition->numblocks - 1]->data;
+      buffer = Cs2PartitionBlock(lgpartition, lgpartition->numblocks - 1)->data;
 
       // Skip the first two records, read in the last one
       for (i = 0; i < 3; i++)
@@ -980,9 +969,7 @@ int YabauseQuickLoadGame(void)
 
       // Free Block
       lgpartition->size = 0;
-      Cs2FreeBlock(lgpartition->block[lgpartition->numblocks - 1]);
-      lgpartition->blocknum[lgpartition->numblocks - 1] = 0xFF;
-      lgpartition->numblocks = 0;
+      Cs2PartitionDelete(lgpartition, 0, lgpartition->numblocks);
 
       // Copy over First Program to addr
       for (i = 0; i < blocks; i++)
@@ -990,7 +977,7 @@ int YabauseQuickLoadGame(void)
          if ((lgpartition = Cs2ReadUnFilteredSector(150+dirrec.lba+i)) == NULL)
             return -1;
 
-         buffer = lgpartition->block[lgpartition->numblocks - 1]->data;
+         buffer = Cs2PartitionBlock(lgpartition, lgpartition->numblocks - 1)->data;
 
          if (size >= 2048)
          {
@@ -1007,9 +994,7 @@ int YabauseQuickLoadGame(void)
 
          // Free Block
          lgpartition->size = 0;
-         Cs2FreeBlock(lgpartition->block[lgpartition->numblocks - 1]);
-         lgpartition->blocknum[lgpartition->numblocks - 1] = 0xFF;
-         lgpartition->numblocks = 0;
+         Cs2PartitionDelete(lgpartition, 0, lgpartition->numblocks);
       }
 
       SH2WriteNotify(addr, blocks<<11);
@@ -1025,9 +1010,7 @@ int YabauseQuickLoadGame(void)
 
       // Free Block
       lgpartition->size = 0;
-      Cs2FreeBlock(lgpartition->block[lgpartition->numblocks - 1]);
-      lgpartition->blocknum[lgpartition->numblocks - 1] = 0xFF;
-      lgpartition->numblocks = 0;
+      Cs2PartitionDelete(lgpartition, 0, lgpartition->numblocks);
 
       return -1;
    }
@@ -104,6 +104,7 @@ extern int lagframecounter;
 extern int LagFrameFlag;
 extern int framelength;
 extern int framecounter;
+extern int saved_centicycles;
 
 int YabauseEmulate(void);
 
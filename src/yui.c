@@ -42,6 +42,7 @@
 #include "vdp2.h"
 #include "yui.h"
 #include "memory.h"
+#include "pace.h"
 
 extern u8 num_button_WII[9];
 extern u8 num_button_CLA[9];
@@ -89,6 +90,10 @@ char Exit_Dol_File[1024];
 SH2Interface_struct *SH2CoreList[] = {
 &SH2Interpreter,
 &SH2DebugInterpreter,
+&SH2BlockInterpreter,
+#ifdef SH2_DYNAREC
+&SH2Dynarec,
+#endif
 NULL
 };
 
@@ -150,7 +155,7 @@ int CartSet();
 int CartSetExec();
 int BiosWith();
 int BiosOnlySet();
-int FrameskipOff();
+int CdSpeedSet();
 
 void TexCopy_LoRes(u32 w, u32 h);
 
@@ -159,6 +164,7 @@ static s32 selected = 0, start = 0;
 static s32 selectedcart = 7;
 static int bioswith = 0;
 static int frameskipoff = 0;
+static u32 cdspeed = CS2_SPEED_REAL;
 int specialcoloron = 1;
 int eachbackupramon = 1;
 int threadingscsp2on = 1;
@@ -369,6 +375,9 @@ void menu_Handle(void)
 		YuiExec();
 		//iso_loaded = 1;
 	}
+	else if (buttons & PAD_BUTTON_Y) {
+		CdSpeedSet();
+	}
 	else if (buttons & PAD_BUTTON_B) {
 		//XXX: ask to quit?
 		mem_Deinit();
@@ -483,6 +492,64 @@ void InitGX(void )
 
 
 
+//Shows the CD speed in the menu's bottom strip
+static void settings_ShowCdSpeed(void)
+{
+	char str[40];
+	if (cdspeed == CS2_SPEED_DRAIN) {
+		strcpy(str, "CD speed: max  (Y to change)");
+	} else {
+		sprintf(str, "CD speed: %ux  (Y to change)", cdspeed);
+	}
+	gui_SetStatus(str);
+}
+
+//Reads the settings file, unknown keys and bad values keep their defaults
+static void settings_Load(void)
+{
+	char line[64];
+	u32 val;
+	FILE *fp = fopen(settingpath, "r");
+	if (!fp) {
+		return;
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "cdspeed %u", &val) == 1 &&
+			(val == CS2_SPEED_DRAIN || (val <= CS2_SPEED_MAX && !(val & (val - 1))))) {
+			cdspeed = val;
+		}
+	}
+	fclose(fp);
+}
+
+static void settings_Save(void)
+{
+	FILE *fp = fopen(settingpath, "w");
+	if (!fp) {
+		return;
+	}
+	fprintf(fp, "cdspeed %u\n", cdspeed);
+	fclose(fp);
+}
+
+//Steps the CD drive through 1x (real), 2x, 4x, 8x, 16x and as fast as the
+//buffer drains, saved to the settings file for the next start
+int CdSpeedSet()
+{
+	if (cdspeed == CS2_SPEED_DRAIN) {
+		cdspeed = CS2_SPEED_REAL;
+	} else if (cdspeed >= CS2_SPEED_MAX) {
+		cdspeed = CS2_SPEED_DRAIN;
+	} else {
+		cdspeed <<= 1;
+	}
+	Cs2SetFastLoad(cdspeed);
+	settings_ShowCdSpeed();
+	settings_Save();
+	return 0;
+}
+
+
 int ResetSettings(void)
 {
    bioswith = 0;
@@ -493,6 +560,7 @@ int ResetSettings(void)
    scspdriverselect = 2;
    //selected;
    frameskipoff = 0;
+   cdspeed = CS2_SPEED_REAL;
    specialcoloron = 1;
    smpcperipheraltiming = 1000;
    smpcothertiming = 1050;
@@ -561,6 +629,7 @@ int main(int argc, char **argv)
 	sprintf(biospath, "%s%s", device_path, "apps/SetaGX/bios.bin");
 	sprintf(games_dir, "%s%s", device_path, "vgames/Saturn");
 	sprintf(saves_dir, "%s%s", device_path, "saves/Saturn");
+	sprintf(settingpath, "%s%s", device_path, "apps/SetaGX/settings.cfg");
 
 	bioswith = 1;			//bioswith
 	selectedcart = 7;		//cartridge
@@ -571,6 +640,7 @@ int main(int argc, char **argv)
 	selected = 0;			//fileselected
 	if(selected >= FILES_PER_PAGE) start = selected - FILES_PER_PAGE + 1;
 	frameskipoff = 1;	//frameskipoff
+	cdspeed = CS2_SPEED_REAL;	//cdspeed
 	specialcoloron = 1;	//specialcoloron
 	smpcperipheraltiming = 1000; //smpcperipheraltiming
 	smpcothertiming = 1050; //smpcothertiming
@@ -578,6 +648,7 @@ int main(int argc, char **argv)
 	declinenum = 10; //declinenum //STANDARD
 	dividenumclock = 1; //dividenumclock
 	threadingscsp2on = 0; //threadingscsp2on	//No threading
+	settings_Load();
 
 	VIDEO_Init();
 	rmode = VIDEO_GetPreferredMode(NULL);
@@ -609,6 +680,7 @@ int main(int argc, char **argv)
 	snd_Init();
 	menu_Init();
 	games_LoadList();
+	settings_ShowCdSpeed();
 
 	GX_InitTexObj(&tex_lores_fb, display_fb, disp.w, disp.h, GX_TF_RGBA8, GX_CLAMP, GX_CLAMP, GX_FALSE);
 	GX_InitTexObjLOD(&tex_lores_fb, GX_NEAR, GX_NEAR, 0, 0, 0, GX_DISABLE, GX_DISABLE, GX_ANISO_1);
@@ -711,10 +783,15 @@ int YuiExec()
 	// Hijack the fps display
 	//VIDSoft.OnScreenDebugMessage = OnScreenDebugMessage;
 	done = 0;
+	Cs2SetFastLoad(cdspeed);
 	if ((ret = YabauseInit(&yinit)) == 0)
 	{
 		ScspSetFrameAccurate(1);
 		YabauseSetDecilineMode(1);
+		//PACE_AUDIO has only run against the host's modelled audio queue
+		//(setagx-bench -p 1), not the AESND voice yet
+		pace_SetMode(PACE_VSYNC);
+		pace_SetFrameskip(!frameskipoff);
 
 
       while(!done)
@@ -728,6 +805,11 @@ int YuiExec()
 				char msg[128] = {0};
 				sprintf(msg, "MEM1 used: %d, available: %d", 0x01800000 - SYS_GetArena1Size(), SYS_GetArena1Size());
 				osd_MsgAdd(20, 28, 0xFFFFFFFF, msg);
+				vdp1_texcache_stats texc;
+				VIDSoftGetTexCacheStats(&texc);
+				sprintf(msg, "VDP1 textures: %u hits, %u new, %u stale, %u evicted, %u failed",
+					texc.hits, texc.misses, texc.stale, texc.evicted, texc.failed);
+				osd_MsgAdd(20, 36, 0xFFFFFFFF, msg);
 				result = YabauseExec();
 			}
 		//XXX: recover memory used...